@@ -0,0 +1,286 @@
+// Build a catalog of the events in a set of raw DAQ files, or query an
+// existing catalog.
+//
+//   capt-catalog [-j threads] [-k MB] -o raw.cat <file-or-directory> ...
+//   capt-catalog -q run=2011,event=10-20 raw.cat
+//
+// The ubdaq files (".ubdaq" and ".ubdaq.gz") are scanned in parallel using
+// only the event record headers.  The PDS files (".root") are scanned in
+// the main thread while the workers run, and only the event number and
+// time branches are read.  An inflate checkpoint is saved every 64 MB (or
+// -k MB) of each compressed ubdaq file, so that a selected event can be
+// read without decompressing the file from the start.  Each checkpoint
+// adds up to 32 kB to the catalog.  The catalog can then be used to
+// convert selected events with the "catalog:" input (see TCatalogInput).
+#include <TRawCatalog.hxx>
+#include <TUBDAQInput.hxx>
+#include <TmPDSInput.hxx>
+
+#include <TCaptLog.hxx>
+#include <TEventContext.hxx>
+
+#include <TROOT.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <cstdlib>
+#include <climits>
+
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace {
+    /// A raw file to be scanned, and the entries found in it.
+    struct ScanFile {
+        std::string Name;
+        CP::TRawCatalog::FileType Type;
+        std::vector<CP::TRawCatalog::Entry> Entries;
+        std::vector<CP::TInflateStreamBuf::Checkpoint> Checkpoints;
+        std::string Error;
+    };
+
+    bool endsWith(const std::string& name, const std::string& suffix) {
+        if (name.size() < suffix.size()) return false;
+        return name.compare(name.size()-suffix.size(),
+                            suffix.size(), suffix) == 0;
+    }
+
+    /// Add a file, or the files in a directory tree, to the scan list.
+    void findFiles(const std::string& path, std::vector<ScanFile>& files) {
+        struct stat status;
+        if (stat(path.c_str(),&status) != 0) {
+            CaptError("Cannot find " << path);
+            return;
+        }
+        if (S_ISDIR(status.st_mode)) {
+            DIR* dir = opendir(path.c_str());
+            if (!dir) {
+                CaptError("Cannot read directory " << path);
+                return;
+            }
+            std::vector<std::string> names;
+            while (struct dirent* entry = readdir(dir)) {
+                std::string name = entry->d_name;
+                if (name == "." || name == "..") continue;
+                names.push_back(path + "/" + name);
+            }
+            closedir(dir);
+            for (std::vector<std::string>::iterator n = names.begin();
+                 n != names.end(); ++n) {
+                findFiles(*n,files);
+            }
+            return;
+        }
+        ScanFile file;
+        char resolved[PATH_MAX];
+        file.Name = path;
+        if (realpath(path.c_str(),resolved)) file.Name = resolved;
+        if (endsWith(path,".ubdaq") || endsWith(path,".ubdaq.gz")) {
+            file.Type = CP::TRawCatalog::kUBDAQ;
+        }
+        else if (endsWith(path,".root")) {
+            file.Type = CP::TRawCatalog::kPDS;
+        }
+        else {
+            return;
+        }
+        files.push_back(file);
+    }
+
+    void fillEntry(CP::TRawCatalog::Entry& entry,
+                   const CP::TEventContext& context,
+                   uint64_t offset) {
+        entry.Run = context.GetRun();
+        entry.SubRun = context.GetSubRun();
+        entry.Event = context.GetEvent();
+        entry.Seconds = context.GetTimeStamp();
+        entry.Nanoseconds = context.GetNanoseconds();
+        entry.File = 0;
+        entry.Offset = offset;
+    }
+
+    /// Scan a ubdaq file using the record headers, and save an inflate
+    /// checkpoint each time spacing bytes are decompressed.  This is run in
+    /// the worker threads.
+    void scanUBDAQ(ScanFile& file, std::streamoff spacing) {
+        try {
+            CP::TUBDAQInput input(file.Name.c_str());
+            input.ApplyInputSelection(false);
+            input.SetCheckpointSpacing(spacing);
+            CP::TEventContext context;
+            while (input.PeekContext(context)) {
+                CP::TRawCatalog::Entry entry;
+                fillEntry(entry,context,input.GetRecordOffset());
+                file.Entries.push_back(entry);
+                input.SkipEvent();
+            }
+            input.GetInflateCheckpoints(file.Checkpoints);
+        }
+        catch (std::exception& e) {
+            file.Error = e.what();
+        }
+        catch (...) {
+            file.Error = "unknown exception";
+        }
+    }
+
+    /// Scan a PDS file using the event number and time branches.
+    void scanPDS(ScanFile& file) {
+        try {
+            CP::TmPDSInput input(file.Name.c_str(),"OLD");
+            input.ApplyInputSelection(false);
+            // Move before the first entry so the peek starts at entry zero.
+            input.ReadEvent(-1);
+            CP::TEventContext context;
+            while (input.PeekContext(context)) {
+                CP::TRawCatalog::Entry entry;
+                fillEntry(entry,context,input.GetPosition()+1);
+                file.Entries.push_back(entry);
+                input.SkipEvent();
+            }
+        }
+        catch (std::exception& e) {
+            file.Error = e.what();
+        }
+        catch (...) {
+            file.Error = "unknown exception";
+        }
+    }
+
+    void usage(const char* program) {
+        std::cout << "Usage: " << program
+                  << " [-j threads] [-k MB] -o <catalog> <file-or-dir> ..."
+                  << std::endl;
+        std::cout << "       " << program
+                  << " -q <selection> <catalog>" << std::endl;
+        std::cout << "    -j <n>   Number of threads for the ubdaq files"
+                  << std::endl;
+        std::cout << "    -k <MB>  Decompressed MB between the inflate"
+                  << " checkpoints (0 for none)" << std::endl;
+        std::cout << "    -o <f>   Write the catalog to <f>" << std::endl;
+        std::cout << "    -q <s>   Print the events selected by <s>"
+                  << " (e.g. run=2011,event=10-20 or time=t1-t2)"
+                  << std::endl;
+    }
+
+    int query(const std::string& selectionString,
+              const std::string& catalogFile) {
+        CP::TRawCatalog catalog;
+        if (!catalog.Read(catalogFile)) return 1;
+        CP::TRawCatalog::Selection selection;
+        if (!selection.Parse(selectionString)) return 1;
+        std::vector<CP::TRawCatalog::Entry> found;
+        catalog.Find(selection,found);
+        for (std::vector<CP::TRawCatalog::Entry>::iterator e = found.begin();
+             e != found.end(); ++e) {
+            std::cout << e->Run
+                      << " " << e->SubRun
+                      << " " << e->Event
+                      << " " << e->Seconds
+                      << "." << e->Nanoseconds
+                      << " " << catalog.GetFileName(e->File)
+                      << " " << e->Offset
+                      << std::endl;
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char **argv) {
+    int threads = std::thread::hardware_concurrency();
+    double checkpointMB = 64;
+    std::string output;
+    std::string selection;
+    bool doQuery = false;
+
+    int c;
+    while ((c = getopt(argc, argv, "j:k:o:q:h")) != -1) {
+        switch (c) {
+        case 'j': threads = std::atoi(optarg); break;
+        case 'k': checkpointMB = std::atof(optarg); break;
+        case 'o': output = optarg; break;
+        case 'q': selection = optarg; doQuery = true; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+
+    if (doQuery) {
+        if (optind+1 != argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        return query(selection,argv[optind]);
+    }
+
+    if (output.empty() || optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (threads < 1) threads = 1;
+
+    std::vector<ScanFile> files;
+    for (int i = optind; i < argc; ++i) findFiles(argv[i],files);
+    CaptLog("Scan " << files.size() << " files with "
+            << threads << " threads");
+
+    // The worker threads take the ubdaq files off of a shared index.  The
+    // ubdaq inputs still go through the ROOT type system while the PDS
+    // files are read with ROOT in this thread.
+    ROOT::EnableThreadSafety();
+    std::atomic<std::size_t> nextFile(0);
+    std::streamoff spacing = std::max(0.0, checkpointMB)*1024*1024;
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i) {
+        workers.push_back(std::thread([&files,&nextFile,spacing]() {
+                    while (true) {
+                        std::size_t f = nextFile++;
+                        if (f >= files.size()) break;
+                        if (files[f].Type != CP::TRawCatalog::kUBDAQ) {
+                            continue;
+                        }
+                        scanUBDAQ(files[f],spacing);
+                    }
+                }));
+    }
+
+    // The PDS files are done in this thread while the workers run.
+    for (std::vector<ScanFile>::iterator f = files.begin();
+         f != files.end(); ++f) {
+        if (f->Type == CP::TRawCatalog::kPDS) scanPDS(*f);
+    }
+
+    for (std::vector<std::thread>::iterator w = workers.begin();
+         w != workers.end(); ++w) {
+        w->join();
+    }
+
+    CP::TRawCatalog catalog;
+    for (std::vector<ScanFile>::iterator f = files.begin();
+         f != files.end(); ++f) {
+        if (!f->Error.empty()) {
+            CaptError("Error scanning " << f->Name << ": " << f->Error);
+        }
+        if (f->Entries.empty()) continue;
+        int index = catalog.AddFile(f->Name,f->Type);
+        catalog.SetCheckpoints(index,f->Checkpoints);
+        for (std::vector<CP::TRawCatalog::Entry>::iterator e
+                 = f->Entries.begin();
+             e != f->Entries.end(); ++e) {
+            e->File = index;
+            catalog.AddEntry(*e);
+        }
+        CaptLog(f->Name << ": " << f->Entries.size() << " events, "
+                << f->Checkpoints.size() << " checkpoints");
+    }
+
+    if (!catalog.Write(output)) return 1;
+    CaptLog("Catalog " << output << ": " << catalog.GetEntries().size()
+            << " events in " << catalog.GetFileCount() << " files");
+    return 0;
+}
@@ -0,0 +1,134 @@
+// Skim selected events from ubdaq files into a new ubdaq file.
+//
+//   capt-skim-raw [-s skim] [-t trigger] [-c selection] [-w first,last]
+//                 -o skim.ubdaq[.gz] <file> ...
+//
+// The skim file has lines of "run event" or "run subrun event" (see
+// skim-events), the trigger is a ubdaq trigger selection (e.g. bnb|numi),
+// and the selection is the ubdaq channel selection (e.g.
+// crates=1,cards=7-12).  The sample window keeps the TPC samples from
+// first up to (but not including) last.  The records are written in the
+// DAQ format (see TUBDAQWriter) so the skim can be read with -tubdaq, and
+// is much smaller than the converted events.
+#include <TUBDAQInput.hxx>
+#include <TUBDAQWriter.hxx>
+#include <TUBDAQChannelSelection.hxx>
+#include <TRunEventSet.hxx>
+
+#include "datatypes/eventRecord.h"
+
+#include <TCaptLog.hxx>
+
+#include <iostream>
+#include <string>
+#include <memory>
+#include <exception>
+#include <cstdlib>
+#include <cstdio>
+
+#include <unistd.h>
+
+namespace {
+    void usage(const char* program) {
+        std::cout << "Usage: " << program
+                  << " [options] -o <output> <file> ..." << std::endl;
+        std::cout << "    -o <f>   Write the skim to <f> (compressed if it"
+                  << " ends in .gz)" << std::endl;
+        std::cout << "    -s <f>   Only keep the events in a skim file"
+                  << std::endl;
+        std::cout << "    -t <s>   Only keep a trigger type"
+                  << " (e.g. bnb|numi)" << std::endl;
+        std::cout << "    -c <s>   Only keep a channel selection"
+                  << " (e.g. crates=1,cards=7-12)" << std::endl;
+        std::cout << "    -w <f,l> Only keep the TPC samples from f up to l"
+                  << std::endl;
+    }
+}
+
+int main(int argc, char **argv) {
+    std::string output;
+    std::string skimFile;
+    std::string trigger;
+    std::string channels;
+    int first = -1;
+    int last = -1;
+
+    int c;
+    while ((c = getopt(argc, argv, "o:s:t:c:w:h")) != -1) {
+        switch (c) {
+        case 'o': output = optarg; break;
+        case 's': skimFile = optarg; break;
+        case 't': trigger = optarg; break;
+        case 'c': channels = optarg; break;
+        case 'w':
+            if (std::sscanf(optarg, "%d,%d", &first, &last) != 2) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (output.empty() || optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    CP::TRunEventSet runEvents;
+    if (!skimFile.empty()) {
+        int added = runEvents.ReadFile(skimFile);
+        CaptLog("Skim " << skimFile << ": " << added << " events");
+        CP::TRunEventSet::SetInputSelection(&runEvents);
+    }
+
+    int triggerMask = 0;
+    if (!trigger.empty()) {
+        triggerMask = CP::TUBDAQInput::ParseTriggerSelection(
+            "ubdaq(trigger=" + trigger + ")");
+        if (triggerMask == 0) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    CP::TUBDAQChannelSelection selection;
+    if (!channels.empty() && !selection.Parse(channels)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    CP::TUBDAQWriter writer(output);
+    if (!writer.IsOpen()) return 1;
+    writer.SetChannelSelection(selection);
+    writer.SetSampleWindow(first, last);
+
+    int status = 0;
+    for (int i = optind; i < argc; ++i) {
+        try {
+            CP::TUBDAQInput input(argv[i]);
+            input.SetChannelSelection(selection);
+            input.SetTriggerSelection(triggerMask);
+            int written = 0;
+            while (true) {
+                std::auto_ptr<gov::fnal::uboone::datatypes::eventRecord>
+                    record(input.NextRecord());
+                if (!record.get()) break;
+                if (!writer.Write(*record)) {
+                    status = 1;
+                    break;
+                }
+                ++written;
+            }
+            CaptLog(argv[i] << ": " << written << " records");
+        }
+        catch (std::exception& e) {
+            CaptError("Error skimming " << argv[i] << ": " << e.what());
+            status = 1;
+        }
+    }
+
+    if (!writer.Close()) return 1;
+    CaptLog("Skim " << output << ": " << writer.GetRecordCount()
+            << " records (" << writer.GetBytesWritten() << " bytes)");
+    return status;
+}
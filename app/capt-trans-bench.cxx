@@ -0,0 +1,611 @@
+// Measure the end to end conversion throughput of an input builder.  The
+// events are read and discarded, and a line is printed for each
+// configuration with the events per second, the MB per second, the peak
+// RSS, and the time per event spent in each stage of the input (see
+// CP::TRawInputProfile).
+//
+//   capt-trans-bench [-t builder] [-j threads] [-w first:last] [-s scale]
+//                    [-n events] [-r repeat] [-g events] [-G layout]
+//                    [-o results] [-c baseline] [-T tolerance] [file]
+//
+// The -j, -w and -s options take a comma separated list, and every
+// combination is run.  The threads read independent copies of the input
+// (like running several jobs at once), so they are only used with the
+// ubdaq and nevis builders which don't share ROOT files.  The sample
+// window and temp digit scaling are the ubdaq builder arguments (see
+// CP::TUBDAQInput), and only apply to the ubdaq builder.  Other builders
+// (mPDS, merge, ubdaqlist, catalog, ...) are opened through the input
+// manager with their default arguments.
+//
+// With -g, a file with the given number of events is generated (see
+// CP::TUBDAQGenerator, CP::TNevisGenerator and CP::TmPDSGenerator) and used
+// as the input.  It's written to the file argument, or to a temporary file
+// that is removed at the end.  The merge builder gets a ubdaq and a PDS
+// file with matching times.  The ubdaq layout is
+// "crates,cards,channels,samples[,pmt-cards]".
+//
+// The results are written as JSON lines with -o, and can be compared to
+// the results from an earlier run with -c.  A configuration fails when the
+// events per second is lower than the baseline by more than the tolerance
+// (a fraction, 0.1 by default), and the exit status is then 2.
+#include <TUBDAQInput.hxx>
+#include <TUBDAQGenerator.hxx>
+#include <TNevisGenerator.hxx>
+#include <TmPDSGenerator.hxx>
+#include <TNevisInput.hxx>
+#include <TmPDSInput.hxx>
+#include <TMergeInput.hxx>
+#include <TRawInputProfile.hxx>
+
+#include <TManager.hxx>
+#include <TInputManager.hxx>
+#include <TVInputFile.hxx>
+#include <TEvent.hxx>
+#include <TCaptLog.hxx>
+
+#include <TROOT.h>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <exception>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+namespace {
+    /// One point in the sweep.
+    struct Config {
+        std::string Builder;
+        int Threads;
+        int First;
+        int Last;
+        int Scale;
+
+        /// The key used to match the configuration in the baseline.
+        std::string Key() const {
+            std::ostringstream key;
+            key << Builder << " threads=" << Threads;
+            if (Builder == "ubdaq") {
+                key << " window=" << First << ":" << Last
+                    << " scale=" << Scale;
+            }
+            return key.str();
+        }
+    };
+
+    /// The time spent in a stage summed over the threads.
+    struct Stage {
+        std::string Name;
+        double Wall;
+        double CPU;
+    };
+
+    /// The result of running a configuration.
+    struct Result {
+        Result() : Events(0), Bytes(0), Seconds(0), PeakRSS(0) {}
+        long Events;
+        double Bytes;
+        double Seconds;
+        double PeakRSS;
+        std::vector<Stage> Stages;
+        std::string Error;
+    };
+
+    /// The result of reading one input.
+    struct Reader {
+        Reader() : Events(0), Bytes(0) {}
+        long Events;
+        double Bytes;
+        std::vector<Stage> Stages;
+        std::string Error;
+    };
+
+    std::vector<std::string> split(const std::string& value, char separator) {
+        std::vector<std::string> fields;
+        std::istringstream input(value);
+        std::string field;
+        while (std::getline(input, field, separator)) fields.push_back(field);
+        return fields;
+    }
+
+    double fileBytes(const std::string& names) {
+        double bytes = 0;
+        std::vector<std::string> files = split(names, ',');
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            struct stat status;
+            if (stat(files[i].c_str(), &status) == 0) bytes += status.st_size;
+        }
+        return bytes;
+    }
+
+    /// Reset the peak RSS of the process.  This only works on linux, and
+    /// otherwise the peak is for the whole job.
+    void resetPeakRSS() {
+        std::ofstream clear("/proc/self/clear_refs");
+        if (clear.is_open()) clear << "5" << std::endl;
+    }
+
+    /// Get the peak RSS in MB.
+    double peakRSS() {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, 6, "VmHWM:") != 0) continue;
+            return std::atof(line.substr(6).c_str())/1024.0;
+        }
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss/1024.0;
+    }
+
+    CP::TVInputFile* openInput(const Config& config,
+                               const std::string& file) {
+        if (config.Builder == "ubdaq") {
+            return new CP::TUBDAQInput(file.c_str(), config.First,
+                                       config.Last, config.Scale);
+        }
+        if (config.Builder == "nevis") {
+            return new CP::TNevisInput(file.c_str());
+        }
+        if (config.Builder == "mPDS") {
+            return new CP::TmPDSInput(file.c_str());
+        }
+        if (config.Builder == "merge") {
+            return new CP::TMergeInput(file.c_str());
+        }
+        return CP::TManager::Get().Input().Builder(
+            config.Builder.c_str()).Open(file.c_str());
+    }
+
+    CP::TRawInputProfile* findProfile(CP::TVInputFile* input) {
+        if (CP::TUBDAQInput* ubdaq = dynamic_cast<CP::TUBDAQInput*>(input)) {
+            return &ubdaq->GetProfile();
+        }
+        if (CP::TNevisInput* nevis = dynamic_cast<CP::TNevisInput*>(input)) {
+            return &nevis->GetProfile();
+        }
+        if (CP::TmPDSInput* pds = dynamic_cast<CP::TmPDSInput*>(input)) {
+            return &pds->GetProfile();
+        }
+        if (CP::TMergeInput* merge = dynamic_cast<CP::TMergeInput*>(input)) {
+            return &merge->GetProfile();
+        }
+        return NULL;
+    }
+
+    /// Read all of the events in an input.  This is run in the worker
+    /// threads.
+    void readInput(const Config& config, const std::string& file,
+                   long maxEvents, bool quiet, Reader& reader) {
+        try {
+            std::auto_ptr<CP::TVInputFile> input(openInput(config, file));
+            if (!input.get()) {
+                reader.Error = "cannot open " + file;
+                return;
+            }
+            CP::TEvent* event = input->FirstEvent();
+            while (event) {
+                ++reader.Events;
+                delete event;
+                if (maxEvents > 0 && reader.Events >= maxEvents) break;
+                event = input->NextEvent();
+            }
+            reader.Bytes = -1;
+            CP::TRawInputProfile* profile = findProfile(input.get());
+            for (int i = 0; profile && i < profile->GetStageCount(); ++i) {
+                Stage stage;
+                stage.Name = profile->GetStageName(i);
+                stage.Wall = profile->GetStageWall(i);
+                stage.CPU = profile->GetStageCPU(i);
+                reader.Stages.push_back(stage);
+            }
+            for (int i = 0; profile && i < profile->GetCounterCount(); ++i) {
+                if (profile->GetCounterName(i) != "bytes in") continue;
+                reader.Bytes = profile->GetCounterTotal(i);
+            }
+            // The bench prints its own summary.
+            if (profile && quiet) profile->SetEnabled(false);
+        }
+        catch (std::exception& e) {
+            reader.Error = e.what();
+        }
+        catch (...) {
+            reader.Error = "unknown exception";
+        }
+    }
+
+    Result runConfig(const Config& config, const std::string& file,
+                     long maxEvents, bool quiet) {
+        Result result;
+        std::vector<Reader> readers(config.Threads);
+        resetPeakRSS();
+        std::chrono::steady_clock::time_point start
+            = std::chrono::steady_clock::now();
+        if (config.Threads == 1) {
+            readInput(config, file, maxEvents, quiet, readers[0]);
+        }
+        else {
+            // Each thread makes its own inputs and events, but they all
+            // go through the ROOT type system.
+            ROOT::EnableThreadSafety();
+            std::vector<std::thread> workers;
+            for (int i = 0; i < config.Threads; ++i) {
+                workers.push_back(
+                    std::thread(readInput, config, file, maxEvents, quiet,
+                                std::ref(readers[i])));
+            }
+            for (std::size_t i = 0; i < workers.size(); ++i) {
+                workers[i].join();
+            }
+        }
+        result.Seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        result.PeakRSS = peakRSS();
+
+        std::map<std::string, int> stageIndex;
+        for (std::size_t r = 0; r < readers.size(); ++r) {
+            const Reader& reader = readers[r];
+            if (!reader.Error.empty()) result.Error = reader.Error;
+            result.Events += reader.Events;
+            // Without a byte counter, the whole file was read.
+            if (reader.Bytes < 0) result.Bytes += fileBytes(file);
+            else result.Bytes += reader.Bytes;
+            for (std::size_t s = 0; s < reader.Stages.size(); ++s) {
+                const Stage& stage = reader.Stages[s];
+                std::map<std::string, int>::iterator found
+                    = stageIndex.find(stage.Name);
+                if (found == stageIndex.end()) {
+                    stageIndex[stage.Name] = result.Stages.size();
+                    result.Stages.push_back(stage);
+                    continue;
+                }
+                result.Stages[found->second].Wall += stage.Wall;
+                result.Stages[found->second].CPU += stage.CPU;
+            }
+        }
+        return result;
+    }
+
+    double eventRate(const Result& result) {
+        return (result.Seconds > 0) ? result.Events/result.Seconds : 0.0;
+    }
+
+    std::string jsonLine(const Config& config, const std::string& file,
+                         const Result& result) {
+        double events = (result.Events > 0) ? result.Events : 1;
+        std::ostringstream line;
+        line << "{\"config\":\"" << config.Key() << "\""
+             << ",\"builder\":\"" << config.Builder << "\""
+             << ",\"file\":\"" << file << "\""
+             << ",\"threads\":" << config.Threads
+             << ",\"first\":" << config.First
+             << ",\"last\":" << config.Last
+             << ",\"scale\":" << config.Scale
+             << ",\"events\":" << result.Events
+             << ",\"seconds\":" << result.Seconds
+             << ",\"events_per_second\":" << eventRate(result)
+             << ",\"mb_per_second\":"
+             << ((result.Seconds > 0) ? result.Bytes/result.Seconds/1E6 : 0)
+             << ",\"peak_rss_mb\":" << result.PeakRSS
+             << ",\"stages\":{";
+        for (std::size_t i = 0; i < result.Stages.size(); ++i) {
+            const Stage& stage = result.Stages[i];
+            if (i > 0) line << ",";
+            line << "\"" << stage.Name << "\":{\"wall_ms\":"
+                 << 1000.0*stage.Wall/events
+                 << ",\"cpu_ms\":" << 1000.0*stage.CPU/events << "}";
+        }
+        line << "}}";
+        return line.str();
+    }
+
+    void printResult(const Config& config, const Result& result) {
+        double events = (result.Events > 0) ? result.Events : 1;
+        std::cout << "bench " << std::setw(46) << std::left << config.Key()
+                  << std::right << std::fixed
+                  << " " << std::setw(8) << result.Events
+                  << " " << std::setw(10) << std::setprecision(2)
+                  << eventRate(result)
+                  << " " << std::setw(10)
+                  << ((result.Seconds > 0)
+                      ? result.Bytes/result.Seconds/1E6 : 0.0)
+                  << " " << std::setw(8) << std::setprecision(1)
+                  << result.PeakRSS
+                  << std::endl;
+        for (std::size_t i = 0; i < result.Stages.size(); ++i) {
+            const Stage& stage = result.Stages[i];
+            std::cout << "      " << std::setw(14) << std::left << stage.Name
+                      << std::right << std::setprecision(3)
+                      << " wall " << std::setw(10)
+                      << 1000.0*stage.Wall/events << " ms/event"
+                      << " cpu " << std::setw(10)
+                      << 1000.0*stage.CPU/events << " ms/event"
+                      << std::endl;
+        }
+        std::cout.unsetf(std::ios::fixed);
+    }
+
+    /// Find a value in a JSON line written by jsonLine.  This is not a
+    /// general JSON parser.
+    bool jsonValue(const std::string& line, const std::string& key,
+                   std::string& value) {
+        std::string tag = "\"" + key + "\":";
+        std::size_t begin = line.find(tag);
+        if (begin == std::string::npos) return false;
+        begin += tag.size();
+        if (line[begin] == '"') {
+            std::size_t end = line.find('"', begin+1);
+            if (end == std::string::npos) return false;
+            value = line.substr(begin+1, end-begin-1);
+            return true;
+        }
+        std::size_t end = line.find_first_of(",}", begin);
+        value = line.substr(begin, end-begin);
+        return true;
+    }
+
+    /// Read the events per second for each configuration in a baseline.
+    bool readBaseline(const std::string& fileName,
+                      std::map<std::string, double>& baseline) {
+        std::ifstream input(fileName.c_str());
+        if (!input.is_open()) {
+            CaptError("Cannot read baseline " << fileName);
+            return false;
+        }
+        std::string line;
+        while (std::getline(input, line)) {
+            std::string key;
+            std::string rate;
+            if (!jsonValue(line, "config", key)) continue;
+            if (!jsonValue(line, "events_per_second", rate)) continue;
+            baseline[key] = std::atof(rate.c_str());
+        }
+        return true;
+    }
+
+    /// Make an empty temporary file for a generated input.
+    bool makeTemporary(std::string& name) {
+        char buffer[] = "/tmp/capt-trans-bench-XXXXXX";
+        int fd = mkstemp(buffer);
+        if (fd < 0) {
+            CaptError("Cannot make a temporary file");
+            return false;
+        }
+        close(fd);
+        name = buffer;
+        return true;
+    }
+
+    /// Generate the input files for a builder.  The merge builder gets a
+    /// ubdaq file with a TPC event every 100 ms, and a PDS file with
+    /// triggers at 100 Hz over the same time.
+    bool generateFiles(const std::string& builder,
+                       const std::vector<std::string>& names,
+                       int events, const std::vector<int>& layout) {
+        const double start = 1420070400.0;
+        if (builder == "nevis") {
+            CP::TNevisGenerator generator;
+            return generator.Write(names[0], events);
+        }
+        if (builder == "mPDS") {
+            CP::TmPDSGenerator generator;
+            generator.SetTime(start, 100.0);
+            return generator.Write(names[0], events);
+        }
+        CP::TUBDAQGenerator generator;
+        generator.SetTPC(layout[0], layout[1], layout[2], layout[3]);
+        generator.SetPMT(layout[4], 10, 40);
+        generator.SetTime(start, 0.1);
+        if (!generator.Write(names[0], events)) return false;
+        if (builder != "merge") return true;
+        CP::TmPDSGenerator pds;
+        pds.SetTime(start - 0.05, 100.0);
+        return pds.Write(names[1], 10*events + 10);
+    }
+
+    std::vector<int> intList(const std::string& value) {
+        std::vector<int> values;
+        std::vector<std::string> fields = split(value, ',');
+        for (std::size_t i = 0; i < fields.size(); ++i) {
+            values.push_back(std::atoi(fields[i].c_str()));
+        }
+        return values;
+    }
+
+    void usage(const char* program) {
+        std::cout << "Usage: " << program << " [options] [file]" << std::endl
+                  << "    -t <b>   Input builder (default ubdaq)" << std::endl
+                  << "    -j <l>   Threads, e.g. 1,2,4 (default 1)"
+                  << std::endl
+                  << "    -w <l>   Sample windows, e.g. -1:-1,2800:3800"
+                  << std::endl
+                  << "    -s <l>   Temp digit scaling, e.g. -1,100"
+                  << std::endl
+                  << "    -n <n>   Maximum events for each input" << std::endl
+                  << "    -r <n>   Repeat each configuration and keep the"
+                  << " fastest" << std::endl
+                  << "    -g <n>   Generate an input file with n events"
+                  << std::endl
+                  << "    -G <l>   Generated crates,cards,channels,samples"
+                  << "[,pmt-cards]" << std::endl
+                  << "    -o <f>   Write the results as JSON lines"
+                  << std::endl
+                  << "    -c <f>   Compare to the baseline results in <f>"
+                  << std::endl
+                  << "    -T <x>   Allowed fractional slowdown (default 0.1)"
+                  << std::endl;
+    }
+}
+
+int main(int argc, char **argv) {
+    std::string builder = "ubdaq";
+    std::vector<int> threadList(1, 1);
+    std::vector<std::string> windowList(1, "-1:-1");
+    std::vector<int> scaleList(1, -1);
+    long maxEvents = 0;
+    int repeat = 1;
+    int generate = 0;
+    std::vector<int> layout = intList("1,16,64,9595,0");
+    std::string output;
+    std::string baselineFile;
+    double tolerance = 0.1;
+
+    int c;
+    while ((c = getopt(argc, argv, "t:j:w:s:n:r:g:G:o:c:T:h")) != -1) {
+        switch (c) {
+        case 't': builder = optarg; break;
+        case 'j': threadList = intList(optarg); break;
+        case 'w': windowList = split(optarg, ','); break;
+        case 's': scaleList = intList(optarg); break;
+        case 'n': maxEvents = std::atol(optarg); break;
+        case 'r': repeat = std::atoi(optarg); break;
+        case 'g': generate = std::atoi(optarg); break;
+        case 'G': layout = intList(optarg); break;
+        case 'o': output = optarg; break;
+        case 'c': baselineFile = optarg; break;
+        case 'T': tolerance = std::atof(optarg); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (layout.size() == 4) layout.push_back(0);
+    if (optind+1 < argc || (optind == argc && generate < 1)
+        || layout.size() != 5 || repeat < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (generate > 0 && builder != "ubdaq" && builder != "nevis"
+        && builder != "mPDS" && builder != "merge") {
+        CaptError("Cannot generate files for " << builder);
+        return 1;
+    }
+
+    // Every stage of the inputs is profiled.  The summaries are only
+    // printed if they were asked for.
+    bool quiet = (std::getenv("CAPTTRANS_PROFILE") == NULL);
+    if (quiet) setenv("CAPTTRANS_PROFILE", "1", 1);
+
+    std::string file;
+    std::vector<std::string> temporary;
+    if (optind < argc) file = argv[optind];
+    if (generate > 0) {
+        std::vector<std::string> names;
+        if (!file.empty()) names = split(file, ',');
+        int needed = (builder == "merge") ? 2 : 1;
+        while ((int) names.size() < needed) {
+            std::string name;
+            if (!makeTemporary(name)) return 1;
+            names.push_back(name);
+            temporary.push_back(name);
+        }
+        if (!generateFiles(builder, names, generate, layout)) return 1;
+        file = names[0];
+        for (int i = 1; i < needed; ++i) file += "," + names[i];
+        CaptLog("Generated " << generate << " events in " << file
+                << " (" << fileBytes(file)/1E6 << " MB)");
+    }
+
+    std::vector<Config> configs;
+    for (std::size_t t = 0; t < threadList.size(); ++t) {
+        for (std::size_t w = 0; w < windowList.size(); ++w) {
+            for (std::size_t s = 0; s < scaleList.size(); ++s) {
+                Config config;
+                config.Builder = builder;
+                config.Threads = std::max(1, threadList[t]);
+                config.First = config.Last = -1;
+                std::vector<std::string> window
+                    = split(windowList[w], ':');
+                if (window.size() > 0) {
+                    config.First = std::atoi(window[0].c_str());
+                }
+                if (window.size() > 1) {
+                    config.Last = std::atoi(window[1].c_str());
+                }
+                config.Scale = scaleList[s];
+                if (config.Threads > 1
+                    && builder != "ubdaq" && builder != "nevis") {
+                    CaptError("Threads are only used with ubdaq and nevis");
+                    continue;
+                }
+                // The window and scale are only ubdaq arguments.
+                if (builder != "ubdaq" && (w > 0 || s > 0)) continue;
+                configs.push_back(config);
+            }
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (!baselineFile.empty() && !readBaseline(baselineFile, baseline)) {
+        return 1;
+    }
+
+    std::ofstream results;
+    if (!output.empty()) {
+        results.open(output.c_str());
+        if (!results.is_open()) {
+            CaptError("Cannot write " << output);
+            return 1;
+        }
+    }
+
+    std::cout << "bench " << std::setw(46) << std::left << "config"
+              << std::right
+              << " " << std::setw(8) << "events"
+              << " " << std::setw(10) << "events/s"
+              << " " << std::setw(10) << "MB/s"
+              << " " << std::setw(8) << "RSS MB" << std::endl;
+
+    int status = 0;
+    for (std::vector<Config>::iterator config = configs.begin();
+         config != configs.end(); ++config) {
+        Result best;
+        for (int r = 0; r < repeat; ++r) {
+            Result result = runConfig(*config, file, maxEvents, quiet);
+            if (r == 0 || eventRate(result) > eventRate(best)) best = result;
+        }
+        if (!best.Error.empty()) {
+            CaptError(config->Key() << ": " << best.Error);
+            status = 1;
+        }
+        printResult(*config, best);
+        if (results.is_open()) {
+            results << jsonLine(*config, file, best) << std::endl;
+        }
+
+        if (baselineFile.empty()) continue;
+        std::map<std::string, double>::iterator reference
+            = baseline.find(config->Key());
+        if (reference == baseline.end()) {
+            std::cout << "compare " << config->Key()
+                      << ": not in the baseline" << std::endl;
+            continue;
+        }
+        double rate = eventRate(best);
+        double change = (reference->second > 0)
+            ? rate/reference->second - 1.0 : 0.0;
+        bool slower = rate < (1.0 - tolerance)*reference->second;
+        std::cout << "compare " << config->Key()
+                  << ": " << std::setprecision(4) << rate
+                  << " events/s, baseline " << reference->second
+                  << " (" << std::showpos << std::setprecision(3)
+                  << 100.0*change << std::noshowpos << "%) "
+                  << (slower ? "REGRESSION" : "ok") << std::endl;
+        if (slower && status == 0) status = 2;
+    }
+
+    for (std::size_t i = 0; i < temporary.size(); ++i) {
+        std::remove(temporary[i].c_str());
+    }
+    return status;
+}
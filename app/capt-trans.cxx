@@ -2,6 +2,12 @@
 
 #include <eventLoop.hxx>
 
+#include <TCaptLog.hxx>
+#include <TRawInputTrace.hxx>
+#include <TDigitColumnFile.hxx>
+
+#include <cstdlib>
+
 class TCaptTransLoop: public CP::TEventLoopFunction {
 public:
     TCaptTransLoop() {
@@ -16,9 +22,30 @@ public:
                   << std::endl;
         std::cout << "    -O <option> Set the option for TObject::ls()"
                   << std::endl;
+        std::cout << "    -O trace=<file> Write a Chrome trace of the input"
+                  << std::endl;
+        std::cout << "    -O columns=<file> Write the digits to a column file"
+                  << std::endl;
+        std::cout << "    -O rowgroup=<MB> Size of a column file row group"
+                  << " in MB" << std::endl;
     }
 
     virtual bool SetOption(std::string option,std::string value="") {
+        if (option == "trace") {
+            if (value == "") value = "capttrans-trace.json";
+            CP::TRawInputTrace::Enable(value);
+            return true;
+        }
+        if (option == "columns") {
+            if (value == "") value = "capttrans-digits.cols";
+            return fColumns.Create(value);
+        }
+        if (option == "rowgroup") {
+            double megabytes = std::atof(value.c_str());
+            if (megabytes <= 0) return false;
+            fColumns.SetRowGroupSize(megabytes);
+            return true;
+        }
         if (value != "") return false;
         if (option == "list") fQuiet =false;
         else fLSOption = option;
@@ -29,19 +56,28 @@ public:
         if (CP::TCaptLog::GetLogLevel()>CP::TCaptLog::QuietLevel && !fQuiet) {
             event.ls(fLSOption.c_str());
         }
+        if (fColumns.IsWriting() && !fColumns.AddEvent(event)) {
+            // Stop writing so the error is only reported once.
+            CaptError("Cannot write the digits to the column file");
+            fColumns.Close();
+        }
         return true;
     }
 
-    // Do nothing... This is here to test compiler warnings.  The warning
-    // can be prevented by adding
+    // Finish the column file.  This also tests compiler warnings.  The
+    // warning can be prevented by adding
     //
     // using CP::TEventLoopFunction::Finalize;
     void Finalize(CP::TRootOutput*const output) {
+        if (fColumns.IsWriting()) fColumns.Finish();
     }
 
 private:
     std::string fLSOption;
     bool fQuiet;
+
+    /// The column file for the digits (see TDigitColumnFile).
+    CP::TDigitColumnFile fColumns;
 };
 
 int main(int argc, char **argv) {
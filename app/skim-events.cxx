@@ -2,9 +2,7 @@
 
 #include <eventLoop.hxx>
 #include <TEventContext.hxx>
-
-#include <fstream>
-#include <sstream>
+#include <TRunEventSet.hxx>
 
 class TDumpEvent: public CP::TEventLoopFunction {
 public:
@@ -15,21 +13,23 @@ public:
     void Usage(void) {
         std::cout << "    -O skim=<file>   Read a skim file for events to save"
                   << std::endl;
+        std::cout << "                     Lines are \"run event\" or"
+                  << " \"run subrun event\""
+                  << std::endl;
+        std::cout << "    With a raw catalog, only the skimmed events are read:"
+                  << std::endl;
+        std::cout << "      -tubdaq catalog:<catalog>:skim=<file>"
+                  << std::endl;
     }
 
     virtual bool SetOption(std::string option,std::string value="") {
         if (option == "skim") {
-            std::ifstream in(value.c_str());
-            std::string line;
-            while (std::getline(in,line)) {
-                CaptLog("Skip: " << line);
-                if (line[0] == '#') continue;
-                std::istringstream lineStream(line);
-                int run, event;
-                lineStream >> run >> event;
-                fRunEvent.push_back(std::make_pair(run,event));
-            }
-            in.close();
+            int added = fRunEvent.ReadFile(value);
+            CaptLog("Skim " << value << ": " << added << " events");
+            // Let the raw inputs check the selection before the event is
+            // decoded.  The check in operator() is still needed for inputs
+            // that don't look at the selection.
+            CP::TRunEventSet::SetInputSelection(&fRunEvent);
             return true;
         }
         
@@ -40,17 +40,17 @@ public:
         CP::TEventContext context = event.GetContext();
         CaptLog("Check " << context);
 
-        // Check to see if the event was in a skim file.
-        for (std::vector< std::pair<int,int> >::const_iterator re
-                 = fRunEvent.begin(); re!= fRunEvent.end(); ++re) {
-            if ((int) context.GetRun() != re->first) continue;
-            if ((int) context.GetEvent() != re->second) continue;
+        // Check to see if the event was in a skim file.  Events without a
+        // subrun match the entry for any subrun.
+        int subrun = context.GetSubRun();
+        if (subrun == (int) CP::TEventContext::Invalid) {
+            subrun = CP::TRunEventSet::kAnySubRun;
+        }
+        if (fRunEvent.Contains(context.GetRun(), subrun, context.GetEvent())) {
             CaptLog("    Save " << context);
             return true;
         }
 
-        
-        
         return false;
     }
 
@@ -62,8 +62,8 @@ public:
 
 private:
 
-    /// A list of events to look for and save if found.
-    std::vector< std::pair<int,int> > fRunEvent;
+    /// A set of events to look for and save if found.
+    CP::TRunEventSet fRunEvent;
 
 };
 
@@ -0,0 +1,231 @@
+#include "TCatalogInput.hxx"
+#include "TUBDAQInput.hxx"
+#include "TmPDSInput.hxx"
+
+#include <TEvent.hxx>
+#include <TCaptLog.hxx>
+#include <TEventContext.hxx>
+#include <TManager.hxx>
+#include <TInputManager.hxx>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+    class TCatalogInputBuilder : public CP::TVInputBuilder {
+    public:
+        TCatalogInputBuilder()
+            : CP::TVInputBuilder("catalog",
+                                 "Read selected events using a raw catalog"
+                                 " [<catalog>:run=r,event=e]") {}
+        CP::TVInputFile* Open(const char* file) const {
+            return new CP::TCatalogInput(file);
+        }
+    };
+
+    class TCatalogInputRegistration {
+    public:
+        TCatalogInputRegistration() {
+            CP::TManager::Get().Input().Register(new TCatalogInputBuilder());
+        }
+    };
+    TCatalogInputRegistration registrationObject;
+
+    /// Order the entries so the files are read from front to back.
+    bool fileOrderLess(const CP::TRawCatalog::Entry& lhs,
+                       const CP::TRawCatalog::Entry& rhs) {
+        if (lhs.File != rhs.File) return lhs.File < rhs.File;
+        return lhs.Offset < rhs.Offset;
+    }
+}
+
+bool CP::TCatalogInput::IsCatalogName(const std::string& name) {
+    return name.compare(0,8,"catalog:") == 0;
+}
+
+bool CP::TCatalogInput::SplitName(const std::string& name,
+                                  std::string& catalogFile,
+                                  std::string& selection) {
+    // The first field is the catalog file unless it looks like part of the
+    // selection.
+    std::string spec = name;
+    if (IsCatalogName(spec)) spec = spec.substr(8);
+    catalogFile = "";
+    selection = spec;
+    std::size_t colon = spec.find(':');
+    std::string field = spec.substr(0,colon);
+    if (field.find('=') == std::string::npos) {
+        catalogFile = field;
+        if (colon != std::string::npos) selection = spec.substr(colon+1);
+        else selection = "";
+    }
+    if (catalogFile.empty()) {
+        const char* env = std::getenv("CAPTTRANS_CATALOG");
+        if (env) catalogFile = env;
+    }
+    return !catalogFile.empty();
+}
+
+CP::TCatalogInput::TCatalogInput(const char* name,
+                                 int first, int last, int scale)
+    : fFilename(name), fNext(0), fPositioned(false),
+      fInput(NULL), fUBDAQInput(NULL), fInputFile(-1), fOpen(false),
+      fFirstSample(first), fLastSample(last), fScaledDigitSave(scale),
+      fTriggerSelection(0), fCompactDigits(0), fWaveformMatrix(0),
+      fRegionThreshold(0), fRegionPadding(0) {
+
+    std::string catalogFile;
+    std::string selectionString;
+    if (!SplitName(fFilename,catalogFile,selectionString)) {
+        CaptError("No catalog file for " << fFilename
+                  << " (set CAPTTRANS_CATALOG)");
+        return;
+    }
+
+    CP::TRawCatalog::Selection selection;
+    if (!selection.Parse(selectionString)) {
+        CaptError("Invalid catalog selection: " << selectionString);
+        return;
+    }
+
+    if (!fCatalog.Read(catalogFile)) return;
+
+    fCatalog.Find(selection,fSelected);
+    std::sort(fSelected.begin(), fSelected.end(), fileOrderLess);
+    fOpen = true;
+
+    CaptLog("Catalog " << catalogFile << ": " << fSelected.size()
+            << " events selected");
+}
+
+CP::TCatalogInput::~TCatalogInput() {
+    CloseFile();
+}
+
+bool CP::TCatalogInput::OpenFile(int file) {
+    CloseFile();
+    fInputFile = file;
+    const std::string& name = fCatalog.GetFileName(file);
+    if (fCatalog.GetFileType(file) == CP::TRawCatalog::kPDS) {
+        try {
+            fInput = new CP::TmPDSInput(name.c_str(),"OLD");
+        }
+        catch (CP::EInputFile&) {
+            CaptError("Cannot open catalog file " << name);
+            fInput = NULL;
+            return false;
+        }
+    }
+    else {
+        fUBDAQInput = new CP::TUBDAQInput(name.c_str(), fFirstSample,
+                                          fLastSample, fScaledDigitSave);
+        fUBDAQInput->SetChannelSelection(fChannelSelection);
+        fUBDAQInput->SetCompactDigits(fCompactDigits);
+        fUBDAQInput->SetWaveformMatrix(fWaveformMatrix);
+        fUBDAQInput->SetRegionsOfInterest(fRegionThreshold,fRegionPadding);
+        std::vector<CP::TInflateStreamBuf::Checkpoint> checkpoints;
+        if (fCatalog.GetCheckpoints(file, checkpoints)) {
+            fUBDAQInput->SetInflateCheckpoints(checkpoints);
+        }
+        fInput = fUBDAQInput;
+    }
+    // The selection was applied to the catalog.
+    fInput->ApplyInputSelection(false);
+    return true;
+}
+
+bool CP::TCatalogInput::SeekEntry(const CP::TRawCatalog::Entry& entry) {
+    if (fUBDAQInput) return fUBDAQInput->SeekRecord(entry.Offset);
+    CP::TmPDSInput* pds = dynamic_cast<CP::TmPDSInput*>(fInput);
+    if (!pds) return false;
+    pds->SeekEntry(entry.Offset);
+    return true;
+}
+
+bool CP::TCatalogInput::PositionNext() {
+    while (fNext < fSelected.size()) {
+        if (fPositioned) return true;
+        const CP::TRawCatalog::Entry& entry = fSelected[fNext];
+        if (fInputFile != (int) entry.File) OpenFile(entry.File);
+
+        // Move to the event and make sure the catalog was right.
+        CP::TEventContext context;
+        if (fInput
+            && SeekEntry(entry)
+            && fInput->PeekContext(context)
+            && context.GetRun() == entry.Run
+            && context.GetEvent() == entry.Event) {
+            fPositioned = true;
+            return true;
+        }
+        CaptError("Catalog event " << entry.Run << "." << entry.Event
+                  << " not found in "
+                  << fCatalog.GetFileName(entry.File));
+        ++fNext;
+    }
+    return false;
+}
+
+bool CP::TCatalogInput::PeekContext(CP::TEventContext& context) {
+    if (!PositionNext()) return false;
+    return fInput->PeekContext(context);
+}
+
+void CP::TCatalogInput::SkipEvent() {
+    if (!PositionNext()) return;
+    fPositioned = false;
+    ++fNext;
+}
+
+CP::TEvent* CP::TCatalogInput::FirstEvent() {
+    return NextEvent();
+}
+
+CP::TEvent* CP::TCatalogInput::NextEvent(int skip) {
+    if (skip > 0) {
+        fNext += skip;
+        fPositioned = false;
+    }
+    const CP::TRunEventSet* selection = GetSelection();
+    while (PositionNext()) {
+        if (selection) {
+            const CP::TRawCatalog::Entry& entry = fSelected[fNext];
+            if (!selection->Contains(entry.Run, entry.SubRun, entry.Event)) {
+                SkipEvent();
+                continue;
+            }
+        }
+        // The trigger is checked here instead of by the raw input so that
+        // it doesn't read past the catalog entry.  The PDS files don't have
+        // trigger bits.
+        if (fUBDAQInput
+            && !CP::TUBDAQInput::TriggerSelected(
+                fTriggerSelection, fUBDAQInput->GetTriggerBits())) {
+            SkipEvent();
+            continue;
+        }
+        CP::TEvent* event = fInput->NextEvent();
+        fPositioned = false;
+        ++fNext;
+        if (event) return event;
+    }
+    return NULL;
+}
+
+int CP::TCatalogInput::GetPosition() const {return fNext;}
+
+bool CP::TCatalogInput::IsOpen() {return fOpen;}
+
+bool CP::TCatalogInput::EndOfFile() {
+    return fNext >= fSelected.size();
+}
+
+void CP::TCatalogInput::CloseFile() {
+    if (fInput) {
+        delete fInput;
+        fInput = NULL;
+        fUBDAQInput = NULL;
+    }
+    fInputFile = -1;
+    fPositioned = false;
+}
@@ -0,0 +1,180 @@
+#ifndef TCatalogInput_hxx_seen
+#define TCatalogInput_hxx_seen
+
+#include <ECore.hxx>
+#include <TVRawInput.hxx>
+#include <TRawCatalog.hxx>
+#include <TUBDAQChannelSelection.hxx>
+
+#include <string>
+#include <vector>
+
+namespace CP {
+    class TCatalogInput;
+    class TUBDAQInput;
+};
+
+/// Read the events selected from a raw catalog (see TRawCatalog and the
+/// capt-catalog application).  The input name has the form
+///
+/// \code
+/// catalog:<catalog-file>:<selection>
+/// \endcode
+///
+/// where the selection is described in TRawCatalog::Selection.  If the
+/// catalog file is left out (e.g. "catalog:run=2011,event=10-20"), then the
+/// catalog named by the CAPTTRANS_CATALOG environment variable is used.
+/// The ubdaq input builder opens a TCatalogInput for any file name that
+/// starts with "catalog:", so the catalog can be used anywhere that a ubdaq
+/// file can be used (e.g. "-tubdaq" or as the TPC file for "-tmerge").
+///
+/// The events in ubdaq files are read with TUBDAQInput, and the events in
+/// PDS files are read with TmPDSInput.  The channel and trigger selections,
+/// and the ways of saving the TPC digits, only apply to the ubdaq files.
+///
+/// The selected events are read in file and offset order.  Each file is
+/// positioned directly at the selected event, so the time to convert the
+/// selection depends on the number of selected events, not on the size of
+/// the files.  A compressed file is decompressed from the last inflate
+/// checkpoint before the event (see TRawCatalog), so only the data between
+/// the checkpoint and the event is decompressed.
+class CP::TCatalogInput : public CP::TVRawInput {
+public:
+    /// Open the catalog and find the selected events.  The first, last and
+    /// scale arguments are passed to TUBDAQInput.
+    TCatalogInput(const char* name, int first=-1, int last=-1, int scale=-1);
+    virtual ~TCatalogInput();
+
+    /// Check if an input name refers to a catalog.
+    static bool IsCatalogName(const std::string& name);
+
+    /// Split an input name into the catalog file and the selection.  This
+    /// returns false if there isn't a catalog file.
+    static bool SplitName(const std::string& name,
+                          std::string& catalogFile,
+                          std::string& selection);
+
+    /// Return the first selected event.
+    virtual CP::TEvent* FirstEvent();
+
+    /// Get the next selected event.  If skip is greater than zero, then
+    /// skip this many selected events before returning.
+    virtual CP::TEvent* NextEvent(int skip=0);
+
+    /// Return the number of selected events that have been passed.
+    virtual int GetPosition(void) const;
+
+    /// Flag that the catalog is open.
+    virtual bool IsOpen();
+
+    /// Flag that all of the selected events have been passed.
+    virtual bool EndOfFile();
+
+    /// Close the current raw file.
+    virtual void CloseFile();
+
+    /// Fill the context for the next selected event.
+    virtual bool PeekContext(CP::TEventContext& context);
+
+    /// Skip the next selected event.
+    virtual void SkipEvent();
+
+    /// Get the number of events selected from the catalog.
+    int GetSelectedCount() const {return fSelected.size();}
+
+    /// Get the name of this input.
+    const char* GetFilename()  const { return fFilename.c_str();  }
+
+    /// Set the crates, cards and channels to convert (see
+    /// TUBDAQChannelSelection).  This is passed to each ubdaq file.
+    void SetChannelSelection(const CP::TUBDAQChannelSelection& selection) {
+        fChannelSelection = selection;
+    }
+
+    /// Only convert the selected events with one of the trigger bits in
+    /// mask (see TUBDAQInput::SetTriggerSelection()).
+    void SetTriggerSelection(int mask) {fTriggerSelection = mask;}
+
+    /// Save the TPC digits as TCompactPulseDigits (see
+    /// TUBDAQInput::SetCompactDigits()).
+    void SetCompactDigits(int encoding) {fCompactDigits = encoding;}
+
+    /// Save the TPC samples as a waveform matrix (see
+    /// TUBDAQInput::SetWaveformMatrix()).
+    void SetWaveformMatrix(int mode) {fWaveformMatrix = mode;}
+
+    /// Only save the regions of interest in the TPC waveforms (see
+    /// TUBDAQInput::SetRegionsOfInterest()).
+    void SetRegionsOfInterest(double threshold, int padding) {
+        fRegionThreshold = threshold;
+        fRegionPadding = padding;
+    }
+
+private:
+    /// Close the current raw file and open a file from the catalog.  This
+    /// returns false if the file can't be opened.
+    bool OpenFile(int file);
+
+    /// Move the raw input to a catalog entry in the open file.
+    bool SeekEntry(const CP::TRawCatalog::Entry& entry);
+
+    /// Position the raw input at the next selected event that can be read.
+    /// This returns false if there are no more selected events.
+    bool PositionNext();
+
+    /// The name of the input.
+    std::string fFilename;
+
+    /// The catalog.
+    CP::TRawCatalog fCatalog;
+
+    /// The selected entries in file and offset order.
+    std::vector<CP::TRawCatalog::Entry> fSelected;
+
+    /// The index of the next selected entry.
+    std::size_t fNext;
+
+    /// Flag that the raw input is positioned at the next selected entry.
+    bool fPositioned;
+
+    /// The raw file that is being read.
+    CP::TVRawInput* fInput;
+
+    /// The raw file that is being read when it's a ubdaq file, otherwise
+    /// NULL.  This is the same object as fInput.
+    CP::TUBDAQInput* fUBDAQInput;
+
+    /// The catalog index of the raw file being read.
+    int fInputFile;
+
+    /// Flag that the catalog was read.
+    bool fOpen;
+
+    /// The first sample to convert.
+    int fFirstSample;
+
+    /// The last sample to convert.
+    int fLastSample;
+
+    /// The scaling for saving the digits.
+    int fScaledDigitSave;
+
+    /// The crates, cards and channels to convert.
+    CP::TUBDAQChannelSelection fChannelSelection;
+
+    /// The trigger bits to select, or zero for every event.
+    int fTriggerSelection;
+
+    /// The encoding for compact TPC digits, or zero for TPulseDigits.
+    int fCompactDigits;
+
+    /// The way the TPC samples are saved.
+    int fWaveformMatrix;
+
+    /// The region of interest threshold, or zero for full waveforms.
+    double fRegionThreshold;
+
+    /// The padding around each region of interest.
+    int fRegionPadding;
+};
+#endif
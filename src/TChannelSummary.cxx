@@ -0,0 +1,195 @@
+#include "TChannelSummary.hxx"
+
+#include <TROOT.h>
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+ClassImp(CP::TChannelSummary);
+
+namespace {
+    /// The sums collected for the samples of one channel.
+    struct SampleSums {
+        SampleSums()
+            : Sum(0), SumSquares(0), Minimum(0x7FFFFFFF),
+              Maximum(-0x7FFFFFFF), Saturated(0), StuckCode(0),
+              OrBits(0), AndBits(~0) {}
+        double Sum;
+        double SumSquares;
+        int Minimum;
+        int Maximum;
+        int Saturated;
+        int StuckCode;
+        int OrBits;
+        int AndBits;
+
+        void Add(int sample) {
+            Sum += sample;
+            SumSquares += (double) sample*sample;
+            Minimum = std::min(Minimum, sample);
+            Maximum = std::max(Maximum, sample);
+            if (sample <= 0 || sample >= 0xFFF) ++Saturated;
+            int low = sample & 0x3F;
+            if (low == 0 || low == 0x3F) ++StuckCode;
+            OrBits |= sample;
+            AndBits &= sample;
+        }
+    };
+
+    /// Add the samples to the sums.
+    template <typename Sample>
+    void sumSamples(const Sample* samples, int n, SampleSums& sums) {
+        for (int i = 0; i < n; ++i) sums.Add(samples[i]);
+    }
+
+#if defined(__SSE2__)
+    /// Add the samples to the sums with four samples at once.
+    void sumSamples(const int* samples, int n, SampleSums& sums) {
+        __m128d sum = _mm_setzero_pd();
+        __m128d sumSquares = _mm_setzero_pd();
+        __m128i minimum = _mm_set1_epi32(0x7FFFFFFF);
+        __m128i maximum = _mm_set1_epi32(-0x7FFFFFFF);
+        __m128i saturated = _mm_setzero_si128();
+        __m128i stuckCode = _mm_setzero_si128();
+        __m128i orBits = _mm_setzero_si128();
+        __m128i andBits = _mm_set1_epi32(~0);
+        const __m128i top = _mm_set1_epi32(0xFFE);
+        const __m128i bottom = _mm_set1_epi32(1);
+        const __m128i lowMask = _mm_set1_epi32(0x3F);
+        const __m128i zero = _mm_setzero_si128();
+        int i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m128i s = _mm_loadu_si128((const __m128i*)(samples + i));
+            __m128d low = _mm_cvtepi32_pd(s);
+            __m128d high = _mm_cvtepi32_pd(_mm_shuffle_epi32(s, 0xEE));
+            sum = _mm_add_pd(sum, _mm_add_pd(low, high));
+            sumSquares = _mm_add_pd(sumSquares,
+                                    _mm_add_pd(_mm_mul_pd(low, low),
+                                               _mm_mul_pd(high, high)));
+            // There isn't a 32 bit min or max in SSE2, so select with a
+            // compare.
+            __m128i less = _mm_cmplt_epi32(s, minimum);
+            minimum = _mm_or_si128(_mm_and_si128(less, s),
+                                   _mm_andnot_si128(less, minimum));
+            __m128i more = _mm_cmpgt_epi32(s, maximum);
+            maximum = _mm_or_si128(_mm_and_si128(more, s),
+                                   _mm_andnot_si128(more, maximum));
+            // The compares are -1 where true, so subtracting counts.
+            saturated = _mm_sub_epi32(
+                saturated, _mm_or_si128(_mm_cmpgt_epi32(s, top),
+                                        _mm_cmplt_epi32(s, bottom)));
+            __m128i code = _mm_and_si128(s, lowMask);
+            stuckCode = _mm_sub_epi32(
+                stuckCode, _mm_or_si128(_mm_cmpeq_epi32(code, zero),
+                                        _mm_cmpeq_epi32(code, lowMask)));
+            orBits = _mm_or_si128(orBits, s);
+            andBits = _mm_and_si128(andBits, s);
+        }
+
+        double sumLanes[2];
+        double squareLanes[2];
+        int minLanes[4], maxLanes[4], satLanes[4], codeLanes[4];
+        int orLanes[4], andLanes[4];
+        _mm_storeu_pd(sumLanes, sum);
+        _mm_storeu_pd(squareLanes, sumSquares);
+        _mm_storeu_si128((__m128i*) minLanes, minimum);
+        _mm_storeu_si128((__m128i*) maxLanes, maximum);
+        _mm_storeu_si128((__m128i*) satLanes, saturated);
+        _mm_storeu_si128((__m128i*) codeLanes, stuckCode);
+        _mm_storeu_si128((__m128i*) orLanes, orBits);
+        _mm_storeu_si128((__m128i*) andLanes, andBits);
+        sums.Sum += sumLanes[0] + sumLanes[1];
+        sums.SumSquares += squareLanes[0] + squareLanes[1];
+        for (int lane = 0; lane < 4; ++lane) {
+            sums.Minimum = std::min(sums.Minimum, minLanes[lane]);
+            sums.Maximum = std::max(sums.Maximum, maxLanes[lane]);
+            sums.Saturated += satLanes[lane];
+            sums.StuckCode += codeLanes[lane];
+            sums.OrBits |= orLanes[lane];
+            sums.AndBits &= andLanes[lane];
+        }
+
+        for (; i < n; ++i) sums.Add(samples[i]);
+    }
+#endif
+}
+
+CP::TChannelSummary::TChannelSummary(const char* name, const char* title)
+    : CP::TDatum(name,title) {}
+
+CP::TChannelSummary::~TChannelSummary() {}
+
+void CP::TChannelSummary::Fill(const CP::TChannelId& id,
+                               const CP::TPulseDigit::Vector& adc) {
+    SampleSums sums;
+    int n = adc.size();
+    if (n > 0) sumSamples(&adc[0], n, sums);
+
+    double pedestal = 0;
+    double rms = 0;
+    if (n > 0) {
+        pedestal = sums.Sum/n;
+        rms = sums.SumSquares/n - pedestal*pedestal;
+        rms = (rms > 0) ? std::sqrt(rms) : 0;
+    }
+    else {
+        sums.Minimum = sums.Maximum = 0;
+        sums.AndBits = 0;
+    }
+
+    fChannel.push_back(id.AsUInt());
+    fSampleCount.push_back(n);
+    fPedestal.push_back(pedestal);
+    fRMS.push_back(rms);
+    fMinimum.push_back(sums.Minimum);
+    fMaximum.push_back(sums.Maximum);
+    fSaturated.push_back(sums.Saturated);
+    fStuckOn.push_back(sums.AndBits & 0xFFF);
+    fStuckOff.push_back(~sums.OrBits & 0xFFF);
+    fStuckCode.push_back(sums.StuckCode);
+}
+
+void CP::TChannelSummary::Clear(Option_t*) {
+    fChannel.clear();
+    fSampleCount.clear();
+    fPedestal.clear();
+    fRMS.clear();
+    fMinimum.clear();
+    fMaximum.clear();
+    fSaturated.clear();
+    fStuckOn.clear();
+    fStuckOff.clear();
+    fStuckCode.clear();
+}
+
+int CP::TChannelSummary::Find(const CP::TChannelId& id) const {
+    std::vector<UInt_t>::const_iterator row
+        = std::find(fChannel.begin(), fChannel.end(), id.AsUInt());
+    if (row == fChannel.end()) return -1;
+    return row - fChannel.begin();
+}
+
+void CP::TChannelSummary::ls(Option_t* opt) const {
+    CP::TDatum::ls(opt);
+    TROOT::IncreaseDirLevel();
+    for (int row = 0; row < GetChannelCount(); ++row) {
+        TROOT::IndentLevel();
+        std::cout << GetChannelId(row)
+                  << " pedestal: " << std::setprecision(5) << fPedestal[row]
+                  << " rms: " << fRMS[row]
+                  << " range: " << fMinimum[row] << "-" << fMaximum[row]
+                  << " saturated: " << fSaturated[row]
+                  << std::hex
+                  << " stuck on: 0x" << fStuckOn[row]
+                  << " off: 0x" << fStuckOff[row]
+                  << std::dec
+                  << std::endl;
+    }
+    TROOT::DecreaseDirLevel();
+}
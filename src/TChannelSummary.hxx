@@ -0,0 +1,114 @@
+#ifndef TChannelSummary_hxx_seen
+#define TChannelSummary_hxx_seen
+
+#include <TDatum.hxx>
+#include <TChannelId.hxx>
+#include <TPulseDigit.hxx>
+
+#include <vector>
+
+namespace CP {
+    class TChannelSummary;
+};
+
+/// Summary statistics of the ADC samples for each channel in an event.
+/// This is filled while the raw data is converted so that the data quality
+/// can be checked without keeping or rereading the digits.  There is one
+/// row for each channel, and the rows are saved as columns so the datum is
+/// compact in the output file.  The samples are 12 bit ADC values.
+///
+/// The stuck bit masks show the ADC bits that never changed: a bit in
+/// GetStuckOn() was set in every sample, and a bit in GetStuckOff() was
+/// clear in every sample.  The stuck code count is the number of samples
+/// where the six low bits are all zero or all one, which is how a stuck
+/// ADC bit usually shows up.
+class CP::TChannelSummary : public CP::TDatum {
+public:
+    TChannelSummary(const char* name = "channelSummary",
+                    const char* title = "ADC Channel Summary");
+    virtual ~TChannelSummary();
+
+    /// Add a row for a channel with the statistics of the samples.
+    void Fill(const CP::TChannelId& id, const CP::TPulseDigit::Vector& adc);
+
+    /// Remove all of the rows.
+    virtual void Clear(Option_t* opt = "");
+
+    /// Get the number of channels.
+    int GetChannelCount() const {return fChannel.size();}
+
+    /// Find the row for a channel.  This returns -1 if the channel isn't
+    /// in the summary.
+    int Find(const CP::TChannelId& id) const;
+
+    /// Get the channel for a row.
+    CP::TChannelId GetChannelId(int row) const {
+        return CP::TChannelId(fChannel[row]);
+    }
+
+    /// Get the number of samples for a row.
+    int GetSampleCount(int row) const {return fSampleCount[row];}
+
+    /// Get the mean of the samples for a row.
+    double GetPedestal(int row) const {return fPedestal[row];}
+
+    /// Get the RMS of the samples around the pedestal for a row.
+    double GetRMS(int row) const {return fRMS[row];}
+
+    /// Get the smallest sample for a row.
+    int GetMinimum(int row) const {return fMinimum[row];}
+
+    /// Get the largest sample for a row.
+    int GetMaximum(int row) const {return fMaximum[row];}
+
+    /// Get the number of samples at the bottom (0) or top (4095) of the ADC
+    /// range for a row.
+    int GetSaturated(int row) const {return fSaturated[row];}
+
+    /// Get the ADC bits that were set in every sample for a row.
+    int GetStuckOn(int row) const {return fStuckOn[row];}
+
+    /// Get the ADC bits that were clear in every sample for a row.
+    int GetStuckOff(int row) const {return fStuckOff[row];}
+
+    /// Get the number of samples with the six low bits all zero or all one
+    /// for a row.
+    int GetStuckCode(int row) const {return fStuckCode[row];}
+
+    /// Print the summary.
+    virtual void ls(Option_t* opt = "") const;
+
+private:
+    /// The channel ids.
+    std::vector<UInt_t> fChannel;
+
+    /// The number of samples.
+    std::vector<Int_t> fSampleCount;
+
+    /// The mean of the samples.
+    std::vector<Float_t> fPedestal;
+
+    /// The RMS of the samples.
+    std::vector<Float_t> fRMS;
+
+    /// The smallest sample.
+    std::vector<Short_t> fMinimum;
+
+    /// The largest sample.
+    std::vector<Short_t> fMaximum;
+
+    /// The number of samples at the ends of the ADC range.
+    std::vector<Int_t> fSaturated;
+
+    /// The bits set in every sample.
+    std::vector<UShort_t> fStuckOn;
+
+    /// The bits clear in every sample.
+    std::vector<UShort_t> fStuckOff;
+
+    /// The number of samples with a stuck code.
+    std::vector<Int_t> fStuckCode;
+
+    ClassDef(TChannelSummary,1);
+};
+#endif
@@ -0,0 +1,137 @@
+#include "TCompactPulseDigit.hxx"
+#include "TUBDAQFormat.hxx"
+
+#include <TROOT.h>
+
+#include <iostream>
+#include <cstdlib>
+
+ClassImp(CP::TCompactPulseDigit);
+
+namespace {
+    /// The difference for a code with a number of zeros.
+    const int zerosDelta[7] = {0, -1, +1, -2, +2, -3, +3};
+}
+
+CP::TCompactPulseDigit::TCompactPulseDigit()
+    : fFirstSample(0), fSampleCount(0), fEncoding(kPacked),
+      fDecoded(false) {}
+
+CP::TCompactPulseDigit::TCompactPulseDigit(const CP::TChannelId& chan,
+                                           int first,
+                                           const CP::TPulseDigit::Vector& adc,
+                                           Encoding encoding)
+    : CP::TDigit(chan), fFirstSample(first), fSampleCount(adc.size()),
+      fEncoding(encoding), fDecoded(false) {
+    if (encoding == kHuffman) EncodeHuffman(adc);
+    else EncodePacked(adc);
+}
+
+CP::TCompactPulseDigit::~TCompactPulseDigit() {}
+
+void CP::TCompactPulseDigit::PushWord(UShort_t word) {
+    fData.push_back(word & 0xFF);
+    fData.push_back(word >> 8);
+}
+
+void CP::TCompactPulseDigit::EncodePacked(
+    const CP::TPulseDigit::Vector& adc) {
+    fData.clear();
+    fData.reserve(3*((adc.size()+1)/2));
+    for (std::size_t i = 0; i < adc.size(); i += 2) {
+        int low = adc[i] & 0xFFF;
+        int high = (i+1 < adc.size()) ? (adc[i+1] & 0xFFF) : 0;
+        fData.push_back(low & 0xFF);
+        fData.push_back((low >> 8) | ((high & 0xF) << 4));
+        fData.push_back(high >> 4);
+    }
+}
+
+void CP::TCompactPulseDigit::DecodePacked() const {
+    if (fSampleCount < 1) {
+        fSamples.clear();
+        return;
+    }
+    fSamples.resize(fSampleCount);
+    if (fData.size() < 3*(((std::size_t) fSampleCount+1)/2)) {
+        throw CP::ECorruptCompactDigit();
+    }
+    const UChar_t* data = &fData[0];
+    for (int i = 0; i < fSampleCount; i += 2) {
+        fSamples[i] = data[0] | ((data[1] & 0xF) << 8);
+        if (i+1 < fSampleCount) {
+            fSamples[i+1] = (data[1] >> 4) | (data[2] << 4);
+        }
+        data += 3;
+    }
+}
+
+void CP::TCompactPulseDigit::EncodeHuffman(
+    const CP::TPulseDigit::Vector& adc) {
+    // The DAQ encoding, but the explicit words keep all 12 bits.
+    CP::TUBDAQFormat::Words words;
+    words.reserve(adc.size());
+    CP::TUBDAQFormat::HuffmanEncode(adc, words, 0xFFF);
+    fData.clear();
+    fData.reserve(2*words.size());
+    for (std::size_t i = 0; i < words.size(); ++i) PushWord(words[i]);
+}
+
+void CP::TCompactPulseDigit::DecodeHuffman() const {
+    fSamples.clear();
+    if (fSampleCount > 0) fSamples.reserve(fSampleCount);
+    int previous = 0;
+    for (std::size_t i = 0; i+1 < fData.size(); i += 2) {
+        UShort_t word = fData[i] | (fData[i+1] << 8);
+        if (!(word & 0x8000)) {
+            previous = word & 0xFFF;
+            fSamples.push_back(previous);
+            continue;
+        }
+        int bit = 0;
+        while (!(word & (1 << bit))) ++bit;
+        int zeros = 0;
+        for (++bit; bit < 16; ++bit) {
+            if (!(word & (1 << bit))) {
+                ++zeros;
+                continue;
+            }
+            if (zeros > 6) throw CP::ECorruptCompactDigit();
+            previous += zerosDelta[zeros];
+            fSamples.push_back(previous);
+            zeros = 0;
+        }
+    }
+    if ((int) fSamples.size() != fSampleCount) {
+        throw CP::ECorruptCompactDigit();
+    }
+}
+
+const CP::TPulseDigit::Vector& CP::TCompactPulseDigit::GetSamples() const {
+    if (fDecoded) return fSamples;
+    if (fEncoding == kHuffman) DecodeHuffman();
+    else DecodePacked();
+    fDecoded = true;
+    return fSamples;
+}
+
+void CP::TCompactPulseDigit::ReleaseSamples() const {
+    CP::TPulseDigit::Vector empty;
+    fSamples.swap(empty);
+    fDecoded = false;
+}
+
+CP::TPulseDigit* CP::TCompactPulseDigit::MakePulseDigit() const {
+    return new CP::TPulseDigit(GetChannelId(), fFirstSample, GetSamples());
+}
+
+void CP::TCompactPulseDigit::ls(Option_t* opt) const {
+    TROOT::IndentLevel();
+    std::cout << "TCompactPulseDigit: " << GetChannelId()
+              << " first: " << fFirstSample
+              << " samples: " << fSampleCount
+              << " encoding: "
+              << (fEncoding == kHuffman ? "huffman" : "packed")
+              << " bytes: " << fData.size()
+              << std::endl;
+}
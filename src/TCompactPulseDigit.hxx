@@ -0,0 +1,115 @@
+#ifndef TCompactPulseDigit_hxx_seen
+#define TCompactPulseDigit_hxx_seen
+
+#include <ECore.hxx>
+#include <TDigit.hxx>
+#include <TPulseDigit.hxx>
+
+#include <vector>
+
+namespace CP {
+    class TCompactPulseDigit;
+
+    EXCEPTION(ECompactDigit,EoaCore);
+    EXCEPTION(ECorruptCompactDigit,ECompactDigit);
+};
+
+/// A pulse digit that keeps the ADC samples compressed in memory and in the
+/// output file.  Most of a TPC waveform is baseline, so this is several
+/// times smaller than a TPulseDigit.  The samples are decoded the first
+/// time they are accessed, and the decoded copy is kept until
+/// ReleaseSamples() is called.  The samples are 12 bit ADC values, and the
+/// higher bits are not saved.
+///
+/// The samples can be saved in one of two encodings.  The packed encoding
+/// keeps two samples in three bytes.  The Huffman encoding uses the delta
+/// code of the DAQ (see channelData::decompress()), so quiet channels take
+/// about one bit per sample.  Each 16 bit word is either an explicit sample
+/// (the high bit is clear), or has the high bit set and holds the codes for
+/// up to fifteen differences of -3 to +3 from the previous sample.
+class CP::TCompactPulseDigit : public CP::TDigit {
+public:
+    /// The ways that the samples can be saved.
+    enum Encoding {
+        kPacked = 1,
+        kHuffman = 2
+    };
+
+    TCompactPulseDigit();
+
+    /// Make a digit for a channel with samples starting at first.
+    TCompactPulseDigit(const CP::TChannelId& chan,
+                       int first,
+                       const CP::TPulseDigit::Vector& adc,
+                       Encoding encoding = kHuffman);
+
+    virtual ~TCompactPulseDigit();
+
+    /// Get the index of the first sample.
+    int GetFirstSample() const {return fFirstSample;}
+
+    /// Get the number of samples.
+    int GetSampleCount() const {return fSampleCount;}
+
+    /// Get a sample.  The samples are decoded on the first access.
+    int GetSample(int index) const {return GetSamples()[index];}
+
+    /// Get all of the samples.  The samples are decoded on the first
+    /// access.
+    const CP::TPulseDigit::Vector& GetSamples() const;
+
+    /// Free the decoded samples.  They will be decoded again if they are
+    /// accessed.
+    void ReleaseSamples() const;
+
+    /// Get the encoding of the saved samples.
+    Encoding GetEncoding() const {return static_cast<Encoding>(fEncoding);}
+
+    /// Get the number of bytes used to save the samples.
+    int GetEncodedSize() const {return fData.size();}
+
+    /// Make a TPulseDigit with the same channel and samples.  The caller
+    /// owns the new digit.
+    CP::TPulseDigit* MakePulseDigit() const;
+
+    /// Print the digit information.
+    virtual void ls(Option_t* opt = "") const;
+
+private:
+    /// Save the samples with two samples in three bytes.
+    void EncodePacked(const CP::TPulseDigit::Vector& adc);
+
+    /// Save the samples with the DAQ delta code.
+    void EncodeHuffman(const CP::TPulseDigit::Vector& adc);
+
+    /// Fill fSamples from the packed samples.
+    void DecodePacked() const;
+
+    /// Fill fSamples from the delta coded samples.
+    void DecodeHuffman() const;
+
+    /// Add a 16 bit word to the saved data.
+    void PushWord(UShort_t word);
+
+    /// The first sample of the digit.
+    Int_t fFirstSample;
+
+    /// The number of samples in the digit.
+    Int_t fSampleCount;
+
+    /// The encoding used for fData.
+    Int_t fEncoding;
+
+    /// The encoded samples.  The 16 bit words of the Huffman encoding are
+    /// saved with the low byte first.
+    std::vector<UChar_t> fData;
+
+    /// The decoded samples.  This is empty until the samples are accessed.
+    mutable CP::TPulseDigit::Vector fSamples; //! Not saved.
+
+    /// Flag that fSamples has been filled.
+    mutable bool fDecoded; //! Not saved.
+
+    ClassDef(TCompactPulseDigit,1);
+};
+#endif
@@ -0,0 +1,117 @@
+#include "TCountingStreamBuf.hxx"
+#include "TRawInputProfile.hxx"
+
+#include <algorithm>
+#include <cstring>
+
+CP::TCountingStreamBuf::TCountingStreamBuf(std::streambuf* source,
+                                           bool seekable)
+    : fSource(source), fSeekable(seekable), fBuffer(65536), fBufferStart(0),
+      fProfile(NULL), fProfileStage(0) {
+    setg(&fBuffer[0], &fBuffer[0], &fBuffer[0]);
+}
+
+CP::TCountingStreamBuf::~TCountingStreamBuf() {}
+
+CP::TCountingStreamBuf::int_type CP::TCountingStreamBuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    fBufferStart += egptr() - eback();
+    setg(&fBuffer[0], &fBuffer[0], &fBuffer[0]);
+    std::streamsize n = ReadSource(&fBuffer[0], fBuffer.size());
+    if (n < 1) return traits_type::eof();
+    setg(&fBuffer[0], &fBuffer[0], &fBuffer[0]+n);
+    return traits_type::to_int_type(*gptr());
+}
+
+std::streamsize CP::TCountingStreamBuf::ReadSource(char* s,
+                                                   std::streamsize n) {
+    // Only ask for what the source has ready so that a source that is
+    // waiting for data (e.g. a file that is still being written) returns
+    // as soon as anything is there.
+    CP::TRawInputProfile::Timer timer(fProfile, fProfileStage);
+    if (traits_type::eq_int_type(fSource->sgetc(), traits_type::eof())) {
+        return 0;
+    }
+    std::streamsize avail = fSource->in_avail();
+    if (avail < 1) avail = 1;
+    return fSource->sgetn(s, std::min(avail, n));
+}
+
+bool CP::TCountingStreamBuf::Peek(char* s, std::streamsize n) {
+    if (n > (std::streamsize) fBuffer.size()) return false;
+    while (egptr() - gptr() < n) {
+        // Move the unread characters to the front of the buffer and read
+        // more after them.
+        std::streamsize unread = egptr() - gptr();
+        fBufferStart += gptr() - eback();
+        std::memmove(&fBuffer[0], gptr(), unread);
+        setg(&fBuffer[0], &fBuffer[0], &fBuffer[0]+unread);
+        std::streamsize got = ReadSource(&fBuffer[0]+unread,
+                                         fBuffer.size()-unread);
+        if (got < 1) return false;
+        setg(&fBuffer[0], &fBuffer[0], &fBuffer[0]+unread+got);
+    }
+    std::memcpy(s, gptr(), n);
+    return true;
+}
+
+std::streamsize CP::TCountingStreamBuf::xsgetn(char* s, std::streamsize n) {
+    // Copy what's already buffered, and then read large requests directly
+    // from the source so the crate payloads aren't copied twice.
+    std::streamsize done = 0;
+    while (done < n) {
+        std::streamsize avail = egptr() - gptr();
+        if (avail > 0) {
+            std::streamsize chunk = std::min(avail, n-done);
+            std::memcpy(s+done, gptr(), chunk);
+            gbump(chunk);
+            done += chunk;
+            continue;
+        }
+        if (n-done >= (std::streamsize) fBuffer.size()) {
+            fBufferStart += egptr() - eback();
+            setg(&fBuffer[0], &fBuffer[0], &fBuffer[0]);
+            CP::TRawInputProfile::Timer timer(fProfile, fProfileStage);
+            std::streamsize got = fSource->sgetn(s+done, n-done);
+            if (got < 1) break;
+            fBufferStart += got;
+            done += got;
+            continue;
+        }
+        if (traits_type::eq_int_type(underflow(), traits_type::eof())) break;
+    }
+    return done;
+}
+
+bool CP::TCountingStreamBuf::SkipTo(std::streamoff position) {
+    std::streamoff current = GetPosition();
+    if (position == current) return true;
+
+    // The position is inside of the local buffer.
+    if (fBufferStart <= position
+        && position <= fBufferStart + (egptr() - eback())) {
+        setg(eback(), eback() + (position-fBufferStart), egptr());
+        return true;
+    }
+
+    if (fSeekable) {
+        std::streampos pos = fSource->pubseekpos(position, std::ios_base::in);
+        if (pos == std::streampos(std::streamoff(-1))) return false;
+        fBufferStart = position;
+        setg(&fBuffer[0], &fBuffer[0], &fBuffer[0]);
+        return true;
+    }
+
+    // Read forward through the source.
+    if (position < current) return false;
+    while (GetPosition() < position) {
+        if (gptr() == egptr()
+            && traits_type::eq_int_type(underflow(), traits_type::eof())) {
+            return false;
+        }
+        std::streamoff step = std::min<std::streamoff>(
+            egptr() - gptr(), position - GetPosition());
+        gbump(step);
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef TCountingStreamBuf_hxx_seen
+#define TCountingStreamBuf_hxx_seen
+
+#include <streambuf>
+#include <vector>
+
+namespace CP {
+    class TCountingStreamBuf;
+    class TRawInputProfile;
+};
+
+/// An input stream buffer that reads from another stream buffer and keeps
+/// track of the position of the next character.  This is used by the raw
+/// inputs so that the offset of each record can be found even when the
+/// file is being decompressed on the fly (the position is then counted in
+/// the decompressed stream).  The source buffer is not owned.
+class CP::TCountingStreamBuf : public std::streambuf {
+public:
+    /// Read from the source buffer.  If seekable is true, then SkipTo() will
+    /// seek the source instead of reading and throwing away the characters.
+    explicit TCountingStreamBuf(std::streambuf* source, bool seekable=false);
+    virtual ~TCountingStreamBuf();
+
+    /// Get the position of the next character that will be read.
+    std::streamoff GetPosition() const {
+        return fBufferStart + (gptr() - eback());
+    }
+
+    /// Move forward to a position in the stream.  This returns false if the
+    /// position is before the current position and the source can't seek,
+    /// or if the source ends before the position is reached.
+    bool SkipTo(std::streamoff position);
+
+    /// Drop the buffered characters and set the position of the next
+    /// character.  This is used after the source was moved (e.g. see
+    /// TInflateStreamBuf::Resume()).
+    void Reset(std::streamoff position) {
+        fBufferStart = position;
+        setg(&fBuffer[0], &fBuffer[0], &fBuffer[0]);
+    }
+
+    /// Copy the next n characters into s without moving the position.  This
+    /// returns false if the stream ends first.  The number of characters
+    /// must be less than the buffer size.
+    bool Peek(char* s, std::streamsize n);
+
+    /// Time the reads from the source as a stage of a profile (see
+    /// TRawInputProfile).  This includes any decompression.  The profile
+    /// is not owned.
+    void SetProfile(CP::TRawInputProfile* profile, int stage) {
+        fProfile = profile;
+        fProfileStage = stage;
+    }
+
+protected:
+    virtual int_type underflow();
+    virtual std::streamsize xsgetn(char* s, std::streamsize n);
+
+private:
+    /// Read up to n characters that are ready in the source, waiting only
+    /// if nothing is ready.  This returns zero at the end of the source.
+    std::streamsize ReadSource(char* s, std::streamsize n);
+
+    /// The buffer that is being read.
+    std::streambuf* fSource;
+
+    /// Flag that the source can seek.
+    bool fSeekable;
+
+    /// The local buffer.
+    std::vector<char> fBuffer;
+
+    /// The position of the start of the local buffer in the source.
+    std::streamoff fBufferStart;
+
+    /// The profile for the source reads, or NULL.
+    CP::TRawInputProfile* fProfile;
+
+    /// The profile stage for the source reads.
+    int fProfileStage;
+};
+#endif
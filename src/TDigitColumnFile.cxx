@@ -0,0 +1,339 @@
+#include "TDigitColumnFile.hxx"
+#include "TCompactPulseDigit.hxx"
+
+#include <TEvent.hxx>
+#include <TDigitContainer.hxx>
+#include <TPulseDigit.hxx>
+#include <TCaptLog.hxx>
+
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace {
+    /// The magic number at the start of a column file.
+    const char kMagic[8] = {'C','A','P','T','C','O','L','S'};
+
+    /// The version of the file layout.
+    const uint32_t kVersion = 1;
+
+    /// The alignment of the columns in the file.
+    const uint64_t kAlignment = 64;
+
+    /// Check that count items of size bytes starting at offset are inside
+    /// a mapped file.  This is written so that a corrupt count or offset
+    /// can't overflow.
+    bool inMap(uint64_t offset, uint64_t count, uint64_t size,
+               uint64_t mapSize) {
+        if (offset > mapSize) return false;
+        return count <= (mapSize - offset)/size;
+    }
+}
+
+CP::TDigitColumnFile::TDigitColumnFile()
+    : fMap(NULL), fMapSize(0), fHeader(NULL), fEvents(NULL),
+      fRowGroups(NULL), fOutput(NULL), fWritten(0), fWriteError(false),
+      fRowGroupSamples(0), fDigitCount(0), fSampleCount(0) {
+    SetRowGroupSize(64);
+}
+
+CP::TDigitColumnFile::~TDigitColumnFile() {
+    Close();
+}
+
+void CP::TDigitColumnFile::SetRowGroupSize(double megabytes) {
+    fRowGroupSamples = megabytes*1024*1024/sizeof(int16_t);
+}
+
+bool CP::TDigitColumnFile::Create(const std::string& fileName) {
+    Close();
+    fOutput = std::fopen(fileName.c_str(), "wb");
+    if (!fOutput) {
+        CaptError("Cannot write digit columns " << fileName);
+        return false;
+    }
+    fFileName = fileName;
+    fWritten = 0;
+    fWriteError = false;
+    fDigitCount = 0;
+    fSampleCount = 0;
+    fEventTable.clear();
+    fRowGroupTable.clear();
+    fSamples.clear();
+    fChannelIds.clear();
+    fKinds.clear();
+    fFirstSamples.clear();
+    fSampleOffsets.assign(1, 0);
+
+    // The header is written again when the file is finished.
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    Write(&header, sizeof(header));
+    return !fWriteError;
+}
+
+void CP::TDigitColumnFile::Write(const void* data, std::size_t bytes) {
+    if (fWriteError || bytes < 1) return;
+    if (std::fwrite(data, 1, bytes, fOutput) != bytes) fWriteError = true;
+    fWritten += bytes;
+}
+
+void CP::TDigitColumnFile::Align() {
+    static const char padding[kAlignment] = {0};
+    Write(padding, (kAlignment - fWritten%kAlignment)%kAlignment);
+}
+
+void CP::TDigitColumnFile::AddDigits(const CP::TDigitContainer& digits,
+                                     int kind) {
+    for (CP::TDigitContainer::const_iterator d = digits.begin();
+         d != digits.end(); ++d) {
+        int first = 0;
+        if (const CP::TPulseDigit* pulse
+            = dynamic_cast<const CP::TPulseDigit*>(*d)) {
+            first = pulse->GetFirstSample();
+            for (int s = 0; s < pulse->GetSampleCount(); ++s) {
+                fSamples.push_back(pulse->GetSample(s));
+            }
+        }
+        else if (const CP::TCompactPulseDigit* compact
+                 = dynamic_cast<const CP::TCompactPulseDigit*>(*d)) {
+            first = compact->GetFirstSample();
+            const CP::TPulseDigit::Vector& samples = compact->GetSamples();
+            fSamples.insert(fSamples.end(), samples.begin(), samples.end());
+        }
+        else continue;
+        fChannelIds.push_back((*d)->GetChannelId().AsUInt());
+        fKinds.push_back(kind);
+        fFirstSamples.push_back(first);
+        fSampleOffsets.push_back(fSamples.size());
+    }
+}
+
+bool CP::TDigitColumnFile::AddEvent(CP::TEvent& event) {
+    if (!fOutput) return false;
+    const CP::TEventContext& context = event.GetContext();
+    EventEntry entry;
+    std::memset(&entry, 0, sizeof(entry));
+    entry.Run = context.GetRun();
+    entry.SubRun = context.GetSubRun();
+    entry.Event = context.GetEvent();
+    entry.Seconds = context.GetTimeStamp();
+    entry.Nanoseconds = context.GetNanoseconds();
+    entry.RowGroup = fRowGroupTable.size();
+    entry.FirstDigit = fChannelIds.size();
+
+    CP::THandle<CP::TDigitContainer> drift
+        = event.Get<CP::TDigitContainer>("~/digits/drift");
+    if (drift) AddDigits(*drift, kTPC);
+    CP::THandle<CP::TDigitContainer> pmt
+        = event.Get<CP::TDigitContainer>("~/digits/pmt");
+    if (pmt) AddDigits(*pmt, kPMT);
+
+    entry.DigitCount = fChannelIds.size() - entry.FirstDigit;
+    fEventTable.push_back(entry);
+
+    // The row group is written once it's full, so it always holds whole
+    // events.
+    if (fSamples.size() >= fRowGroupSamples) WriteRowGroup();
+    return !fWriteError;
+}
+
+void CP::TDigitColumnFile::WriteRowGroup() {
+    RowGroupEntry group;
+    std::memset(&group, 0, sizeof(group));
+    group.FirstEvent = 0;
+    if (!fRowGroupTable.empty()) {
+        group.FirstEvent = fRowGroupTable.back().FirstEvent
+            + fRowGroupTable.back().EventCount;
+    }
+    group.EventCount = fEventTable.size() - group.FirstEvent;
+    if (group.EventCount < 1) return;
+    group.DigitCount = fChannelIds.size();
+    group.SampleCount = fSamples.size();
+
+    Align();
+    group.Samples = fWritten;
+    if (!fSamples.empty()) {
+        Write(&fSamples[0], fSamples.size()*sizeof(int16_t));
+    }
+    Align();
+    group.ChannelIds = fWritten;
+    if (!fChannelIds.empty()) {
+        Write(&fChannelIds[0], fChannelIds.size()*sizeof(uint32_t));
+    }
+    Align();
+    group.Kinds = fWritten;
+    if (!fKinds.empty()) Write(&fKinds[0], fKinds.size());
+    Align();
+    group.FirstSamples = fWritten;
+    if (!fFirstSamples.empty()) {
+        Write(&fFirstSamples[0], fFirstSamples.size()*sizeof(int32_t));
+    }
+    Align();
+    group.SampleOffsets = fWritten;
+    Write(&fSampleOffsets[0], fSampleOffsets.size()*sizeof(uint64_t));
+    fRowGroupTable.push_back(group);
+
+    fDigitCount += group.DigitCount;
+    fSampleCount += group.SampleCount;
+    fSamples.clear();
+    fChannelIds.clear();
+    fKinds.clear();
+    fFirstSamples.clear();
+    fSampleOffsets.assign(1, 0);
+}
+
+bool CP::TDigitColumnFile::Finish() {
+    if (!fOutput) return false;
+    WriteRowGroup();
+    Align();
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.Magic, kMagic, sizeof(kMagic));
+    header.Version = kVersion;
+    header.Complete = 1;
+    header.EventCount = fEventTable.size();
+    header.DigitCount = fDigitCount;
+    header.SampleCount = fSampleCount;
+    header.RowGroupCount = fRowGroupTable.size();
+    header.EventTable = fWritten;
+    if (!fEventTable.empty()) {
+        Write(&fEventTable[0], fEventTable.size()*sizeof(EventEntry));
+    }
+    header.RowGroupTable = fWritten;
+    if (!fRowGroupTable.empty()) {
+        Write(&fRowGroupTable[0],
+              fRowGroupTable.size()*sizeof(RowGroupEntry));
+    }
+
+    if (!fWriteError) {
+        if (std::fseek(fOutput, 0, SEEK_SET) != 0) fWriteError = true;
+        else if (std::fwrite(&header, sizeof(header), 1, fOutput) != 1) {
+            fWriteError = true;
+        }
+    }
+    if (std::fclose(fOutput) != 0) fWriteError = true;
+    fOutput = NULL;
+    fEventTable.clear();
+    fRowGroupTable.clear();
+
+    if (fWriteError) {
+        CaptError("Cannot write digit columns " << fFileName);
+        return false;
+    }
+    CaptLog("Wrote digit columns " << fFileName
+            << " (" << header.EventCount << " events, "
+            << header.DigitCount << " digits in "
+            << header.RowGroupCount << " row groups)");
+    return true;
+}
+
+bool CP::TDigitColumnFile::Open(const std::string& fileName) {
+    Close();
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat status;
+    if (fstat(fd, &status) != 0
+        || status.st_size < (off_t) sizeof(FileHeader)) {
+        close(fd);
+        return false;
+    }
+    void* map = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+    fMap = static_cast<const char*>(map);
+    fMapSize = status.st_size;
+    fHeader = reinterpret_cast<const FileHeader*>(fMap);
+
+    bool valid = std::memcmp(fHeader->Magic, kMagic, sizeof(kMagic)) == 0
+        && fHeader->Version == kVersion
+        && fHeader->Complete == 1
+        && inMap(fHeader->EventTable, fHeader->EventCount,
+                 sizeof(EventEntry), fMapSize)
+        && inMap(fHeader->RowGroupTable, fHeader->RowGroupCount,
+                 sizeof(RowGroupEntry), fMapSize);
+    if (valid) {
+        fEvents = reinterpret_cast<const EventEntry*>(
+            fMap + fHeader->EventTable);
+        fRowGroups = reinterpret_cast<const RowGroupEntry*>(
+            fMap + fHeader->RowGroupTable);
+        valid = CheckColumns();
+    }
+    if (!valid) {
+        CaptError("Invalid digit column file " << fileName);
+        Close();
+        return false;
+    }
+    fFileName = fileName;
+    return true;
+}
+
+bool CP::TDigitColumnFile::CheckColumns() const {
+    for (uint64_t g = 0; g < fHeader->RowGroupCount; ++g) {
+        const RowGroupEntry& group = fRowGroups[g];
+        if (!inMap(group.Samples, group.SampleCount,
+                   sizeof(int16_t), fMapSize)
+            || !inMap(group.ChannelIds, group.DigitCount,
+                      sizeof(uint32_t), fMapSize)
+            || !inMap(group.Kinds, group.DigitCount,
+                      sizeof(uint8_t), fMapSize)
+            || !inMap(group.FirstSamples, group.DigitCount,
+                      sizeof(int32_t), fMapSize)
+            || group.DigitCount >= fMapSize
+            || !inMap(group.SampleOffsets, group.DigitCount+1,
+                      sizeof(uint64_t), fMapSize)) {
+            return false;
+        }
+        // The samples of each digit must be inside the sample column.
+        const uint64_t* offsets = GetSampleOffsets(group);
+        uint64_t last = 0;
+        for (uint64_t d = 0; d <= group.DigitCount; ++d) {
+            if (offsets[d] < last || offsets[d] > group.SampleCount) {
+                return false;
+            }
+            last = offsets[d];
+        }
+    }
+    for (uint64_t e = 0; e < fHeader->EventCount; ++e) {
+        const EventEntry& event = fEvents[e];
+        if (event.RowGroup >= fHeader->RowGroupCount) return false;
+        const RowGroupEntry& group = fRowGroups[event.RowGroup];
+        if (event.FirstDigit > group.DigitCount
+            || event.DigitCount > group.DigitCount - event.FirstDigit) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const int16_t* CP::TDigitColumnFile::GetEventSamples(int event,
+                                                     uint64_t& count) const {
+    const EventEntry& entry = GetEvent(event);
+    const RowGroupEntry& group = GetRowGroup(entry.RowGroup);
+    const uint64_t* offsets = GetSampleOffsets(group);
+    uint64_t first = offsets[entry.FirstDigit];
+    count = offsets[entry.FirstDigit + entry.DigitCount] - first;
+    return GetSamples(group) + first;
+}
+
+void CP::TDigitColumnFile::Close() {
+    if (fOutput) {
+        std::fclose(fOutput);
+        fOutput = NULL;
+        fEventTable.clear();
+        fRowGroupTable.clear();
+    }
+    if (fMap) {
+        munmap(const_cast<char*>(fMap), fMapSize);
+        fMap = NULL;
+        fMapSize = 0;
+        fHeader = NULL;
+        fEvents = NULL;
+        fRowGroups = NULL;
+    }
+}
@@ -0,0 +1,223 @@
+#ifndef TDigitColumnFile_hxx_seen
+#define TDigitColumnFile_hxx_seen
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+
+namespace CP {
+    class TDigitColumnFile;
+    class TEvent;
+    class TDigitContainer;
+};
+
+/// A flat file with the TPC and PMT digits of the converted events saved
+/// as columns so that an analysis (e.g. numpy.memmap in python) can map it
+/// into memory and get the samples without reading the events back through
+/// ROOT.  It's written by capt-trans with -O columns=<file>.
+///
+/// The digits are saved in row groups of consecutive events.  Each row
+/// group has a column with the samples of every digit (int16), and columns
+/// with the channel id, the kind (TPC or PMT), the first sample, and the
+/// offset of each digit in the sample column.  The offset column has one
+/// more entry than there are digits, so the samples of digit i are from
+/// offset[i] up to offset[i+1].  The digits of an event are together, so
+/// the samples of an event are one contiguous block that can be read (or
+/// mapped) at once.  The row group size is set in MB of samples, and a row
+/// group always has at least one event.
+///
+/// The file starts with a FileHeader, followed by the row groups (each
+/// column is aligned to 64 bytes), the EventEntry table, and the
+/// RowGroupEntry table.  The offsets in the tables are bytes from the start
+/// of the file, and every value is in native byte order.  The header is
+/// written last, and is only marked complete when the file was finished.
+///
+/// \code
+/// CP::TDigitColumnFile columns;
+/// columns.Open("run.cols");
+/// uint64_t count;
+/// const int16_t* samples = columns.GetEventSamples(10, count);
+/// \endcode
+class CP::TDigitColumnFile {
+public:
+    /// The header at the beginning of the file.
+    struct FileHeader {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t Complete;
+        uint64_t EventCount;
+        uint64_t DigitCount;
+        uint64_t SampleCount;
+        uint64_t RowGroupCount;
+        uint64_t EventTable;
+        uint64_t RowGroupTable;
+        uint64_t Reserved[8];
+    };
+
+    /// An event.  The digits are counted from the start of the row group.
+    struct EventEntry {
+        int32_t Run;
+        int32_t SubRun;
+        int32_t Event;
+        uint32_t Seconds;
+        uint32_t Nanoseconds;
+        uint32_t RowGroup;
+        uint64_t FirstDigit;
+        uint64_t DigitCount;
+    };
+
+    /// A row group, and the offsets of its columns.
+    struct RowGroupEntry {
+        uint64_t FirstEvent;
+        uint64_t EventCount;
+        uint64_t DigitCount;
+        uint64_t SampleCount;
+        uint64_t Samples;        // int16_t[SampleCount]
+        uint64_t ChannelIds;     // uint32_t[DigitCount]
+        uint64_t Kinds;          // uint8_t[DigitCount]
+        uint64_t FirstSamples;   // int32_t[DigitCount]
+        uint64_t SampleOffsets;  // uint64_t[DigitCount+1]
+    };
+
+    /// The kinds of digit.
+    enum {
+        kTPC = 0,               // A digit in "~/digits/drift".
+        kPMT = 1                // A digit in "~/digits/pmt".
+    };
+
+    TDigitColumnFile();
+    virtual ~TDigitColumnFile();
+
+    /// Start writing a file.
+    bool Create(const std::string& fileName);
+
+    /// Set the size of the samples in a row group in MB.  This can be
+    /// changed while the file is written.
+    void SetRowGroupSize(double megabytes);
+
+    /// Add the digits of an event to a file being written.  This returns
+    /// false if the file can't be written.
+    bool AddEvent(CP::TEvent& event);
+
+    /// Finish a file being written.  This returns false if it couldn't be
+    /// written.
+    bool Finish();
+
+    /// Map a file for reading.  This returns false if the file doesn't
+    /// exist, isn't complete, or has a column or event outside the file.
+    bool Open(const std::string& fileName);
+
+    /// Close the file.  A file being written that wasn't finished is left
+    /// marked as incomplete.
+    void Close();
+
+    /// Flag that a file is being written.
+    bool IsWriting() const {return fOutput != NULL;}
+
+    /// Flag that a file is mapped for reading.
+    bool IsReading() const {return fMap != NULL;}
+
+    /// Get the number of events in a file being read.
+    int GetEventCount() const {return fHeader->EventCount;}
+
+    /// Get an event from a file being read.
+    const EventEntry& GetEvent(int event) const {return fEvents[event];}
+
+    /// Get the number of row groups in a file being read.
+    int GetRowGroupCount() const {return fHeader->RowGroupCount;}
+
+    /// Get a row group from a file being read.
+    const RowGroupEntry& GetRowGroup(int group) const {
+        return fRowGroups[group];
+    }
+
+    /// Get the columns of a row group from a file being read.
+    const int16_t* GetSamples(const RowGroupEntry& group) const {
+        return reinterpret_cast<const int16_t*>(fMap + group.Samples);
+    }
+    const uint32_t* GetChannelIds(const RowGroupEntry& group) const {
+        return reinterpret_cast<const uint32_t*>(fMap + group.ChannelIds);
+    }
+    const uint8_t* GetKinds(const RowGroupEntry& group) const {
+        return reinterpret_cast<const uint8_t*>(fMap + group.Kinds);
+    }
+    const int32_t* GetFirstSamples(const RowGroupEntry& group) const {
+        return reinterpret_cast<const int32_t*>(fMap + group.FirstSamples);
+    }
+    const uint64_t* GetSampleOffsets(const RowGroupEntry& group) const {
+        return reinterpret_cast<const uint64_t*>(fMap
+                                                 + group.SampleOffsets);
+    }
+
+    /// Get the samples of every digit in an event from a file being read,
+    /// and the number of samples.
+    const int16_t* GetEventSamples(int event, uint64_t& count) const;
+
+private:
+    /// Add the digits in a container to the row group being written.
+    void AddDigits(const CP::TDigitContainer& digits, int kind);
+
+    /// Check that the columns and events of a mapped file are inside the
+    /// file.
+    bool CheckColumns() const;
+
+    /// Write the row group being filled.
+    void WriteRowGroup();
+
+    /// Write a block to the file being written.
+    void Write(const void* data, std::size_t bytes);
+
+    /// Pad the file being written to the column alignment.
+    void Align();
+
+    /// The name of the file.
+    std::string fFileName;
+
+    /// The mapped file, or NULL.
+    const char* fMap;
+
+    /// The size of the mapped file.
+    std::size_t fMapSize;
+
+    /// The header of the mapped file.
+    const FileHeader* fHeader;
+
+    /// The event table of the mapped file.
+    const EventEntry* fEvents;
+
+    /// The row group table of the mapped file.
+    const RowGroupEntry* fRowGroups;
+
+    /// The file being written, or NULL.
+    std::FILE* fOutput;
+
+    /// The number of bytes written.
+    uint64_t fWritten;
+
+    /// Flag that a write failed.
+    bool fWriteError;
+
+    /// The number of samples in a row group.
+    uint64_t fRowGroupSamples;
+
+    /// The digits written so far.
+    uint64_t fDigitCount;
+
+    /// The samples written so far.
+    uint64_t fSampleCount;
+
+    /// The events for a file being written.
+    std::vector<EventEntry> fEventTable;
+
+    /// The row groups for a file being written.
+    std::vector<RowGroupEntry> fRowGroupTable;
+
+    /// The columns of the row group being filled.
+    std::vector<int16_t> fSamples;
+    std::vector<uint32_t> fChannelIds;
+    std::vector<uint8_t> fKinds;
+    std::vector<int32_t> fFirstSamples;
+    std::vector<uint64_t> fSampleOffsets;
+};
+#endif
@@ -0,0 +1,181 @@
+#include "TFollowStreamBuf.hxx"
+
+#include <TCaptLog.hxx>
+
+#include <cerrno>
+#include <ctime>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+CP::TFollowStreamBuf::TFollowStreamBuf(const char* name, int idleTimeout)
+    : fFile(-1), fNotify(-1), fIdleTimeout(idleTimeout),
+      fWriterClosed(false), fBuffer(65536) {
+    setg(&fBuffer[0], &fBuffer[0], &fBuffer[0]);
+
+    // The watch is set up before the file is opened so no writes are
+    // missed.
+#ifdef __linux__
+    fNotify = inotify_init();
+    if (fNotify >= 0
+        && inotify_add_watch(fNotify, name,
+                             IN_MODIFY | IN_CLOSE_WRITE
+                             | IN_DELETE_SELF | IN_MOVE_SELF) < 0) {
+        close(fNotify);
+        fNotify = -1;
+    }
+#endif
+    if (fNotify < 0) {
+        CaptWarn("Polling for changes to " << name);
+    }
+
+    fFile = open(name, O_RDONLY);
+    if (fFile < 0) {
+        CaptError("Cannot open " << name << " to follow");
+        return;
+    }
+
+    // A writer that closed the file before the watch was added will never
+    // send an event, so check that the file is still being written.
+    int writer = HasWriter();
+    if (writer == 0) {
+        CaptLog("No writer for " << name << ", reading to the end");
+        fWriterClosed = true;
+    }
+    else if (writer < 0 && fIdleTimeout < 0) {
+        CaptWarn("Cannot find the writer for " << name
+                 << " (use an idle timeout to stop following)");
+    }
+}
+
+bool CP::TFollowStreamBuf::IsGzip() const {
+    if (fFile < 0) return false;
+    unsigned char magic[2];
+    if (pread(fFile, magic, sizeof(magic), 0) != sizeof(magic)) return false;
+    return magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+int CP::TFollowStreamBuf::HasWriter() const {
+#ifdef __linux__
+    struct stat file;
+    if (fstat(fFile, &file) != 0) return -1;
+    DIR* proc = opendir("/proc");
+    if (!proc) return -1;
+    int result = 0;
+    // This process is checked too since the writer can be another thread.
+    // The descriptor being followed is read only so it doesn't count.
+    while (struct dirent* entry = readdir(proc)) {
+        char* end = NULL;
+        std::strtol(entry->d_name, &end, 10);
+        if (end == entry->d_name || *end != 0) continue;
+        std::string fdDir = std::string("/proc/") + entry->d_name + "/fd";
+        DIR* fds = opendir(fdDir.c_str());
+        // The process may have exited, or belong to another user, so only
+        // the processes that can be read are checked.
+        if (!fds) continue;
+        while (struct dirent* fd = readdir(fds)) {
+            if (fd->d_name[0] == '.') continue;
+            struct stat target;
+            std::string path = fdDir + "/" + fd->d_name;
+            if (stat(path.c_str(), &target) != 0) continue;
+            if (target.st_dev != file.st_dev
+                || target.st_ino != file.st_ino) continue;
+            // The flags in fdinfo are octal.
+            std::string info = std::string("/proc/") + entry->d_name
+                + "/fdinfo/" + fd->d_name;
+            std::FILE* flags = std::fopen(info.c_str(), "r");
+            if (!flags) continue;
+            char line[256];
+            while (std::fgets(line, sizeof(line), flags)) {
+                unsigned int mode;
+                if (std::sscanf(line, "flags: %o", &mode) != 1) continue;
+                if (mode & (O_WRONLY | O_RDWR)) result = 1;
+            }
+            std::fclose(flags);
+            if (result > 0) break;
+        }
+        closedir(fds);
+        if (result > 0) break;
+    }
+    closedir(proc);
+    return result;
+#else
+    return -1;
+#endif
+}
+
+CP::TFollowStreamBuf::~TFollowStreamBuf() {
+    if (fFile >= 0) close(fFile);
+    if (fNotify >= 0) close(fNotify);
+}
+
+CP::TFollowStreamBuf::int_type CP::TFollowStreamBuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    if (fFile < 0) return traits_type::eof();
+    while (true) {
+        ssize_t n = read(fFile, &fBuffer[0], fBuffer.size());
+        if (n > 0) {
+            setg(&fBuffer[0], &fBuffer[0], &fBuffer[0]+n);
+            return traits_type::to_int_type(*gptr());
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return traits_type::eof();
+        // At the current end of the file.  If the writer is finished, then
+        // this is the real end.
+        if (fWriterClosed) return traits_type::eof();
+        if (!WaitForData()) return traits_type::eof();
+    }
+}
+
+bool CP::TFollowStreamBuf::WaitForData() {
+    std::time_t start = std::time(NULL);
+    while (true) {
+        if (fNotify >= 0) {
+            struct pollfd watch;
+            watch.fd = fNotify;
+            watch.events = POLLIN;
+            watch.revents = 0;
+            int ready = poll(&watch, 1, 1000);
+            if (ready > 0) {
+#ifdef __linux__
+                char events[4096];
+                ssize_t n = read(fNotify, events, sizeof(events));
+                for (char* p = events; p < events + n; ) {
+                    struct inotify_event* event
+                        = reinterpret_cast<struct inotify_event*>(p);
+                    // A moved file is still followed since it's the same
+                    // file and the writer can still have it open.
+                    if (event->mask & (IN_CLOSE_WRITE | IN_DELETE_SELF)) {
+                        fWriterClosed = true;
+                    }
+                    p += sizeof(struct inotify_event) + event->len;
+                }
+#endif
+                return true;
+            }
+            if (ready < 0 && errno != EINTR) return false;
+        }
+        else {
+            // Without inotify, check the file every tenth of a second.
+            usleep(100000);
+            off_t here = lseek(fFile, 0, SEEK_CUR);
+            off_t end = lseek(fFile, 0, SEEK_END);
+            lseek(fFile, here, SEEK_SET);
+            if (end > here) return true;
+        }
+        if (fIdleTimeout >= 0 && std::time(NULL) - start >= fIdleTimeout) {
+            CaptLog("No new data for " << fIdleTimeout << " seconds");
+            return false;
+        }
+    }
+}
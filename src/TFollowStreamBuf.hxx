@@ -0,0 +1,66 @@
+#ifndef TFollowStreamBuf_hxx_seen
+#define TFollowStreamBuf_hxx_seen
+
+#include <streambuf>
+#include <vector>
+
+namespace CP {
+    class TFollowStreamBuf;
+};
+
+/// An input stream buffer for a file that is still being written.  When the
+/// reader catches up with the writer, this waits for more data instead of
+/// reporting the end of the file.  On linux the file is watched with
+/// inotify so new data is seen as soon as it's written, and the end of the
+/// file is reported once the writer closes the file (or the file is
+/// deleted) and everything has been read.  A file that's renamed is still
+/// followed since the writer can keep writing it.  If no other process has
+/// the file open for writing when it's opened, the writer has already
+/// finished and the end of the file is reported once everything has been
+/// read.  A reader that knows the file is finished (e.g. it found an end
+/// caboose) just stops reading.  If an idle timeout is set, the end of the
+/// file is also reported when nothing has been written for that long.
+class CP::TFollowStreamBuf : public std::streambuf {
+public:
+    /// Open a file to follow.  The idle timeout is in seconds, and a
+    /// negative timeout waits forever.
+    explicit TFollowStreamBuf(const char* name, int idleTimeout = -1);
+    virtual ~TFollowStreamBuf();
+
+    /// Flag that the file is open.
+    bool IsOpen() const {return fFile >= 0;}
+
+    /// Check if the file starts with the gzip magic number (0x1f 0x8b).
+    /// This doesn't use up any of the data.
+    bool IsGzip() const;
+
+protected:
+    virtual int_type underflow();
+
+private:
+    /// Wait until the file has changed.  This returns false if the idle
+    /// timeout expires.
+    bool WaitForData();
+
+    /// Check if another process has the file open for writing.  Processes
+    /// that can't be inspected (e.g. they belong to another user) are
+    /// skipped.  This returns -1 if it can't be checked at all (e.g.
+    /// without /proc).
+    int HasWriter() const;
+
+    /// The file descriptor being read.
+    int fFile;
+
+    /// The inotify descriptor, or -1 if it's not available.
+    int fNotify;
+
+    /// The idle timeout in seconds.
+    int fIdleTimeout;
+
+    /// Flag that the writer has closed the file.
+    bool fWriterClosed;
+
+    /// The local buffer.
+    std::vector<char> fBuffer;
+};
+#endif
@@ -0,0 +1,210 @@
+#include "TInflateStreamBuf.hxx"
+
+#include <TCaptLog.hxx>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    /// The size of the deflate window.
+    const std::size_t kWindowSize = 32768;
+
+    /// The zlib window bits to read a gzip member.
+    const int kGzipBits = 15 + 16;
+
+    /// The zlib window bits to read deflate data without the gzip wrapper.
+    const int kRawBits = -15;
+
+    /// The size of the gzip member trailer (the CRC and length).
+    const int kTrailerSize = 8;
+}
+
+CP::TInflateStreamBuf::TInflateStreamBuf(std::streambuf* source,
+                                         std::size_t blockSize)
+    : fSource(source), fStream(new z_stream), fRaw(false), fEnd(false),
+      fInput(blockSize), fInputStart(0), fOutput(blockSize), fOut(0),
+      fSpacing(0), fLastCheckpoint(0) {
+    setg(&fOutput[0], &fOutput[0], &fOutput[0]);
+    std::memset(fStream, 0, sizeof(z_stream));
+    fStream->next_in = reinterpret_cast<Bytef*>(&fInput[0]);
+    fStream->avail_in = 0;
+    if (inflateInit2(fStream, kGzipBits) != Z_OK) {
+        CaptError("Cannot start the decompression");
+        fEnd = true;
+    }
+    std::streamoff start = fSource->pubseekoff(0, std::ios_base::cur,
+                                               std::ios_base::in);
+    if (start > 0) fInputStart = start;
+}
+
+CP::TInflateStreamBuf::~TInflateStreamBuf() {
+    inflateEnd(fStream);
+    delete fStream;
+}
+
+bool CP::TInflateStreamBuf::FillInput() {
+    z_stream& strm = *fStream;
+    const char* next = reinterpret_cast<const char*>(strm.next_in);
+    std::size_t unused = strm.avail_in;
+    fInputStart += next - &fInput[0];
+    if (unused > 0) std::memmove(&fInput[0], next, unused);
+    strm.next_in = reinterpret_cast<Bytef*>(&fInput[0]);
+    std::streamsize got = fSource->sgetn(&fInput[unused],
+                                         fInput.size() - unused);
+    if (got < 1) return false;
+    strm.avail_in = unused + got;
+    return true;
+}
+
+bool CP::TInflateStreamBuf::SkipTrailer() {
+    z_stream& strm = *fStream;
+    int skip = kTrailerSize;
+    while (skip > 0) {
+        if (strm.avail_in < 1 && !FillInput()) return false;
+        int n = std::min<int>(skip, strm.avail_in);
+        strm.next_in += n;
+        strm.avail_in -= n;
+        skip -= n;
+    }
+    return true;
+}
+
+void CP::TInflateStreamBuf::SaveCheckpoint(std::streamoff out) {
+    z_stream& strm = *fStream;
+    std::vector<Bytef> window(kWindowSize);
+    uInt length = window.size();
+    if (inflateGetDictionary(&strm, &window[0], &length) != Z_OK) return;
+    Checkpoint checkpoint;
+    checkpoint.In = fInputStart + (reinterpret_cast<const char*>(strm.next_in)
+                                   - &fInput[0]);
+    checkpoint.Out = out;
+    checkpoint.Bits = strm.data_type & 7;
+    uLongf size = compressBound(length);
+    checkpoint.Window.resize(size);
+    if (compress2(reinterpret_cast<Bytef*>(&checkpoint.Window[0]), &size,
+                  &window[0], length, Z_BEST_SPEED) != Z_OK) {
+        return;
+    }
+    checkpoint.Window.resize(size);
+    fCheckpoints.push_back(checkpoint);
+    fLastCheckpoint = out;
+}
+
+std::streamsize CP::TInflateStreamBuf::Inflate(char* s, std::streamsize n) {
+    if (fEnd || n < 1) return 0;
+    z_stream& strm = *fStream;
+    strm.next_out = reinterpret_cast<Bytef*>(s);
+    strm.avail_out = n;
+    // Stop at the end of each deflate block when checkpoints are saved.
+    int flush = (fSpacing > 0) ? Z_BLOCK : Z_NO_FLUSH;
+    while (strm.avail_out > 0) {
+        if (strm.avail_in < 1 && !FillInput()) {
+            CaptError("Compressed data is truncated");
+            fEnd = true;
+            break;
+        }
+        int status = inflate(&strm, flush);
+        if (status == Z_STREAM_END) {
+            if (fRaw && !SkipTrailer()) {
+                CaptError("Compressed data is truncated");
+                fEnd = true;
+                break;
+            }
+            // Another gzip member can follow this one.
+            if (strm.avail_in < 1 && !FillInput()) {
+                fEnd = true;
+                break;
+            }
+            inflateReset2(&strm, kGzipBits);
+            fRaw = false;
+            continue;
+        }
+        if (status != Z_OK && status != Z_BUF_ERROR) {
+            CaptError("Corrupt compressed data: "
+                      << (strm.msg ? strm.msg : "unknown error"));
+            fEnd = true;
+            break;
+        }
+        if (fSpacing > 0
+            && (strm.data_type & 128) && !(strm.data_type & 64)) {
+            std::streamoff out = fOut + (n - strm.avail_out);
+            if (out - fLastCheckpoint >= fSpacing) SaveCheckpoint(out);
+        }
+    }
+    std::streamsize produced = n - strm.avail_out;
+    fOut += produced;
+    return produced;
+}
+
+bool CP::TInflateStreamBuf::Resume(const Checkpoint& checkpoint) {
+    z_stream& strm = *fStream;
+    fEnd = true;
+    setg(&fOutput[0], &fOutput[0], &fOutput[0]);
+    std::vector<Bytef> window(kWindowSize);
+    uLongf length = window.size();
+    if (checkpoint.Bits > 7
+        || uncompress(&window[0], &length,
+                      reinterpret_cast<const Bytef*>(
+                          checkpoint.Window.data()),
+                      checkpoint.Window.size()) != Z_OK) {
+        CaptError("Corrupt inflate checkpoint at " << checkpoint.Out);
+        return false;
+    }
+    std::streamoff start = checkpoint.In - (checkpoint.Bits ? 1 : 0);
+    std::streampos pos = fSource->pubseekpos(start, std::ios_base::in);
+    if (pos != std::streampos(start)) return false;
+    inflateReset2(&strm, kRawBits);
+    fInputStart = start;
+    strm.next_in = reinterpret_cast<Bytef*>(&fInput[0]);
+    strm.avail_in = 0;
+    if (checkpoint.Bits > 0) {
+        int_type byte = fSource->sbumpc();
+        if (traits_type::eq_int_type(byte, traits_type::eof())) return false;
+        fInputStart = start + 1;
+        inflatePrime(&strm, checkpoint.Bits,
+                     traits_type::to_int_type(byte) >> (8-checkpoint.Bits));
+    }
+    if (inflateSetDictionary(&strm, &window[0], length) != Z_OK) {
+        CaptError("Corrupt inflate checkpoint at " << checkpoint.Out);
+        return false;
+    }
+    fRaw = true;
+    fEnd = false;
+    fOut = checkpoint.Out;
+    fLastCheckpoint = checkpoint.Out;
+    return true;
+}
+
+CP::TInflateStreamBuf::int_type CP::TInflateStreamBuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    std::streamsize n = Inflate(&fOutput[0], fOutput.size());
+    setg(&fOutput[0], &fOutput[0], &fOutput[0] + n);
+    if (n < 1) return traits_type::eof();
+    return traits_type::to_int_type(*gptr());
+}
+
+std::streamsize CP::TInflateStreamBuf::xsgetn(char* s, std::streamsize n) {
+    // Copy what's already decompressed, and then decompress large requests
+    // straight into the caller's buffer.
+    std::streamsize done = 0;
+    while (done < n) {
+        std::streamsize avail = egptr() - gptr();
+        if (avail > 0) {
+            std::streamsize chunk = std::min(avail, n-done);
+            std::memcpy(s+done, gptr(), chunk);
+            gbump(chunk);
+            done += chunk;
+            continue;
+        }
+        if (n-done >= (std::streamsize) fOutput.size()) {
+            std::streamsize got = Inflate(s+done, n-done);
+            if (got < 1) break;
+            done += got;
+            continue;
+        }
+        if (traits_type::eq_int_type(underflow(), traits_type::eof())) break;
+    }
+    return done;
+}
@@ -0,0 +1,129 @@
+#ifndef TInflateStreamBuf_hxx_seen
+#define TInflateStreamBuf_hxx_seen
+
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+struct z_stream_s;
+
+namespace CP {
+    class TInflateStreamBuf;
+};
+
+/// An input stream buffer that decompresses a gzip file read from another
+/// stream buffer.  Files with several gzip members (e.g. made with cat) are
+/// read as one stream.  The source buffer is not owned.
+///
+/// The buffer can save inflate checkpoints while it reads the file.  A
+/// checkpoint is the state of the decompression at the start of a deflate
+/// block: the offset in the compressed file, the number of bits of the
+/// previous byte that belong to the block, and the last 32 kB of the
+/// decompressed stream (the window the next block can refer back to).  The
+/// decompression can later be restarted at a checkpoint with Resume(), so a
+/// record in the middle of a large compressed file can be read without
+/// decompressing everything before it.  The checkpoints are saved by
+/// capt-catalog in the raw catalog (see TRawCatalog and TCatalogInput).
+class CP::TInflateStreamBuf : public std::streambuf {
+public:
+    /// A place where the decompression can be restarted.
+    struct Checkpoint {
+        /// The offset of the first compressed byte with bits of the next
+        /// block (the block starts Bits bits before the end of the byte
+        /// before this one when Bits isn't zero).
+        uint64_t In;
+
+        /// The position in the decompressed stream.
+        uint64_t Out;
+
+        /// The number of bits of the previous compressed byte that belong
+        /// to the next block.
+        uint32_t Bits;
+
+        /// The window of decompressed data before the checkpoint.  This is
+        /// saved with zlib compression.
+        std::string Window;
+    };
+
+    /// Decompress the source.  The source must be at the start of the gzip
+    /// data.
+    explicit TInflateStreamBuf(std::streambuf* source,
+                               std::size_t blockSize = 1<<20);
+    virtual ~TInflateStreamBuf();
+
+    /// Save a checkpoint each time at least this many bytes have been
+    /// decompressed since the last one.  Zero (the default) doesn't save
+    /// checkpoints.
+    void SetCheckpointSpacing(std::streamoff spacing) {fSpacing = spacing;}
+
+    /// Get the checkpoints that have been saved.
+    const std::vector<Checkpoint>& GetCheckpoints() const {
+        return fCheckpoints;
+    }
+
+    /// Restart the decompression at a checkpoint.  The source must be
+    /// seekable.  This returns false if the source can't be moved to the
+    /// checkpoint, or if the checkpoint is corrupt.  The buffer can't be
+    /// read after a failure.
+    bool Resume(const Checkpoint& checkpoint);
+
+    /// Get the position in the decompressed stream of the next character
+    /// that will be read.
+    std::streamoff GetPosition() const {return fOut - (egptr() - gptr());}
+
+protected:
+    virtual int_type underflow();
+    virtual std::streamsize xsgetn(char* s, std::streamsize n);
+
+private:
+    /// Decompress up to n characters into s.  This returns the number of
+    /// characters, and zero at the end of the data or after an error.
+    std::streamsize Inflate(char* s, std::streamsize n);
+
+    /// Read more compressed data from the source after the data that
+    /// hasn't been used.  This returns false at the end of the source.
+    bool FillInput();
+
+    /// Skip the trailer of a gzip member that was decompressed without
+    /// the gzip wrapper (after Resume()).  This returns false if the source
+    /// ends first.
+    bool SkipTrailer();
+
+    /// Save a checkpoint at the current position.
+    void SaveCheckpoint(std::streamoff out);
+
+    /// The compressed data.
+    std::streambuf* fSource;
+
+    /// The zlib state.
+    z_stream_s* fStream;
+
+    /// Flag that the deflate data is being read without the gzip wrapper.
+    bool fRaw;
+
+    /// Flag that the end of the data (or an error) was reached.
+    bool fEnd;
+
+    /// The compressed data read from the source.
+    std::vector<char> fInput;
+
+    /// The source offset of the start of the input buffer.
+    std::streamoff fInputStart;
+
+    /// The decompressed data.
+    std::vector<char> fOutput;
+
+    /// The number of characters decompressed.
+    std::streamoff fOut;
+
+    /// The decompressed bytes between the checkpoints.
+    std::streamoff fSpacing;
+
+    /// The position of the last checkpoint.
+    std::streamoff fLastCheckpoint;
+
+    /// The checkpoints that have been saved.
+    std::vector<Checkpoint> fCheckpoints;
+};
+#endif
@@ -1,4 +1,6 @@
 #include "TMergeInput.hxx"
+#include "TVRawInput.hxx"
+#include "TCatalogInput.hxx"
 
 #include <TEvent.hxx>
 #include <TCaptLog.hxx>
@@ -65,13 +67,26 @@ namespace {
 CP::TMergeInput::TMergeInput(const char* name, double window, double offset) 
     : fFilename(name), fTPCFile(NULL),
       fPDSFile(NULL), fPDSEvent(NULL), fEventsRead(0),
-      fWindow(window), fOffset(offset) {
+      fWindow(window), fOffset(offset), fProfile("merge " + fFilename) {
 
-    std::string tpcFilename
-        = fFilename.substr(0,fFilename.find_first_of(','));
+    // The stages and counters must be added in the order of the enums.
+    fProfile.AddStage("tpc");
+    fProfile.AddStage("pds");
+    fProfile.AddStage("combine");
+    fProfile.AddCounter("pds matched");
+    fProfile.AddCounter("pds discarded");
+    fProfile.AddCounter("pds digits");
+
+    // The TPC input can be a catalog selection which has commas of it's
+    // own, so then the PDS file is after the last comma.
+    std::size_t split = fFilename.find_first_of(',');
+    if (CP::TCatalogInput::IsCatalogName(fFilename)) {
+        split = fFilename.find_last_of(',');
+    }
+
+    std::string tpcFilename = fFilename.substr(0,split);
     
-    std::string pdsFilename
-        = fFilename.substr(fFilename.find_first_of(',')+1);
+    std::string pdsFilename = fFilename.substr(split+1);
     
     CaptLog("Open TPC File: " << tpcFilename);
     CaptLog("Open PDS File: " << pdsFilename);
@@ -80,6 +95,10 @@ CP::TMergeInput::TMergeInput(const char* name, double window, double offset)
         tpcFilename.c_str());
     fPDSFile = CP::TManager::Get().Input().Builder("mPDS").Open(
         pdsFilename.c_str());
+
+    // The PDS events are selected by time, not by the run and event number.
+    CP::TVRawInput* pdsRaw = dynamic_cast<CP::TVRawInput*>(fPDSFile);
+    if (pdsRaw) pdsRaw->ApplyInputSelection(false);
 }
 
 CP::TMergeInput::~TMergeInput() {
@@ -94,29 +113,53 @@ CP::TEvent* CP::TMergeInput::NextEvent(int skip) {
     // The next TPC event is the next event.
     std::auto_ptr<CP::TEvent> newEvent;
     {
+        CP::TRawInputProfile::Timer timer(&fProfile,kStageTPC);
         CP::TEvent* tpcEvent = fTPCFile->NextEvent();
         if (!tpcEvent) return NULL;
         newEvent.reset(tpcEvent);
     }
     
-    if (!fPDSEvent && !fPDSFile->EndOfFile()) fPDSEvent = fPDSFile->NextEvent();
-    if (!fPDSEvent) return newEvent.release();
-
     CP::NanoStamp eventContextStamp =
         CP::TimeToNanoStamp(newEvent->GetContext().GetTimeStamp(),
                             newEvent->GetContext().GetNanoseconds());
-    
-    CP::NanoStamp pdsContextStamp =
-        CP::TimeToNanoStamp(fPDSEvent->GetContext().GetTimeStamp(),
-                            fPDSEvent->GetContext().GetNanoseconds());
-    
-    double timeDiff = pdsContextStamp - eventContextStamp;
+
+    // If the PDS input can report the context of the next event without
+    // decoding it, then the PDS events before the window are skipped
+    // without ever being built.
+    CP::TVRawInput* pdsRaw = dynamic_cast<CP::TVRawInput*>(fPDSFile);
+
     // Look for the last PDS event to consider.
     CaptNamedInfo("merge", "TPC event " << newEvent->GetContext());
-    while (fPDSEvent && timeDiff < fWindow) {
+    CP::TRawInputProfile::Timer pdsTimer(&fProfile,kStagePDS);
+    while (true) {
+        CP::TEventContext pdsContext;
+        if (fPDSEvent) {
+            pdsContext = fPDSEvent->GetContext();
+        }
+        else if (pdsRaw) {
+            if (!pdsRaw->PeekContext(pdsContext)) break;
+        }
+        else {
+            if (fPDSFile->EndOfFile()) break;
+            fPDSEvent = fPDSFile->NextEvent();
+            if (!fPDSEvent) break;
+            pdsContext = fPDSEvent->GetContext();
+        }
+
+        CP::NanoStamp pdsContextStamp =
+            CP::TimeToNanoStamp(pdsContext.GetTimeStamp(),
+                                pdsContext.GetNanoseconds());
+        double timeDiff = pdsContextStamp - eventContextStamp;
+
+        // This PDS event is after the window, so save it for the next TPC
+        // event.
+        if (timeDiff >= fWindow) break;
+
         // See if this PDS event is after the start of the window, and add it
         // to the event if it is.
         if (timeDiff > -fWindow) {
+            if (!fPDSEvent) fPDSEvent = fPDSFile->NextEvent();
+            if (!fPDSEvent) break;
             // Get the pds event container, and create it if it doesn't
             // exist.
             CP::THandle<CP::TDataVector> subEvents
@@ -126,22 +169,22 @@ CP::TEvent* CP::TMergeInput::NextEvent(int skip) {
                 subEvents = newEvent->Get<CP::TDataVector>("~/subEvents");
             }
             subEvents->AddDatum(fPDSEvent);
+            fProfile.Count(kCountMatched);
             CaptNamedInfo("merge", "  PDS Match " << timeDiff/unit::second
-                    << " Event " << fPDSEvent->GetContext().GetEvent());
+                    << " Event " << pdsContext.GetEvent());
         }
         else {
+            if (fPDSEvent) delete fPDSEvent;
+            else pdsRaw->SkipEvent();
+            fProfile.Count(kCountDiscarded);
             CaptNamedInfo("merge", "  PDS Discard " << timeDiff/unit::second
-                    << " Event " << fPDSEvent->GetContext().GetEvent());
+                    << " Event " << pdsContext.GetEvent());
         }
         fPDSEvent = NULL;
-        if (!fPDSFile->EndOfFile()) fPDSEvent = fPDSFile->NextEvent();
-        if (!fPDSEvent) break;
-        pdsContextStamp =
-            CP::TimeToNanoStamp(fPDSEvent->GetContext().GetTimeStamp(),
-                                fPDSEvent->GetContext().GetNanoseconds());
-        timeDiff = pdsContextStamp - eventContextStamp;
     }
+    pdsTimer.Stop();
 
+    CP::TRawInputProfile::Timer combineTimer(&fProfile,kStageCombine);
     // Get the combined pmt digits container, and create it if it doesn't exist.
     CP::THandle<CP::TDigitContainer> combinedPDS 
         = newEvent->Get<CP::TDigitContainer>("~/digits/pmt");
@@ -181,10 +224,14 @@ CP::TEvent* CP::TMergeInput::NextEvent(int skip) {
                 header->SetEndValid(combinedPDS->size());
                 combinedPDS->AddHeader(header);
             }
+            fProfile.Count(kCountDigits, digits->size());
             digits->clear();
         }
     }
-    
+    combineTimer.Stop();
+
+    fProfile.EndEvent(newEvent->GetContext().GetRun(),
+                      newEvent->GetContext().GetEvent());
     ++fEventsRead;
     return newEvent.release();
 }
@@ -204,6 +251,7 @@ bool CP::TMergeInput::EndOfFile() {
 }
 
 void CP::TMergeInput::CloseFile() {
+    fProfile.PrintSummary();
     if (fTPCFile) {
         delete fTPCFile;
         fTPCFile = NULL;
@@ -4,6 +4,7 @@
 #include <ECore.hxx>
 #include <TVInputFile.hxx>
 #include <HEPUnits.hxx>
+#include <TRawInputProfile.hxx>
 
 #include <string>
 #include <istream>
@@ -30,6 +31,13 @@ namespace CP {
 /// offset is controlled by the second arguement.  For example,
 /// -tmerge(20ms,10ms) will merge PDS events that are in a +/-20ms window
 /// centered 10ms after the TPC trigger (as based on the PDS computer time).
+///
+/// The TPC events can be selected from a raw catalog (see TCatalogInput), and
+/// then the PDS file comes after the selection
+///
+/// \code
+///  capt-trans.exe -tmerge catalog:raw.cat:run=2011,event=10-20,outfile_2011.root
+/// \endcode
 class  CP::TMergeInput : public CP::TVInputFile {
 public:
 
@@ -70,7 +78,26 @@ public:
     /// Get the name of this file
     const char* GetFilename()  const { return fFilename.c_str();  } 
 
+    /// Get the profile of the time spent merging the files (see
+    /// TRawInputProfile).  The TPC and PDS inputs have their own profiles,
+    /// and the time in them is included in the tpc and pds stages.
+    CP::TRawInputProfile& GetProfile() {return fProfile;}
+
 private:
+    /// The stages timed by the profile.
+    enum {
+        kStageTPC,           // Reading the TPC event.
+        kStagePDS,           // Reading and matching the PDS events.
+        kStageCombine        // Combining the PDS digits.
+    };
+
+    /// The counters kept by the profile.
+    enum {
+        kCountMatched,       // PDS events added to a TPC event.
+        kCountDiscarded,     // PDS events that were outside the window.
+        kCountDigits         // PDS digits combined.
+    };
+
     /// name of the currently open file
     std::string fFilename; 
 
@@ -91,5 +118,8 @@ private:
 
     /// The offset from the TPC event time for the center of the merge window.
     double fOffset;
+
+    /// The profile of the time spent merging the files.
+    CP::TRawInputProfile fProfile;
 };
 #endif
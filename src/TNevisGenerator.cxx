@@ -0,0 +1,103 @@
+#include "TNevisGenerator.hxx"
+
+#include <TCaptLog.hxx>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+    bool endsWith(const std::string& name, const std::string& suffix) {
+        if (name.size() < suffix.size()) return false;
+        return name.compare(name.size()-suffix.size(),
+                            suffix.size(), suffix) == 0;
+    }
+}
+
+CP::TNevisGenerator::TNevisGenerator(int seed)
+    : fRandom(seed), fChannels(64), fSamples(3200), fNoise(2.0),
+      fPulseRate(1.0), fRun(1), fFirstEvent(0) {}
+
+CP::TNevisGenerator::~TNevisGenerator() {}
+
+void CP::TNevisGenerator::AddHeaderValue(Words& words, int value) {
+    words.push_back((value/4095) & 0xFFF);
+    words.push_back((value%4095) & 0xFFF);
+}
+
+void CP::TNevisGenerator::MakeSamples(int channel, Words& samples) {
+    double pedestal = 400 + 10*(channel%64) + fRandom.Uniform()*100;
+    std::vector<double> signal(fSamples, pedestal);
+    // The pulses are gaussian with a few samples width.
+    int pulses = fRandom.Poisson(fPulseRate);
+    for (int p = 0; p < pulses; ++p) {
+        double peak = fRandom.Uniform(fSamples);
+        double height = fRandom.Exp(100.0);
+        double width = 2.0 + fRandom.Uniform(3.0);
+        int low = std::max(0, (int) (peak - 5*width));
+        int high = std::min(fSamples, (int) (peak + 5*width) + 1);
+        for (int s = low; s < high; ++s) {
+            double x = (s - peak)/width;
+            signal[s] += height*std::exp(-0.5*x*x);
+        }
+    }
+    for (int s = 0; s < fSamples; ++s) {
+        int value = signal[s] + fRandom.Gaus(0.0, fNoise) + 0.5;
+        samples.push_back(std::max(0, std::min(0xFFF, value)));
+    }
+}
+
+void CP::TNevisGenerator::MakeEvent(int event, Words& words) {
+    std::size_t begin = words.size();
+    for (int i = 0; i < 3; ++i) words.push_back(0xFFFF);
+    words.push_back(0);
+    std::size_t size = words.size();
+    AddHeaderValue(words, 0);
+    AddHeaderValue(words, event);
+    AddHeaderValue(words, fRun);
+    words.push_back(0);
+    words.push_back(0);
+    for (int channel = 0; channel < fChannels; ++channel) {
+        words.push_back(0x4000 | (channel & 0xFFF));
+        MakeSamples(channel, words);
+        words.push_back(0x5000 | (channel & 0xFFF));
+    }
+    words.push_back(0xE000);
+    // Fill in the event size now that it's known.
+    int eventSize = words.size() - begin;
+    words[size] = (eventSize/4095) & 0xFFF;
+    words[size+1] = (eventSize%4095) & 0xFFF;
+}
+
+bool CP::TNevisGenerator::Write(const std::string& fileName, int events) {
+    bool compress = endsWith(fileName, ".gz");
+    gzFile gzOutput = NULL;
+    FILE* output = NULL;
+    if (compress) gzOutput = gzopen(fileName.c_str(), "wb");
+    else output = std::fopen(fileName.c_str(), "wb");
+    if (!gzOutput && !output) {
+        CaptError("Cannot write " << fileName);
+        return false;
+    }
+
+    bool ok = true;
+    Words words;
+    for (int event = 0; ok && event < events; ++event) {
+        words.clear();
+        MakeEvent(fFirstEvent + event, words);
+        std::size_t bytes = words.size()*sizeof(uint16_t);
+        if (compress) {
+            ok = (gzwrite(gzOutput, &words[0], bytes) == (int) bytes);
+        }
+        else {
+            ok = (std::fwrite(&words[0], 1, bytes, output) == bytes);
+        }
+    }
+
+    if (compress) ok = (gzclose(gzOutput) == Z_OK) && ok;
+    else ok = (std::fclose(output) == 0) && ok;
+    if (!ok) CaptError("Error writing " << fileName);
+    return ok;
+}
@@ -0,0 +1,80 @@
+#ifndef TNevisGenerator_hxx_seen
+#define TNevisGenerator_hxx_seen
+
+#include <TRandom3.h>
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace CP {
+    class TNevisGenerator;
+};
+
+/// Make synthetic Nevis DAQ files so that TNevisInput can be benchmarked and
+/// checked without DAQ data.  Each event has the word layout read by
+/// TNevisInput: the three 0xFFFF barrier words and the event header, then
+/// for each channel a 0x4 header word, the samples, and a 0x5 trailer
+/// word, and finally a word with the 0xE flag.  The samples are a pedestal
+/// with gaussian noise, and pulses that arrive at a given rate.
+///
+/// \code
+/// CP::TNevisGenerator generator;
+/// generator.SetChannels(64);
+/// generator.SetPulseRate(2.0);
+/// generator.Write("synthetic.nevis.gz",1000);
+/// \endcode
+///
+/// The same seed always makes the same file.
+class CP::TNevisGenerator {
+public:
+    typedef std::vector<uint16_t> Words;
+
+    explicit TNevisGenerator(int seed = 1);
+    virtual ~TNevisGenerator();
+
+    /// Set the number of channels in each event (no more than 4096).
+    void SetChannels(int channels) {fChannels = channels;}
+
+    /// Set the number of samples in each channel.
+    void SetSamples(int samples) {fSamples = samples;}
+
+    /// Set the RMS of the noise in ADC counts.
+    void SetNoise(double rms) {fNoise = rms;}
+
+    /// Set the mean number of pulses in each channel of an event.
+    void SetPulseRate(double pulses) {fPulseRate = pulses;}
+
+    /// Set the run number, and the number of the first event.
+    void SetRun(int run, int firstEvent = 0) {
+        fRun = run;
+        fFirstEvent = firstEvent;
+    }
+
+    /// Write a file with the given number of events.  The file is gzip
+    /// compressed if the name ends in ".gz".  This returns false if the
+    /// file can't be written.
+    bool Write(const std::string& fileName, int events);
+
+    /// Make the words for an event.
+    void MakeEvent(int event, Words& words);
+
+    /// Make the samples for a channel.
+    void MakeSamples(int channel, Words& samples);
+
+private:
+    /// Add a pair of words holding a value as two base 4095 digits the way
+    /// the event header does.
+    static void AddHeaderValue(Words& words, int value);
+
+    /// The random number generator.
+    TRandom3 fRandom;
+
+    int fChannels;
+    int fSamples;
+    double fNoise;
+    double fPulseRate;
+    int fRun;
+    int fFirstEvent;
+};
+#endif
@@ -1,4 +1,5 @@
 #include "TNevisInput.hxx"
+#include "TRunEventSet.hxx"
 #include "TEvent.hxx"
 #include "TEventContext.hxx"
 
@@ -39,17 +40,37 @@ namespace {
 }
 
 CP::TNevisInput::TNevisInput(const char* name) 
-    : fFilename(name) {
+    : fFilename(name), fPeeked(false), fWordBegin(0), fWordEnd(0),
+      fProfile("nevis " + fFilename), fLastOffset(0) {
     int32_t endian = 0x12345678;
 
     fDoByteSwap = *(char*)(&endian) != 0x78;
 
+    // The name "-" reads the standard input.  The descriptor is duplicated
+    // so that closing the file doesn't close stdin.
 #ifdef NEVIS_USE_ZLIB
-    fFile = gzopen(fFilename.c_str(),"rb");
+    // The zlib reader passes uncompressed data through unchanged, so the
+    // compression is found from the magic number and pipes can be read.
+    if (fFilename == "-") fFile = gzdopen(dup(STDIN_FILENO),"rb");
+    else fFile = gzopen(fFilename.c_str(),"rb");
+    if (fFile) gzbuffer(fFile, 1<<20);
 #else
-    fFile = fopen(fFilename.c_str(),"rb");
+    if (fFilename == "-") fFile = fdopen(dup(STDIN_FILENO),"rb");
+    else fFile = fopen(fFilename.c_str(),"rb");
 #endif
 
+    fWords.resize(1<<18);
+
+    // The stages and counters must be added in the order of the enums.
+    fProfile.AddStage("read");
+    fProfile.AddStage("decode");
+    fProfile.AddStage("digits");
+    fProfile.AddCounter("bytes in");
+    fProfile.AddCounter("bytes out");
+    fProfile.AddCounter("skipped");
+    fProfile.AddCounter("channels");
+    fProfile.AddCounter("samples");
+    fProfile.AddCounter("digits");
 }
 
 CP::TNevisInput::~TNevisInput() {
@@ -60,40 +81,64 @@ CP::TEvent* CP::TNevisInput::FirstEvent() {
     return NextEvent();
 }
 
-int CP::TNevisInput::Read(unsigned int& flag, unsigned int& data) {
-    uint16_t word16;
-    
+bool CP::TNevisInput::FillWords() {
+    fWordBegin = fWordEnd = 0;
+    if (!fFile) return false;
+
+    CP::TRawInputProfile::Timer timer(&fProfile,kStageRead);
 #ifdef NEVIS_USE_ZLIB
-    int result = gzread(fFile,&word16,sizeof(uint16_t));
+    int result = gzread(fFile,&fWords[0],fWords.size()*sizeof(uint16_t));
+    if (result<1) return false;
+    fWordEnd = result/sizeof(uint16_t);
+    if (fProfile.IsEnabled()) {
+        // The offset is in the compressed file.
+        long offset = gzoffset(fFile);
+        fProfile.Count(kCountBytesIn, offset - fLastOffset);
+        fLastOffset = offset;
+    }
 #else
-    int result = fread(&word16,sizeof(uint16_t),1,fFile);
+    std::size_t result = fread(&fWords[0],sizeof(uint16_t),fWords.size(),
+                               fFile);
+    fWordEnd = result;
+    fProfile.Count(kCountBytesIn, result*sizeof(uint16_t));
 #endif
+    fProfile.Count(kCountBytesOut, fWordEnd*sizeof(uint16_t));
+
+    return fWordEnd > 0;
+}
+
+bool CP::TNevisInput::TryRead(unsigned int& flag, unsigned int& data) {
+    if (fWordBegin >= fWordEnd && !FillWords()) return false;
+    uint16_t word16 = fWords[fWordBegin++];
 
     flag = (word16 & 0xF000) >> 12;
     data = (word16 & 0x0FFF);
 
-    if (result<1) {
-        CaptError("Read Error " << result);
-        throw ETruncatedNevisEvent();
-    };
-
 #ifdef DUMP
     CaptLog("Read 0x" << std::hex << flag
             << " 0x" << std::hex << data
             << " (" << std::dec << data << ")");
 #endif
 
-    return result;
+    return true;
 }
 
-CP::TEvent* CP::TNevisInput::NextEvent(int skip) {
+int CP::TNevisInput::Read(unsigned int& flag, unsigned int& data) {
+    if (!TryRead(flag,data)) {
+        CaptError("Read Error");
+        throw ETruncatedNevisEvent();
+    };
+    return 1;
+}
+
+bool CP::TNevisInput::ReadHeader(CP::TEventContext& context) {
     unsigned int flag;
     unsigned int data;
     
-    CP::TEventContext context;
-
-    /// Read the event barrier at the beginning of the event.  (three words).  
-    Read(flag,data);
+    /// Read the event barrier at the beginning of the event.  (three words).
+    /// Running out of data before the first word just means that the last
+    /// event has been read.
+    if (!TryRead(flag,data)) return false;
     if (flag != 0xf || data != 0xfff) {
         CaptError("Error in input file.");
         throw ETruncatedNevisEvent();
@@ -143,6 +188,59 @@ CP::TEvent* CP::TNevisInput::NextEvent(int skip) {
     Read(flag,data);
     Read(flag,data);
 
+    return true;
+}
+
+void CP::TNevisInput::SkipEventData() {
+    unsigned int flag;
+    unsigned int data;
+    // The event ends with the first 0xe flag.  The channel headers (0x4),
+    // the samples (0x0) and the channel trailers (0x5) are all passed over.
+    do {
+        Read(flag,data);
+    } while (flag != 0xe);
+}
+
+bool CP::TNevisInput::PeekContext(CP::TEventContext& context) {
+    if (!fPeeked) {
+        if (!fFile) return false;
+        fPeekContext = CP::TEventContext();
+        if (!ReadHeader(fPeekContext)) return false;
+        fPeeked = true;
+    }
+    context = fPeekContext;
+    return true;
+}
+
+void CP::TNevisInput::SkipEvent() {
+    CP::TEventContext context;
+    if (!PeekContext(context)) return;
+    CP::TRawInputProfile::Timer timer(&fProfile,kStageDecode);
+    SkipEventData();
+    fPeeked = false;
+    fProfile.Count(kCountSkipped);
+}
+
+CP::TEvent* CP::TNevisInput::NextEvent(int skip) {
+    unsigned int flag;
+    unsigned int data;
+    
+    CP::TEventContext context;
+    CP::TRawInputProfile::Timer timer(&fProfile,kStageDecode);
+
+    // Read event headers until an event is selected.  The Nevis DAQ
+    // doesn't record a subrun, so the selection matches any subrun.
+    const CP::TRunEventSet* selection = GetSelection();
+    while (true) {
+        if (!PeekContext(context)) return NULL;
+        if (!selection) break;
+        if (selection->Contains(context.GetRun(),
+                                CP::TRunEventSet::kAnySubRun,
+                                context.GetEvent())) break;
+        SkipEvent();
+    }
+    fPeeked = false;
+
     std::cout << "Event " << context << std::endl;
 
     // Create the event.
@@ -183,8 +281,13 @@ CP::TEvent* CP::TNevisInput::NextEvent(int skip) {
                 }
             } while (flag == 0x0);
             // Create the digit.
+            CP::TRawInputProfile::Timer digitTimer(&fProfile,kStageDigits);
             CP::TPulseDigit* digit = new TPulseDigit(channel,0, adc);
             drift->push_back(digit);
+            digitTimer.Stop();
+            fProfile.Count(kCountChannels);
+            fProfile.Count(kCountSamples, adc.size());
+            fProfile.Count(kCountDigits);
 
             if (flag == 0x5) continue;
             if (flag == 0xe) break;
@@ -196,6 +299,9 @@ CP::TEvent* CP::TNevisInput::NextEvent(int skip) {
                   << " " << data);
     }
 
+    timer.Stop();
+    fProfile.EndEvent(context.GetRun(), context.GetEvent());
+
     return newEvent.release();
 }
 
@@ -205,6 +311,9 @@ bool CP::TNevisInput::IsOpen() {return fFile;}
 
 bool CP::TNevisInput::EndOfFile() {
 
+    if (!fFile) return true;
+    if (fWordBegin < fWordEnd) return false;
+
 #ifdef NEVIS_USE_ZLIB
     return gzeof(fFile);
 #else
@@ -216,6 +325,7 @@ bool CP::TNevisInput::EndOfFile() {
 void CP::TNevisInput::CloseFile() {
 
     if (!fFile) return;
+    fProfile.PrintSummary();
 
 #ifdef NEVIS_USE_ZLIB
     gzclose(fFile);
@@ -2,7 +2,9 @@
 #define TNevisInput_hxx_seen
 
 #include <ECore.hxx>
-#include <TVInputFile.hxx>
+#include <TVRawInput.hxx>
+#include <TEventContext.hxx>
+#include <TRawInputProfile.hxx>
 
 
 #define NEVIS_USE_ZLIB
@@ -13,6 +15,8 @@
 #endif
 
 #include <string>
+#include <vector>
+#include <stdint.h>
 
 namespace CP {
     class TNevisInput;
@@ -21,7 +25,10 @@ namespace CP {
     EXCEPTION(EOverlongNevisADC,EInputFile);
 };
 
-class  CP::TNevisInput : public CP::TVInputFile {
+/// Read a file written by the Nevis DAQ.  The file can be compressed with
+/// gzip, and the name "-" reads the standard input so the data can be
+/// converted straight from a pipe.
+class  CP::TNevisInput : public CP::TVRawInput {
 public:
     TNevisInput(const char* fName);
     virtual ~TNevisInput(); 
@@ -49,20 +56,80 @@ public:
     /// Close the input file.
     virtual void CloseFile();
 
+    /// Fill the context of the next event from the event header words.
+    virtual bool PeekContext(CP::TEventContext& context);
+
+    /// Skip the next event without building any digits.
+    virtual void SkipEvent();
+
     /// Get the name of this file
     const char* GetFilename()  const { return fFilename.c_str();  } 
 
+    /// Get the profile of the time spent reading the file (see
+    /// TRawInputProfile).
+    CP::TRawInputProfile& GetProfile() {return fProfile;}
+
 private:
 
+    /// The stages timed by the profile.
+    enum {
+        kStageRead,          // Reading (and inflating) the file.
+        kStageDecode,        // Decoding the words.
+        kStageDigits         // Making the digits.
+    };
+
+    /// The counters kept by the profile.
+    enum {
+        kCountBytesIn,       // Bytes read from the file.
+        kCountBytesOut,      // Bytes after decompression.
+        kCountSkipped,       // Events that were skipped.
+        kCountChannels,      // Channels converted.
+        kCountSamples,       // Samples converted.
+        kCountDigits         // Digits made.
+    };
+
     /// Wrapper around fread or gzread to simplify the coding.
     int Read(unsigned int& flag, unsigned int& data);
 
+    /// Read the next block of words from the file.  This returns false if
+    /// there aren't any more words.
+    bool FillWords();
+
+    /// Read a word, but return false instead of throwing an exception if
+    /// the end of the file has been reached.
+    bool TryRead(unsigned int& flag, unsigned int& data);
+
+    /// Read the event header words and fill the run and event numbers in the
+    /// context.  This returns false if the end of the file was reached
+    /// before the header started.
+    bool ReadHeader(CP::TEventContext& context);
+
+    /// Skip the channel data for the current event without building any
+    /// digits.
+    void SkipEventData();
+
     /// name of the currently open file
     std::string fFilename; 
 
     /// Flag for if the file needs to be byteswapped.
     bool fDoByteSwap; 
 
+    /// Flag that the header of the next event has been read.
+    bool fPeeked;
+
+    /// The context from the header of the next event (valid if fPeeked).
+    CP::TEventContext fPeekContext;
+
+    /// The block of words read from the file.  The file is read in large
+    /// blocks so that a pipe can be read efficiently.
+    std::vector<uint16_t> fWords;
+
+    /// The index of the next word to use in fWords.
+    std::size_t fWordBegin;
+
+    /// The number of words in fWords.
+    std::size_t fWordEnd;
+
     /// The file to be read.  This can be either a zlib file, or a stdio file.
 #ifdef NEVIS_USE_ZLIB
     gzFile fFile;
@@ -70,5 +137,12 @@ private:
     FILE *fFile;
 #endif
 
+    /// The profile of the time spent reading the file.
+    CP::TRawInputProfile fProfile;
+
+    /// The offset in the (compressed) file when the bytes were last
+    /// counted.
+    long fLastOffset;
+
 };
 #endif
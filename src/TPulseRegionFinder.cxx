@@ -0,0 +1,117 @@
+#include "TPulseRegionFinder.hxx"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+    /// Find the samples that are above high or below low.
+    template <typename Sample>
+    void findOverThreshold(const Sample* samples, int n, int high, int low,
+                           std::vector<int>& over) {
+        for (int i = 0; i < n; ++i) {
+            if (samples[i] > high || samples[i] < low) over.push_back(i);
+        }
+    }
+
+#if defined(__SSE2__)
+    /// Find the samples that are above high or below low.  Four samples are
+    /// compared at once.  Most of a waveform is under threshold, so this is
+    /// usually one compare and one test per four samples.
+    void findOverThreshold(const int* samples, int n, int high, int low,
+                           std::vector<int>& over) {
+        const __m128i high4 = _mm_set1_epi32(high);
+        const __m128i low4 = _mm_set1_epi32(low);
+        int i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m128i s = _mm_loadu_si128((const __m128i*)(samples + i));
+            __m128i out = _mm_or_si128(_mm_cmpgt_epi32(s,high4),
+                                       _mm_cmplt_epi32(s,low4));
+            int bits = _mm_movemask_ps(_mm_castsi128_ps(out));
+            while (bits) {
+                over.push_back(i + __builtin_ctz(bits));
+                bits &= bits - 1;
+            }
+        }
+        for (; i < n; ++i) {
+            if (samples[i] > high || samples[i] < low) over.push_back(i);
+        }
+    }
+#endif
+}
+
+CP::TPulseRegionFinder::TPulseRegionFinder(double threshold, int padding)
+    : fThreshold(threshold), fPadding(padding), fBaseline(0), fNoise(1),
+      fHistogram(4096) {}
+
+CP::TPulseRegionFinder::~TPulseRegionFinder() {}
+
+void CP::TPulseRegionFinder::FindBaseline(
+    const CP::TPulseDigit::Vector& adc) {
+    fBaseline = 0;
+    fNoise = 1;
+    if (adc.empty()) return;
+
+    std::fill(fHistogram.begin(), fHistogram.end(), 0);
+    for (CP::TPulseDigit::Vector::const_iterator s = adc.begin();
+         s != adc.end(); ++s) {
+        ++fHistogram[*s & 0xFFF];
+    }
+    int half = (adc.size()+1)/2;
+
+    // The median.
+    int median = 0;
+    int count = 0;
+    for (median = 0; median < (int) fHistogram.size(); ++median) {
+        count += fHistogram[median];
+        if (count >= half) break;
+    }
+
+    // The median absolute deviation is found by moving out from the
+    // median until half of the samples are included.
+    int deviation = 0;
+    count = fHistogram[median];
+    while (count < half) {
+        ++deviation;
+        if (median-deviation >= 0) count += fHistogram[median-deviation];
+        if (median+deviation < (int) fHistogram.size()) {
+            count += fHistogram[median+deviation];
+        }
+    }
+
+    // Convert the deviation into the sigma of a gaussian.
+    fBaseline = median;
+    fNoise = std::max(1.0, 1.4826*deviation);
+}
+
+void CP::TPulseRegionFinder::AddSample(int index, int samples) {
+    // A sample over threshold extends the current region, or starts a new
+    // one if it's past the padding.
+    int begin = std::max(0, index - fPadding);
+    int end = std::min(samples, index + fPadding + 1);
+    if (!fRegions.empty() && begin <= fRegions.back().second) {
+        fRegions.back().second = end;
+        return;
+    }
+    fRegions.push_back(Region(begin,end));
+}
+
+void CP::TPulseRegionFinder::Find(const CP::TPulseDigit::Vector& adc) {
+    fRegions.clear();
+    FindBaseline(adc);
+
+    int n = adc.size();
+    int cut = fThreshold*fNoise;
+    int high = fBaseline + cut;
+    int low = fBaseline - cut;
+
+    fOverThreshold.clear();
+    if (n > 0) findOverThreshold(&adc[0], n, high, low, fOverThreshold);
+    for (std::vector<int>::iterator index = fOverThreshold.begin();
+         index != fOverThreshold.end(); ++index) {
+        AddSample(*index,n);
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef TPulseRegionFinder_hxx_seen
+#define TPulseRegionFinder_hxx_seen
+
+#include <TPulseDigit.hxx>
+
+#include <vector>
+#include <utility>
+
+namespace CP {
+    class TPulseRegionFinder;
+};
+
+/// Find the regions of interest in a TPC waveform so that the noise
+/// between them doesn't need to be saved.  The baseline is the median of
+/// the samples, and the noise is found from the median absolute deviation,
+/// so neither is pulled by the signals.  A sample is over threshold when it
+/// is further than the threshold (in units of the noise) from the baseline
+/// in either direction so that the bipolar induction signals are kept.
+/// Each region is padded on both sides, and regions that touch after
+/// padding are merged.
+class CP::TPulseRegionFinder {
+public:
+    /// A region as the index of the first sample, and one past the last
+    /// sample.
+    typedef std::pair<int,int> Region;
+
+    /// Make a finder with a threshold (in units of the noise) and the
+    /// number of samples to keep before and after each region.
+    explicit TPulseRegionFinder(double threshold = 5.0, int padding = 10);
+    virtual ~TPulseRegionFinder();
+
+    /// Find the baseline, noise and regions for the samples.  The samples
+    /// are 12 bit ADC values.
+    void Find(const CP::TPulseDigit::Vector& adc);
+
+    /// Get the baseline found for the last waveform.
+    double GetBaseline() const {return fBaseline;}
+
+    /// Get the noise found for the last waveform.  This is never less than
+    /// one ADC count.
+    double GetNoise() const {return fNoise;}
+
+    /// Get the regions found in the last waveform.
+    const std::vector<Region>& GetRegions() const {return fRegions;}
+
+    /// Get the threshold in units of the noise.
+    double GetThreshold() const {return fThreshold;}
+
+    /// Get the padding in samples.
+    int GetPadding() const {return fPadding;}
+
+private:
+    /// Fill the baseline and noise from a histogram of the samples.
+    void FindBaseline(const CP::TPulseDigit::Vector& adc);
+
+    /// Add a sample that is over threshold to the regions.  The samples
+    /// must be added in order.
+    void AddSample(int index, int samples);
+
+    /// The threshold in units of the noise.
+    double fThreshold;
+
+    /// The number of samples to keep before and after a region.
+    int fPadding;
+
+    /// The baseline of the last waveform.
+    double fBaseline;
+
+    /// The noise of the last waveform.
+    double fNoise;
+
+    /// The regions found in the last waveform.
+    std::vector<Region> fRegions;
+
+    /// The histogram of the samples (kept to avoid reallocating it).
+    std::vector<int> fHistogram;
+
+    /// The samples over threshold (kept to avoid reallocating it).
+    std::vector<int> fOverThreshold;
+};
+#endif
@@ -0,0 +1,424 @@
+#include "TRawCatalog.hxx"
+
+#include <TCaptLog.hxx>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <cstdlib>
+
+namespace {
+    /// The first bytes of a catalog file.
+    const char catalogMagic[8] = {'C','P','R','A','W','C','A','T'};
+
+    /// The version of the catalog file format.  Version 2 added the inflate
+    /// checkpoints.
+    const uint32_t catalogVersion = 2;
+
+    bool entryLess(const CP::TRawCatalog::Entry& lhs,
+                   const CP::TRawCatalog::Entry& rhs) {
+        if (lhs.Run != rhs.Run) return lhs.Run < rhs.Run;
+        if (lhs.SubRun != rhs.SubRun) return lhs.SubRun < rhs.SubRun;
+        if (lhs.Event != rhs.Event) return lhs.Event < rhs.Event;
+        if (lhs.File != rhs.File) return lhs.File < rhs.File;
+        return lhs.Offset < rhs.Offset;
+    }
+
+    bool entryRunLess(const CP::TRawCatalog::Entry& lhs, int32_t run) {
+        return lhs.Run < run;
+    }
+
+    bool runEntryLess(int32_t run, const CP::TRawCatalog::Entry& rhs) {
+        return run < rhs.Run;
+    }
+
+    template <typename T>
+    void writeValue(std::ostream& output, const T& value) {
+        output.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool readValue(std::istream& input, T& value) {
+        input.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return input.good();
+    }
+
+    /// The number of bytes in an entry in the file.
+    const uint64_t entryBytes = 6*sizeof(uint32_t) + sizeof(uint64_t);
+
+    /// The number of bytes in a checkpoint in the file, not counting the
+    /// window.
+    const uint64_t checkpointBytes = 2*sizeof(uint64_t) + 2*sizeof(uint32_t);
+
+    /// Get the number of bytes left in the file.  The counts read from the
+    /// file are checked against this before anything is allocated, so a
+    /// truncated or corrupt catalog can't ask for a huge buffer.
+    uint64_t remainingBytes(std::istream& input, uint64_t size) {
+        std::streamoff position = input.tellg();
+        if (position < 0 || (uint64_t) position > size) return 0;
+        return size - position;
+    }
+
+    /// Get the size of a file that is open for input.
+    bool fileSize(std::istream& input, uint64_t& size) {
+        std::streamoff position = input.tellg();
+        input.seekg(0, std::ios::end);
+        std::streamoff end = input.tellg();
+        input.seekg(position, std::ios::beg);
+        if (position < 0 || end < 0) return false;
+        size = end;
+        return true;
+    }
+
+    /// Read a checkpoint.  The window is only read if it's wanted, and is
+    /// skipped otherwise.  This returns false if the checkpoint doesn't fit
+    /// in the file.
+    bool readCheckpoint(std::istream& input, uint64_t size,
+                        CP::TInflateStreamBuf::Checkpoint& checkpoint,
+                        bool window) {
+        uint32_t length;
+        if (!readValue(input, checkpoint.In)) return false;
+        if (!readValue(input, checkpoint.Out)) return false;
+        if (!readValue(input, checkpoint.Bits)) return false;
+        if (!readValue(input, length)) return false;
+        if (length > remainingBytes(input,size)) return false;
+        if (!window) {
+            input.seekg(length, std::ios::cur);
+            return input.good();
+        }
+        checkpoint.Window.resize(length);
+        if (length > 0) input.read(&checkpoint.Window[0], length);
+        return input.good();
+    }
+}
+
+bool CP::TRawCatalog::Selection::Parse(const std::string& selection) {
+    std::istringstream items(selection);
+    std::string item;
+    while (std::getline(items,item,',')) {
+        if (item.empty()) continue;
+        std::size_t equal = item.find('=');
+        if (equal == std::string::npos) {
+            CaptError("Invalid catalog selection: " << item);
+            return false;
+        }
+        std::string key = item.substr(0,equal);
+        std::string value = item.substr(equal+1);
+        if (key == "skim") {
+            if (fSkim.ReadFile(value) < 1) return false;
+            fHasSkim = true;
+            continue;
+        }
+        Range range;
+        char* end = NULL;
+        range.Low = std::strtoll(value.c_str(),&end,10);
+        if (end == value.c_str()) {
+            CaptError("Invalid catalog selection value: " << item);
+            return false;
+        }
+        range.High = range.Low;
+        if (*end == '-') {
+            const char* high = end+1;
+            range.High = std::strtoll(high,&end,10);
+            if (end == high) {
+                CaptError("Invalid catalog selection range: " << item);
+                return false;
+            }
+        }
+        if (*end != 0) {
+            CaptError("Invalid catalog selection value: " << item);
+            return false;
+        }
+        if (key == "run") fRuns.push_back(range);
+        else if (key == "subrun") fSubRuns.push_back(range);
+        else if (key == "event") fEvents.push_back(range);
+        else if (key == "time") fTimes.push_back(range);
+        else {
+            CaptError("Invalid catalog selection key: " << item);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CP::TRawCatalog::Selection::InRanges(const std::vector<Range>& ranges,
+                                          int64_t value) {
+    if (ranges.empty()) return true;
+    for (std::vector<Range>::const_iterator r = ranges.begin();
+         r != ranges.end(); ++r) {
+        if (r->Low <= value && value <= r->High) return true;
+    }
+    return false;
+}
+
+bool CP::TRawCatalog::Selection::Match(const Entry& entry) const {
+    if (!InRanges(fRuns,entry.Run)) return false;
+    if (!InRanges(fSubRuns,entry.SubRun)) return false;
+    if (!InRanges(fEvents,entry.Event)) return false;
+    if (!InRanges(fTimes,entry.Seconds)) return false;
+    if (fHasSkim && !fSkim.Contains(entry.Run,entry.SubRun,entry.Event)) {
+        return false;
+    }
+    return true;
+}
+
+void CP::TRawCatalog::Selection::GetRunRange(int32_t& low,
+                                             int32_t& high) const {
+    low = std::numeric_limits<int32_t>::min();
+    high = std::numeric_limits<int32_t>::max();
+    if (fRuns.empty()) return;
+    int64_t l = fRuns.front().Low;
+    int64_t h = fRuns.front().High;
+    for (std::vector<Range>::const_iterator r = fRuns.begin();
+         r != fRuns.end(); ++r) {
+        l = std::min(l, r->Low);
+        h = std::max(h, r->High);
+    }
+    low = std::max<int64_t>(l, low);
+    high = std::min<int64_t>(h, high);
+}
+
+CP::TRawCatalog::TRawCatalog() : fSorted(true) {}
+
+CP::TRawCatalog::~TRawCatalog() {}
+
+int CP::TRawCatalog::AddFile(const std::string& name, FileType type) {
+    std::map<std::string,int>::const_iterator found = fFileIndex.find(name);
+    if (found != fFileIndex.end()) return found->second;
+    File file;
+    file.Name = name;
+    file.Type = type;
+    fFiles.push_back(file);
+    fFileIndex[name] = fFiles.size()-1;
+    return fFiles.size()-1;
+}
+
+void CP::TRawCatalog::SetCheckpoints(
+    int i, const std::vector<CP::TInflateStreamBuf::Checkpoint>& points) {
+    fFiles[i].Checkpoints = points;
+    fFiles[i].CheckpointCount = 0;
+}
+
+bool CP::TRawCatalog::GetCheckpoints(
+    int i, std::vector<CP::TInflateStreamBuf::Checkpoint>& points) const {
+    const File& file = fFiles[i];
+    points = file.Checkpoints;
+    if (file.CheckpointCount < 1) return true;
+    std::ifstream input(fCatalogName.c_str(),
+                        std::ios::in | std::ios::binary);
+    uint64_t size;
+    if (!input.is_open() || !fileSize(input,size)) {
+        CaptError("Cannot read checkpoints from catalog: " << fCatalogName);
+        return false;
+    }
+    input.seekg(file.CheckpointStart, std::ios::beg);
+    points.resize(file.CheckpointCount);
+    for (uint32_t c = 0; c < file.CheckpointCount; ++c) {
+        if (!readCheckpoint(input, size, points[c], true)) {
+            CaptError("Truncated catalog: " << fCatalogName);
+            points.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void CP::TRawCatalog::AddEntry(const Entry& entry) {
+    fEntries.push_back(entry);
+    fSorted = false;
+}
+
+void CP::TRawCatalog::Sort() {
+    if (fSorted) return;
+    std::sort(fEntries.begin(), fEntries.end(), entryLess);
+    fSorted = true;
+}
+
+void CP::TRawCatalog::Find(const Selection& selection,
+                           std::vector<Entry>& found) const {
+    found.clear();
+    std::vector<Entry>::const_iterator begin = fEntries.begin();
+    std::vector<Entry>::const_iterator end = fEntries.end();
+    if (fSorted) {
+        int32_t low;
+        int32_t high;
+        selection.GetRunRange(low,high);
+        begin = std::lower_bound(fEntries.begin(), fEntries.end(),
+                                 low, entryRunLess);
+        end = std::upper_bound(begin, fEntries.end(), high, runEntryLess);
+    }
+    for (std::vector<Entry>::const_iterator e = begin; e != end; ++e) {
+        if (selection.Match(*e)) found.push_back(*e);
+    }
+}
+
+bool CP::TRawCatalog::Write(const std::string& fileName) {
+    Sort();
+    // Get all of the checkpoints before the file is opened since they may
+    // be read from the same file.
+    std::vector< std::vector<CP::TInflateStreamBuf::Checkpoint> >
+        checkpoints(fFiles.size());
+    for (std::size_t i = 0; i < fFiles.size(); ++i) {
+        if (!GetCheckpoints(i, checkpoints[i])) return false;
+    }
+    std::ofstream output(fileName.c_str(),
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        CaptError("Cannot open catalog for writing: " << fileName);
+        return false;
+    }
+    output.write(catalogMagic, sizeof(catalogMagic));
+    writeValue(output, catalogVersion);
+    writeValue(output, static_cast<uint32_t>(fFiles.size()));
+    for (std::vector<File>::const_iterator f = fFiles.begin();
+         f != fFiles.end(); ++f) {
+        writeValue(output, static_cast<uint32_t>(f->Type));
+        writeValue(output, static_cast<uint32_t>(f->Name.size()));
+        output.write(f->Name.data(), f->Name.size());
+    }
+    writeValue(output, static_cast<uint64_t>(fEntries.size()));
+    for (std::vector<Entry>::const_iterator e = fEntries.begin();
+         e != fEntries.end(); ++e) {
+        writeValue(output, e->Run);
+        writeValue(output, e->SubRun);
+        writeValue(output, e->Event);
+        writeValue(output, e->Seconds);
+        writeValue(output, e->Nanoseconds);
+        writeValue(output, e->File);
+        writeValue(output, e->Offset);
+    }
+    std::vector<uint64_t> starts(fFiles.size());
+    for (std::size_t i = 0; i < checkpoints.size(); ++i) {
+        writeValue(output, static_cast<uint32_t>(checkpoints[i].size()));
+        starts[i] = output.tellp();
+        for (std::vector<CP::TInflateStreamBuf::Checkpoint>::const_iterator
+                 c = checkpoints[i].begin();
+             c != checkpoints[i].end(); ++c) {
+            writeValue(output, c->In);
+            writeValue(output, c->Out);
+            writeValue(output, c->Bits);
+            writeValue(output, static_cast<uint32_t>(c->Window.size()));
+            output.write(c->Window.data(), c->Window.size());
+        }
+    }
+    output.close();
+    if (output.fail()) {
+        CaptError("Error writing catalog: " << fileName);
+        return false;
+    }
+    // The checkpoints are now read from the new file when they're needed.
+    fCatalogName = fileName;
+    for (std::size_t i = 0; i < fFiles.size(); ++i) {
+        fFiles[i].Checkpoints.clear();
+        fFiles[i].CheckpointStart = starts[i];
+        fFiles[i].CheckpointCount = checkpoints[i].size();
+    }
+    return true;
+}
+
+bool CP::TRawCatalog::Read(const std::string& fileName) {
+    fCatalogName = fileName;
+    fFiles.clear();
+    fFileIndex.clear();
+    fEntries.clear();
+    fSorted = true;
+
+    std::ifstream input(fileName.c_str(), std::ios::in | std::ios::binary);
+    if (!input.is_open()) {
+        CaptError("Cannot open catalog: " << fileName);
+        return false;
+    }
+    uint64_t size;
+    if (!fileSize(input,size)) {
+        CaptError("Cannot find the size of catalog: " << fileName);
+        return false;
+    }
+    char magic[sizeof(catalogMagic)];
+    input.read(magic, sizeof(magic));
+    if (!input.good()
+        || !std::equal(magic, magic+sizeof(magic), catalogMagic)) {
+        CaptError("Not a catalog file: " << fileName);
+        return false;
+    }
+    uint32_t version;
+    if (!readValue(input,version) || version < 1
+        || version > catalogVersion) {
+        CaptError("Unsupported catalog version in " << fileName);
+        return false;
+    }
+    uint32_t files;
+    if (!readValue(input,files)) return false;
+    if (files > remainingBytes(input,size)/(2*sizeof(uint32_t))) {
+        CaptError("Truncated catalog: " << fileName);
+        return false;
+    }
+    for (uint32_t i = 0; i < files; ++i) {
+        uint32_t type;
+        uint32_t length;
+        if (!readValue(input,type)) return false;
+        if (!readValue(input,length)) return false;
+        if (length > remainingBytes(input,size)) {
+            CaptError("Truncated catalog: " << fileName);
+            fFiles.clear();
+            fFileIndex.clear();
+            return false;
+        }
+        File file;
+        file.Type = static_cast<FileType>(type);
+        file.Name.resize(length);
+        if (length > 0) input.read(&file.Name[0], length);
+        if (!input.good()) return false;
+        fFileIndex[file.Name] = fFiles.size();
+        fFiles.push_back(file);
+    }
+    uint64_t entries;
+    if (!readValue(input,entries)) return false;
+    if (entries > remainingBytes(input,size)/entryBytes) {
+        CaptError("Truncated catalog: " << fileName);
+        fFiles.clear();
+        fFileIndex.clear();
+        return false;
+    }
+    fEntries.reserve(entries);
+    for (uint64_t i = 0; i < entries; ++i) {
+        Entry entry;
+        readValue(input, entry.Run);
+        readValue(input, entry.SubRun);
+        readValue(input, entry.Event);
+        readValue(input, entry.Seconds);
+        readValue(input, entry.Nanoseconds);
+        readValue(input, entry.File);
+        readValue(input, entry.Offset);
+        if (input.fail() || entry.File >= fFiles.size()) {
+            CaptError("Truncated catalog: " << fileName);
+            fEntries.clear();
+            return false;
+        }
+        fEntries.push_back(entry);
+    }
+    if (version < 2) return true;
+
+    // Find the checkpoints for each file, but leave them in the file.
+    for (std::vector<File>::iterator f = fFiles.begin();
+         f != fFiles.end(); ++f) {
+        uint32_t count;
+        if (!readValue(input,count)
+            || count > remainingBytes(input,size)/checkpointBytes) {
+            CaptError("Truncated catalog: " << fileName);
+            fEntries.clear();
+            return false;
+        }
+        f->CheckpointStart = input.tellg();
+        f->CheckpointCount = count;
+        for (uint32_t c = 0; c < count; ++c) {
+            CP::TInflateStreamBuf::Checkpoint checkpoint;
+            if (!readCheckpoint(input, size, checkpoint, false)) {
+                CaptError("Truncated catalog: " << fileName);
+                fEntries.clear();
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,172 @@
+#ifndef TRawCatalog_hxx_seen
+#define TRawCatalog_hxx_seen
+
+#include <TRunEventSet.hxx>
+#include <TInflateStreamBuf.hxx>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+namespace CP {
+    class TRawCatalog;
+};
+
+/// A catalog of the events in a set of raw DAQ files.  Each entry records
+/// the run, subrun, event, time stamp, the file holding the event, and the
+/// offset of the event in the file.  For a ubdaq file, the offset is the
+/// byte offset of the event record (counted in the decompressed stream for
+/// a ".gz" file), and for a PDS file it's the tree entry.  The catalog is
+/// built by the capt-catalog application using the header-only reads (see
+/// TVRawInput), and is read by TCatalogInput so that selected events can be
+/// converted without reading the rest of the file.
+///
+/// A compressed ubdaq file can also have inflate checkpoints (see
+/// TInflateStreamBuf) so that TCatalogInput can start decompressing close
+/// to a selected event instead of at the start of the file.  The
+/// checkpoints are only read from the catalog file when they are needed
+/// (see GetCheckpoints()).
+///
+/// The catalog file is a binary file written in the host byte order.  It
+/// has a short header, the table of file names, the entries as fixed length
+/// records sorted by run, subrun and event, and then the checkpoints for
+/// each file.  Catalogs written before the checkpoints were added can still
+/// be read.
+class CP::TRawCatalog {
+public:
+    /// The types of file that can be in the catalog.
+    enum FileType {kUBDAQ = 1, kPDS = 2};
+
+    /// An event in the catalog.
+    struct Entry {
+        int32_t Run;
+        int32_t SubRun;
+        int32_t Event;
+        uint32_t Seconds;
+        uint32_t Nanoseconds;
+        uint32_t File;
+        uint64_t Offset;
+    };
+
+    /// A selection of catalog entries.  The selection is a comma separated
+    /// list of key=value pairs where the keys are "run", "subrun", "event",
+    /// "time" (unix seconds), or "skim".  The run, subrun, event and time
+    /// values are either a single number or an inclusive "low-high" range,
+    /// and a key can be repeated to select several ranges.  The skim value is
+    /// the name of a skim file (see TRunEventSet::ReadFile()).  An entry is
+    /// selected if it matches every key that is given, so
+    /// "run=2011,event=10-20" selects eleven events from run 2011.
+    class Selection {
+    public:
+        Selection() : fHasSkim(false) {}
+
+        /// Parse a selection string.  This returns false if the string
+        /// can't be parsed.
+        bool Parse(const std::string& selection);
+
+        /// Check if an entry is selected.
+        bool Match(const Entry& entry) const;
+
+        /// Get the run range that can be selected.  If no runs are given,
+        /// this is the full range of integers.
+        void GetRunRange(int32_t& low, int32_t& high) const;
+
+    private:
+        struct Range {
+            int64_t Low;
+            int64_t High;
+        };
+
+        static bool InRanges(const std::vector<Range>& ranges,
+                             int64_t value);
+
+        std::vector<Range> fRuns;
+        std::vector<Range> fSubRuns;
+        std::vector<Range> fEvents;
+        std::vector<Range> fTimes;
+        CP::TRunEventSet fSkim;
+        bool fHasSkim;
+    };
+
+    TRawCatalog();
+    virtual ~TRawCatalog();
+
+    /// Add a file to the catalog and return its index.  If the file is
+    /// already in the catalog, the existing index is returned.
+    int AddFile(const std::string& name, FileType type);
+
+    /// Add an entry to the catalog.  The file index must come from
+    /// AddFile().
+    void AddEntry(const Entry& entry);
+
+    /// Get the number of files.
+    int GetFileCount() const {return fFiles.size();}
+
+    /// Get the name of a file.
+    const std::string& GetFileName(int i) const {return fFiles[i].Name;}
+
+    /// Get the type of a file.
+    FileType GetFileType(int i) const {return fFiles[i].Type;}
+
+    /// Set the inflate checkpoints for a file.
+    void SetCheckpoints(
+        int i, const std::vector<CP::TInflateStreamBuf::Checkpoint>& points);
+
+    /// Get the inflate checkpoints for a file.  The checkpoints of a catalog
+    /// that was read from a file are read when this is called.  This
+    /// returns false if the checkpoints can't be read.
+    bool GetCheckpoints(
+        int i, std::vector<CP::TInflateStreamBuf::Checkpoint>& points) const;
+
+    /// Get the entries.  These are sorted after Sort(), Read() or Write()
+    /// is called.
+    const std::vector<Entry>& GetEntries() const {return fEntries;}
+
+    /// Sort the entries by run, subrun, event, file and offset.
+    void Sort();
+
+    /// Fill a vector with the selected entries in catalog order.  When the
+    /// selection has a run, only the entries for that run are looked at.
+    void Find(const Selection& selection, std::vector<Entry>& found) const;
+
+    /// Write the catalog to a file.  This returns false if the file can't
+    /// be written.
+    bool Write(const std::string& fileName);
+
+    /// Read the catalog from a file, replacing the current contents.  This
+    /// returns false if the file isn't a catalog.
+    bool Read(const std::string& fileName);
+
+private:
+    struct File {
+        File() : CheckpointStart(0), CheckpointCount(0) {}
+        std::string Name;
+        FileType Type;
+
+        /// The checkpoints set with SetCheckpoints().
+        std::vector<CP::TInflateStreamBuf::Checkpoint> Checkpoints;
+
+        /// The offset of the checkpoints in the catalog file that was read.
+        uint64_t CheckpointStart;
+
+        /// The number of checkpoints in the catalog file that was read.
+        uint32_t CheckpointCount;
+    };
+
+    /// The name of the catalog file that was read.
+    std::string fCatalogName;
+
+    /// The files in the catalog.
+    std::vector<File> fFiles;
+
+    /// The index of each file by name.
+    std::map<std::string,int> fFileIndex;
+
+    /// The entries in the catalog.
+    std::vector<Entry> fEntries;
+
+    /// Flag that the entries are sorted.
+    bool fSorted;
+};
+#endif
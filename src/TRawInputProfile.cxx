@@ -0,0 +1,201 @@
+#include "TRawInputProfile.hxx"
+
+#include <TCaptLog.hxx>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <ctime>
+
+namespace {
+    double wallSeconds() {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return now.tv_sec + 1E-9*now.tv_nsec;
+    }
+
+    double cpuSeconds() {
+        struct timespec now;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+        return now.tv_sec + 1E-9*now.tv_nsec;
+    }
+
+    /// Get the stream for the JSON lines.  All of the profiles write to the
+    /// same file.
+    std::ostream& jsonStream(const std::string& fileName) {
+        if (fileName.empty()) return std::cerr;
+        static std::ofstream output(fileName.c_str(), std::ios::app);
+        return output;
+    }
+
+    /// Quote a string for JSON.  The names are simple, so only quotes and
+    /// backslashes need to be escaped.
+    std::string jsonString(const std::string& value) {
+        std::string quoted = "\"";
+        for (std::size_t i = 0; i < value.size(); ++i) {
+            if (value[i] == '"' || value[i] == '\\') quoted += '\\';
+            quoted += value[i];
+        }
+        return quoted + "\"";
+    }
+}
+
+CP::TRawInputProfile::TRawInputProfile(const std::string& name)
+    : fName(name), fTraceCategory(CP::TRawInputTrace::Intern(name)),
+      fEnabled(false), fJSON(false), fPrinted(false), fEvents(0) {
+    const char* env = std::getenv("CAPTTRANS_PROFILE");
+    if (!env) return;
+    std::string value(env);
+    if (value.empty() || value == "0") return;
+    fEnabled = true;
+    std::size_t json = value.find("json");
+    if (json == std::string::npos) return;
+    fJSON = true;
+    if (value.compare(json,5,"json=") == 0) {
+        fJSONFile = value.substr(json+5);
+        fJSONFile = fJSONFile.substr(0,fJSONFile.find(','));
+    }
+}
+
+CP::TRawInputProfile::~TRawInputProfile() {}
+
+void CP::TRawInputProfile::SetName(const std::string& name) {
+    fName = name;
+    fTraceCategory = CP::TRawInputTrace::Intern(name);
+}
+
+int CP::TRawInputProfile::AddStage(const std::string& name) {
+    Stage stage;
+    stage.Name = name;
+    stage.TraceName = CP::TRawInputTrace::Intern(name);
+    stage.Calls = 0;
+    stage.Wall = stage.CPU = 0;
+    stage.LastWall = stage.LastCPU = 0;
+    fStages.push_back(stage);
+    return fStages.size()-1;
+}
+
+int CP::TRawInputProfile::AddCounter(const std::string& name) {
+    Counter counter;
+    counter.Name = name;
+    counter.Total = counter.Last = 0;
+    fCounters.push_back(counter);
+    return fCounters.size()-1;
+}
+
+void CP::TRawInputProfile::StartStage(int stage) {
+    Frame frame;
+    frame.Stage = stage;
+    frame.Wall = wallSeconds();
+    frame.CPU = cpuSeconds();
+    fRunning.push_back(frame);
+    CP::TRawInputTrace::Begin(fStages[stage].TraceName, fTraceCategory);
+}
+
+void CP::TRawInputProfile::StopStage(int stage) {
+    if (fRunning.empty() || fRunning.back().Stage != stage) {
+        CaptError("Profile " << fName << ": stage "
+                  << fStages[stage].Name << " stopped out of order");
+        fRunning.clear();
+        return;
+    }
+    CP::TRawInputTrace::End(fStages[stage].TraceName);
+    Frame frame = fRunning.back();
+    fRunning.pop_back();
+    double wall = wallSeconds() - frame.Wall;
+    double cpu = cpuSeconds() - frame.CPU;
+    Stage& current = fStages[stage];
+    ++current.Calls;
+    current.Wall += wall;
+    current.CPU += cpu;
+    // The time is taken out of the enclosing stage so that each stage only
+    // has its own time.
+    if (!fRunning.empty()) {
+        Stage& parent = fStages[fRunning.back().Stage];
+        parent.Wall -= wall;
+        parent.CPU -= cpu;
+    }
+}
+
+void CP::TRawInputProfile::EndEvent(int run, int event) {
+    CP::TRawInputTrace::MarkEvent(fTraceCategory, run, event);
+    if (!fEnabled) return;
+    ++fEvents;
+    if (fJSON) WriteEvent(run,event);
+    for (std::vector<Stage>::iterator s = fStages.begin();
+         s != fStages.end(); ++s) {
+        s->LastWall = s->Wall;
+        s->LastCPU = s->CPU;
+    }
+    for (std::vector<Counter>::iterator c = fCounters.begin();
+         c != fCounters.end(); ++c) {
+        c->Last = c->Total;
+    }
+}
+
+void CP::TRawInputProfile::WriteEvent(int run, int event) {
+    std::ostringstream line;
+    line << "{\"input\":" << jsonString(fName)
+         << ",\"run\":" << run
+         << ",\"event\":" << event
+         << ",\"stages\":{";
+    for (std::size_t i = 0; i < fStages.size(); ++i) {
+        const Stage& s = fStages[i];
+        if (i > 0) line << ",";
+        line << jsonString(s.Name)
+             << ":{\"wall\":" << s.Wall - s.LastWall
+             << ",\"cpu\":" << s.CPU - s.LastCPU << "}";
+    }
+    line << "},\"counters\":{";
+    for (std::size_t i = 0; i < fCounters.size(); ++i) {
+        const Counter& c = fCounters[i];
+        if (i > 0) line << ",";
+        line << jsonString(c.Name) << ":" << std::setprecision(15)
+             << c.Total - c.Last;
+    }
+    line << "}}";
+    jsonStream(fJSONFile) << line.str() << std::endl;
+}
+
+void CP::TRawInputProfile::PrintSummary() {
+    if (!fEnabled || fPrinted) return;
+    fPrinted = true;
+
+    double wall = 0;
+    double cpu = 0;
+    for (std::vector<Stage>::iterator s = fStages.begin();
+         s != fStages.end(); ++s) {
+        wall += s->Wall;
+        cpu += s->CPU;
+    }
+    double events = (fEvents > 0) ? fEvents : 1;
+
+    CaptLog("Profile " << fName << ": " << fEvents << " events, "
+            << std::setprecision(4) << wall << " s wall, "
+            << cpu << " s cpu");
+    for (std::vector<Stage>::iterator s = fStages.begin();
+         s != fStages.end(); ++s) {
+        CaptLog("   " << std::setw(12) << std::left << s->Name
+                << std::right
+                << " calls " << std::setw(10) << s->Calls
+                << " wall " << std::setw(10) << std::setprecision(4)
+                << s->Wall << " s"
+                << " (" << std::setw(5) << std::setprecision(3)
+                << ((wall > 0) ? 100.0*s->Wall/wall : 0.0) << "%)"
+                << " cpu " << std::setw(10) << std::setprecision(4)
+                << s->CPU << " s"
+                << " " << std::setprecision(4) << 1000.0*s->Wall/events
+                << " ms/event");
+    }
+    for (std::vector<Counter>::iterator c = fCounters.begin();
+         c != fCounters.end(); ++c) {
+        CaptLog("   " << std::setw(12) << std::left << c->Name
+                << std::right
+                << " total " << std::setw(14) << std::setprecision(12)
+                << c->Total
+                << " per event " << std::setprecision(6)
+                << c->Total/events);
+    }
+}
@@ -0,0 +1,199 @@
+#ifndef TRawInputProfile_hxx_seen
+#define TRawInputProfile_hxx_seen
+
+#include <TRawInputTrace.hxx>
+
+#include <string>
+#include <vector>
+
+namespace CP {
+    class TRawInputProfile;
+};
+
+/// Collect the time spent in each stage of a raw input, and counters for
+/// the amount of data that was handled, so that a slow conversion can be
+/// understood.  The profile is compiled into each of the raw inputs, but
+/// does nothing unless it is enabled.  It's enabled by setting the
+/// CAPTTRANS_PROFILE environment variable (or with SetEnabled()), and the
+/// summary is printed when the input file is closed.
+///
+/// \code
+/// CAPTTRANS_PROFILE=1 capt-trans -tubdaq run.ubdaq
+/// CAPTTRANS_PROFILE=json=profile.jsonl capt-trans -tubdaq run.ubdaq
+/// \endcode
+///
+/// When the value contains "json", a JSON line is also written for each
+/// event with the time and counts for that event.  The lines go to the
+/// file after "json=" (the lines from all of the inputs go to the same
+/// file), or to the standard error.
+///
+/// The stage times are wall and CPU (for the thread) seconds.  The stages
+/// can be nested, and the time for a stage doesn't include the time in the
+/// stages inside of it.  When a TRawInputTrace is being recorded, the
+/// stages are also added to the trace.
+class CP::TRawInputProfile {
+public:
+    /// Make a profile for an input.  The name is used in the summary.
+    explicit TRawInputProfile(const std::string& name);
+    virtual ~TRawInputProfile();
+
+    /// Time a stage while the timer exists.  Nothing is done if the profile
+    /// is NULL or isn't active.
+    ///
+    /// \code
+    /// {
+    ///     CP::TRawInputProfile::Timer timer(&fProfile, kDecode);
+    ///     Decode();
+    /// }
+    /// \endcode
+    class Timer {
+    public:
+        Timer(CP::TRawInputProfile* profile, int stage)
+            : fProfile(NULL), fStage(stage) {
+            if (profile && profile->IsActive()) {
+                fProfile = profile;
+                fProfile->StartStage(fStage);
+            }
+        }
+        ~Timer() {Stop();}
+
+        /// Stop the timer before it's destroyed.
+        void Stop() {
+            if (fProfile) fProfile->StopStage(fStage);
+            fProfile = NULL;
+        }
+    private:
+        CP::TRawInputProfile* fProfile;
+        int fStage;
+    };
+
+    /// Flag that the profile is being collected.
+    bool IsEnabled() const {return fEnabled;}
+
+    /// Turn the profile on or off.
+    void SetEnabled(bool enabled) {fEnabled = enabled;}
+
+    /// Flag that the stages need to be timed, either for the profile or
+    /// for the trace.
+    bool IsActive() const {
+        return fEnabled || CP::TRawInputTrace::IsEnabled();
+    }
+
+    /// Set the name of the input (e.g. the file being read).
+    void SetName(const std::string& name);
+
+    /// Add a stage and return the index used to time it.
+    int AddStage(const std::string& name);
+
+    /// Add a counter and return the index used to increment it.
+    int AddCounter(const std::string& name);
+
+    /// Increment a counter.
+    void Count(int counter, double value = 1) {
+        if (fEnabled) fCounters[counter].Total += value;
+    }
+
+    /// Start timing a stage.  This is usually done with a Timer.
+    void StartStage(int stage);
+
+    /// Stop timing a stage.  This must be the last stage that was started.
+    void StopStage(int stage);
+
+    /// Finish an event.  This counts the event and writes the JSON line
+    /// when it's been requested.
+    void EndEvent(int run, int event);
+
+    /// Print the summary.  This only prints once, and only when the profile
+    /// is enabled.
+    void PrintSummary();
+
+    /// Get the number of events that were profiled.
+    long GetEventCount() const {return fEvents;}
+
+    /// Get the number of stages.
+    int GetStageCount() const {return fStages.size();}
+
+    /// Get the name of a stage.
+    const std::string& GetStageName(int stage) const {
+        return fStages[stage].Name;
+    }
+
+    /// Get the wall seconds spent in a stage.
+    double GetStageWall(int stage) const {return fStages[stage].Wall;}
+
+    /// Get the CPU seconds spent in a stage.
+    double GetStageCPU(int stage) const {return fStages[stage].CPU;}
+
+    /// Get the number of counters.
+    int GetCounterCount() const {return fCounters.size();}
+
+    /// Get the name of a counter.
+    const std::string& GetCounterName(int counter) const {
+        return fCounters[counter].Name;
+    }
+
+    /// Get the total for a counter.
+    double GetCounterTotal(int counter) const {
+        return fCounters[counter].Total;
+    }
+
+private:
+    /// The accumulated time for a stage.
+    struct Stage {
+        std::string Name;
+        int TraceName;
+        long Calls;
+        double Wall;
+        double CPU;
+        double LastWall;
+        double LastCPU;
+    };
+
+    /// The accumulated value of a counter.
+    struct Counter {
+        std::string Name;
+        double Total;
+        double Last;
+    };
+
+    /// A running stage.
+    struct Frame {
+        int Stage;
+        double Wall;
+        double CPU;
+    };
+
+    /// Write the JSON line for the event just finished.
+    void WriteEvent(int run, int event);
+
+    /// The name of the input.
+    std::string fName;
+
+    /// The index of the input name in the trace.
+    int fTraceCategory;
+
+    /// Flag that the profile is being collected.
+    bool fEnabled;
+
+    /// Flag that a JSON line is written for each event.
+    bool fJSON;
+
+    /// The file for the JSON lines, or empty for the standard error.
+    std::string fJSONFile;
+
+    /// Flag that the summary was printed.
+    bool fPrinted;
+
+    /// The number of events.
+    long fEvents;
+
+    /// The stages.
+    std::vector<Stage> fStages;
+
+    /// The counters.
+    std::vector<Counter> fCounters;
+
+    /// The stages that are running.
+    std::vector<Frame> fRunning;
+};
+#endif
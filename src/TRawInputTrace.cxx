@@ -0,0 +1,218 @@
+#include "TRawInputTrace.hxx"
+
+#include <TCaptLog.hxx>
+
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <mutex>
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+
+#include <unistd.h>
+
+std::atomic<bool> CP::TRawInputTrace::fEnabled(false);
+
+namespace {
+    /// A begin, end or event record.
+    struct Record {
+        double Time;
+        int Name;
+        int Category;
+        int Thread;
+        int Run;
+        int Event;
+        char Phase;
+    };
+
+    /// The trace shared by all of the threads.
+    struct TraceState {
+        TraceState() : Next(0), Count(0), Start(0) {}
+        std::mutex Mutex;
+        std::vector<Record> Ring;
+        std::size_t Next;
+        std::size_t Count;
+        double Start;
+        std::string FileName;
+        std::vector<std::string> Names;
+        std::map<std::string,int> Index;
+        std::map<int,std::string> ThreadNames;
+    };
+
+    TraceState& traceState() {
+        static TraceState state;
+        return state;
+    }
+
+    double wallMicroseconds() {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return 1E6*now.tv_sec + 1E-3*now.tv_nsec;
+    }
+
+    /// Get a small number for the current thread so the trace is easy to
+    /// read.
+    int threadId() {
+        static std::atomic<int> threads(0);
+        static thread_local int id = ++threads;
+        return id;
+    }
+
+    /// Quote a string for JSON.
+    std::string jsonString(const std::string& value) {
+        std::string quoted = "\"";
+        for (std::size_t i = 0; i < value.size(); ++i) {
+            if (value[i] == '"' || value[i] == '\\') quoted += '\\';
+            quoted += value[i];
+        }
+        return quoted + "\"";
+    }
+
+    void addRecord(char phase, int name, int category,
+                   int run = 0, int event = 0) {
+        double now = wallMicroseconds();
+        int thread = threadId();
+        TraceState& state = traceState();
+        std::lock_guard<std::mutex> lock(state.Mutex);
+        if (state.Ring.empty()) return;
+        Record& record = state.Ring[state.Next];
+        record.Time = now - state.Start;
+        record.Name = name;
+        record.Category = category;
+        record.Thread = thread;
+        record.Run = run;
+        record.Event = event;
+        record.Phase = phase;
+        state.Next = (state.Next + 1) % state.Ring.size();
+        if (state.Count < state.Ring.size()) ++state.Count;
+    }
+
+    void writeAtExit() {CP::TRawInputTrace::Write();}
+
+    /// Enable the trace from the environment.
+    class TRawInputTraceEnvironment {
+    public:
+        TRawInputTraceEnvironment() {
+            const char* env = std::getenv("CAPTTRANS_TRACE");
+            if (!env) return;
+            std::string value(env);
+            if (value.empty() || value == "0") return;
+            if (value == "1") value = "capttrans-trace.json";
+            CP::TRawInputTrace::Enable(value);
+        }
+    };
+    TRawInputTraceEnvironment environmentObject;
+}
+
+void CP::TRawInputTrace::Enable(const std::string& fileName, int capacity) {
+    TraceState& state = traceState();
+    {
+        std::lock_guard<std::mutex> lock(state.Mutex);
+        state.FileName = fileName;
+        if (!state.Ring.empty()) return;
+        state.Ring.resize(capacity>0 ? capacity : kDefaultCapacity);
+        state.Start = wallMicroseconds();
+    }
+    std::atexit(writeAtExit);
+    fEnabled = true;
+    SetThreadName("main");
+}
+
+int CP::TRawInputTrace::Intern(const std::string& name) {
+    TraceState& state = traceState();
+    std::lock_guard<std::mutex> lock(state.Mutex);
+    std::map<std::string,int>::iterator found = state.Index.find(name);
+    if (found != state.Index.end()) return found->second;
+    state.Names.push_back(name);
+    state.Index[name] = state.Names.size()-1;
+    return state.Names.size()-1;
+}
+
+void CP::TRawInputTrace::Begin(int name, int category) {
+    if (!fEnabled) return;
+    addRecord('B', name, category);
+}
+
+void CP::TRawInputTrace::End(int name) {
+    if (!fEnabled) return;
+    addRecord('E', name, -1);
+}
+
+void CP::TRawInputTrace::MarkEvent(int category, int run, int event) {
+    if (!fEnabled) return;
+    static int eventName = Intern("event");
+    addRecord('i', eventName, category, run, event);
+}
+
+void CP::TRawInputTrace::SetThreadName(const std::string& name) {
+    if (!fEnabled) return;
+    int thread = threadId();
+    TraceState& state = traceState();
+    std::lock_guard<std::mutex> lock(state.Mutex);
+    state.ThreadNames[thread] = name;
+}
+
+CP::TRawInputTrace::Span::Span(const char* name, const char* category)
+    : fName(-1) {
+    if (!fEnabled) return;
+    fName = Intern(name);
+    Begin(fName, Intern(category));
+}
+
+CP::TRawInputTrace::Span::~Span() {
+    if (fName >= 0) End(fName);
+}
+
+bool CP::TRawInputTrace::Write() {
+    if (!fEnabled) return true;
+    TraceState& state = traceState();
+    std::lock_guard<std::mutex> lock(state.Mutex);
+    std::ofstream output(state.FileName.c_str());
+    if (!output) {
+        CaptError("Cannot write trace to " << state.FileName);
+        return false;
+    }
+
+    int pid = getpid();
+    output << "{\"traceEvents\":[\n";
+    output << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+           << ",\"tid\":0,\"args\":{\"name\":\"captTrans\"}}";
+    for (std::map<int,std::string>::iterator t = state.ThreadNames.begin();
+         t != state.ThreadNames.end(); ++t) {
+        output << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+               << ",\"tid\":" << t->first
+               << ",\"args\":{\"name\":" << jsonString(t->second) << "}}";
+    }
+
+    // The oldest records may have been overwritten, so an end without a
+    // begin is dropped.
+    std::map<int,int> depth;
+    std::size_t size = state.Ring.size();
+    std::size_t first = (state.Next + size - state.Count) % size;
+    output.precision(15);
+    for (std::size_t i = 0; i < state.Count; ++i) {
+        const Record& record = state.Ring[(first + i) % size];
+        if (record.Phase == 'B') ++depth[record.Thread];
+        if (record.Phase == 'E') {
+            if (depth[record.Thread] < 1) continue;
+            --depth[record.Thread];
+        }
+        output << ",\n{\"name\":" << jsonString(state.Names[record.Name])
+               << ",\"ph\":\"" << record.Phase << "\""
+               << ",\"ts\":" << record.Time
+               << ",\"pid\":" << pid
+               << ",\"tid\":" << record.Thread;
+        if (record.Category >= 0) {
+            output << ",\"cat\":" << jsonString(state.Names[record.Category]);
+        }
+        if (record.Phase == 'i') {
+            output << ",\"s\":\"t\",\"args\":{\"run\":" << record.Run
+                   << ",\"event\":" << record.Event << "}";
+        }
+        output << "}";
+    }
+    output << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+    return true;
+}
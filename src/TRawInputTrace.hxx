@@ -0,0 +1,77 @@
+#ifndef TRawInputTrace_hxx_seen
+#define TRawInputTrace_hxx_seen
+
+#include <string>
+#include <atomic>
+
+namespace CP {
+    class TRawInputTrace;
+};
+
+/// Record a timeline of the stages of the raw inputs so that stalls (for
+/// instance the decompression starving the decoder, or a merge waiting for
+/// the PDS file) can be seen.  The begin and end of each stage timed by a
+/// TRawInputProfile is recorded along with the thread, and each event is
+/// marked.  The records are kept in a fixed size ring buffer (so only the
+/// end of a long job is kept), and written at exit as a Chrome trace JSON
+/// file that can be loaded into chrome://tracing or the Perfetto UI.
+///
+/// The trace is enabled by setting the CAPTTRANS_TRACE environment variable
+/// to the output file name (a value of "1" writes capttrans-trace.json), or
+/// with "capt-trans -O trace=<file>".
+///
+/// \code
+/// CAPTTRANS_TRACE=run2011.json capt-trans -tubdaqlist @run2011.list
+/// \endcode
+///
+/// The methods are static and may be called from any thread.
+class CP::TRawInputTrace {
+public:
+    /// Time a span while the object exists.  Nothing is done if the trace
+    /// isn't enabled.  The name and category are interned, so this should
+    /// only be used for spans that don't happen often (e.g. opening a
+    /// file).
+    class Span {
+    public:
+        Span(const char* name, const char* category);
+        ~Span();
+    private:
+        int fName;
+    };
+
+    /// Flag that the trace is being recorded.
+    static bool IsEnabled() {return fEnabled;}
+
+    /// Start recording the trace, and write it to fileName at exit.  The
+    /// capacity is the number of records kept in the ring buffer.
+    static void Enable(const std::string& fileName,
+                       int capacity = kDefaultCapacity);
+
+    /// Get the index for a name (or category) used in the records.
+    static int Intern(const std::string& name);
+
+    /// Record the beginning of a span on the current thread.
+    static void Begin(int name, int category);
+
+    /// Record the end of the last span started on the current thread.
+    static void End(int name);
+
+    /// Mark the end of an event.
+    static void MarkEvent(int category, int run, int event);
+
+    /// Name the current thread in the trace.
+    static void SetThreadName(const std::string& name);
+
+    /// Write the trace.  This is done at exit, but can be called earlier.
+    /// It returns false if the file can't be written.
+    static bool Write();
+
+    /// The default number of records kept.  Each record is 32 bytes.
+    static const int kDefaultCapacity = 1<<20;
+
+private:
+    /// Flag that the trace is being recorded.  This is read by every thread
+    /// without the lock.
+    static std::atomic<bool> fEnabled;
+};
+#endif
@@ -0,0 +1,99 @@
+#include "TRawStreamBuf.hxx"
+
+#include <TCaptLog.hxx>
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+CP::TRawStreamBuf::TRawStreamBuf(const char* name, std::size_t blockSize)
+    : fFile(-1), fOwned(false), fSeekable(false), fBuffer(blockSize),
+      fBufferStart(0) {
+    setg(&fBuffer[0], &fBuffer[0], &fBuffer[0]);
+    if (std::strcmp(name,"-") == 0) {
+        fFile = STDIN_FILENO;
+    }
+    else {
+        fFile = open(name, O_RDONLY);
+        fOwned = true;
+        if (fFile < 0) {
+            CaptError("Cannot open " << name << ": " << std::strerror(errno));
+            return;
+        }
+    }
+    struct stat status;
+    if (fstat(fFile,&status) == 0 && S_ISREG(status.st_mode)) {
+        fSeekable = true;
+        fBufferStart = lseek(fFile, 0, SEEK_CUR);
+    }
+}
+
+CP::TRawStreamBuf::~TRawStreamBuf() {
+    if (fOwned && fFile >= 0) close(fFile);
+}
+
+std::streamsize CP::TRawStreamBuf::ReadBlock() {
+    if (fFile < 0) return 0;
+    char* end = egptr();
+    std::streamsize space = &fBuffer[0] + fBuffer.size() - end;
+    if (space < 1) return 0;
+    while (true) {
+        ssize_t n = read(fFile, end, space);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 1) return 0;
+        setg(eback(), gptr(), end+n);
+        return n;
+    }
+}
+
+bool CP::TRawStreamBuf::IsGzip() {
+    // A pipe can return less than asked for, so keep reading until there
+    // are two characters.
+    while (egptr() - gptr() < 2) {
+        if (ReadBlock() < 1) return false;
+    }
+    return (static_cast<unsigned char>(gptr()[0]) == 0x1f
+            && static_cast<unsigned char>(gptr()[1]) == 0x8b);
+}
+
+CP::TRawStreamBuf::int_type CP::TRawStreamBuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    fBufferStart += egptr() - eback();
+    setg(&fBuffer[0], &fBuffer[0], &fBuffer[0]);
+    if (ReadBlock() < 1) return traits_type::eof();
+    return traits_type::to_int_type(*gptr());
+}
+
+CP::TRawStreamBuf::pos_type CP::TRawStreamBuf::seekoff(
+    off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) {
+    if (!fSeekable) return pos_type(off_type(-1));
+    off_type current = fBufferStart + (gptr() - eback());
+    if (dir == std::ios_base::cur) {
+        if (off == 0) return pos_type(current);
+        return seekpos(pos_type(current+off), std::ios_base::in);
+    }
+    if (dir == std::ios_base::end) {
+        off_type end = lseek(fFile, 0, SEEK_END);
+        if (end < 0) return pos_type(off_type(-1));
+        return seekpos(pos_type(end+off), std::ios_base::in);
+    }
+    return seekpos(pos_type(off), std::ios_base::in);
+}
+
+CP::TRawStreamBuf::pos_type CP::TRawStreamBuf::seekpos(
+    pos_type pos, std::ios_base::openmode) {
+    if (!fSeekable) return pos_type(off_type(-1));
+    off_type target = pos;
+    if (fBufferStart <= target
+        && target <= fBufferStart + (egptr() - eback())) {
+        setg(eback(), eback() + (target - fBufferStart), egptr());
+        return pos;
+    }
+    if (lseek(fFile, target, SEEK_SET) < 0) return pos_type(off_type(-1));
+    fBufferStart = target;
+    setg(&fBuffer[0], &fBuffer[0], &fBuffer[0]);
+    return pos;
+}
@@ -0,0 +1,63 @@
+#ifndef TRawStreamBuf_hxx_seen
+#define TRawStreamBuf_hxx_seen
+
+#include <streambuf>
+#include <vector>
+
+namespace CP {
+    class TRawStreamBuf;
+};
+
+/// An input stream buffer that reads a raw DAQ file in large blocks using
+/// the file descriptor.  The name "-" reads the standard input, and a named
+/// pipe (FIFO) can be read like any other file.  Seeking is only supported
+/// for regular files, and the buffer never seeks on its own, so the data can
+/// be streamed straight from a transfer pipe without being copied to disk.
+class CP::TRawStreamBuf : public std::streambuf {
+public:
+    /// Open the file.  The name "-" is the standard input.
+    explicit TRawStreamBuf(const char* name, std::size_t blockSize = 1<<20);
+    virtual ~TRawStreamBuf();
+
+    /// Flag that the file is open.
+    bool IsOpen() const {return fFile >= 0;}
+
+    /// Flag that the file can seek (i.e. it's a regular file).
+    bool IsSeekable() const {return fSeekable;}
+
+    /// Check if the data starts with the gzip magic number (0x1f 0x8b).
+    /// This must be called before anything is read, and doesn't use up any
+    /// of the data.
+    bool IsGzip();
+
+    /// Get the position in the file of the next character that will be
+    /// read.
+    off_type GetPosition() const {return fBufferStart + (gptr() - eback());}
+
+protected:
+    virtual int_type underflow();
+    virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                             std::ios_base::openmode which);
+    virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+
+private:
+    /// Read a block from the file into the buffer after the characters
+    /// that are already there.  This returns the number of characters read.
+    std::streamsize ReadBlock();
+
+    /// The file descriptor.
+    int fFile;
+
+    /// Flag that the descriptor should be closed.
+    bool fOwned;
+
+    /// Flag that the file can seek.
+    bool fSeekable;
+
+    /// The local buffer.
+    std::vector<char> fBuffer;
+
+    /// The file position of the start of the buffer.
+    off_type fBufferStart;
+};
+#endif
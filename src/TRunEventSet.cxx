@@ -0,0 +1,120 @@
+#include "TRunEventSet.hxx"
+
+#include <TCaptLog.hxx>
+
+#include <fstream>
+#include <sstream>
+#include <stdint.h>
+
+const CP::TRunEventSet* CP::TRunEventSet::fInputSelection = NULL;
+
+CP::TRunEventSet::TRunEventSet() : fEntries(0) {
+    Slot empty = {0, 0, 0, false};
+    fTable.resize(64,empty);
+}
+
+CP::TRunEventSet::~TRunEventSet() {}
+
+std::size_t CP::TRunEventSet::Hash(int run, int event) const {
+    // Mix the run and event into 64 bits (this is the splitmix64
+    // finalizer).  The run numbers are all similar, and the event numbers
+    // are sequential, so the mixing is needed to keep the probe sequences
+    // short.
+    uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(run)) << 32)
+        | static_cast<uint32_t>(event);
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return static_cast<std::size_t>(key) & (fTable.size()-1);
+}
+
+void CP::TRunEventSet::Grow() {
+    std::vector<Slot> old;
+    old.swap(fTable);
+    Slot empty = {0, 0, 0, false};
+    fTable.resize(2*old.size(),empty);
+    fEntries = 0;
+    for (std::vector<Slot>::const_iterator s = old.begin();
+         s != old.end(); ++s) {
+        if (s->Used) Insert(s->Run, s->SubRun, s->Event);
+    }
+}
+
+void CP::TRunEventSet::Insert(int run, int subrun, int event) {
+    // Keep the load factor below one half.
+    if (2*(fEntries+1) > (int) fTable.size()) Grow();
+    std::size_t mask = fTable.size()-1;
+    std::size_t i = Hash(run,event);
+    while (fTable[i].Used) {
+        if (fTable[i].Run == run
+            && fTable[i].SubRun == subrun
+            && fTable[i].Event == event) return;
+        i = (i+1) & mask;
+    }
+    fTable[i].Run = run;
+    fTable[i].SubRun = subrun;
+    fTable[i].Event = event;
+    fTable[i].Used = true;
+    ++fEntries;
+}
+
+bool CP::TRunEventSet::Contains(int run, int subrun, int event) const {
+    std::size_t mask = fTable.size()-1;
+    std::size_t i = Hash(run,event);
+    while (fTable[i].Used) {
+        const Slot& slot = fTable[i];
+        if (slot.Run == run && slot.Event == event) {
+            if (slot.SubRun == kAnySubRun) return true;
+            if (subrun == kAnySubRun) return true;
+            if (slot.SubRun == subrun) return true;
+        }
+        i = (i+1) & mask;
+    }
+    return false;
+}
+
+void CP::TRunEventSet::Clear() {
+    Slot empty = {0, 0, 0, false};
+    fTable.assign(64,empty);
+    fEntries = 0;
+}
+
+int CP::TRunEventSet::ReadFile(const std::string& fileName) {
+    std::ifstream in(fileName.c_str());
+    if (!in.is_open()) {
+        CaptError("Cannot open skim file: " << fileName);
+        return 0;
+    }
+    int before = fEntries;
+    std::string line;
+    while (std::getline(in,line)) {
+        if (line.empty()) continue;
+        if (line[0] == '#') continue;
+        std::istringstream lineStream(line);
+        int values[3];
+        int found = 0;
+        while (found < 3 && lineStream >> values[found]) ++found;
+        if (found == 2) {
+            Insert(values[0],values[1]);
+        }
+        else if (found == 3) {
+            Insert(values[0],values[1],values[2]);
+        }
+        else {
+            CaptError("Invalid skim line: " << line);
+        }
+    }
+    in.close();
+    // Events already in the set aren't added again.
+    return fEntries - before;
+}
+
+void CP::TRunEventSet::SetInputSelection(const CP::TRunEventSet* selection) {
+    fInputSelection = selection;
+}
+
+const CP::TRunEventSet* CP::TRunEventSet::GetInputSelection() {
+    return fInputSelection;
+}
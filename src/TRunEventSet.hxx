@@ -0,0 +1,92 @@
+#ifndef TRunEventSet_hxx_seen
+#define TRunEventSet_hxx_seen
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace CP {
+    class TRunEventSet;
+};
+
+/// A set of (run, subrun, event) numbers used to select events.  The set is
+/// an open-addressed hash table (linear probing on the run and event number)
+/// so checking if an event is selected takes a couple of probes no matter
+/// how many events are in the list.  A subrun of kAnySubRun matches every
+/// subrun.  That is how the two column "run event" skim files are handled,
+/// and it's also what an input without a subrun (e.g. Nevis) should use
+/// when asking about an event.
+///
+/// The raw input classes (TUBDAQInput, TNevisInput and TmPDSInput) check
+/// the input selection, if one has been set, before the event digits are
+/// built so that unselected events cost as little as possible.
+class CP::TRunEventSet {
+public:
+    /// The subrun value that matches any subrun.
+    enum {kAnySubRun = -1};
+
+    TRunEventSet();
+    virtual ~TRunEventSet();
+
+    /// Add an event to the set.
+    void Insert(int run, int subrun, int event);
+
+    /// Add an event to the set that will match any subrun.
+    void Insert(int run, int event) {Insert(run,kAnySubRun,event);}
+
+    /// Check if an event is in the set.  If either the subrun in the set,
+    /// or the subrun that is being checked is kAnySubRun, then only the run
+    /// and event need to match.
+    bool Contains(int run, int subrun, int event) const;
+
+    /// Read a skim file and add the events to the set.  Each line has
+    /// either "run event" or "run subrun event".  Lines starting with '#'
+    /// are comments.  This returns the number of events added (an event
+    /// that is already in the set isn't counted).
+    int ReadFile(const std::string& fileName);
+
+    /// Return the number of events in the set.
+    int GetSize() const {return fEntries;}
+
+    /// Flag that the set is empty.
+    bool IsEmpty() const {return fEntries < 1;}
+
+    /// Remove all of the events from the set.
+    void Clear();
+
+    /// Set the selection that is applied by the raw input classes before
+    /// an event is decoded.  The set is not owned and must remain valid
+    /// until it is replaced.  A NULL pointer turns off the selection.
+    static void SetInputSelection(const CP::TRunEventSet* selection);
+
+    /// Get the selection applied by the raw input classes.  This returns
+    /// NULL if all events should be read.
+    static const CP::TRunEventSet* GetInputSelection();
+
+private:
+    /// A slot in the hash table.
+    struct Slot {
+        int Run;
+        int SubRun;
+        int Event;
+        bool Used;
+    };
+
+    /// Find the starting slot for a run and event.  The subrun isn't
+    /// hashed so that the wildcard entries end up in the same probe
+    /// sequence as the exact entries.
+    std::size_t Hash(int run, int event) const;
+
+    /// Double the size of the table.
+    void Grow();
+
+    /// The hash table.  The size is always a power of two.
+    std::vector<Slot> fTable;
+
+    /// The number of used slots.
+    int fEntries;
+
+    /// The input selection.
+    static const CP::TRunEventSet* fInputSelection;
+};
+#endif
@@ -0,0 +1,34 @@
+#ifndef TUBDAQCaboose_hxx_seen
+#define TUBDAQCaboose_hxx_seen
+
+#include <stdint.h>
+
+namespace CP {
+    struct TUBDAQCaboose;
+};
+
+/// A caboose that can follow an event record in a ubdaq file.  The version
+/// 5 ubdaq format is just one boost archive after another, so a reader
+/// can't tell a finished file from one that the DAQ is still writing.  A
+/// writer that knows about cabooses puts one after each record with the
+/// size of the record, and puts a caboose with a size of zero at the end of
+/// the file.  TUBDAQInput accepts files with or without cabooses, and stops
+/// cleanly when it finds the end caboose (this is what ends a
+/// "ubdaq(follow)" input).
+///
+/// A boost archive starts with the eight byte length of the archive
+/// signature (22), so the caboose marker can't be confused with the start
+/// of a record.  The fields are written in the host byte order.
+struct CP::TUBDAQCaboose {
+    /// The marker that starts a caboose ("CABOOSE!" as a little endian
+    /// word).
+    static const uint64_t kMarker = 0x2145534F4F424143ULL;
+
+    /// The marker.
+    uint64_t Marker;
+
+    /// The size of the record before the caboose, or zero for the end of
+    /// the file.
+    uint64_t Size;
+};
+#endif
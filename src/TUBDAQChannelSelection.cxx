@@ -0,0 +1,140 @@
+#include "TUBDAQChannelSelection.hxx"
+
+#include <TCaptLog.hxx>
+
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+CP::TUBDAQChannelSelection::TUBDAQChannelSelection() : fHasMask(false) {}
+
+CP::TUBDAQChannelSelection::~TUBDAQChannelSelection() {}
+
+bool CP::TUBDAQChannelSelection::ParseRange(const std::string& value,
+                                            Range& range) {
+    char* end = NULL;
+    range.Low = std::strtol(value.c_str(),&end,10);
+    if (end == value.c_str()) return false;
+    range.High = range.Low;
+    if (*end == '-') {
+        const char* high = end+1;
+        range.High = std::strtol(high,&end,10);
+        if (end == high) return false;
+    }
+    return *end == 0;
+}
+
+bool CP::TUBDAQChannelSelection::InRanges(const std::vector<Range>& ranges,
+                                          int value) {
+    if (ranges.empty()) return true;
+    for (std::vector<Range>::const_iterator r = ranges.begin();
+         r != ranges.end(); ++r) {
+        if (r->Low <= value && value <= r->High) return true;
+    }
+    return false;
+}
+
+bool CP::TUBDAQChannelSelection::Parse(const std::string& args) {
+    // Only look inside of the parentheses.
+    std::string argument = args;
+    std::size_t open = argument.find('(');
+    if (open != std::string::npos) argument = argument.substr(open+1);
+    std::size_t close = argument.rfind(')');
+    if (close != std::string::npos) argument = argument.substr(0,close);
+
+    std::istringstream items(argument);
+    std::string item;
+    while (std::getline(items,item,',')) {
+        std::size_t equal = item.find('=');
+        if (equal == std::string::npos) continue;
+        std::string key = item.substr(0,equal);
+        std::string value = item.substr(equal+1);
+        if (key == "mask") {
+            if (!ReadMaskFile(value)) return false;
+            continue;
+        }
+        std::vector<Range>* ranges = NULL;
+        if (key == "crates") ranges = &fCrates;
+        else if (key == "cards") ranges = &fCards;
+        else if (key == "channels") ranges = &fChannels;
+        else continue;
+        Range range;
+        if (!ParseRange(value,range)) {
+            CaptError("Invalid ubdaq channel selection: " << item);
+            return false;
+        }
+        ranges->push_back(range);
+        CaptLog("UBDAQ builder argument: " << item
+                << " --> Convert " << key << " " << range.Low
+                << " to " << range.High);
+    }
+    return true;
+}
+
+bool CP::TUBDAQChannelSelection::ReadMaskFile(const std::string& fileName) {
+    std::ifstream input(fileName.c_str());
+    if (!input.is_open()) {
+        CaptError("Cannot open channel mask " << fileName);
+        return false;
+    }
+    std::string line;
+    int entries = 0;
+    while (std::getline(input,line)) {
+        std::size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        std::istringstream fields(line);
+        int crate;
+        if (!(fields >> crate)) continue;
+        int card = -1;
+        int channel = -1;
+        if (fields >> card) {
+            if (!(fields >> channel)) channel = -1;
+        }
+        else card = -1;
+        fMask.insert(MaskKey(crate,card,channel));
+        fMaskCrates.insert(crate);
+        ++entries;
+    }
+    fHasMask = true;
+    CaptLog("Channel mask " << fileName << ": " << entries << " entries");
+    return true;
+}
+
+bool CP::TUBDAQChannelSelection::CrateSelected(int crate) const {
+    if (!InRanges(fCrates,crate)) return false;
+    if (fHasMask && fMaskCrates.find(crate) == fMaskCrates.end()) {
+        return false;
+    }
+    return true;
+}
+
+uint32_t CP::TUBDAQChannelSelection::GetCardMask(int crate) const {
+    if (!CrateSelected(crate)) return 0;
+    bool wholeCrate = !fHasMask
+        || fMask.find(MaskKey(crate,-1,-1)) != fMask.end();
+    uint32_t mask = 0;
+    for (int card = 0; card < 32; ++card) {
+        if (!InRanges(fCards,card)) continue;
+        if (!wholeCrate) {
+            // The card is needed if the mask has the whole card or any of
+            // its channels.
+            std::set<int64_t>::const_iterator entry
+                = fMask.lower_bound(MaskKey(crate,card,-1));
+            if (entry == fMask.end()
+                || *entry >= MaskKey(crate,card+1,-1)) continue;
+        }
+        mask |= (uint32_t) 1 << card;
+    }
+    return mask;
+}
+
+bool CP::TUBDAQChannelSelection::ChannelSelected(int crate, int card,
+                                                 int channel) const {
+    if (!InRanges(fChannels,channel)) return false;
+    if (!InRanges(fCards,card)) return false;
+    if (!CrateSelected(crate)) return false;
+    if (!fHasMask) return true;
+    return fMask.find(MaskKey(crate,-1,-1)) != fMask.end()
+        || fMask.find(MaskKey(crate,card,-1)) != fMask.end()
+        || fMask.find(MaskKey(crate,card,channel)) != fMask.end();
+}
@@ -0,0 +1,101 @@
+#ifndef TUBDAQChannelSelection_hxx_seen
+#define TUBDAQChannelSelection_hxx_seen
+
+#include <string>
+#include <vector>
+#include <set>
+#include <stdint.h>
+
+namespace CP {
+    class TUBDAQChannelSelection;
+};
+
+/// A selection of the crates, cards (FEMs) and channels to convert from a
+/// ubdaq file.  The selection is used by TUBDAQInput so that the crates and
+/// cards that aren't needed are passed over using the sizes in their
+/// headers without being copied or unpacked, and digits are only made for
+/// the selected channels.  It's filled from the ubdaq builder arguments,
+/// for instance
+///
+/// \code
+/// -tubdaq(crates=1-2,cards=7-12,channels=0-31)
+/// -tubdaq(crates=1,crates=4,mask=collection.mask)
+/// \endcode
+///
+/// where the values are a single number or an inclusive "low-high" range,
+/// and a key can be repeated to select several ranges.  The cards are
+/// selected by module number, and the channels by the channel number in
+/// the card, so the card and channel ranges apply to every selected crate.
+/// The mask file has one "crate [card [channel]]" entry per line (a
+/// missing card or channel selects all of them), and lines starting with
+/// "#" are comments.  A channel must pass every selection that is given.
+/// The selection applies to the TPC and PMT crates.
+class CP::TUBDAQChannelSelection {
+public:
+    TUBDAQChannelSelection();
+    virtual ~TUBDAQChannelSelection();
+
+    /// Parse the selection from the arguments given to a ubdaq style input
+    /// builder (e.g. "ubdaq(2800,3800,crates=1-2)").  Arguments that aren't
+    /// part of the selection are ignored.  This returns false if a
+    /// selection value can't be parsed.
+    bool Parse(const std::string& args);
+
+    /// Read a channel mask file.  This returns false if the file can't be
+    /// read.
+    bool ReadMaskFile(const std::string& fileName);
+
+    /// Flag that everything is selected.
+    bool IsEmpty() const {
+        return fCrates.empty() && fCards.empty() && fChannels.empty()
+            && !fHasMask;
+    }
+
+    /// Check if any of a crate is selected.
+    bool CrateSelected(int crate) const;
+
+    /// Get the mask of the cards selected in a crate.  Bit n is set if
+    /// module n is selected (see crateData::setCardSelection).
+    uint32_t GetCardMask(int crate) const;
+
+    /// Check if a channel is selected.
+    bool ChannelSelected(int crate, int card, int channel) const;
+
+private:
+    struct Range {
+        int Low;
+        int High;
+    };
+
+    /// Parse a "low-high" range, or a single number.
+    static bool ParseRange(const std::string& value, Range& range);
+
+    /// Check if a value is in any of the ranges.  An empty set of ranges
+    /// has every value.
+    static bool InRanges(const std::vector<Range>& ranges, int value);
+
+    /// Make the key for a mask entry.  A card or channel of -1 means all.
+    static int64_t MaskKey(int crate, int card, int channel) {
+        return ((int64_t) crate << 40)
+            + ((int64_t) (card+1) << 20) + (channel+1);
+    }
+
+    /// The selected crates.
+    std::vector<Range> fCrates;
+
+    /// The selected cards.
+    std::vector<Range> fCards;
+
+    /// The selected channels.
+    std::vector<Range> fChannels;
+
+    /// The entries in the mask file.
+    std::set<int64_t> fMask;
+
+    /// The crates with entries in the mask file.
+    std::set<int> fMaskCrates;
+
+    /// Flag that a mask file was read.
+    bool fHasMask;
+};
+#endif
@@ -0,0 +1,153 @@
+#include "TUBDAQEventCache.hxx"
+
+#include "TRawInputTrace.hxx"
+
+#include <TCaptLog.hxx>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+
+class CP::TUBDAQEventCache::Worker {
+public:
+    /// Locks the cache (and the source).
+    std::mutex Lock;
+
+    /// Signals that there is something to read ahead, or that the worker
+    /// should stop.
+    std::condition_variable Wake;
+
+    /// Flag that the thread should finish.
+    bool Stop;
+
+    std::thread Thread;
+};
+
+CP::TUBDAQEventCache::TUBDAQEventCache(Source& source, double megabytes,
+                                       int readAhead)
+    : fSource(source), fBudget(megabytes*1024*1024),
+      fReadAhead(std::max(0,readAhead)), fSize(0), fEnd(-1),
+      fNextAhead(0), fLastAhead(0), fHits(0), fMisses(0), fWorker(NULL) {
+    if (fReadAhead < 1) return;
+    fWorker = new Worker;
+    fWorker->Stop = false;
+    fWorker->Thread = std::thread(&CP::TUBDAQEventCache::ReadAhead, this);
+}
+
+CP::TUBDAQEventCache::~TUBDAQEventCache() {
+    if (fWorker) {
+        {
+            std::lock_guard<std::mutex> lock(fWorker->Lock);
+            fWorker->Stop = true;
+        }
+        fWorker->Wake.notify_all();
+        fWorker->Thread.join();
+        delete fWorker;
+        fWorker = NULL;
+    }
+    for (std::map<int,Entry>::iterator r = fRecords.begin();
+         r != fRecords.end(); ++r) {
+        delete r->second.Data;
+    }
+}
+
+const CP::TUBDAQEventCache::Record* CP::TUBDAQEventCache::Find(int index) {
+    std::map<int,Entry>::iterator r = fRecords.find(index);
+    if (r == fRecords.end()) return NULL;
+    fUseOrder.splice(fUseOrder.begin(), fUseOrder, r->second.Use);
+    return r->second.Data;
+}
+
+void CP::TUBDAQEventCache::Trim(int keep) {
+    std::list<int>::iterator use = fUseOrder.end();
+    while (fSize > fBudget && use != fUseOrder.begin()) {
+        --use;
+        if (*use == keep) continue;
+        std::map<int,Entry>::iterator r = fRecords.find(*use);
+        fSize -= r->second.Data->GetSize();
+        delete r->second.Data;
+        fRecords.erase(r);
+        use = fUseOrder.erase(use);
+    }
+}
+
+const CP::TUBDAQEventCache::Record* CP::TUBDAQEventCache::Decode(int index) {
+    if (index < 0) return NULL;
+    if (0 <= fEnd && fEnd <= index) return NULL;
+    Record* record = new Record;
+    bool found = false;
+    try {
+        found = fSource.DecodeRecord(index, *record);
+    }
+    catch (...) {
+        delete record;
+        throw;
+    }
+    if (!found) {
+        delete record;
+        if (fEnd < 0 || index < fEnd) fEnd = index;
+        return NULL;
+    }
+    Entry& entry = fRecords[index];
+    entry.Data = record;
+    fUseOrder.push_front(index);
+    entry.Use = fUseOrder.begin();
+    fSize += record->GetSize();
+    Trim(index);
+    return record;
+}
+
+const CP::TUBDAQEventCache::Record* CP::TUBDAQEventCache::Acquire(int index) {
+    // The lock is held until the record is released.
+    if (fWorker) fWorker->Lock.lock();
+    fLastAhead = fNextAhead = index+1;
+    const Record* record = Find(index);
+    if (record) {
+        ++fHits;
+        return record;
+    }
+    ++fMisses;
+    try {
+        return Decode(index);
+    }
+    catch (...) {
+        Release();
+        throw;
+    }
+}
+
+void CP::TUBDAQEventCache::Release() {
+    fLastAhead = fNextAhead + fReadAhead;
+    if (!fWorker) return;
+    fWorker->Lock.unlock();
+    fWorker->Wake.notify_all();
+}
+
+void CP::TUBDAQEventCache::ReadAhead() {
+    CP::TRawInputTrace::SetThreadName("ubdaq read ahead");
+    std::unique_lock<std::mutex> lock(fWorker->Lock);
+    while (true) {
+        while (!fWorker->Stop && fNextAhead >= fLastAhead) {
+            fWorker->Wake.wait(lock);
+        }
+        if (fWorker->Stop) return;
+        int index = fNextAhead++;
+        if (fRecords.find(index) != fRecords.end()) continue;
+        try {
+            if (!Decode(index)) fLastAhead = fNextAhead;
+        }
+        catch (std::exception& e) {
+            CaptError("Cannot read ahead record " << index
+                      << ": " << e.what());
+            fLastAhead = fNextAhead;
+        }
+        catch (...) {
+            // Nothing can escape the thread, so stop reading ahead and let
+            // the reader find the error when it gets to this record.
+            CaptError("Cannot read ahead record " << index);
+            fLastAhead = fNextAhead;
+        }
+    }
+}
@@ -0,0 +1,154 @@
+#ifndef TUBDAQEventCache_hxx_seen
+#define TUBDAQEventCache_hxx_seen
+
+#include <TUBDAQSampleCache.hxx>
+
+#include <vector>
+#include <list>
+#include <map>
+#include <cstddef>
+
+namespace CP {
+    class TUBDAQEventCache;
+};
+
+/// A cache in memory of the most recently decoded ubdaq records so that an
+/// event display can move backward and forward through a file (see
+/// TUBDAQInput::ReadEvent() and TUBDAQInput::PreviousEvent()) without
+/// decoding each event again.  The records are kept in decoded form (the
+/// context, trigger data, and the samples of every channel), and the
+/// TEvent is made from them when it's asked for.  Making the event is a
+/// copy of the samples, while the decoding needs the inflation, unpacking
+/// and Huffman decoding of the record.
+///
+/// The cache is limited to a number of MB, and the least recently used
+/// records are dropped when it's full.  While the events are being looked
+/// at, the next few records after the last one that was asked for are
+/// decoded in a background thread so that stepping forward doesn't wait.
+/// The budget should be big enough to hold more than the records read
+/// ahead.
+///
+/// The records are decoded by a Source (TUBDAQInput).  The source is only
+/// used by one thread at a time, and an acquired record is held until it's
+/// released, so the source doesn't need to be thread safe.
+///
+/// \code
+/// const CP::TUBDAQEventCache::Record* record = cache.Acquire(index);
+/// if (record) event = MakeEvent(*record);
+/// cache.Release();
+/// \endcode
+class CP::TUBDAQEventCache {
+public:
+    /// A decoded record.  The channel offsets are from the start of the
+    /// samples.
+    struct Record {
+        CP::TUBDAQSampleCache::EventEntry Event;
+        std::vector<CP::TUBDAQSampleCache::ChannelEntry> Channels;
+        std::vector<char> Samples;
+
+        /// The memory used by the record.
+        std::size_t GetSize() const {
+            return sizeof(Record)
+                + Channels.size()*sizeof(CP::TUBDAQSampleCache::ChannelEntry)
+                + Samples.size();
+        }
+    };
+
+    /// The interface used to decode the records.
+    class Source {
+    public:
+        virtual ~Source() {}
+
+        /// Decode the record at index (counted from zero in the file).
+        /// This returns false if there isn't a record at the index.
+        virtual bool DecodeRecord(int index, Record& record) = 0;
+    };
+
+    /// Make a cache holding up to megabytes of records, and reading ahead
+    /// the given number of records.  A read ahead of zero doesn't start the
+    /// background thread.
+    TUBDAQEventCache(Source& source, double megabytes, int readAhead);
+    virtual ~TUBDAQEventCache();
+
+    /// Get the record at index, decoding it if it isn't in the cache.  This
+    /// returns NULL if there isn't a record at the index.  The cache is
+    /// locked until Release() is called, even if NULL is returned.
+    const Record* Acquire(int index);
+
+    /// Release the record from Acquire(), and start reading ahead from the
+    /// record after it.
+    void Release();
+
+    /// Get the number of records in the cache.
+    int GetRecordCount() const {return fRecords.size();}
+
+    /// Get the memory used by the records in the cache.
+    std::size_t GetSize() const {return fSize;}
+
+    /// Get the number of records that were found in the cache, and the
+    /// number that had to be decoded when they were acquired.
+    int GetHits() const {return fHits;}
+    int GetMisses() const {return fMisses;}
+
+private:
+    /// The thread and locks.  This is defined in the source so the thread
+    /// headers aren't seen by the dictionary.
+    class Worker;
+
+    /// Decode the record at index and add it to the cache.  This must be
+    /// called with the cache locked, and returns NULL if there isn't a
+    /// record.
+    const Record* Decode(int index);
+
+    /// Mark the record at index as the most recently used, and return it.
+    /// This returns NULL if the record isn't in the cache.
+    const Record* Find(int index);
+
+    /// Drop the least recently used records until the cache fits the
+    /// budget.  The record at keep isn't dropped.
+    void Trim(int keep);
+
+    /// Read the records ahead of the last one acquired.  This is run in the
+    /// background thread.
+    void ReadAhead();
+
+    /// A record in the cache, and its place in the use order.
+    struct Entry {
+        Record* Data;
+        std::list<int>::iterator Use;
+    };
+
+    /// The source of the records.
+    Source& fSource;
+
+    /// The most memory to use.
+    std::size_t fBudget;
+
+    /// The number of records to read ahead.
+    int fReadAhead;
+
+    /// The records in the cache by index.
+    std::map<int, Entry> fRecords;
+
+    /// The record indices with the most recently used first.
+    std::list<int> fUseOrder;
+
+    /// The memory used by the records.
+    std::size_t fSize;
+
+    /// The index of the first missing record, or -1 if the end of the file
+    /// hasn't been found.
+    int fEnd;
+
+    /// The next record to read ahead, and the first one that shouldn't be
+    /// read ahead.
+    int fNextAhead;
+    int fLastAhead;
+
+    int fHits;
+    int fMisses;
+
+    /// The thread reading ahead, or NULL.
+    Worker* fWorker;
+};
+#endif
@@ -0,0 +1,125 @@
+#include "TUBDAQFormat.hxx"
+
+#include "share/boonetypes.h"
+
+#include <cstring>
+#include <cstdlib>
+
+namespace {
+    /// The DAQ codes for the difference from the previous sample, indexed
+    /// by the difference plus three.  The code is the number of zeros
+    /// before a one.
+    const int deltaZeros[7] = {5, 3, 1, 0, 2, 4, 6};
+
+    void push32(CP::TUBDAQFormat::Words& words, uint32_t value) {
+        words.push_back(value & 0xFFFF);
+        words.push_back(value >> 16);
+    }
+
+    template <typename Vector>
+    void huffmanEncode(const Vector& samples, CP::TUBDAQFormat::Words& data,
+                       int mask) {
+        std::size_t i = 0;
+        int previous = 0;
+        while (i < samples.size()) {
+            int sample = samples[i] & mask;
+            int delta = sample - previous;
+            if (i == 0 || std::abs(delta) > 3) {
+                // The difference can't be coded, so save the sample.
+                data.push_back(sample);
+                previous = sample;
+                ++i;
+                continue;
+            }
+
+            // Pack as many codes as fit after the marker bit.  The first
+            // code is in the lowest bits, and the last one ends at bit 15,
+            // so the unused bits are left at the bottom.
+            int codes[15];
+            int count = 0;
+            int length = 0;
+            while (i < samples.size()) {
+                sample = samples[i] & mask;
+                delta = sample - previous;
+                if (std::abs(delta) > 3) break;
+                int zeros = deltaZeros[delta+3];
+                if (length + zeros + 1 > 15) break;
+                codes[count++] = zeros;
+                length += zeros + 1;
+                previous = sample;
+                ++i;
+            }
+            int bit = 15 - length;
+            uint16_t word = 1 << bit;
+            for (int c = 0; c < count; ++c) {
+                bit += codes[c] + 1;
+                word |= 1 << bit;
+            }
+            data.push_back(word);
+        }
+    }
+
+    /// Add a card to a crate.  The word count and the checksum (the 24 bit
+    /// sum of the payload words) are filled from the payload.
+    template <typename Header>
+    void addCard(CP::TUBDAQFormat::Words& crate, Header header,
+                 const CP::TUBDAQFormat::Words& payload) {
+        uint32_t checksum = 0;
+        for (CP::TUBDAQFormat::Words::const_iterator w = payload.begin();
+             w != payload.end(); ++w) {
+            checksum += *w;
+        }
+        header.word_count = CP::TUBDAQFormat::Encode24(payload.size()-1);
+        header.checksum = CP::TUBDAQFormat::Encode24(checksum & 0xFFFFFF);
+        const uint16_t* words = reinterpret_cast<const uint16_t*>(&header);
+        crate.insert(crate.end(), words,
+                     words + sizeof(header)/sizeof(uint16_t));
+        crate.insert(crate.end(), payload.begin(), payload.end());
+    }
+
+    /// Make an empty card header for a module.
+    template <typename Header>
+    Header makeHeader(int module) {
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        header.id_and_module = module << 16;
+        return header;
+    }
+}
+
+void CP::TUBDAQFormat::HuffmanEncode(const Words& samples, Words& data,
+                                     int mask) {
+    huffmanEncode(samples, data, mask);
+}
+
+void CP::TUBDAQFormat::HuffmanEncode(const std::vector<int>& samples,
+                                     Words& data, int mask) {
+    huffmanEncode(samples, data, mask);
+}
+
+uint32_t CP::TUBDAQFormat::Encode24(uint32_t value) {
+    return ((value & 0xFFF) << 16) | ((value >> 12) & 0xFFF);
+}
+
+void CP::TUBDAQFormat::BeginCrate(Words& crate) {
+    push32(crate, 0xFFFFFFFF);
+}
+
+void CP::TUBDAQFormat::AddTPCCard(Words& crate, int module,
+                                  const Words& payload) {
+    addCard(crate, makeHeader<card_header_t>(module), payload);
+}
+
+void CP::TUBDAQFormat::AddTPCCard(Words& crate, const card_header& header,
+                                  const Words& payload) {
+    addCard(crate, header, payload);
+}
+
+void CP::TUBDAQFormat::AddPMTCard(Words& crate, int module,
+                                  const Words& payload) {
+    addCard(crate, makeHeader<pmt_card_header_t>(module), payload);
+}
+
+void CP::TUBDAQFormat::EndCrate(Words& crate) {
+    push32(crate, 0xE0000000);
+}
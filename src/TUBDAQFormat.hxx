@@ -0,0 +1,65 @@
+#ifndef TUBDAQFormat_hxx_seen
+#define TUBDAQFormat_hxx_seen
+
+#include <vector>
+#include <stdint.h>
+
+struct card_header;
+
+namespace CP {
+    class TUBDAQFormat;
+};
+
+/// The word layout of the ubdaq crates for the code that writes them
+/// (TUBDAQWriter, TUBDAQGenerator and TCompactPulseDigit).  A crate payload
+/// is a start word, then a card header and the card words for each card,
+/// and then an end word.  The card headers save the 24 bit counts as two
+/// 12 bit halves, and the samples are Huffman encoded the way the DAQ does
+/// it (see channelData::decompress() for the decoder).
+///
+/// \code
+/// CP::TUBDAQFormat::Words crate;
+/// CP::TUBDAQFormat::BeginCrate(crate);
+/// CP::TUBDAQFormat::AddTPCCard(crate, module, payload);
+/// CP::TUBDAQFormat::EndCrate(crate);
+/// \endcode
+class CP::TUBDAQFormat {
+public:
+    typedef std::vector<uint16_t> Words;
+
+    /// The bits of a sample that the DAQ keeps in an explicit word.
+    static const int kSampleMask = 0x7FF;
+
+    /// Encode the samples the way the DAQ does.  The explicit words keep
+    /// the bits in mask, and the difference to the next sample is saved as
+    /// a variable length code when it's no more than three counts.  The
+    /// words are added to the end of data.
+    static void HuffmanEncode(const Words& samples, Words& data,
+                              int mask = kSampleMask);
+    static void HuffmanEncode(const std::vector<int>& samples, Words& data,
+                              int mask = kSampleMask);
+
+    /// Encode a 24 bit value into the two 12 bit halves used by the card
+    /// headers.
+    static uint32_t Encode24(uint32_t value);
+
+    /// Start a crate.
+    static void BeginCrate(Words& crate);
+
+    /// Add a card header and the card payload to a crate.  The header only
+    /// has the module number, the word count and the checksum.
+    static void AddTPCCard(Words& crate, int module, const Words& payload);
+
+    /// Add a card to a crate with a copy of a card header read from the
+    /// DAQ.  The header keeps the event and frame numbers, but gets the
+    /// word count and checksum of the new payload.
+    static void AddTPCCard(Words& crate, const card_header& header,
+                           const Words& payload);
+
+    /// Add a PMT card header and the card payload to a crate.
+    static void AddPMTCard(Words& crate, int module, const Words& payload);
+
+    /// Finish a crate.
+    static void EndCrate(Words& crate);
+};
+#endif
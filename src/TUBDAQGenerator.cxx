@@ -0,0 +1,202 @@
+#include "TUBDAQGenerator.hxx"
+#include "TUBDAQFormat.hxx"
+
+#include "datatypes/eventRecord.h"
+#include "datatypes/crateData.h"
+#include "datatypes/crateDataPMT.h"
+
+#include <TCaptLog.hxx>
+
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+
+#include <fstream>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+
+namespace {
+    namespace dt = gov::fnal::uboone::datatypes;
+
+    /// The unix time of midnight Jan 1, 2012 UTC which is the zero of the
+    /// global header clock.
+    const double kHeaderEpoch = 1325376000.0;
+
+    std::shared_ptr<char> makeBuffer(const CP::TUBDAQGenerator::Words& words) {
+        std::shared_ptr<char> buffer(new char[2*words.size()],
+                                     std::default_delete<char[]>());
+        std::memcpy(buffer.get(), &words[0], 2*words.size());
+        return buffer;
+    }
+
+    bool endsWith(const std::string& name, const std::string& suffix) {
+        if (name.size() < suffix.size()) return false;
+        return name.compare(name.size()-suffix.size(),
+                            suffix.size(), suffix) == 0;
+    }
+}
+
+CP::TUBDAQGenerator::TUBDAQGenerator(int seed)
+    : fRandom(seed), fTPCCrates(1), fTPCCards(16), fTPCChannels(64),
+      fTPCSamples(9595), fHuffmanFraction(1.0), fNoise(2.0),
+      fPMTCards(0), fPMTWindows(10), fPMTLength(40),
+      fRun(1), fSubRun(0), fStartTime(kHeaderEpoch), fPeriod(1.0) {}
+
+CP::TUBDAQGenerator::~TUBDAQGenerator() {}
+
+void CP::TUBDAQGenerator::SetTPC(int crates, int cards,
+                                 int channels, int samples) {
+    fTPCCrates = crates;
+    fTPCCards = cards;
+    fTPCChannels = channels;
+    fTPCSamples = samples;
+}
+
+void CP::TUBDAQGenerator::SetPMT(int cards, int windows, int length) {
+    fPMTCards = cards;
+    fPMTWindows = windows;
+    fPMTLength = length;
+}
+
+void CP::TUBDAQGenerator::MakeSamples(int channel, Words& samples) {
+    double pedestal = 400 + 10*channel + fRandom.Uniform()*100;
+    for (int s = 0; s < fTPCSamples; ++s) {
+        int value = pedestal + fRandom.Gaus(0.0, fNoise) + 0.5;
+        value = std::max(0, std::min(0x7FF, value));
+        samples.push_back(value);
+    }
+}
+
+void CP::TUBDAQGenerator::EncodeSamples(const Words& samples, Words& data) {
+    if (fRandom.Uniform() < fHuffmanFraction) {
+        CP::TUBDAQFormat::HuffmanEncode(samples, data);
+        return;
+    }
+    data.insert(data.end(), samples.begin(), samples.end());
+}
+
+void CP::TUBDAQGenerator::MakeTPCCard(Words& payload,
+                                      std::vector<Words>* samples) {
+    Words channelSamples;
+    for (int channel = 0; channel < fTPCChannels; ++channel) {
+        channelSamples.clear();
+        MakeSamples(channel, channelSamples);
+        payload.push_back(0x4000 | channel);
+        EncodeSamples(channelSamples, payload);
+        payload.push_back(0x5000 | channel);
+        if (samples) samples->push_back(channelSamples);
+    }
+}
+
+void CP::TUBDAQGenerator::MakePMTCard(Words& payload) {
+    payload.push_back(0x4000);
+    for (int channel = 0; channel < kPMTChannels; ++channel) {
+        for (int w = 0; w < fPMTWindows; ++w) {
+            uint32_t frame = w % 8;
+            uint32_t sample = 1000*w + channel;
+            payload.push_back(0x1000 | channel);
+            payload.push_back(((frame & 0x7) << 5)
+                              | ((sample >> 12) & 0x1F));
+            payload.push_back(sample & 0xFFF);
+            for (int s = 0; s < fPMTLength; ++s) {
+                int value = 2048 + fRandom.Gaus(0.0, fNoise) + 0.5;
+                value = std::max(0, std::min(0xFFF, value));
+                // The last sample flags the end of the window.
+                if (s == fPMTLength-1) value |= 0x3000;
+                payload.push_back(value);
+            }
+        }
+    }
+    payload.push_back(0xC000);
+}
+
+void CP::TUBDAQGenerator::MakeTPCCrate(Words& crate) {
+    CP::TUBDAQFormat::BeginCrate(crate);
+    Words payload;
+    for (int card = 0; card < fTPCCards; ++card) {
+        payload.clear();
+        MakeTPCCard(payload);
+        CP::TUBDAQFormat::AddTPCCard(crate, card + 4, payload);
+    }
+    CP::TUBDAQFormat::EndCrate(crate);
+}
+
+void CP::TUBDAQGenerator::MakePMTCrate(Words& crate) {
+    CP::TUBDAQFormat::BeginCrate(crate);
+    Words payload;
+    for (int card = 0; card < fPMTCards; ++card) {
+        payload.clear();
+        MakePMTCard(payload);
+        CP::TUBDAQFormat::AddPMTCard(crate, card + 4, payload);
+    }
+    CP::TUBDAQFormat::EndCrate(crate);
+}
+
+bool CP::TUBDAQGenerator::Write(const std::string& fileName, int events) {
+    std::ofstream file(fileName.c_str(), std::ios::binary);
+    if (!file.is_open()) {
+        CaptError("Cannot write " << fileName);
+        return false;
+    }
+    boost::iostreams::filtering_ostream output;
+    if (endsWith(fileName, ".gz")) {
+        output.push(boost::iostreams::gzip_compressor());
+    }
+    output.push(file);
+
+    Words words;
+    for (int event = 0; event < events; ++event) {
+        dt::eventRecord record;
+        dt::globalHeader* header = record.getGlobalHeaderPtr();
+        header->setRunNumber(fRun);
+        header->setSubrunNumber(fSubRun);
+        header->setEventNumber(event);
+        double time = fStartTime + event*fPeriod - kHeaderEpoch;
+        uint32_t seconds = std::floor(time);
+        uint32_t nanoseconds = 1E9*(time - seconds);
+        header->setSeconds(seconds);
+        header->setMilliSeconds(nanoseconds/1000000);
+        header->setMicroSeconds((nanoseconds/1000) % 1000);
+        header->setNanoSeconds(nanoseconds % 1000);
+
+        for (int crateNumber = 1; crateNumber <= fTPCCrates; ++crateNumber) {
+            words.clear();
+            MakeTPCCrate(words);
+            dt::crateHeader crateHeader;
+            crateHeader.setCrateNumber(crateNumber);
+            crateHeader.setCardCount(fTPCCards);
+            crateHeader.setCrateSize(2*words.size());
+            crateHeader.setCrateEventNumber(event);
+            record.insertSEB(crateHeader,
+                             dt::crateData(makeBuffer(words),
+                                           2*words.size()));
+        }
+
+        if (fPMTCards > 0) {
+            words.clear();
+            MakePMTCrate(words);
+            dt::crateHeader crateHeader;
+            crateHeader.setCrateNumber(fTPCCrates+1);
+            crateHeader.setCardCount(fPMTCards);
+            crateHeader.setCrateSize(2*words.size());
+            crateHeader.setCrateEventNumber(event);
+            record.insertSEB(crateHeader,
+                             dt::crateDataPMT(makeBuffer(words),
+                                              2*words.size()));
+        }
+
+        // Each record is a separate archive the way the DAQ writes them.
+        boost::archive::binary_oarchive archive(output);
+        archive << record;
+    }
+
+    output.reset();
+    if (!file.good()) {
+        CaptError("Error writing " << fileName);
+        return false;
+    }
+    return true;
+}
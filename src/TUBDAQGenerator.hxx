@@ -0,0 +1,108 @@
+#ifndef TUBDAQGenerator_hxx_seen
+#define TUBDAQGenerator_hxx_seen
+
+#include <TRandom3.h>
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace CP {
+    class TUBDAQGenerator;
+};
+
+/// Make synthetic ubdaq files so that the conversion can be benchmarked
+/// and checked without DAQ data.  Each event record has the TPC crates,
+/// and optionally a PMT crate, filled with the same word layout the DAQ
+/// writes.  The TPC samples are a pedestal with gaussian noise, and a
+/// fraction of the channels are Huffman encoded the way the DAQ does it
+/// (the rest are saved as explicit words).  The PMT crate has cards with
+/// 40 channels that each have several readout windows.
+///
+/// \code
+/// CP::TUBDAQGenerator generator;
+/// generator.SetTPC(1,16,64,9595);
+/// generator.Write("synthetic.ubdaq",100);
+/// \endcode
+///
+/// The payloads can also be made directly (e.g. to time the unpackers).
+/// The same seed always makes the same file.
+class CP::TUBDAQGenerator {
+public:
+    typedef std::vector<uint16_t> Words;
+
+    explicit TUBDAQGenerator(int seed = 1);
+    virtual ~TUBDAQGenerator();
+
+    /// Set the number of TPC crates, the cards in each crate, the channels
+    /// on each card, and the samples in each channel.
+    void SetTPC(int crates, int cards, int channels, int samples);
+
+    /// Set the fraction of the TPC channels that are Huffman encoded.
+    void SetHuffmanFraction(double fraction) {fHuffmanFraction = fraction;}
+
+    /// Set the RMS of the noise in ADC counts.
+    void SetNoise(double rms) {fNoise = rms;}
+
+    /// Set the number of PMT cards, the readout windows for each channel,
+    /// and the samples in each window.  There is no PMT crate when the
+    /// number of cards is zero (the default).
+    void SetPMT(int cards, int windows, int length);
+
+    /// Set the run and sub-run numbers of the events.
+    void SetRun(int run, int subRun) {fRun = run; fSubRun = subRun;}
+
+    /// Set the unix time of the first event, and the time between events
+    /// (both in seconds).
+    void SetTime(double start, double period) {
+        fStartTime = start;
+        fPeriod = period;
+    }
+
+    /// Write a file with the given number of events.  The file is gzip
+    /// compressed if the name ends in ".gz".  This returns false if the
+    /// file can't be written.
+    bool Write(const std::string& fileName, int events);
+
+    /// Make the samples for a TPC channel.
+    void MakeSamples(int channel, Words& samples);
+
+    /// Make the data words for the samples of a TPC channel.  The samples
+    /// are Huffman encoded for the requested fraction of the channels.
+    void EncodeSamples(const Words& samples, Words& data);
+
+    /// Make the payload of a TPC card.  The samples of each channel are
+    /// added to samples when it's not NULL.
+    void MakeTPCCard(Words& payload, std::vector<Words>* samples = NULL);
+
+    /// Make the payload of a PMT card.
+    void MakePMTCard(Words& payload);
+
+    /// Make a TPC crate.
+    void MakeTPCCrate(Words& crate);
+
+    /// Make a PMT crate.
+    void MakePMTCrate(Words& crate);
+
+    /// The number of channels on a PMT card.
+    static const int kPMTChannels = 40;
+
+private:
+    /// The random number generator.
+    TRandom3 fRandom;
+
+    int fTPCCrates;
+    int fTPCCards;
+    int fTPCChannels;
+    int fTPCSamples;
+    double fHuffmanFraction;
+    double fNoise;
+    int fPMTCards;
+    int fPMTWindows;
+    int fPMTLength;
+    int fRun;
+    int fSubRun;
+    double fStartTime;
+    double fPeriod;
+};
+#endif
@@ -1,4 +1,15 @@
 #include "TUBDAQInput.hxx"
+#include "TRunEventSet.hxx"
+#include "TCountingStreamBuf.hxx"
+#include "TCatalogInput.hxx"
+#include "TFollowStreamBuf.hxx"
+#include "TRawStreamBuf.hxx"
+#include "TUBDAQCaboose.hxx"
+#include "TCompactPulseDigit.hxx"
+#include "TPulseRegionFinder.hxx"
+#include "TChannelSummary.hxx"
+#include "TUBDAQSampleCache.hxx"
+#include "TWaveformMatrix.hxx"
 
 #include "datatypes/eventRecord.h"
 
@@ -8,11 +19,13 @@
 
 #include "TEvent.hxx"
 #include "TCaptLog.hxx"
+#include "TIntegerDatum.hxx"
 #include "TEventContext.hxx"
 #include "TManager.hxx"
 #include "TPulseDigit.hxx"
 #include "TInputManager.hxx"
 #include "TTPCChannelId.hxx"
+#include "TPDSChannelId.hxx"
 
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/serialization/map.hpp>
@@ -21,10 +34,6 @@
 #include <boost/serialization/version.hpp>
 #include <boost/serialization/split_member.hpp>
 
-#include <boost/iostreams/filtering_streambuf.hpp>
-#include <boost/iostreams/filter/zlib.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
-
 #include <stdint.h>
 #include <iostream>
 #include <fstream>
@@ -34,6 +43,10 @@
 #include <cstdlib>
 #include <cstring>
 #include <sstream>
+#include <map>
+#include <algorithm>
+
+#include <sys/stat.h>
 
 namespace {
     class TUBDAQInputBuilder : public CP::TVInputBuilder {
@@ -41,50 +54,99 @@ namespace {
         TUBDAQInputBuilder() 
             : CP::TVInputBuilder("ubdaq",
                                  "Read a uboone DAQ file"
-                                 " [ubdaq(temp[=n]) to not save digits]" ) {}
+                                 " [ubdaq(temp[=n]) to not save digits]"
+                                 " [ubdaq(follow[=idle]) for a growing file]"
+                                 " [ubdaq(crates=a-b,cards=c-d,channels=e-f,"
+                                 "mask=file)]"
+                                 " [ubdaq(trigger=ext|calib|...)]"
+                                 " [ubdaq(compact[=packed])]"
+                                 " [ubdaq(matrix[=only])]"
+                                 " [ubdaq(roi[=sigma],roipad=n)]"
+                                 " [ubdaq(cache[=dir],cachemax=MB) to keep"
+                                 " the samples on disk (2 bytes/sample,"
+                                 " 8 GB limit)]"
+                                 " [ubdaq(lru[=MB],ahead=n)]"
+                                 " [catalog:<file>:run=r,event=e]") {}
         CP::TVInputFile* Open(const char* file) const {
-            std::string args = GetArguments();
-            if (args.find("(") != std::string::npos) {
-                CaptLog("UBDAQ builder argument: " << args);
-                std::string argument = args.substr(
-                    args.find_first_of('(')+1);
-                int first=-1;
-                int last = -1;
-                std::istringstream parse(argument);
-                parse >> first;
-                if (parse.good()) {
-                    char sep;
-                    do {
-                        parse >> sep;
-                    } while (sep != ',' && parse.good());
-                    parse >> last;
-                }
-                else {
-                    first = last = -1;
+            int first = -1;
+            int last = -1;
+            int scaling = -1;
+            CP::TUBDAQInput::ParseBuilderArguments(GetArguments(),
+                                                   first, last, scaling);
+            // Events selected from a raw catalog.
+            if (CP::TCatalogInput::IsCatalogName(file)) {
+                CP::TUBDAQChannelSelection selection;
+                if (!selection.Parse(GetArguments())) {
+                    CaptError("Invalid channel selection for " << file
+                              << ": " << GetArguments());
+                    throw CP::EUBDAQChannelSelection();
                 }
-                if (first > 0) {
-                    CaptLog("UBDAQ builder argument: " << args 
-                            << " --> " << first
-                            << " to " << last << " sample will be calibrated");
+                CP::TCatalogInput* input
+                    = new CP::TCatalogInput(file,first,last,scaling);
+                input->SetChannelSelection(selection);
+                input->SetTriggerSelection(
+                    CP::TUBDAQInput::ParseTriggerSelection(GetArguments()));
+                input->SetCompactDigits(
+                    CP::TUBDAQInput::ParseCompactDigits(GetArguments()));
+                input->SetWaveformMatrix(
+                    CP::TUBDAQInput::ParseWaveformMatrix(GetArguments()));
+                double threshold = 0;
+                int padding = 0;
+                if (CP::TUBDAQInput::ParseRegionArguments(
+                        GetArguments(), threshold, padding)) {
+                    input->SetRegionsOfInterest(threshold,padding);
                 }
-                if (args.find("temp") != std::string::npos) {
-                    int scaling = 200;
-                    std::size_t pos = args.find("temp=");
-                    if (pos != std::string::npos) {
-                        std::string tempArg = args.substr(pos+5);
-                        std::istringstream parseTemp(tempArg);
-                        parseTemp >> scaling;
-                    }
-                    CaptLog("UBDAQ builder argument: " << args
-                            << " --> Digits scaled in output file by "
-                            << scaling);
-                    return new CP::TUBDAQInput(file,first,last,scaling);
-                }
-                else {
-                    return new CP::TUBDAQInput(file,first,last,-1);
+                return input;
+            }
+            // Follow a file that's being written.
+            std::string args = GetArguments();
+            int follow = 0;
+            std::string followArg;
+            if (CP::TVRawInput::FindBuilderOption(args, "follow",
+                                                  followArg)) {
+                follow = -1;
+                if (!followArg.empty()) {
+                    std::istringstream parseFollow(followArg);
+                    parseFollow >> follow;
                 }
+                CaptLog("UBDAQ builder argument: " << args
+                        << " --> Follow the file"
+                        << " (idle timeout " << follow << ")");
+            }
+            CP::TUBDAQChannelSelection selection;
+            if (!selection.Parse(args)) {
+                CaptError("Invalid channel selection for " << file
+                          << ": " << args);
+                throw CP::EUBDAQChannelSelection();
+            }
+            CP::TUBDAQInput* input
+                = new CP::TUBDAQInput(file,first,last,scaling,follow);
+            input->SetChannelSelection(selection);
+            input->SetTriggerSelection(
+                CP::TUBDAQInput::ParseTriggerSelection(args));
+            input->SetCompactDigits(
+                CP::TUBDAQInput::ParseCompactDigits(args));
+            input->SetWaveformMatrix(
+                CP::TUBDAQInput::ParseWaveformMatrix(args));
+            double threshold = 0;
+            int padding = 0;
+            if (CP::TUBDAQInput::ParseRegionArguments(args,
+                                                      threshold, padding)) {
+                input->SetRegionsOfInterest(threshold,padding);
             }
-            return new CP::TUBDAQInput(file);
+            std::string cache;
+            double cacheLimit = 0;
+            if (CP::TUBDAQInput::ParseCacheArguments(args, cache,
+                                                     cacheLimit)) {
+                input->SetSampleCache(cache, cacheLimit);
+            }
+            double megabytes = 0;
+            int readAhead = 0;
+            if (CP::TUBDAQInput::ParseEventCacheArguments(args, megabytes,
+                                                          readAhead)) {
+                input->SetEventCache(megabytes, readAhead);
+            }
+            return input;
         }
     };
 
@@ -131,24 +193,405 @@ namespace {
     }
 }
 
-CP::TUBDAQInput::TUBDAQInput(const char* name, int first, int last, int scale) 
-    : fFilename(name), fFirstSample(first), fLastSample(last),
-      fScaledDigitSave(scale) {
+namespace {
+    /// The leading part of an eventRecord (everything before the SEB maps).
+    /// This has the same serialized layout as the front of
+    /// eventRecord::serialize, so it's loaded from the archive in place of
+    /// the full record and leaves the archive positioned at the crate data.
+    class eventRecordHead {
+    public:
+        explicit eventRecordHead(
+            gov::fnal::uboone::datatypes::eventRecord& record)
+            : fRecord(record), fVersion(0) {}
+
+        unsigned int GetVersion() const {return fVersion;}
+
+    private:
+        gov::fnal::uboone::datatypes::eventRecord& fRecord;
+        unsigned int fVersion;
+
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version) {
+            fVersion = version;
+            uint8_t ioMode;
+            gov::fnal::uboone::datatypes::globalHeader globalHeader;
+            if (version>1) {
+                gov::fnal::uboone::datatypes::triggerData triggerData;
+                gov::fnal::uboone::datatypes::gps gpsData;
+                gov::fnal::uboone::datatypes::beamHeader beamHeader;
+                std::vector<gov::fnal::uboone::datatypes::beamData> beamData;
+                ar & ioMode
+                    & globalHeader
+                    & triggerData
+                    & gpsData
+                    & beamHeader & beamData;
+                fRecord.setTriggerData(triggerData);
+                fRecord.setGPS(gpsData);
+                fRecord.setBeamHeader(beamHeader);
+                for (std::size_t i = 0; i<beamData.size(); ++i) {
+                    fRecord.insertBeamData(beamData[i]);
+                }
+            }
+            else if (version>0) {
+                ar & ioMode & globalHeader;
+            }
+            fRecord.setGlobalHeader(globalHeader);
+        }
+    };
+
+    /// Read the crate data (crateData or crateDataPMT) for one SEB.  This
+    /// has the same serialized layout as the crate data class.  When the
+    /// crate is being skipped, the payload is passed over using the size
+    /// in the record without being allocated or copied.
+    template <class CrateData>
+    class crateReader {
+    public:
+        explicit crateReader(bool skip) : fSkip(skip) {}
+
+        CrateData& GetData() {return fData;}
+
+        void SetSkip(bool skip) {fSkip = skip;}
+        bool GetSkip() const {return fSkip;}
 
-    if (fFilename.rfind(".gz") != std::string::npos) {
-        std::ifstream *compressed
-            = new std::ifstream(fFilename.c_str(),
-                                std::ios::in | std::ios::binary);
-        boost::iostreams::filtering_istreambuf *input 
-            = new boost::iostreams::filtering_istreambuf();
-        input->push(boost::iostreams::gzip_decompressor());
-        input->push(*compressed);
-        fFile = new std::istream(input);
+    private:
+        CrateData fData;
+        bool fSkip;
+
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version) {
+            if (!fSkip) {
+                boost::serialization::access::member_load(ar,fData,version);
+                return;
+            }
+            if (version<1) return;
+            size_t dataSize;
+            uint8_t ioMode;
+            ar & dataSize;
+            ar & ioMode;
+            if (ioMode == gov::fnal::uboone::datatypes::IO_GRANULARITY_CRATE) {
+                // The archive can't seek, so drain the payload through a
+                // small buffer.
+                char buffer[16384];
+                while (dataSize > 0) {
+                    std::size_t chunk = std::min(dataSize,sizeof(buffer));
+                    ar.load_binary(buffer,chunk);
+                    dataSize -= chunk;
+                }
+            }
+            else {
+                // The DAQ writes the crate granularity, so a record already
+                // unpacked into cards is rare.  Read it and throw it away.
+                gov::fnal::uboone::datatypes::eventHeader header;
+                typename CrateData::cardMap_t cards;
+                gov::fnal::uboone::datatypes::eventTrailer trailer;
+                ar & header;
+                ar & cards;
+                ar & trailer;
+            }
+        }
+    };
+
+    /// One entry in a SEB map.  This has the same serialized layout as the
+    /// std::pair<crateHeader,CrateData> in the map.  A crate that isn't in
+    /// the channel selection is skipped once its header has been read.
+    template <class CrateData>
+    class sebEntry {
+    public:
+        sebEntry(bool skip, const CP::TUBDAQChannelSelection& selection)
+            : fData(skip), fSelection(selection) {}
+
+        gov::fnal::uboone::datatypes::crateHeader& GetHeader() {
+            return fHeader;
+        }
+        CrateData& GetData() {return fData.GetData();}
+        bool IsSkipped() const {return fData.GetSkip();}
+
+    private:
+        gov::fnal::uboone::datatypes::crateHeader fHeader;
+        crateReader<CrateData> fData;
+        const CP::TUBDAQChannelSelection& fSelection;
+
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version) {
+            ar & fHeader;
+            if (!fSelection.IsEmpty()
+                && !fSelection.CrateSelected(fHeader.getCrateNumber())) {
+                fData.SetSkip(true);
+            }
+            ar & fData;
+        }
+    };
+
+    /// Read one of the SEB maps in an eventRecord.  This has the same
+    /// serialized layout as the std::map (the boost map serialization
+    /// writes a count, an item version, and then the items).  The crates
+    /// are added to the record unless they are being skipped, and are told
+    /// which cards are selected.
+    template <class CrateData>
+    class sebMapReader {
+    public:
+        sebMapReader(gov::fnal::uboone::datatypes::eventRecord& record,
+                     bool skip,
+                     const CP::TUBDAQChannelSelection& selection)
+            : fRecord(record), fSkip(skip), fSelection(selection) {}
+
+    private:
+        gov::fnal::uboone::datatypes::eventRecord& fRecord;
+        bool fSkip;
+        const CP::TUBDAQChannelSelection& fSelection;
+
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version) {
+            const boost::serialization::library_version_type
+                libraryVersion(ar.get_library_version());
+            boost::serialization::item_version_type itemVersion(0);
+            boost::serialization::collection_size_type count;
+            ar >> BOOST_SERIALIZATION_NVP(count);
+            if (boost::serialization::library_version_type(3)
+                < libraryVersion) {
+                ar >> BOOST_SERIALIZATION_NVP(itemVersion);
+            }
+            while (count-- > 0) {
+                sebEntry<CrateData> entry(fSkip,fSelection);
+                ar >> boost::serialization::make_nvp("item", entry);
+                if (entry.IsSkipped()) continue;
+                if (!fSelection.IsEmpty()) {
+                    entry.GetData().setCardSelection(
+                        fSelection.GetCardMask(
+                            entry.GetHeader().getCrateNumber()));
+                }
+                fRecord.insertSEB(entry.GetHeader(),entry.GetData());
+            }
+        }
+    };
+}
+
+void CP::TUBDAQInput::ParseBuilderArguments(const std::string& args,
+                                            int& first, int& last,
+                                            int& scaling) {
+    first = -1;
+    last = -1;
+    scaling = -1;
+    if (args.find("(") == std::string::npos) return;
+    CaptLog("UBDAQ builder argument: " << args);
+    std::string argument = args.substr(args.find_first_of('(')+1);
+    std::istringstream parse(argument);
+    parse >> first;
+    if (parse.good()) {
+        char sep;
+        do {
+            parse >> sep;
+        } while (sep != ',' && parse.good());
+        parse >> last;
     }
     else {
-        fFile = new std::ifstream(fFilename.c_str(),
-                                  std::ios::in | std::ios::binary);
+        first = last = -1;
+    }
+    if (first > 0) {
+        CaptLog("UBDAQ builder argument: " << args 
+                << " --> " << first
+                << " to " << last << " sample will be calibrated");
+    }
+    std::string tempArg;
+    if (FindBuilderOption(args, "temp", tempArg)) {
+        scaling = 200;
+        if (!tempArg.empty()) {
+            std::istringstream parseTemp(tempArg);
+            parseTemp >> scaling;
+        }
+        CaptLog("UBDAQ builder argument: " << args
+                << " --> Digits scaled in output file by "
+                << scaling);
+    }
+}
+
+namespace {
+    /// The names of the trigger types in the trigger bits.  These follow
+    /// the triggerData::is*Trigger() methods.
+    struct TriggerName {
+        const char* Name;
+        int Bits;
+    };
+    const TriggerName triggerNames[] = {
+        {"pmt",    0x00FF},
+        {"ext",    0x0100},
+        {"active", 0x0200},
+        {"bnb",    0x0400},
+        {"numi",   0x0800},
+        {"veto",   0x1000},
+        {"calib",  0x2000},
+        {NULL,     0}
+    };
+}
+
+int CP::TUBDAQInput::ParseTriggerSelection(const std::string& args) {
+    std::string value;
+    if (!FindBuilderOption(args, "trigger", value) || value.empty()) {
+        return 0;
+    }
+
+    int mask = 0;
+    std::istringstream types(value);
+    std::string type;
+    while (std::getline(types,type,'|')) {
+        int bits = 0;
+        for (const TriggerName* t = triggerNames; t->Name; ++t) {
+            if (type == t->Name) bits = t->Bits;
+        }
+        if (bits == 0) {
+            // Allow the bits to be given directly (e.g. trigger=0x2000).
+            char* end = NULL;
+            bits = std::strtol(type.c_str(),&end,0);
+            if (end == type.c_str() || *end != 0) bits = 0;
+        }
+        if (bits == 0) {
+            CaptError("Invalid ubdaq trigger type: " << type);
+            continue;
+        }
+        mask |= bits;
     }
+    if (mask != 0) {
+        CaptLog("UBDAQ builder argument: trigger=" << value
+                << " --> Convert trigger bits 0x"
+                << std::hex << mask << std::dec);
+    }
+    return mask;
+}
+
+int CP::TUBDAQInput::ParseCompactDigits(const std::string& args) {
+    std::string value;
+    if (!FindBuilderOption(args, "compact", value)) return 0;
+    int encoding = CP::TCompactPulseDigit::kHuffman;
+    if (value == "packed") {
+        encoding = CP::TCompactPulseDigit::kPacked;
+    }
+    else if (!value.empty() && value != "huffman") {
+        CaptError("Invalid compact digit encoding: " << value);
+    }
+    CaptLog("UBDAQ builder argument: " << args
+            << " --> Save compact TPC digits ("
+            << (encoding == CP::TCompactPulseDigit::kPacked
+                ? "packed" : "huffman") << ")");
+    return encoding;
+}
+
+int CP::TUBDAQInput::ParseWaveformMatrix(const std::string& args) {
+    std::string value;
+    if (!FindBuilderOption(args, "matrix", value)) return kDigitsOnly;
+    int mode = kMatrixAndDigits;
+    if (value == "only") mode = kMatrixOnly;
+    else if (!value.empty()) {
+        CaptError("Invalid waveform matrix mode: " << value);
+    }
+    CaptLog("UBDAQ builder argument: " << args
+            << " --> Save a TPC waveform matrix"
+            << (mode == kMatrixOnly ? " without digits" : ""));
+    return mode;
+}
+
+bool CP::TUBDAQInput::ParseRegionArguments(const std::string& args,
+                                           double& threshold,
+                                           int& padding) {
+    threshold = 0;
+    padding = 10;
+    std::string value;
+    if (!FindBuilderOption(args, "roi", value)) return false;
+    threshold = value.empty() ? 5.0 : std::atof(value.c_str());
+    if (FindBuilderOption(args, "roipad", value)) {
+        padding = std::atoi(value.c_str());
+    }
+    if (threshold <= 0) return false;
+    CaptLog("UBDAQ builder argument: " << args
+            << " --> Keep regions over " << threshold
+            << " sigma with " << padding << " samples of padding");
+    return true;
+}
+
+bool CP::TUBDAQInput::ParseCacheArguments(const std::string& args,
+                                          std::string& directory,
+                                          double& megabytes) {
+    directory = "";
+    megabytes = 8192;
+    if (!FindBuilderOption(args, "cache", directory)) return false;
+    if (directory.empty()) {
+        const char* env = std::getenv("CAPTTRANS_CACHE");
+        directory = (env && *env) ? env : "capttrans-cache";
+    }
+    std::string value;
+    if (FindBuilderOption(args, "cachemax", value)) {
+        megabytes = std::atof(value.c_str());
+    }
+    CaptLog("UBDAQ builder argument: " << args
+            << " --> Cache the decoded samples in " << directory
+            << " (up to " << megabytes << " MB)");
+    return true;
+}
+
+bool CP::TUBDAQInput::ParseEventCacheArguments(const std::string& args,
+                                               double& megabytes,
+                                               int& readAhead) {
+    megabytes = 256;
+    readAhead = 4;
+    std::string value;
+    if (!FindBuilderOption(args, "lru", value)) return false;
+    if (!value.empty()) megabytes = std::atof(value.c_str());
+    if (FindBuilderOption(args, "ahead", value)) {
+        readAhead = std::atoi(value.c_str());
+    }
+    if (megabytes <= 0) return false;
+    CaptLog("UBDAQ builder argument: " << args
+            << " --> Keep " << megabytes << " MB of decoded events"
+            << " and read " << readAhead << " ahead");
+    return true;
+}
+
+void CP::TUBDAQInput::SetRegionsOfInterest(double threshold, int padding) {
+    if (fRegionFinder) {
+        delete fRegionFinder;
+        fRegionFinder = NULL;
+    }
+    if (threshold <= 0) return;
+    fRegionFinder = new CP::TPulseRegionFinder(threshold,padding);
+}
+
+CP::TUBDAQInput::TUBDAQInput(const char* name, int first, int last, int scale,
+                             int follow) 
+    : fFilename(name), fRawFile(NULL), fInflate(NULL),
+      fCheckpointSpacing(0), fFollow(NULL),
+      fEndCaboose(false), fBuffer(NULL), fFile(NULL), fRecordOffset(0),
+      fFirstSample(first), fLastSample(last),
+      fScaledDigitSave(scale), fArchive(NULL), fRecord(NULL),
+      fRecordVersion(0), fTriggerSelection(0), fTriggerBits(-1),
+      fCompactDigits(0), fWaveformMatrix(kDigitsOnly),
+      fRegionFinder(NULL), fContextHasTime(false), fErrorThrottle(100),
+      fShortMatrixRows(0),
+      fCache(NULL), fCacheEvent(0), fEventCache(NULL), fEventCacheNext(0),
+      fEventCacheEnd(false), fProfile("ubdaq " + fFilename),
+      fLastRawPosition(0), fLastPosition(0) {
+
+    // The stages and counters must be added in the order of the enums.
+    fProfile.AddStage("read");
+    fProfile.AddStage("deserialize");
+    fProfile.AddStage("unpack");
+    fProfile.AddStage("event");
+    fProfile.AddStage("copy");
+    fProfile.AddStage("digits");
+    fProfile.AddStage("pmt");
+    fProfile.AddStage("cache");
+    fProfile.AddCounter("bytes in");
+    fProfile.AddCounter("bytes out");
+    fProfile.AddCounter("skipped");
+    fProfile.AddCounter("channels");
+    fProfile.AddCounter("samples");
+    fProfile.AddCounter("digits");
+    fProfile.AddCounter("allocations");
+    fProfile.AddCounter("cached events");
+
+    OpenStreams(follow);
 
     // Determine the detector type being converted so that the partition can
     // be correctly set.  This depends on the file naming convention, but the
@@ -163,224 +606,1333 @@ CP::TUBDAQInput::TUBDAQInput(const char* name, int first, int last, int scale)
     fEventsRead = 0;
 }
 
+void CP::TUBDAQInput::OpenStreams(int follow) {
+    if (follow != 0) {
+        // The file is still being written, so read through a buffer that
+        // waits for the writer.  A gzip stream can't be inflated while
+        // it's being written, so it's read once like any other file.
+        fFollow = new CP::TFollowStreamBuf(fFilename.c_str(),follow);
+        if (fFollow->IsGzip()) {
+            CaptError("Cannot follow a compressed file: " << fFilename);
+            delete fFollow;
+            fFollow = NULL;
+        }
+    }
+    if (fFollow) {
+        fBuffer = new CP::TCountingStreamBuf(fFollow);
+    }
+    else {
+        // The file might be a pipe (or the standard input), so the
+        // compression is found from the magic number instead of the name.
+        fRawFile = new CP::TRawStreamBuf(fFilename.c_str());
+        if (fRawFile->IsGzip()) {
+            fInflate = new CP::TInflateStreamBuf(fRawFile);
+            fInflate->SetCheckpointSpacing(fCheckpointSpacing);
+            fBuffer = new CP::TCountingStreamBuf(fInflate);
+        }
+        else {
+            fBuffer = new CP::TCountingStreamBuf(fRawFile,
+                                                 fRawFile->IsSeekable());
+        }
+    }
+    fBuffer->SetProfile(&fProfile,kStageRead);
+    fFile = new std::istream(fBuffer);
+}
+
+void CP::TUBDAQInput::CloseStreams() {
+    if (fFile) {
+        delete fFile;
+        fFile = NULL;
+    }
+    if (fBuffer) {
+        delete fBuffer;
+        fBuffer = NULL;
+    }
+    if (fInflate) {
+        delete fInflate;
+        fInflate = NULL;
+    }
+    if (fFollow) {
+        delete fFollow;
+        fFollow = NULL;
+    }
+    if (fRawFile) {
+        delete fRawFile;
+        fRawFile = NULL;
+    }
+}
+
+bool CP::TUBDAQInput::Rewind() {
+    // A pipe can only be read once.
+    if (!fRawFile || !fRawFile->IsSeekable()) return false;
+    FinishRecord();
+    CloseStreams();
+    OpenStreams(0);
+    fEndCaboose = false;
+    fLastPosition = 0;
+    fLastRawPosition = 0;
+    return IsOpen();
+}
+
+bool CP::TUBDAQInput::ResumeInflate(std::streamoff offset) {
+    if (!fInflate || fCheckpoints.empty()) return false;
+    // Find the last checkpoint at or before the offset.
+    std::size_t low = 0;
+    std::size_t high = fCheckpoints.size();
+    while (low < high) {
+        std::size_t middle = (low + high)/2;
+        if (fCheckpoints[middle].Out <= (uint64_t) offset) low = middle + 1;
+        else high = middle;
+    }
+    if (low == 0) return false;
+    const CP::TInflateStreamBuf::Checkpoint& checkpoint
+        = fCheckpoints[low-1];
+    std::streamoff current = fBuffer->GetPosition();
+    if (current <= offset && (std::streamoff) checkpoint.Out <= current) {
+        return false;
+    }
+    if (!fInflate->Resume(checkpoint)) {
+        CaptError("Cannot use inflate checkpoint at " << checkpoint.Out
+                  << " in " << fFilename);
+        fCheckpoints.clear();
+        Rewind();
+        return false;
+    }
+    fBuffer->Reset(checkpoint.Out);
+    return true;
+}
+
+void CP::TUBDAQInput::SetCheckpointSpacing(std::streamoff spacing) {
+    fCheckpointSpacing = spacing;
+    if (fInflate) fInflate->SetCheckpointSpacing(spacing);
+}
+
+void CP::TUBDAQInput::GetInflateCheckpoints(
+    std::vector<CP::TInflateStreamBuf::Checkpoint>& checkpoints) const {
+    checkpoints.clear();
+    if (fInflate) checkpoints = fInflate->GetCheckpoints();
+}
+
 CP::TUBDAQInput::~TUBDAQInput() {
     CloseFile();
+    SetRegionsOfInterest(0,0);
+}
+
+void CP::TUBDAQInput::SetSampleCache(const std::string& directory,
+                                     double megabytes) {
+    if (fCache) {
+        delete fCache;
+        fCache = NULL;
+    }
+    if (directory.empty()) return;
+    if (fFollow || fEventsRead > 0) {
+        CaptError("Sample cache must be set before reading " << fFilename);
+        return;
+    }
+    CP::TUBDAQSampleCache::Key key;
+    if (!CP::TUBDAQSampleCache::MakeKey(fFilename, key)) {
+        CaptError("Cannot cache samples for " << fFilename);
+        return;
+    }
+    mkdir(directory.c_str(), 0777);
+    std::string name = CP::TUBDAQSampleCache::CacheName(directory, key);
+    fCache = new CP::TUBDAQSampleCache();
+    if (fCache->Open(name, key)) {
+        CaptLog("Read " << fFilename << " from sample cache " << name);
+        // A record that was peeked before the cache was set is dropped.
+        FinishRecord();
+        fCacheEvent = 0;
+        return;
+    }
+    if (!fCache->Create(name, key)) {
+        delete fCache;
+        fCache = NULL;
+        return;
+    }
+    if (megabytes > 0) fCache->SetSizeLimit(megabytes*1024*1024);
+}
+
+bool CP::TUBDAQInput::IsReadingCache() const {
+    return fCache && fCache->IsReading();
+}
+
+void CP::TUBDAQInput::SetEventCache(double megabytes, int readAhead) {
+    if (fEventCache) {
+        delete fEventCache;
+        fEventCache = NULL;
+    }
+    if (megabytes <= 0) return;
+    if (fFollow) {
+        CaptError("Cannot cache the events of a followed file");
+        return;
+    }
+    // The sample cache can already be read in any order.
+    if (IsReadingCache()) return;
+    AbandonCache("event cache");
+    fEventCache = new CP::TUBDAQEventCache(*this, megabytes, readAhead);
+    fEventCacheNext = fEventsRead;
+    fEventCacheEnd = false;
+}
+
+void CP::TUBDAQInput::AbandonCache(const char* reason) {
+    if (!fCache || !fCache->IsWriting()) return;
+    CaptLog("Sample cache not written for " << fFilename
+            << " (" << reason << ")");
+    fCache->Close();
 }
 
 CP::TEvent* CP::TUBDAQInput::FirstEvent() {
     return NextEvent();
 }
 
-CP::TEvent* CP::TUBDAQInput::NextEvent(int skip) {
-    typedef std::map<gov::fnal::uboone::datatypes::crateHeader,
-                     gov::fnal::uboone::datatypes::crateData,
-                     gov::fnal::uboone::datatypes::compareCrateHeader> crateMap;
-    typedef std::map<gov::fnal::uboone::datatypes::cardHeader,
-                     gov::fnal::uboone::datatypes::cardData,
-                     gov::fnal::uboone::datatypes::compareCardHeader> cardMap;
-    typedef std::map<int,
-                     gov::fnal::uboone::datatypes::channelData> channelMap;
+bool CP::TUBDAQInput::ReadRecordHead() {
+    if (IsReadingCache()) return ReadCacheHead();
+    if (fArchive) return true;
+    if (!fFile) return false;
+    if (fEndCaboose) return false;
 
-    gov::fnal::uboone::datatypes::eventRecord ubdaqRecord;
+    // The archive header can't be read from an empty stream, so check for
+    // the end of the file first.
+    if (fFile->peek() == std::char_traits<char>::eof()) return false;
 
-    boost::archive::binary_iarchive archive(*fFile);
+    // Pass over any cabooses after the last record.  The end caboose
+    // finishes the file even if the writer hasn't closed it.
+    CP::TUBDAQCaboose caboose;
+    while (fBuffer->Peek(reinterpret_cast<char*>(&caboose), sizeof(caboose))
+           && caboose.Marker == CP::TUBDAQCaboose::kMarker) {
+        fBuffer->SkipTo(fBuffer->GetPosition() + sizeof(caboose));
+        if (caboose.Size == 0) {
+            fEndCaboose = true;
+            return false;
+        }
+        if (fFile->peek() == std::char_traits<char>::eof()) return false;
+    }
 
-    archive >> ubdaqRecord;
-    ubdaqRecord.updateIOMode(
-        gov::fnal::uboone::datatypes::IO_GRANULARITY_CHANNEL);
+    fRecordOffset = fBuffer->GetPosition();
+    if (fEventsRead == (int) fRecordOffsets.size()) {
+        fRecordOffsets.push_back(fRecordOffset);
+    }
+    CP::TRawInputProfile::Timer timer(&fProfile,kStageDeserialize);
+    fArchive = new boost::archive::binary_iarchive(*fFile);
+    fRecord = new gov::fnal::uboone::datatypes::eventRecord();
+    eventRecordHead head(*fRecord);
+    (*fArchive) >> head;
+    fRecordVersion = head.GetVersion();
+    timer.Stop();
 
-    // Build the event context.
-    CP::TEventContext context;
+    // The trigger data was added in version 2 of the event record.
+    fTriggerBits = -1;
+    if (fRecordVersion>1) {
+        fTriggerBits = fRecord->getTriggerDataPtr()->getTriggerBits();
+    }
 
-    context.SetRun(ubdaqRecord.getGlobalHeader().getRunNumber());
-    context.SetSubRun(ubdaqRecord.getGlobalHeader().getSubrunNumber());
-    context.SetEvent(ubdaqRecord.getGlobalHeader().getEventNumber());
-
-    do {
-        // Check if the global header clock is "reasonable".  If it is, then
-        // correct for the offset.
-        std::time_t offset2000 = ubdaqRecord.getGlobalHeader().getSeconds();
-        if (offset2000 != 0xFFFFFFFF) {
-            // The header counts the number of seconds since midnight Jan 1,
-            // 2012 UTC so it needs to be converted into a standard unix time
-            // before being saved into the context.  This raises the usual
-            // UNIX problem that it's time handling is insane, so bend over
-            // backwards to fix it.
-            struct tm offsetTime;
-            offsetTime.tm_year = 112;
-            offsetTime.tm_mon = 0;
-            offsetTime.tm_mday = 1;
-            offsetTime.tm_hour = 0;
-            offsetTime.tm_min = 0;
-            offsetTime.tm_sec = 0;
-            offsetTime.tm_isdst = 0;
-            std::time_t offsetTimeT= unixMkTimeIsInsane(&offsetTime);
-            unsigned int seconds = offset2000 + offsetTimeT;
-            unsigned int milliseconds
-                = ubdaqRecord.getGlobalHeader().getMilliSeconds();
-            unsigned int microseconds
-                = ubdaqRecord.getGlobalHeader().getMicroSeconds();
-            unsigned int nanoseconds
-                = ubdaqRecord.getGlobalHeader().getNanoSeconds()
-                + 1000*microseconds + 1000000*milliseconds;
-            context.SetTimeStamp(seconds);
-            context.SetNanoseconds(nanoseconds);
-            break;
-        }
-        
-        // The number of seconds hasn't been initialized, so try the SEB
-        // clocks.
-        crateMap &crates = ubdaqRecord.getSEBMap();
-        unsigned int seconds = 0xFFFFFFFF;
-        unsigned int nanoseconds = 0xFFFFFFFF;
-        for (crateMap::iterator crate = crates.begin(); 
-             crate != crates.end();
-             ++crate) {
-            crateMap::key_type crate_header = crate->first;
-            unsigned int crateSec = crate_header.getSebTimeSec();
-            unsigned int crateUsec = crate_header.getSebTimeUsec();
-            if ((crateSec < seconds) ||
-                (crateSec == seconds && 1000*crateUsec < nanoseconds)) {
-                seconds = crateSec;
-                nanoseconds = 1000*crateUsec;
-                context.SetTimeStamp(seconds);
-                context.SetNanoseconds(nanoseconds);
-            }
-        }
+    gov::fnal::uboone::datatypes::globalHeader* header
+        = fRecord->getGlobalHeaderPtr();
+    
+    // Build the event context.
+    fContext = CP::TEventContext();
+    fContextHasTime = false;
 
-        if (seconds != 0xFFFFFFFF) break;
-        CaptError("Event " << context.GetRun() 
-                  << "." << context.GetEvent() 
-                  << ": No time for DAQ.");
+    fContext.SetRun(header->getRunNumber());
+    fContext.SetSubRun(header->getSubrunNumber());
+    fContext.SetEvent(header->getEventNumber());
 
-    } while (false);
+    // Check if the global header clock is "reasonable".  If it is, then
+    // correct for the offset.  If it isn't, the SEB clocks are used, but
+    // those can only be found after the crates are read.
+    std::time_t offset2000 = header->getSeconds();
+    if (offset2000 != 0xFFFFFFFF) {
+        // The header counts the number of seconds since midnight Jan 1,
+        // 2012 UTC so it needs to be converted into a standard unix time
+        // before being saved into the context.  This raises the usual
+        // UNIX problem that it's time handling is insane, so bend over
+        // backwards to fix it.
+        struct tm offsetTime;
+        offsetTime.tm_year = 112;
+        offsetTime.tm_mon = 0;
+        offsetTime.tm_mday = 1;
+        offsetTime.tm_hour = 0;
+        offsetTime.tm_min = 0;
+        offsetTime.tm_sec = 0;
+        offsetTime.tm_isdst = 0;
+        std::time_t offsetTimeT= unixMkTimeIsInsane(&offsetTime);
+        unsigned int seconds = offset2000 + offsetTimeT;
+        unsigned int milliseconds = header->getMilliSeconds();
+        unsigned int microseconds = header->getMicroSeconds();
+        unsigned int nanoseconds
+            = header->getNanoSeconds()
+            + 1000*microseconds + 1000000*milliseconds;
+        fContext.SetTimeStamp(seconds);
+        fContext.SetNanoseconds(nanoseconds);
+        fContextHasTime = true;
+    }
 
     // Define the partition for this data.
     if (fDetector == "mCAPTAIN") {
-        context.SetPartition(CP::TEventContext::kmCAPTAIN);
+        fContext.SetPartition(CP::TEventContext::kmCAPTAIN);
     }
     else if (fDetector == "CAPTAIN") {
-        context.SetPartition(CP::TEventContext::kCAPTAIN);
+        fContext.SetPartition(CP::TEventContext::kCAPTAIN);
     }
     else {
-        context.SetPartition(CP::TEventContext::kCAPTAIN);
-        static int errorThrottle=100;
-        if (--errorThrottle>0) {
-            CaptError("Detector type not set for " << context.GetRun() 
-                      << "." << context.GetEvent() 
+        fContext.SetPartition(CP::TEventContext::kCAPTAIN);
+        if (--fErrorThrottle>0) {
+            CaptError("Detector type not set for " << fContext.GetRun() 
+                      << "." << fContext.GetEvent() 
                       << ": Defaulting to CAPTAIN.");
         }
     }        
-        
+
+    return true;
+}
+
+void CP::TUBDAQInput::ReadRecordCrates(bool skip) {
+    typedef gov::fnal::uboone::datatypes::crateData crateData;
+    typedef gov::fnal::uboone::datatypes::crateDataPMT crateDataPMT;
+
+    CP::TRawInputProfile::Timer timer(&fProfile,kStageDeserialize);
+    sebMapReader<crateData> tpcReader(*fRecord,skip,fChannelSelection);
+    (*fArchive) >> tpcReader;
+
+    // The PMT crates were added in version 2 of the event record.
+    if (fRecordVersion>1) {
+        sebMapReader<crateDataPMT> pmtReader(*fRecord,skip,
+                                             fChannelSelection);
+        (*fArchive) >> pmtReader;
+    }
+}
+
+void CP::TUBDAQInput::FinishRecord() {
+    if (fArchive) {
+        delete fArchive;
+        fArchive = NULL;
+    }
+    if (fRecord) {
+        delete fRecord;
+        fRecord = NULL;
+    }
+}
+
+bool CP::TUBDAQInput::PeekContext(CP::TEventContext& context) {
+    if (fEventCache) {
+        const CP::TUBDAQEventCache::Record* record
+            = fEventCache->Acquire(fEventCacheNext);
+        if (record) {
+            FillContext(record->Event, context);
+            fTriggerBits = record->Event.TriggerBits;
+        }
+        fEventCache->Release();
+        return record != NULL;
+    }
+    if (!ReadRecordHead()) return false;
+    context = fContext;
+    return true;
+}
+
+std::streamoff CP::TUBDAQInput::GetRecordOffset() const {
+    if (IsReadingCache()) {
+        if (fCacheEvent >= fCache->GetEventCount()) return -1;
+        return fCache->GetEvent(fCacheEvent).RecordOffset;
+    }
+    if (fArchive) return fRecordOffset;
+    if (!fBuffer) return -1;
+    return fBuffer->GetPosition();
+}
+
+bool CP::TUBDAQInput::SeekRecord(std::streamoff offset) {
+    if (IsReadingCache()) {
+        // The cached events are in file order.
+        int low = 0;
+        int high = fCache->GetEventCount();
+        while (low < high) {
+            int middle = (low + high)/2;
+            if (fCache->GetEvent(middle).RecordOffset < offset) {
+                low = middle + 1;
+            }
+            else high = middle;
+        }
+        if (low < fCache->GetEventCount()
+            && fCache->GetEvent(low).RecordOffset == offset) {
+            fCacheEvent = low;
+            return true;
+        }
+        CaptError("Cannot find record at " << offset
+                  << " in cache for " << fFilename);
+        return false;
+    }
+    if (!fBuffer) return false;
+    if (fArchive) {
+        if (offset == fRecordOffset) return true;
+        FinishRecord();
+    }
+    if (offset != fBuffer->GetPosition()) AbandonCache("record seek");
+    fFile->clear();
+    if (fInflate) ResumeInflate(offset);
+    if (!fBuffer->SkipTo(offset)) {
+        // A compressed file can't move backward, so it's read again from
+        // the start.
+        if (offset > fBuffer->GetPosition()
+            || !Rewind() || !fBuffer->SkipTo(offset)) {
+            CaptError("Cannot find record at " << offset
+                      << " in " << fFilename);
+            return false;
+        }
+    }
+    // The data that was passed over isn't counted as read.
+    fLastPosition = fBuffer->GetPosition();
+    if (fRawFile) fLastRawPosition = fRawFile->GetPosition();
+    return true;
+}
+
+void CP::TUBDAQInput::CountBytes() {
+    if (!fProfile.IsEnabled() || !fBuffer) return;
+    std::streamoff position = fBuffer->GetPosition();
+    std::streamoff rawPosition = position;
+    if (fRawFile) rawPosition = fRawFile->GetPosition();
+    fProfile.Count(kCountBytesOut, position - fLastPosition);
+    fProfile.Count(kCountBytesIn, rawPosition - fLastRawPosition);
+    fLastPosition = position;
+    fLastRawPosition = rawPosition;
+}
+
+void CP::TUBDAQInput::SkipEvent() {
+    if (fEventCache) {
+        ++fEventCacheNext;
+        fProfile.Count(kCountSkipped);
+        return;
+    }
+    if (!ReadRecordHead()) return;
+    if (IsReadingCache()) {
+        ++fCacheEvent;
+        fProfile.Count(kCountSkipped);
+        ++fEventsRead;
+        return;
+    }
+    AbandonCache("record skipped");
+    ReadRecordCrates(true);
+    FinishRecord();
+    fProfile.Count(kCountSkipped);
+    CountBytes();
+    ++fEventsRead;
+}
+
+bool CP::TUBDAQInput::ReadSelectedHead() {
+    // Skip records until one is selected.  Without an input or trigger
+    // selection, this is the next record.  The decision only needs the
+    // global header and trigger data, so the unselected records are never
+    // copied or unpacked.
+    const CP::TRunEventSet* selection = GetSelection();
+    while (true) {
+        if (!ReadRecordHead()) return false;
+        if (selection && !selection->Contains(fContext.GetRun(),
+                                              fContext.GetSubRun(),
+                                              fContext.GetEvent())) {
+            SkipEvent();
+            continue;
+        }
+        if (!TriggerSelected(fTriggerSelection,fTriggerBits)) {
+            SkipEvent();
+            continue;
+        }
+        return true;
+    }
+}
+
+gov::fnal::uboone::datatypes::eventRecord* CP::TUBDAQInput::NextRecord() {
+    if (fEventCache || IsReadingCache()) {
+        CaptError("Cannot read raw records through a cache for "
+                  << fFilename);
+        return NULL;
+    }
+    AbandonCache("raw records read");
+    if (!ReadSelectedHead()) return NULL;
+
+    // The unselected crates are passed over, and the rest are left at the
+    // crate granularity.
+    ReadRecordCrates(false);
+    gov::fnal::uboone::datatypes::eventRecord* record = fRecord;
+    fRecord = NULL;
+    FinishRecord();
+    CountBytes();
+    ++fEventsRead;
+    return record;
+}
+
+CP::TEvent* CP::TUBDAQInput::NextEvent(int skip) {
+    typedef gov::fnal::uboone::datatypes::eventRecord::sebMap_t crateMap;
+    typedef gov::fnal::uboone::datatypes::crateData::cardMap_t cardMap;
+    typedef gov::fnal::uboone::datatypes::cardData::channelMap_t channelMap;
+
+    if (fEventCache) {
+        return ReadCachedEvent(fEventCacheNext + std::max(0,skip), true);
+    }
+
+    if (!ReadSelectedHead()) {
+        // The cache is only kept when every record was converted.
+        if (fCache && fCache->IsWriting() && EndOfFile()) fCache->Finish();
+        return NULL;
+    }
+    int triggerBits = fTriggerBits;
+    if (IsReadingCache()) return NextCachedEvent();
+    if (!fChannelSelection.IsEmpty()) AbandonCache("channel selection");
+    std::streamoff recordOffset = fRecordOffset;
+
+    // Commit to reading the full record.
+    ReadRecordCrates(false);
+    std::auto_ptr<gov::fnal::uboone::datatypes::eventRecord>
+        record(fRecord);
+    fRecord = NULL;
+    FinishRecord();
+
+    gov::fnal::uboone::datatypes::eventRecord& ubdaqRecord = *record;
+    {
+        CP::TRawInputProfile::Timer timer(&fProfile,kStageUnpack);
+        ubdaqRecord.updateIOMode(
+            gov::fnal::uboone::datatypes::IO_GRANULARITY_CHANNEL);
+    }
+
+    CP::TEventContext context = fContext;
+
+    // The number of seconds in the global header hasn't been initialized,
+    // so try the SEB clocks.
+    if (!fContextHasTime) SetCrateTime(ubdaqRecord, context);
+
     // Create the event.
+    CP::TRawInputProfile::Timer eventTimer(&fProfile,kStageEvent);
     std::auto_ptr<CP::TEvent> newEvent(new CP::TEvent(context));
     newEvent->SetTimeStamp(context.GetTimeStamp(), context.GetNanoseconds());
+
+    // Save the trigger data.
+    const gov::fnal::uboone::datatypes::triggerData& trigger
+        = *ubdaqRecord.getTriggerDataPtr();
+    if (triggerBits >= 0) {
+        AddTriggerDatum(*newEvent, triggerBits,
+                        trigger.getFrame(),
+                        trigger.getSampleNumber_64MHz(),
+                        trigger.getTrigEventNum());
+    }
         
-    // Get the digits container, and create it if it doesn't exist.
-    CP::THandle<CP::TDigitContainer> drift 
-        = newEvent->Get<CP::TDigitContainer>("~/digits/drift");
-    if (!drift) {
-        CP::THandle<CP::TDataVector> dv
-            = newEvent->Get<CP::TDataVector>("~/digits");
-        if (!dv) {
-            newEvent->AddDatum(new CP::TDataVector("digits"));
-            dv = newEvent->Get<CP::TDataVector>("~/digits");
-        }
-        if (0<fScaledDigitSave && 0 != (fEventsRead % fScaledDigitSave)) {
-            dv->AddTemporary(new CP::TDigitContainer("drift"));
-        }
-        else {
-            dv->AddDatum(new CP::TDigitContainer("drift"));
-        }
-        drift = newEvent->Get<CP::TDigitContainer>("~/digits/drift");
+    CP::TDigitContainer& drift
+        = GetDigitContainer(*newEvent,"drift",fEventsRead);
+    eventTimer.Stop();
+
+    // Start the event in the sample cache.  The channels are added as they
+    // are converted.
+    if (fCache && fCache->IsWriting()) {
+        CP::TUBDAQSampleCache::EventEntry entry;
+        FillEventEntry(ubdaqRecord, context, triggerBits, recordOffset,
+                       entry);
+        fCache->AddEvent(entry);
     }
 
-    // Get the digits from the event.
-    CP::TPulseDigit::Vector adc(30000);
-    crateMap crates = ubdaqRecord.getSEBMap();
-    for (crateMap::iterator crate = crates.begin(); 
+    // Convert the PMT windows that were read out through the SEBs.  These
+    // go into the same container that is used for the PDS DAQ files.
+    if (!ubdaqRecord.getSEBPMTMap().empty()) {
+        CP::TDigitContainer& pmt
+            = GetDigitContainer(*newEvent,"pmt",fEventsRead);
+        CP::TRawInputProfile::Timer timer(&fProfile,kStagePMT);
+        ConvertPMTCrates(ubdaqRecord,pmt);
+    }
+
+    // Get the digits from the event.  The crates and cards that aren't
+    // selected were never unpacked, but the channels are checked here.
+    bool selectChannels = !fChannelSelection.IsEmpty();
+    std::auto_ptr<CP::TChannelSummary> summary(
+        new CP::TChannelSummary("channelSummary"));
+    const crateMap& crates = ubdaqRecord.getSEBMap();
+    for (crateMap::const_iterator crate = crates.begin(); 
          crate != crates.end();
          ++crate) {
-        crateMap::key_type crate_header = crate->first;
-        int crateNum = crate_header.getCrateNumber();
-        crateMap::mapped_type crate_data = crate->second;
-        cardMap cards = crate_data.getCardMap();
-        for (cardMap::iterator card = cards.begin();
+        int crateNum = crate->first.getCrateNumber();
+        const cardMap& cards = crate->second.getCardMap();
+        fProfile.Count(kCountAllocations, 1 + cards.size());
+
+        // Size the waveform matrix for the selected channels before any
+        // of them are converted.
+        CP::TWaveformMatrix* matrix = NULL;
+        if (fWaveformMatrix != kDigitsOnly) {
+            int rows = 0;
+            int ticks = 0;
+            for (cardMap::const_iterator card = cards.begin();
+                 card != cards.end();
+                 ++card) {
+                int cardNum = card->first.getModule();
+                const channelMap& channels = card->second.getChannelMap();
+                for (channelMap::const_iterator channel = channels.begin();
+                     channel != channels.end();
+                     ++channel) {
+                    if (selectChannels
+                        && !fChannelSelection.ChannelSelected(
+                            crateNum,cardNum,
+                            channel->second.getChannelNumber())) {
+                        continue;
+                    }
+                    int begin, end;
+                    GetSampleWindow(channel->second.getChannelDataSize()
+                                    /sizeof(UShort_t), begin, end);
+                    // A channel too short for the window has no row.
+                    if (begin != std::max(0,fFirstSample)) continue;
+                    ticks = std::max(ticks, end - begin);
+                    ++rows;
+                }
+            }
+            if (rows > 0) {
+                matrix = &GetCrateMatrix(*newEvent, crateNum, rows, ticks,
+                                         fEventsRead);
+            }
+        }
+
+        for (cardMap::const_iterator card = cards.begin();
              card != cards.end();
              ++card) {
-            cardMap::key_type card_header = card->first;
-            int cardNum = card_header.getModule();
-            cardMap::mapped_type card_data = card->second;
-            channelMap channels = card_data.getChannelMap();
-            for (channelMap::iterator channel = channels.begin();
+            int cardNum = card->first.getModule();
+            const channelMap& channels = card->second.getChannelMap();
+            for (channelMap::const_iterator channel = channels.begin();
                  channel != channels.end();
                  ++channel) {
                 int channelNum = channel->second.getChannelNumber();
-                CP::TTPCChannelId chanId(crateNum,cardNum,channelNum);
-
+                if (selectChannels
+                    && !fChannelSelection.ChannelSelected(crateNum,cardNum,
+                                                          channelNum)) {
+                    continue;
+                }
                 int nSamples
                     = channel->second.getChannelDataSize()/sizeof(UShort_t);
-                Char_t* samples = channel->second.getChannelDataPtr();
-                int beginSamples = 0;
+                const Char_t* samples = channel->second.getChannelDataPtr();
 
-                // Possibly truncate some of the samples at the beginning.
-                if (fFirstSample > 0 && fFirstSample < nSamples) {
-                    beginSamples = fFirstSample;
+                // The cache gets every sample so that it can be used with
+                // any sample window.
+                if (fCache && fCache->IsWriting()) {
+                    CP::TRawInputProfile::Timer timer(&fProfile,kStageCache);
+                    fCache->AddChannel(CP::TUBDAQSampleCache::kTPC,
+                                       crateNum, cardNum, channelNum,
+                                       0, samples, nSamples);
                 }
 
-                // Possibly truncate some of the samples at the end.
-                if (fLastSample > fFirstSample && fLastSample < nSamples) {
-                    nSamples = fLastSample;
-                }
+                ConvertTPCChannel(drift, *summary,
+                                  CP::TTPCChannelId(crateNum,cardNum,
+                                                    channelNum),
+                                  samples, nSamples, matrix);
+            }
+        }
+        WarnShortMatrixRows(crateNum);
+    }
 
-                // Protect against data-mangling...
-                if (nSamples > 9596) {
-                    CaptError("Truncate digit length"
-                              << " from " << nSamples
-                              << " for " << chanId);
-                    nSamples = 9596;
-                }
+    if (summary->GetChannelCount() > 0) {
+        newEvent->AddDatum(summary.release());
+    }
+
+    CountBytes();
+    fProfile.EndEvent(context.GetRun(), context.GetEvent());
+
+    ++fEventsRead;
+    return newEvent.release();
+}
+
+void CP::TUBDAQInput::SetCrateTime(
+    const gov::fnal::uboone::datatypes::eventRecord& record,
+    CP::TEventContext& context) {
+    typedef gov::fnal::uboone::datatypes::eventRecord::sebMap_t crateMap;
+    const crateMap& crates = record.getSEBMap();
+    unsigned int seconds = 0xFFFFFFFF;
+    unsigned int nanoseconds = 0xFFFFFFFF;
+    for (crateMap::const_iterator crate = crates.begin(); 
+         crate != crates.end();
+         ++crate) {
+        const crateMap::key_type& crate_header = crate->first;
+        unsigned int crateSec = crate_header.getSebTimeSec();
+        unsigned int crateUsec = crate_header.getSebTimeUsec();
+        if ((crateSec < seconds) ||
+            (crateSec == seconds && 1000*crateUsec < nanoseconds)) {
+            seconds = crateSec;
+            nanoseconds = 1000*crateUsec;
+            context.SetTimeStamp(seconds);
+            context.SetNanoseconds(nanoseconds);
+        }
+    }
+
+    if (seconds == 0xFFFFFFFF) {
+        CaptError("Event " << context.GetRun() 
+                  << "." << context.GetEvent() 
+                  << ": No time for DAQ.");
+    }
+}
+
+void CP::TUBDAQInput::FillEventEntry(
+    gov::fnal::uboone::datatypes::eventRecord& record,
+    const CP::TEventContext& context, int triggerBits,
+    std::streamoff recordOffset,
+    CP::TUBDAQSampleCache::EventEntry& entry) {
+    const gov::fnal::uboone::datatypes::triggerData& trigger
+        = *record.getTriggerDataPtr();
+    entry.Run = context.GetRun();
+    entry.SubRun = context.GetSubRun();
+    entry.Event = context.GetEvent();
+    entry.Seconds = context.GetTimeStamp();
+    entry.Nanoseconds = context.GetNanoseconds();
+    entry.TriggerBits = triggerBits;
+    entry.TriggerFrame = (triggerBits<0) ? 0 : trigger.getFrame();
+    entry.TriggerSample
+        = (triggerBits<0) ? 0 : trigger.getSampleNumber_64MHz();
+    entry.TriggerEvent = (triggerBits<0) ? 0 : trigger.getTrigEventNum();
+    entry.ChannelCount = 0;
+    entry.RecordOffset = recordOffset;
+    entry.FirstChannel = 0;
+}
+
+void CP::TUBDAQInput::FillContext(
+    const CP::TUBDAQSampleCache::EventEntry& entry,
+    CP::TEventContext& context) {
+    context = CP::TEventContext();
+    context.SetRun(entry.Run);
+    context.SetSubRun(entry.SubRun);
+    context.SetEvent(entry.Event);
+    context.SetTimeStamp(entry.Seconds);
+    context.SetNanoseconds(entry.Nanoseconds);
+    if (fDetector == "mCAPTAIN") {
+        context.SetPartition(CP::TEventContext::kmCAPTAIN);
+    }
+    else {
+        context.SetPartition(CP::TEventContext::kCAPTAIN);
+    }
+}
+
+bool CP::TUBDAQInput::ReadCacheHead() {
+    if (fCacheEvent >= fCache->GetEventCount()) return false;
+    const CP::TUBDAQSampleCache::EventEntry& entry
+        = fCache->GetEvent(fCacheEvent);
+    FillContext(entry, fContext);
+    fContextHasTime = true;
+    fTriggerBits = entry.TriggerBits;
+    fRecordOffset = entry.RecordOffset;
+    return true;
+}
+
+CP::TEvent* CP::TUBDAQInput::NextCachedEvent() {
+    const CP::TUBDAQSampleCache::EventEntry& entry
+        = fCache->GetEvent(fCacheEvent++);
+    CP::TEvent* event = MakeEvent(entry, fCache->GetChannels(entry),
+                                  fCache->GetData(), fEventsRead);
+    fProfile.Count(kCountCached);
+    fProfile.EndEvent(entry.Run, entry.Event);
+    ++fEventsRead;
+    return event;
+}
+
+CP::TEvent* CP::TUBDAQInput::MakeEvent(
+    const CP::TUBDAQSampleCache::EventEntry& entry,
+    const CP::TUBDAQSampleCache::ChannelEntry* channels,
+    const char* data, int index) {
+    CP::TEventContext context;
+    FillContext(entry, context);
+
+    CP::TRawInputProfile::Timer eventTimer(&fProfile,kStageEvent);
+    std::auto_ptr<CP::TEvent> newEvent(new CP::TEvent(context));
+    newEvent->SetTimeStamp(context.GetTimeStamp(),
+                           context.GetNanoseconds());
+    if (entry.TriggerBits >= 0) {
+        AddTriggerDatum(*newEvent, entry.TriggerBits, entry.TriggerFrame,
+                        entry.TriggerSample, entry.TriggerEvent);
+    }
+    CP::TDigitContainer& drift = GetDigitContainer(*newEvent,"drift",index);
+    CP::TDigitContainer* pmt = NULL;
+    eventTimer.Stop();
+
+    // The channels are in the order they were converted, so the PMT
+    // windows come first.
+    bool selectChannels = !fChannelSelection.IsEmpty();
+    std::auto_ptr<CP::TChannelSummary> summary(
+        new CP::TChannelSummary("channelSummary"));
+
+    // Size the waveform matrix for each crate before any channels are
+    // converted.  The map holds the rows and ticks, and then the matrix.
+    std::map<int, std::pair<int,int> > crateSizes;
+    std::map<int, CP::TWaveformMatrix*> matrices;
+    if (fWaveformMatrix != kDigitsOnly) {
+        for (int i = 0; i < entry.ChannelCount; ++i) {
+            const CP::TUBDAQSampleCache::ChannelEntry& channel = channels[i];
+            if (channel.Kind != CP::TUBDAQSampleCache::kTPC) continue;
+            if (selectChannels
+                && !fChannelSelection.ChannelSelected(channel.Crate,
+                                                      channel.Card,
+                                                      channel.Channel)) {
+                continue;
+            }
+            int begin, end;
+            GetSampleWindow(channel.Samples, begin, end);
+            // A channel too short for the window has no row.
+            if (begin != std::max(0,fFirstSample)) continue;
+            std::pair<int,int>& size = crateSizes[channel.Crate];
+            ++size.first;
+            size.second = std::max(size.second, end - begin);
+        }
+        for (std::map<int, std::pair<int,int> >::iterator c
+                 = crateSizes.begin();
+             c != crateSizes.end(); ++c) {
+            matrices[c->first] = &GetCrateMatrix(*newEvent, c->first,
+                                                 c->second.first,
+                                                 c->second.second, index);
+        }
+    }
+
+    int lastCrate = -1;
+    for (int i = 0; i < entry.ChannelCount; ++i) {
+        const CP::TUBDAQSampleCache::ChannelEntry& channel = channels[i];
+        if (selectChannels
+            && !fChannelSelection.ChannelSelected(channel.Crate,
+                                                  channel.Card,
+                                                  channel.Channel)) {
+            continue;
+        }
+        if (channel.Crate != lastCrate) {
+            WarnShortMatrixRows(lastCrate);
+            lastCrate = channel.Crate;
+        }
+        const char* samples = data + channel.Offset;
+        if (channel.Kind == CP::TUBDAQSampleCache::kPMT) {
+            if (!pmt) pmt = &GetDigitContainer(*newEvent,"pmt",index);
+            CP::TRawInputProfile::Timer timer(&fProfile,kStagePMT);
+            ConvertPMTWindow(*pmt,
+                             CP::TPDSChannelId(channel.Crate,channel.Card,
+                                               channel.Channel),
+                             channel.First, samples, channel.Samples);
+            continue;
+        }
+        CP::TWaveformMatrix* matrix = NULL;
+        if (!matrices.empty()) matrix = matrices[channel.Crate];
+        ConvertTPCChannel(drift, *summary,
+                          CP::TTPCChannelId(channel.Crate,channel.Card,
+                                            channel.Channel),
+                          samples, channel.Samples, matrix);
+    }
+    WarnShortMatrixRows(lastCrate);
+
+    if (summary->GetChannelCount() > 0) {
+        newEvent->AddDatum(summary.release());
+    }
+    return newEvent.release();
+}
+
+namespace {
+    /// Add a channel to a decoded record.
+    void addRecordChannel(CP::TUBDAQEventCache::Record& record, int kind,
+                          int crate, int card, int channel, int first,
+                          const char* samples, int count) {
+        CP::TUBDAQSampleCache::ChannelEntry entry;
+        entry.Kind = kind;
+        entry.Crate = crate;
+        entry.Card = card;
+        entry.Channel = channel;
+        entry.First = first;
+        entry.Samples = count;
+        entry.Offset = record.Samples.size();
+        record.Samples.insert(record.Samples.end(),
+                              samples, samples + count*sizeof(UShort_t));
+        record.Channels.push_back(entry);
+        ++record.Event.ChannelCount;
+    }
+}
+
+bool CP::TUBDAQInput::MoveToRecord(int index) {
+    if (index < 0) return false;
+    if (index == fEventsRead) return true;
+    if (index < (int) fRecordOffsets.size()) {
+        if (!SeekRecord(fRecordOffsets[index])) return false;
+        fEventsRead = index;
+        return true;
+    }
+    // Pass over the records that haven't been found yet.
+    while (fEventsRead < index) {
+        if (!ReadRecordHead()) return false;
+        ReadRecordCrates(true);
+        FinishRecord();
+        CountBytes();
+        ++fEventsRead;
+    }
+    return true;
+}
+
+bool CP::TUBDAQInput::DecodeRecord(int index,
+                                   CP::TUBDAQEventCache::Record& cached) {
+    typedef gov::fnal::uboone::datatypes::eventRecord::sebMap_t crateMap;
+    typedef gov::fnal::uboone::datatypes::crateData::cardMap_t cardMap;
+    typedef gov::fnal::uboone::datatypes::cardData::channelMap_t channelMap;
+    typedef gov::fnal::uboone::datatypes::eventRecord::sebMapPMT_t pmtMap;
+    typedef gov::fnal::uboone::datatypes::crateDataPMT::cardMap_t pmtCardMap;
+    typedef gov::fnal::uboone::datatypes::cardDataPMT::channelMap_t
+        pmtChannelMap;
+    typedef gov::fnal::uboone::datatypes::channelDataPMT::windowMap_t
+        windowMap;
+
+    if (!MoveToRecord(index)) return false;
+    if (!ReadRecordHead()) return false;
+    int triggerBits = fTriggerBits;
+    std::streamoff recordOffset = fRecordOffset;
+
+    ReadRecordCrates(false);
+    std::auto_ptr<gov::fnal::uboone::datatypes::eventRecord>
+        record(fRecord);
+    fRecord = NULL;
+    FinishRecord();
+    {
+        CP::TRawInputProfile::Timer timer(&fProfile,kStageUnpack);
+        record->updateIOMode(
+            gov::fnal::uboone::datatypes::IO_GRANULARITY_CHANNEL);
+    }
 
-                // Read the ADC data.  This could be more efficient, but as
-                // long as it's not a bottle neck, I'm keeping it bog simple.
-                adc.clear();
-                for (int i=beginSamples; i<nSamples; ++i) {
-                    UShort_t sample;
-                    // A copy is used since the ADC samples (uint16_t) are
-                    // saved in an array of uint8_t and may not be aligned
-                    // with shorts.  The copy works even if the alignment is
-                    // wrong.
-                    std::copy(samples+(i)*sizeof(UShort_t),
-                              samples+(i+1)*sizeof(UShort_t),
-                              (char*)(&sample));
-                    adc.push_back(sample);
+    CP::TEventContext context = fContext;
+    if (!fContextHasTime) SetCrateTime(*record, context);
+    FillEventEntry(*record, context, triggerBits, recordOffset,
+                   cached.Event);
+
+    // The channels are kept in the order they are converted.
+    CP::TRawInputProfile::Timer timer(&fProfile,kStageCopy);
+    const pmtMap& pmtCrates = record->getSEBPMTMap();
+    for (pmtMap::const_iterator crate = pmtCrates.begin(); 
+         crate != pmtCrates.end();
+         ++crate) {
+        const pmtCardMap& cards = crate->second.getCardMap();
+        for (pmtCardMap::const_iterator card = cards.begin();
+             card != cards.end();
+             ++card) {
+            const pmtChannelMap& channels = card->second.getChannelMap();
+            for (pmtChannelMap::const_iterator channel = channels.begin();
+                 channel != channels.end();
+                 ++channel) {
+                const windowMap& windows = channel->second.getWindowMap();
+                for (windowMap::const_iterator window = windows.begin();
+                     window != windows.end();
+                     ++window) {
+                    int nSamples
+                        = window->second.getWindowDataSize()/sizeof(UShort_t);
+                    const char* samples = window->second.getWindowDataPtr();
+                    if (!samples || nSamples < 1) continue;
+                    addRecordChannel(cached, CP::TUBDAQSampleCache::kPMT,
+                                     crate->first.getCrateNumber(),
+                                     card->first.getModule(),
+                                     channel->first,
+                                     window->first.getFrame()*kPMTFrameSamples
+                                     + window->first.getSample(),
+                                     samples, nSamples);
                 }
+            }
+        }
+    }
 
-                // Create the digit.
-                CP::TPulseDigit* digit = new TPulseDigit(chanId,
-                                                         beginSamples,
-                                                         adc);
-                drift->push_back(digit);
+    const crateMap& crates = record->getSEBMap();
+    for (crateMap::const_iterator crate = crates.begin(); 
+         crate != crates.end();
+         ++crate) {
+        const cardMap& cards = crate->second.getCardMap();
+        for (cardMap::const_iterator card = cards.begin();
+             card != cards.end();
+             ++card) {
+            const channelMap& channels = card->second.getChannelMap();
+            for (channelMap::const_iterator channel = channels.begin();
+                 channel != channels.end();
+                 ++channel) {
+                addRecordChannel(
+                    cached, CP::TUBDAQSampleCache::kTPC,
+                    crate->first.getCrateNumber(),
+                    card->first.getModule(),
+                    channel->second.getChannelNumber(), 0,
+                    channel->second.getChannelDataPtr(),
+                    channel->second.getChannelDataSize()/sizeof(UShort_t));
             }
         }
     }
+    timer.Stop();
 
+    CountBytes();
     ++fEventsRead;
-    return newEvent.release();
+    return true;
+}
+
+CP::TEvent* CP::TUBDAQInput::ReadCachedEvent(int index, bool select) {
+    const CP::TRunEventSet* selection = select ? GetSelection() : NULL;
+    for (;; ++index) {
+        const CP::TUBDAQEventCache::Record* record
+            = fEventCache->Acquire(index);
+        if (!record) {
+            fEventCache->Release();
+            fEventCacheNext = std::max(0,index);
+            fEventCacheEnd = true;
+            return NULL;
+        }
+        const CP::TUBDAQSampleCache::EventEntry& entry = record->Event;
+        if ((selection && !selection->Contains(entry.Run, entry.SubRun,
+                                               entry.Event))
+            || (select && !TriggerSelected(fTriggerSelection,
+                                           entry.TriggerBits))) {
+            fEventCache->Release();
+            fProfile.Count(kCountSkipped);
+            continue;
+        }
+        CP::TEvent* event = NULL;
+        try {
+            event = MakeEvent(entry,
+                              record->Channels.empty()
+                              ? NULL : &record->Channels[0],
+                              record->Samples.empty()
+                              ? NULL : &record->Samples[0],
+                              index);
+            fProfile.Count(kCountCached);
+            fProfile.EndEvent(entry.Run, entry.Event);
+        }
+        catch (...) {
+            fEventCache->Release();
+            throw;
+        }
+        fEventCache->Release();
+        fEventCacheNext = index+1;
+        fEventCacheEnd = false;
+        return event;
+    }
+}
+
+CP::TEvent* CP::TUBDAQInput::ReadEvent(int n) {
+    if (IsReadingCache()) {
+        if (n < 0 || n >= fCache->GetEventCount()) return NULL;
+        fCacheEvent = n;
+        fEventsRead = n;
+        ReadCacheHead();
+        return NextCachedEvent();
+    }
+    if (!fEventCache) {
+        // Without the event cache, each record is found and decoded when
+        // it's asked for.
+        if (n < 0) return NULL;
+        AbandonCache("records read out of order");
+        CP::TUBDAQEventCache::Record record;
+        if (!DecodeRecord(n, record)) return NULL;
+        CP::TEvent* event
+            = MakeEvent(record.Event,
+                        record.Channels.empty() ? NULL : &record.Channels[0],
+                        record.Samples.empty() ? NULL : &record.Samples[0],
+                        n);
+        fProfile.EndEvent(record.Event.Run, record.Event.Event);
+        return event;
+    }
+    if (n < 0) {
+        fEventCacheNext = 0;
+        return NULL;
+    }
+    return ReadCachedEvent(n, false);
+}
+
+CP::TEvent* CP::TUBDAQInput::PreviousEvent(int skip) {
+    // The position is after the event that was just read.
+    return ReadEvent(GetPosition() - 2 - std::max(0,skip));
+}
+
+CP::TDigitContainer& CP::TUBDAQInput::GetDigitContainer(CP::TEvent& event,
+                                                        const char* name,
+                                                        int index) {
+    std::string path = std::string("~/digits/") + name;
+    CP::THandle<CP::TDigitContainer> digits
+        = event.Get<CP::TDigitContainer>(path.c_str());
+    if (digits) return *digits;
+    CP::THandle<CP::TDataVector> dv = event.Get<CP::TDataVector>("~/digits");
+    if (!dv) {
+        event.AddDatum(new CP::TDataVector("digits"));
+        dv = event.Get<CP::TDataVector>("~/digits");
+    }
+    if (0<fScaledDigitSave && 0 != (index % fScaledDigitSave)) {
+        dv->AddTemporary(new CP::TDigitContainer(name));
+    }
+    else {
+        dv->AddDatum(new CP::TDigitContainer(name));
+    }
+    digits = event.Get<CP::TDigitContainer>(path.c_str());
+    return *digits;
+}
+
+CP::TWaveformMatrix& CP::TUBDAQInput::GetCrateMatrix(CP::TEvent& event,
+                                                     int crate,
+                                                     int channels,
+                                                     int ticks,
+                                                     int index) {
+    std::ostringstream name;
+    name << "crate" << crate;
+    CP::THandle<CP::TDataVector> dv
+        = event.Get<CP::TDataVector>("~/waveforms");
+    if (!dv) {
+        event.AddDatum(new CP::TDataVector("waveforms"));
+        dv = event.Get<CP::TDataVector>("~/waveforms");
+    }
+    CP::THandle<CP::TWaveformMatrix> matrix
+        = dv->Get<CP::TWaveformMatrix>(name.str().c_str());
+    if (!matrix) {
+        if (0<fScaledDigitSave && 0 != (index % fScaledDigitSave)) {
+            dv->AddTemporary(new CP::TWaveformMatrix(name.str().c_str()));
+        }
+        else {
+            dv->AddDatum(new CP::TWaveformMatrix(name.str().c_str()));
+        }
+        matrix = dv->Get<CP::TWaveformMatrix>(name.str().c_str());
+    }
+    matrix->Resize(channels, ticks, std::max(0,fFirstSample));
+    fProfile.Count(kCountAllocations);
+    return *matrix;
+}
+
+bool CP::TUBDAQInput::GetSampleWindow(int nSamples,
+                                      int& begin, int& end) const {
+    begin = 0;
+    end = nSamples;
+
+    // Possibly truncate some of the samples at the beginning.
+    if (fFirstSample > 0 && fFirstSample < nSamples) {
+        begin = fFirstSample;
+    }
+
+    // Possibly truncate some of the samples at the end.
+    if (fLastSample > fFirstSample && fLastSample < nSamples) {
+        end = fLastSample;
+    }
+
+    // Protect against data-mangling...
+    if (end > 9596) {
+        end = 9596;
+        return false;
+    }
+    return true;
 }
 
-int  CP::TUBDAQInput::GetPosition() const {return fEventsRead;}
+void CP::TUBDAQInput::AddTriggerDatum(CP::TEvent& event, int bits,
+                                      int frame, int sample, int number) {
+    std::auto_ptr<CP::TIntegerDatum> triggerDatum(
+        new CP::TIntegerDatum("trigger"));
+    triggerDatum->push_back(bits);
+    triggerDatum->push_back(frame);
+    triggerDatum->push_back(sample);
+    triggerDatum->push_back(number);
+    event.AddDatum(triggerDatum.release());
+}
+
+void CP::TUBDAQInput::ConvertTPCChannel(CP::TDigitContainer& drift,
+                                        CP::TChannelSummary& summary,
+                                        const CP::TChannelId& chanId,
+                                        const char* samples, int nSamples,
+                                        CP::TWaveformMatrix* matrix) {
+    int beginSamples = 0;
+    int endSamples = 0;
+    if (!GetSampleWindow(nSamples, beginSamples, endSamples)) {
+        CaptError("Truncate digit length"
+                  << " to " << endSamples
+                  << " for " << chanId);
+    }
+    nSamples = endSamples;
+
+    // Read the ADC data.
+    CP::TRawInputProfile::Timer copyTimer(&fProfile,kStageCopy);
+    CopySamples(samples,beginSamples,nSamples,fADC);
+
+    // The matrix row is copied straight from the raw samples.  A channel
+    // that is too short for the sample window doesn't start at the first
+    // column, so it's left out of the matrix instead of adding a row that
+    // could be mistaken for real samples.
+    if (matrix) {
+        if (beginSamples != matrix->GetFirstSample()) {
+            ++fShortMatrixRows;
+        }
+        else {
+            matrix->AddRow(chanId,
+                           samples + beginSamples*sizeof(UShort_t),
+                           nSamples - beginSamples);
+        }
+    }
+
+    // Summarize the samples while they are in the cache.
+    summary.Fill(chanId,fADC);
+    copyTimer.Stop();
+    fProfile.Count(kCountChannels);
+    fProfile.Count(kCountSamples, fADC.size());
+
+    // Create the digit.
+    if (fWaveformMatrix == kMatrixOnly) return;
+    CP::TRawInputProfile::Timer digitTimer(&fProfile,kStageDigits);
+    if (!fRegionFinder) {
+        AddTPCDigit(drift,chanId,beginSamples,fADC);
+        return;
+    }
+
+    // Only keep the regions of interest.  Each region is a separate digit
+    // starting at the first sample in the region.
+    fRegionFinder->Find(fADC);
+    const std::vector<CP::TPulseRegionFinder::Region>& regions
+        = fRegionFinder->GetRegions();
+    for (std::vector<CP::TPulseRegionFinder::Region>::
+             const_iterator r = regions.begin();
+         r != regions.end(); ++r) {
+        fRegion.assign(fADC.begin()+r->first, fADC.begin()+r->second);
+        AddTPCDigit(drift,chanId,beginSamples+r->first,fRegion);
+    }
+}
 
-bool CP::TUBDAQInput::IsOpen() {return fFile;}
+void CP::TUBDAQInput::WarnShortMatrixRows(int crate) {
+    if (fShortMatrixRows < 1) return;
+    CaptWarn("Crate " << crate << ": " << fShortMatrixRows
+             << " channels do not reach sample " << std::max(0,fFirstSample)
+             << " and have no waveform matrix row");
+    fShortMatrixRows = 0;
+}
+
+void CP::TUBDAQInput::CopySamples(const char* samples, int first, int last,
+                                  CP::TPulseDigit::Vector& adc) {
+    // The ADC samples (uint16_t) are saved in an array of uint8_t and may
+    // not be aligned with shorts, so they are copied as a block of bytes.
+    adc.resize(std::max(0, last-first));
+    if (adc.empty()) return;
+    const char* begin = samples + first*sizeof(UShort_t);
+    if (sizeof(CP::TPulseDigit::Vector::value_type) == sizeof(UShort_t)) {
+        std::memcpy(&adc[0], begin, adc.size()*sizeof(UShort_t));
+        return;
+    }
+
+    // The digit samples are wider than the ADC words, so the words are
+    // copied a block at a time into an aligned buffer and then widened.
+    UShort_t words[1024];
+    const std::size_t blockSize = sizeof(words)/sizeof(words[0]);
+    for (std::size_t i = 0; i < adc.size(); i += blockSize) {
+        std::size_t count = std::min(blockSize, adc.size() - i);
+        std::memcpy(words, begin + i*sizeof(UShort_t),
+                    count*sizeof(UShort_t));
+        std::copy(words, words + count, adc.begin() + i);
+    }
+}
+
+void CP::TUBDAQInput::AddTPCDigit(CP::TDigitContainer& drift,
+                                  const CP::TChannelId& chanId,
+                                  int first,
+                                  const CP::TPulseDigit::Vector& adc) {
+    fProfile.Count(kCountDigits);
+    fProfile.Count(kCountAllocations);
+    if (fCompactDigits) {
+        drift.push_back(
+            new CP::TCompactPulseDigit(
+                chanId, first, adc,
+                static_cast<CP::TCompactPulseDigit::Encoding>(
+                    fCompactDigits)));
+        return;
+    }
+    drift.push_back(new CP::TPulseDigit(chanId,first,adc));
+}
+
+void CP::TUBDAQInput::ConvertPMTCrates(
+    const gov::fnal::uboone::datatypes::eventRecord& record,
+    CP::TDigitContainer& pmt) {
+    typedef gov::fnal::uboone::datatypes::eventRecord::sebMapPMT_t crateMap;
+    typedef gov::fnal::uboone::datatypes::crateDataPMT::cardMap_t cardMap;
+    typedef gov::fnal::uboone::datatypes::cardDataPMT::channelMap_t
+        channelMap;
+    typedef gov::fnal::uboone::datatypes::channelDataPMT::windowMap_t
+        windowMap;
+
+    // The maps are walked by reference, and the samples are decoded
+    // straight out of the window data, so the only copy is into the digit.
+    bool selectChannels = !fChannelSelection.IsEmpty();
+    bool writeCache = fCache && fCache->IsWriting();
+    const crateMap& crates = record.getSEBPMTMap();
+    for (crateMap::const_iterator crate = crates.begin(); 
+         crate != crates.end();
+         ++crate) {
+        int crateNum = crate->first.getCrateNumber();
+        const cardMap& cards = crate->second.getCardMap();
+        fProfile.Count(kCountAllocations, 1 + cards.size());
+        for (cardMap::const_iterator card = cards.begin();
+             card != cards.end();
+             ++card) {
+            int cardNum = card->first.getModule();
+            const channelMap& channels = card->second.getChannelMap();
+            for (channelMap::const_iterator channel = channels.begin();
+                 channel != channels.end();
+                 ++channel) {
+                int channelNum = channel->first;
+                if (selectChannels
+                    && !fChannelSelection.ChannelSelected(crateNum,cardNum,
+                                                          channelNum)) {
+                    continue;
+                }
+                CP::TPDSChannelId chanId(crateNum,cardNum,channelNum);
+                const windowMap& windows = channel->second.getWindowMap();
+                for (windowMap::const_iterator window = windows.begin();
+                     window != windows.end();
+                     ++window) {
+                    // The window position is the readout frame (the last
+                    // three bits) and the sample in that frame.
+                    int firstSample
+                        = window->first.getFrame()*kPMTFrameSamples
+                        + window->first.getSample();
+                    int nSamples
+                        = window->second.getWindowDataSize()/sizeof(UShort_t);
+                    const char* samples = window->second.getWindowDataPtr();
+                    if (!samples || nSamples < 1) continue;
+                    if (writeCache) {
+                        fCache->AddChannel(CP::TUBDAQSampleCache::kPMT,
+                                           crateNum, cardNum, channelNum,
+                                           firstSample, samples, nSamples);
+                    }
+                    ConvertPMTWindow(pmt,chanId,firstSample,
+                                     samples,nSamples);
+                }
+            }
+        }
+    }
+}
+
+void CP::TUBDAQInput::ConvertPMTWindow(CP::TDigitContainer& pmt,
+                                       const CP::TChannelId& chanId,
+                                       int firstSample,
+                                       const char* samples, int nSamples) {
+    // The upper bits of each word are flags that mark the end of the
+    // window.  The words are copied since the window data is a char array
+    // and may not be aligned.
+    fADC.resize(nSamples);
+    for (int i=0; i<nSamples; ++i) {
+        UShort_t word;
+        std::memcpy(&word, samples+i*sizeof(UShort_t), sizeof(UShort_t));
+        fADC[i] = word & 0x0FFF;
+    }
+
+    pmt.push_back(new TPulseDigit(chanId,firstSample,fADC));
+    fProfile.Count(kCountChannels);
+    fProfile.Count(kCountSamples, nSamples);
+    fProfile.Count(kCountDigits);
+    fProfile.Count(kCountAllocations);
+}
+
+int  CP::TUBDAQInput::GetPosition() const {
+    if (fEventCache) return fEventCacheNext;
+    return fEventsRead;
+}
+
+bool CP::TUBDAQInput::IsOpen() {
+    if (fFollow) return fFollow->IsOpen();
+    return fRawFile && fRawFile->IsOpen();
+}
 
 bool CP::TUBDAQInput::EndOfFile() {
+    if (IsReadingCache()) return fCacheEvent >= fCache->GetEventCount();
+    if (fEventCache) return fEventCacheEnd;
+    if (!fFile) return true;
+    if (fEndCaboose) return true;
     return fFile->eof() || fFile->fail();
 }
 
 void CP::TUBDAQInput::CloseFile() {
-    if (fFile) {
-        delete fFile;
-        fFile = NULL;
+    // The read ahead is stopped before the file is closed.
+    if (fEventCache) {
+        delete fEventCache;
+        fEventCache = NULL;
+    }
+    fProfile.PrintSummary();
+    FinishRecord();
+    if (fCache) {
+        AbandonCache("file not finished");
+        delete fCache;
+        fCache = NULL;
     }
+    CloseStreams();
 }
 
@@ -2,20 +2,86 @@
 #define TUBDAQInput_hxx_seen
 
 #include <ECore.hxx>
-#include <TVInputFile.hxx>
+#include <TVRawInput.hxx>
+#include <TEventContext.hxx>
+#include <TUBDAQChannelSelection.hxx>
+#include <TPulseDigit.hxx>
+#include <TRawInputProfile.hxx>
+#include <TUBDAQEventCache.hxx>
+#include <TInflateStreamBuf.hxx>
 
 #include <boost/archive/binary_iarchive.hpp>
 
 #include <string>
 #include <istream>
+#include <vector>
 
 namespace CP {
+    /// The channel selection in the builder arguments can't be parsed.
+    EXCEPTION(EUBDAQChannelSelection,EInputFile);
+
     class TUBDAQInput;
+    class TCountingStreamBuf;
+    class TFollowStreamBuf;
+    class TRawStreamBuf;
+    class TDigitContainer;
+    class TPulseRegionFinder;
+    class TChannelSummary;
+    class TUBDAQSampleCache;
+    class TWaveformMatrix;
 };
 
+namespace gov {
+    namespace fnal {
+        namespace uboone {
+            namespace datatypes {
+                class eventRecord;
+            }
+        }
+    }
+}
+
 
-/// A class to 
-class  CP::TUBDAQInput : public CP::TVInputFile {
+/// A class to read files written by the uboone DAQ.  Each event in the
+/// file is a separate boost binary archive holding an eventRecord.  The
+/// global header and trigger data are at the front of the record, so the
+/// event context can be found (see PeekContext()) without reading the crate
+/// data.
+///
+/// The TPC crates are converted into TPulseDigits in "~/digits/drift".  When
+/// the PMTs are read out through the SEBs, each PMT readout window is
+/// converted into a TPulseDigit in "~/digits/pmt" (with a TPDSChannelId of
+/// crate, card and channel), so a separate PDS file isn't needed.
+///
+/// The trigger data is added to the event as a TIntegerDatum named
+/// "trigger" holding the trigger bits (see
+/// triggerData::getTriggerBits()), the trigger frame, the 64 MHz sample
+/// number, and the trigger event number.  Records can be selected by
+/// trigger type (see SetTriggerSelection()) before any crate data is read.
+///
+/// The TPC digits can be saved as TCompactPulseDigits instead of
+/// TPulseDigits (see SetCompactDigits()) to reduce the size of the event in
+/// memory and in the output file.  The TPC digits can also be limited to
+/// the regions of interest (see SetRegionsOfInterest()) so that the noise
+/// between the signals isn't saved.
+///
+/// The pedestal, RMS, range, saturation and stuck bits of every converted
+/// TPC channel are saved in a TChannelSummary named "channelSummary" so
+/// that the data quality can be checked without the digits.
+///
+/// The TPC samples of each crate can also be saved as a TWaveformMatrix in
+/// "~/waveforms/crate<n>" (see SetWaveformMatrix()), which is filled while
+/// the crate is decoded, so that downstream processing can work on one
+/// aligned block of samples instead of a TPulseDigit for each channel.
+///
+/// The decoded samples can be kept in a cache on disk (see
+/// SetSampleCache()) so that converting the same file again doesn't need to
+/// inflate, unpack and decode the raw records.  For an event display, the
+/// recently decoded records can be kept in memory (see SetEventCache()) so
+/// that ReadEvent() and PreviousEvent() can move around the file without
+/// decoding each event again.
+class  CP::TUBDAQInput : public CP::TVRawInput,
+                         private CP::TUBDAQEventCache::Source {
 public:
 
     /// Open an file written in ubdaq format (microboone DAQ format).  The
@@ -27,7 +93,21 @@ public:
     /// range, but -tubdaq(2800,3800) only converts the 500 us right around
     /// the trigger time (assuming we are using a 4.5 ms sampling period and
     /// the trigger is at sample 3200.
-    TUBDAQInput(const char* fName, int first =-1, int last=-1, int scale=-1);
+    ///
+    /// The file name "-" reads the standard input, and a named pipe can be
+    /// read like a file.  A compressed file is recognized by the gzip magic
+    /// number, so the name doesn't need to end in ".gz".
+    ///
+    /// If follow is not zero, the file is being written by the DAQ and the
+    /// input waits for new event records instead of stopping at the end of
+    /// the file.  The input stops when the DAQ closes the file (or had
+    /// already closed it when the input was opened) or writes the end
+    /// caboose (see TUBDAQCaboose).  A positive value is an idle timeout in
+    /// seconds.  This is controlled with -tubdaq(follow) or
+    /// -tubdaq(follow=60), and only works for uncompressed files.  A
+    /// compressed file is read once without following it.
+    TUBDAQInput(const char* fName, int first =-1, int last=-1, int scale=-1,
+                int follow=0);
     virtual ~TUBDAQInput(); 
 
     /// Return the first event in the input file.  If the file does not
@@ -38,7 +118,31 @@ public:
     /// Get the next event from the input file.  If skip is greater than zero,
     /// then skip this many events before returning.
     virtual CP::TEvent* NextEvent(int skip=0);
+
+    /// Get the event before the last one that was read.  If skip is
+    /// greater than zero, then skip back this many more events.  The input
+    /// selection isn't applied.  See ReadEvent().
+    virtual CP::TEvent* PreviousEvent(int skip=0);
+
+    /// Read the n'th record in the file (counted from zero), or return
+    /// NULL if there isn't one.  The input and trigger selections aren't
+    /// applied.  The records are found by moving back to a record that was
+    /// already passed, or forward through the file, and each record is
+    /// decoded again unless the event cache is used (see SetEventCache()).
+    /// A compressed file is read again from the start to move backward to
+    /// a record that isn't in the cache.
+    CP::TEvent* ReadEvent(int n);
     
+    /// Read the next record that passes the input and trigger selections
+    /// without converting it.  The crates that aren't in the channel
+    /// selection are left out of the record, and the crates that are kept
+    /// are still at the crate granularity, but know which cards are
+    /// selected (see crateData::setCardSelection()).  The caller owns the
+    /// record.  This returns NULL at the end of the file, and can't be
+    /// used with the sample or event caches.  It's used to skim the raw
+    /// records into a new file (see TUBDAQWriter).
+    gov::fnal::uboone::datatypes::eventRecord* NextRecord();
+
     /// Return the position of the event just read inside of the file.  A
     /// position of zero is the first event.  After reading the last event,
     /// the position will be the total number of events in the file.  This is
@@ -54,17 +158,407 @@ public:
     /// Close the input file.
     virtual void CloseFile();
 
+    /// Fill the context of the next event using only the global header.
+    /// The crate data for the event is not read.
+    virtual bool PeekContext(CP::TEventContext& context);
+
+    /// Skip the next event.  The crate data is passed over using the sizes
+    /// in the record without being copied or unpacked.
+    virtual void SkipEvent();
+
     /// Get the name of this file
     const char* GetFilename()  const { return fFilename.c_str();  } 
 
+    /// Set the crates, cards and channels to convert.  The crates and
+    /// cards that aren't selected are passed over without being unpacked.
+    /// This is controlled from the command line using the builder
+    /// arguments (e.g. -tubdaq(crates=1-2,cards=7-12)).  See
+    /// TUBDAQChannelSelection.
+    void SetChannelSelection(const CP::TUBDAQChannelSelection& selection) {
+        fChannelSelection = selection;
+    }
+
+    /// Get the crates, cards and channels being converted.
+    const CP::TUBDAQChannelSelection& GetChannelSelection() const {
+        return fChannelSelection;
+    }
+
+    /// Only convert records with one of the trigger bits in mask (see
+    /// triggerData::getTriggerBits()).  The decision is made from the
+    /// trigger data at the front of the record, so the crate data for the
+    /// other records is passed over without being copied or unpacked.  A
+    /// mask of zero converts every record.  This is controlled from the
+    /// command line with -tubdaq(trigger=calib) or
+    /// -tubdaq(trigger=bnb|numi).  See ParseTriggerSelection().
+    void SetTriggerSelection(int mask) {fTriggerSelection = mask;}
+
+    /// Get the trigger bits being selected.
+    int GetTriggerSelection() const {return fTriggerSelection;}
+
+    /// Get the trigger bits for the next record.  This is only valid after
+    /// PeekContext() has returned true, and is -1 if the record doesn't
+    /// have trigger data.
+    int GetTriggerBits() const {return fTriggerBits;}
+
+    /// Check if a record with the trigger bits passes a trigger selection.
+    static bool TriggerSelected(int mask, int bits) {
+        if (mask == 0) return true;
+        return bits > 0 && (bits & mask) != 0;
+    }
+
+    /// Save the TPC digits as TCompactPulseDigits using an encoding (see
+    /// TCompactPulseDigit::Encoding).  An encoding of zero saves
+    /// TPulseDigits.  This is controlled from the command line with
+    /// -tubdaq(compact) for the Huffman encoding, or -tubdaq(compact=packed)
+    /// for 12 bit packed samples.
+    void SetCompactDigits(int encoding) {fCompactDigits = encoding;}
+
+    /// Get the encoding used for the TPC digits, or zero for TPulseDigits.
+    int GetCompactDigits() const {return fCompactDigits;}
+
+    /// Parse the compact digit encoding from the arguments given to a
+    /// ubdaq style input builder (e.g. "ubdaq(compact=packed)").  This
+    /// returns zero if compact digits were not requested.
+    static int ParseCompactDigits(const std::string& args);
+
+    /// The ways the TPC samples can be saved.
+    enum WaveformMatrix {
+        kDigitsOnly = 0,        // Only save the TPC digits.
+        kMatrixAndDigits = 1,   // Save a waveform matrix and the digits.
+        kMatrixOnly = 2         // Only save a waveform matrix.
+    };
+
+    /// Save the TPC samples of each crate as a TWaveformMatrix in
+    /// "~/waveforms/crate<n>".  The matrix has a row for each selected
+    /// channel that reaches the start of the sample window (a channel that
+    /// is too short is left out with a warning), and holds the whole
+    /// sample window even when only the regions of interest are saved as
+    /// digits.  With kMatrixOnly the TPC digits aren't made, but the
+    /// channel summary is still filled.  This is controlled from the
+    /// command line with -tubdaq(matrix), or with -tubdaq(matrix=only) to
+    /// skip the digits.
+    void SetWaveformMatrix(int mode) {fWaveformMatrix = mode;}
+
+    /// Get the way the TPC samples are saved.
+    int GetWaveformMatrix() const {return fWaveformMatrix;}
+
+    /// Parse the waveform matrix mode from the arguments given to a ubdaq
+    /// style input builder (e.g. "ubdaq(matrix=only)").  This returns
+    /// kDigitsOnly if a matrix was not requested.
+    static int ParseWaveformMatrix(const std::string& args);
+
+    /// Only save the regions of the TPC waveforms that are over a threshold
+    /// (in units of the channel noise), plus padding samples on each side.
+    /// Each region is saved as a separate digit.  The baseline and noise
+    /// are found separately for each channel and event (see
+    /// TPulseRegionFinder).  A threshold of zero saves the full waveforms.
+    /// This is controlled from the command line with -tubdaq(roi) for a
+    /// five sigma threshold, or -tubdaq(roi=4,roipad=20).
+    void SetRegionsOfInterest(double threshold, int padding);
+
+    /// Parse the region of interest threshold and padding from the
+    /// arguments given to a ubdaq style input builder.  This returns false
+    /// if regions of interest were not requested.
+    static bool ParseRegionArguments(const std::string& args,
+                                     double& threshold, int& padding);
+
+    /// Parse the trigger selection from the arguments given to a ubdaq
+    /// style input builder (e.g. "ubdaq(trigger=ext|calib)").  The trigger
+    /// types are pmt, ext, active, bnb, numi, veto and calib, or a number
+    /// giving the bits.  This returns zero if there isn't a trigger
+    /// selection.
+    static int ParseTriggerSelection(const std::string& args);
+
+    /// Parse the arguments given to a ubdaq style input builder
+    /// (e.g. "ubdaq(2800,3800,temp=100)") into the first and last sample,
+    /// and the digit save scaling.  Values that aren't given are set to -1.
+    static void ParseBuilderArguments(const std::string& args,
+                                      int& first, int& last, int& scaling);
+
+    /// Keep the decoded samples in a cache file in the directory (see
+    /// TUBDAQSampleCache).  If there is a cache for this file, the events
+    /// are made from the cache and the raw file isn't read.  Otherwise, the
+    /// cache is written while the file is converted, and is kept if every
+    /// record in the file was converted.  This must be called before the
+    /// first event is read, and doesn't work for a followed file or the
+    /// standard input.  An empty directory turns off the cache.  This is
+    /// controlled from the command line with -tubdaq(cache=<directory>), or
+    /// -tubdaq(cache) for the directory in the CAPTTRANS_CACHE environment
+    /// variable (or "capttrans-cache").
+    ///
+    /// The cache needs two bytes of disk for every sample, so it's several
+    /// times bigger than the raw file.  A cache that would be bigger than
+    /// megabytes isn't written (zero doesn't limit the size).  The limit
+    /// is set with -tubdaq(cache,cachemax=<MB>), and is 8 GB by default.
+    void SetSampleCache(const std::string& directory,
+                        double megabytes = 8192);
+
+    /// Flag that the events are being made from a sample cache.
+    bool IsReadingCache() const;
+
+    /// Keep the most recently decoded records in memory (up to megabytes),
+    /// and decode the next readAhead records in the background (see
+    /// TUBDAQEventCache).  This is meant for interactive use where the
+    /// same events are looked at again, and NextEvent(), PreviousEvent()
+    /// and ReadEvent() are then served from the cache.  The sample cache
+    /// (see SetSampleCache()) isn't written while the event cache is used.
+    /// A size of zero turns off the cache.  This is controlled from the
+    /// command line with -tubdaq(lru=<MB>,ahead=<n>), where the default is
+    /// a 256 MB cache that reads 4 records ahead.  The cache is only used
+    /// when it's asked for.
+    void SetEventCache(double megabytes, int readAhead);
+
+    /// Parse the event cache size (in MB) and read ahead from the arguments
+    /// given to a ubdaq style input builder.  This returns false if the
+    /// event cache was not requested.
+    static bool ParseEventCacheArguments(const std::string& args,
+                                         double& megabytes, int& readAhead);
+
+    /// Parse the sample cache directory and size limit (in MB) from the
+    /// arguments given to a ubdaq style input builder.  This returns false
+    /// if the cache was not requested.
+    static bool ParseCacheArguments(const std::string& args,
+                                    std::string& directory,
+                                    double& megabytes);
+
+    /// Get the offset of the next record in the file.  If the record has
+    /// been peeked, this is the offset of the peeked record.  For a
+    /// compressed file, the offset is in the decompressed stream.
+    std::streamoff GetRecordOffset() const;
+
+    /// Position the file so that the next record read starts at offset
+    /// (which must have come from GetRecordOffset()).  A compressed file
+    /// is decompressed from the last inflate checkpoint before the record
+    /// (see SetInflateCheckpoints()), or else from the current position
+    /// (moving forward) or the start of the file (moving backward).  This
+    /// returns false if the record can't be reached.
+    bool SeekRecord(std::streamoff offset);
+
+    /// Save an inflate checkpoint each time this many bytes of a compressed
+    /// file are decompressed (see TInflateStreamBuf).  This must be set
+    /// before the file is read, and is used by capt-catalog.
+    void SetCheckpointSpacing(std::streamoff spacing);
+
+    /// Get the inflate checkpoints saved while a compressed file was read.
+    void GetInflateCheckpoints(
+        std::vector<CP::TInflateStreamBuf::Checkpoint>& checkpoints) const;
+
+    /// Set the inflate checkpoints for a compressed file so that
+    /// SeekRecord() doesn't need to decompress the file from the start.
+    /// The checkpoints must have been saved from the same file, and must
+    /// be sorted by position.
+    void SetInflateCheckpoints(
+        const std::vector<CP::TInflateStreamBuf::Checkpoint>& checkpoints) {
+        fCheckpoints = checkpoints;
+    }
+
+    /// Get the profile of the time spent reading the file (see
+    /// TRawInputProfile).
+    CP::TRawInputProfile& GetProfile() {return fProfile;}
+
+    /// Copy the 16 bit ADC samples from first up to (but not including)
+    /// last out of the channel data into adc.  The channel data is a char
+    /// array, so the samples may not be aligned.  This is used to convert
+    /// each TPC channel, and is public so that it can be benchmarked.
+    static void CopySamples(const char* samples, int first, int last,
+                            CP::TPulseDigit::Vector& adc);
+
 private:
 
+    /// The stages timed by the profile.
+    enum {
+        kStageRead,          // Reading (and inflating) the file.
+        kStageDeserialize,   // Reading the boost archive.
+        kStageUnpack,        // Unpacking the crates into channels.
+        kStageEvent,         // Making the event and containers.
+        kStageCopy,          // Copying and summarizing the samples.
+        kStageDigits,        // Making the TPC digits.
+        kStagePMT,           // Making the PMT digits.
+        kStageCache          // Writing the sample cache.
+    };
+
+    /// The counters kept by the profile.
+    enum {
+        kCountBytesIn,       // Bytes read from the file.
+        kCountBytesOut,      // Bytes in the decompressed records.
+        kCountSkipped,       // Records that were skipped.
+        kCountChannels,      // Channels converted.
+        kCountSamples,       // Samples converted.
+        kCountDigits,        // Digits made.
+        kCountAllocations,   // Crate and card buffers, and digits.
+        kCountCached         // Events made from the sample cache.
+    };
+
+    /// Add the bytes read since the last call to the profile.
+    void CountBytes();
+
+    /// Read the leading part of the next record (up to the crate data) and
+    /// fill the context.  This returns false at the end of the file.
+    bool ReadRecordHead();
+
+    /// Read the crate data for the record that was started by
+    /// ReadRecordHead().  If skip is true, the crate data is passed over.
+    void ReadRecordCrates(bool skip);
+
+    /// Read the leading part of the next record that passes the input and
+    /// trigger selections.  The records that aren't selected are skipped.
+    /// This returns false at the end of the file.
+    bool ReadSelectedHead();
+
+    /// Clear the state for the record that was just read or skipped.
+    void FinishRecord();
+
+    /// Open the file (or start following it).
+    void OpenStreams(int follow);
+
+    /// Close the file.
+    void CloseStreams();
+
+    /// Open the file again so that it's read from the start.  This
+    /// returns false if the file can't be read again (e.g. it's a pipe).
+    bool Rewind();
+
+    /// Restart the decompression at the last inflate checkpoint before
+    /// offset if that's closer than the current position.  This returns
+    /// false if the file wasn't moved.
+    bool ResumeInflate(std::streamoff offset);
+
+    /// Position the file at a record (counted from zero).  This returns
+    /// false if there isn't a record at the index.
+    bool MoveToRecord(int index);
+
+    /// Decode a record for the event cache.  This is the
+    /// TUBDAQEventCache::Source interface.
+    virtual bool DecodeRecord(int index, CP::TUBDAQEventCache::Record& record);
+
+    /// Make an event from the event cache starting at the record at index.
+    /// If select is true, records are passed over until one is in the
+    /// input and trigger selections.
+    CP::TEvent* ReadCachedEvent(int index, bool select);
+
+    /// Set the time of the context from the SEB clocks.  This is used when
+    /// the global header doesn't have the time.
+    void SetCrateTime(
+        const gov::fnal::uboone::datatypes::eventRecord& record,
+        CP::TEventContext& context);
+
+    /// Fill a sample cache event entry for a record.
+    void FillEventEntry(
+        gov::fnal::uboone::datatypes::eventRecord& record,
+        const CP::TEventContext& context, int triggerBits,
+        std::streamoff recordOffset,
+        CP::TUBDAQSampleCache::EventEntry& entry);
+
+    /// Fill the context from a sample cache event entry.
+    void FillContext(const CP::TUBDAQSampleCache::EventEntry& entry,
+                     CP::TEventContext& context);
+
+    /// Make the event for the record at index from the decoded samples.
+    /// The channel offsets are from the start of data.
+    CP::TEvent* MakeEvent(const CP::TUBDAQSampleCache::EventEntry& entry,
+                          const CP::TUBDAQSampleCache::ChannelEntry* channels,
+                          const char* data, int index);
+
+    /// Fill the context for the next event in the sample cache.  This
+    /// returns false after the last cached event.
+    bool ReadCacheHead();
+
+    /// Make the next event in the sample cache.
+    CP::TEvent* NextCachedEvent();
+
+    /// Stop writing the sample cache (e.g. because a record was skipped).
+    void AbandonCache(const char* reason);
+
+    /// Get a digit container in "~/digits", and create it if it doesn't
+    /// exist.  The container is temporary when the digits aren't being
+    /// saved for the record at index.
+    CP::TDigitContainer& GetDigitContainer(CP::TEvent& event,
+                                           const char* name, int index);
+
+    /// Add the "trigger" datum to the event.
+    void AddTriggerDatum(CP::TEvent& event, int bits, int frame,
+                         int sample, int number);
+
+    /// Get the waveform matrix for a crate in "~/waveforms", and create it
+    /// with room for the channels and ticks.  The matrix is temporary when
+    /// the digits aren't being saved for the record at index.
+    CP::TWaveformMatrix& GetCrateMatrix(CP::TEvent& event, int crate,
+                                        int channels, int ticks,
+                                        int index);
+
+    /// Apply the sample window to a TPC channel with nSamples samples.
+    /// This returns false if the end was cut to protect against a mangled
+    /// channel.
+    bool GetSampleWindow(int nSamples, int& begin, int& end) const;
+
+    /// Convert the samples for a TPC channel into digits, and summarize
+    /// them.  The sample window is applied here.  The samples are also
+    /// copied into the next row of the matrix when it isn't NULL.
+    void ConvertTPCChannel(CP::TDigitContainer& drift,
+                           CP::TChannelSummary& summary,
+                           const CP::TChannelId& chanId,
+                           const char* samples, int nSamples,
+                           CP::TWaveformMatrix* matrix = NULL);
+
+    /// Warn once about the channels of a crate that were too short to be
+    /// added to the waveform matrix, and reset the count.
+    void WarnShortMatrixRows(int crate);
+
+    /// Convert the words in a PMT readout window into a digit.
+    void ConvertPMTWindow(CP::TDigitContainer& pmt,
+                          const CP::TChannelId& chanId,
+                          int firstSample,
+                          const char* samples, int nSamples);
+
+    /// Convert the PMT readout windows in the record into digits.  The
+    /// first sample of each digit is counted from the start of the readout
+    /// frame number given in the window header (modulo 8).
+    void ConvertPMTCrates(
+        const gov::fnal::uboone::datatypes::eventRecord& record,
+        CP::TDigitContainer& pmt);
+
+    /// Add a TPC digit to the container.  This makes a TCompactPulseDigit
+    /// or a TPulseDigit.
+    void AddTPCDigit(CP::TDigitContainer& drift,
+                     const CP::TChannelId& chanId,
+                     int first,
+                     const CP::TPulseDigit::Vector& adc);
+
+    /// The number of samples in a PMT readout frame (1.6 ms at 64 MHz).
+    static const int kPMTFrameSamples = 102400;
+
     /// name of the currently open file
     std::string fFilename; 
 
+    /// The file being read.
+    CP::TRawStreamBuf* fRawFile;
+
+    /// The decompression buffer when the file is compressed, otherwise
+    /// NULL.
+    CP::TInflateStreamBuf* fInflate;
+
+    /// The decompressed bytes between the inflate checkpoints that are
+    /// saved, or zero.
+    std::streamoff fCheckpointSpacing;
+
+    /// The inflate checkpoints for the file.
+    std::vector<CP::TInflateStreamBuf::Checkpoint> fCheckpoints;
+
+    /// The buffer for a file that is being followed, otherwise NULL.
+    CP::TFollowStreamBuf* fFollow;
+
+    /// Flag that the end caboose has been read.
+    bool fEndCaboose;
+
+    /// The buffer that counts the position in the (decompressed) file.
+    CP::TCountingStreamBuf* fBuffer;
+
     /// The input stream attached to the file.
     std::istream* fFile;
 
+    /// The offset of the record currently being read.
+    std::streamoff fRecordOffset;
+
     /// The detector type
     std::string fDetector;
     
@@ -84,5 +578,81 @@ private:
     /// digits for the first event are always saved.  A value of -1 says to
     /// always save the digits.
     int fScaledDigitSave;
+
+    /// The archive for the record currently being read.  This is only valid
+    /// between ReadRecordHead() and FinishRecord().
+    boost::archive::binary_iarchive* fArchive;
+
+    /// The record currently being read.
+    gov::fnal::uboone::datatypes::eventRecord* fRecord;
+
+    /// The eventRecord class version for the current record.
+    unsigned int fRecordVersion;
+
+    /// The context of the record currently being read.
+    CP::TEventContext fContext;
+
+    /// The crates, cards and channels to convert.
+    CP::TUBDAQChannelSelection fChannelSelection;
+
+    /// The trigger bits to select, or zero for every record.
+    int fTriggerSelection;
+
+    /// The trigger bits of the record currently being read, or -1 if it
+    /// doesn't have trigger data.
+    int fTriggerBits;
+
+    /// The encoding for compact TPC digits, or zero for TPulseDigits.
+    int fCompactDigits;
+
+    /// The way the TPC samples are saved (see SetWaveformMatrix()).
+    int fWaveformMatrix;
+
+    /// The region finder when only the regions of interest are saved,
+    /// otherwise NULL.
+    CP::TPulseRegionFinder* fRegionFinder;
+
+    /// True if the context has a time stamp from the global header.
+    bool fContextHasTime;
+
+    /// The number of missing detector type errors left to print.
+    int fErrorThrottle;
+
+    /// The number of channels in the current crate that were too short for
+    /// the waveform matrix.
+    int fShortMatrixRows;
+
+    /// The sample cache being read or written, otherwise NULL.
+    CP::TUBDAQSampleCache* fCache;
+
+    /// The index of the next event in a sample cache being read.
+    int fCacheEvent;
+
+    /// The recently decoded records, or NULL.
+    CP::TUBDAQEventCache* fEventCache;
+
+    /// The index of the next record to get from the event cache.
+    int fEventCacheNext;
+
+    /// Flag that the end of the file was found through the event cache.
+    bool fEventCacheEnd;
+
+    /// The offsets of the records that have been found in the file.
+    std::vector<std::streamoff> fRecordOffsets;
+
+    /// The buffers for the samples of the channel being converted.
+    CP::TPulseDigit::Vector fADC;
+    CP::TPulseDigit::Vector fRegion;
+
+    /// The profile of the time spent reading the file.
+    CP::TRawInputProfile fProfile;
+
+    /// The position in the file (before decompression) when the bytes
+    /// were last counted.
+    std::streamoff fLastRawPosition;
+
+    /// The position in the decompressed file when the bytes were last
+    /// counted.
+    std::streamoff fLastPosition;
 };
 #endif
@@ -0,0 +1,368 @@
+#include "TUBDAQListInput.hxx"
+#include "TUBDAQInput.hxx"
+#include "TCatalogInput.hxx"
+#include "TRawCatalog.hxx"
+#include "TRawInputTrace.hxx"
+
+#include <TEvent.hxx>
+#include <TCaptLog.hxx>
+#include <TEventContext.hxx>
+#include <TManager.hxx>
+#include <TInputManager.hxx>
+
+#include <future>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <exception>
+#include <set>
+
+#include <glob.h>
+
+namespace {
+    class TUBDAQListInputBuilder : public CP::TVInputBuilder {
+    public:
+        TUBDAQListInputBuilder() 
+            : CP::TVInputBuilder("ubdaqlist",
+                                 "Read a list of uboone DAQ files"
+                                 " [a,b,c or glob or @list or catalog:...]"
+                                 " [ubdaqlist(trigger=ext|calib|...)]"
+                                 " [ubdaqlist(compact[=packed])]"
+                                 " [ubdaqlist(matrix[=only])]"
+                                 " [ubdaqlist(roi[=sigma],roipad=n)]"
+                                 " [ubdaqlist(cache[=dir],cachemax=MB)]"){}
+        CP::TVInputFile* Open(const char* file) const {
+            int first = -1;
+            int last = -1;
+            int scaling = -1;
+            CP::TUBDAQInput::ParseBuilderArguments(GetArguments(),
+                                                   first, last, scaling);
+            CP::TUBDAQChannelSelection selection;
+            if (!selection.Parse(GetArguments())) {
+                CaptError("Invalid channel selection for " << file
+                          << ": " << GetArguments());
+                throw CP::EUBDAQChannelSelection();
+            }
+            CP::TUBDAQListInput* input
+                = new CP::TUBDAQListInput(file,first,last,scaling);
+            input->SetChannelSelection(selection);
+            input->SetTriggerSelection(
+                CP::TUBDAQInput::ParseTriggerSelection(GetArguments()));
+            input->SetCompactDigits(
+                CP::TUBDAQInput::ParseCompactDigits(GetArguments()));
+            input->SetWaveformMatrix(
+                CP::TUBDAQInput::ParseWaveformMatrix(GetArguments()));
+            double threshold = 0;
+            int padding = 0;
+            if (CP::TUBDAQInput::ParseRegionArguments(
+                    GetArguments(), threshold, padding)) {
+                input->SetRegionsOfInterest(threshold,padding);
+            }
+            std::string cache;
+            double cacheLimit = 0;
+            if (CP::TUBDAQInput::ParseCacheArguments(GetArguments(),
+                                                     cache, cacheLimit)) {
+                input->SetSampleCache(cache, cacheLimit);
+            }
+            return input;
+        }
+    };
+
+    class TUBDAQListInputRegistration {
+    public:
+        TUBDAQListInputRegistration() {
+            CP::TManager::Get().Input().Register(
+                new TUBDAQListInputBuilder());
+        }
+    };
+    TUBDAQListInputRegistration registrationObject;
+}
+
+class CP::TUBDAQListInput::Prefetch {
+public:
+    /// The index in fFiles of the file being opened.
+    std::size_t Index;
+
+    /// The opened file.
+    std::future<CP::TUBDAQInput*> Result;
+};
+
+CP::TUBDAQListInput::TUBDAQListInput(const char* name,
+                                     int first, int last, int scale)
+    : fFilename(name), fNextFile(0), fCurrent(NULL), fPrefetch(NULL),
+      fEventsRead(0), fFinished(false),
+      fFirstSample(first), fLastSample(last), fScaledDigitSave(scale),
+      fTriggerSelection(0), fCompactDigits(0), fWaveformMatrix(0),
+      fRegionThreshold(0), fRegionPadding(0), fCacheLimit(0) {
+    ExpandName();
+    CaptLog("UBDAQ list " << fFilename << ": " << fFiles.size() << " files");
+    if (!fFiles.empty()) StartPrefetch(0);
+}
+
+CP::TUBDAQListInput::~TUBDAQListInput() {
+    CloseFile();
+}
+
+void CP::TUBDAQListInput::SetChannelSelection(
+    const CP::TUBDAQChannelSelection& selection) {
+    fChannelSelection = selection;
+    if (fCurrent) fCurrent->SetChannelSelection(selection);
+}
+
+void CP::TUBDAQListInput::SetTriggerSelection(int mask) {
+    fTriggerSelection = mask;
+    if (fCurrent) fCurrent->SetTriggerSelection(mask);
+}
+
+void CP::TUBDAQListInput::SetCompactDigits(int encoding) {
+    fCompactDigits = encoding;
+    if (fCurrent) fCurrent->SetCompactDigits(encoding);
+}
+
+void CP::TUBDAQListInput::SetWaveformMatrix(int mode) {
+    fWaveformMatrix = mode;
+    if (fCurrent) fCurrent->SetWaveformMatrix(mode);
+}
+
+void CP::TUBDAQListInput::SetRegionsOfInterest(double threshold,
+                                               int padding) {
+    fRegionThreshold = threshold;
+    fRegionPadding = padding;
+    if (fCurrent) fCurrent->SetRegionsOfInterest(threshold,padding);
+}
+
+void CP::TUBDAQListInput::SetSampleCache(const std::string& directory,
+                                         double megabytes) {
+    fCacheDirectory = directory;
+    fCacheLimit = megabytes;
+    if (fCurrent) fCurrent->SetSampleCache(directory, megabytes);
+}
+
+void CP::TUBDAQListInput::ExpandName() {
+    fFiles.clear();
+
+    // The files holding events selected from a catalog.
+    if (CP::TCatalogInput::IsCatalogName(fFilename)) {
+        std::string catalogFile;
+        std::string selectionString;
+        if (!CP::TCatalogInput::SplitName(fFilename,
+                                          catalogFile,selectionString)) {
+            CaptError("No catalog file for " << fFilename);
+            return;
+        }
+        CP::TRawCatalog::Selection selection;
+        if (!selection.Parse(selectionString)) return;
+        CP::TRawCatalog catalog;
+        if (!catalog.Read(catalogFile)) return;
+        std::vector<CP::TRawCatalog::Entry> found;
+        catalog.Find(selection,found);
+        std::set<std::string> names;
+        for (std::vector<CP::TRawCatalog::Entry>::iterator e = found.begin();
+             e != found.end(); ++e) {
+            if (catalog.GetFileType(e->File) != CP::TRawCatalog::kUBDAQ) {
+                continue;
+            }
+            names.insert(catalog.GetFileName(e->File));
+        }
+        fFiles.assign(names.begin(),names.end());
+        return;
+    }
+
+    // A text file with one file name per line.
+    if (!fFilename.empty() && fFilename[0] == '@') {
+        std::ifstream list(fFilename.substr(1).c_str());
+        if (!list.is_open()) {
+            CaptError("Cannot open file list: " << fFilename.substr(1));
+            return;
+        }
+        std::string line;
+        while (std::getline(list,line)) {
+            std::size_t begin = line.find_first_not_of(" \t");
+            if (begin == std::string::npos) continue;
+            if (line[begin] == '#') continue;
+            std::size_t end = line.find_last_not_of(" \t\r");
+            fFiles.push_back(line.substr(begin,end-begin+1));
+        }
+        return;
+    }
+
+    // A glob pattern.  The matches are sorted.
+    if (fFilename.find_first_of("*?[") != std::string::npos) {
+        glob_t matches;
+        if (glob(fFilename.c_str(), 0, NULL, &matches) == 0) {
+            for (std::size_t i = 0; i < matches.gl_pathc; ++i) {
+                fFiles.push_back(matches.gl_pathv[i]);
+            }
+        }
+        else {
+            CaptError("No files match " << fFilename);
+        }
+        globfree(&matches);
+        return;
+    }
+
+    // A comma separated list.
+    std::istringstream names(fFilename);
+    std::string name;
+    while (std::getline(names,name,',')) {
+        if (!name.empty()) fFiles.push_back(name);
+    }
+}
+
+CP::TUBDAQInput* CP::TUBDAQListInput::OpenFile(std::string name,
+                                               int first, int last,
+                                               int scale) {
+    CP::TRawInputTrace::Span span("open", "ubdaqlist");
+    std::auto_ptr<CP::TUBDAQInput> input(
+        new CP::TUBDAQInput(name.c_str(),first,last,scale));
+    if (!input->IsOpen()) return NULL;
+    // The list applies the input selection.
+    input->ApplyInputSelection(false);
+    // Peeking reads the first record header, which fills the input buffer
+    // and starts the decompression.
+    CP::TEventContext context;
+    input->PeekContext(context);
+    return input.release();
+}
+
+CP::TUBDAQInput* CP::TUBDAQListInput::PrefetchFile(std::string name,
+                                                   int first, int last,
+                                                   int scale) {
+    CP::TRawInputTrace::SetThreadName("ubdaqlist prefetch");
+    return OpenFile(name, first, last, scale);
+}
+
+void CP::TUBDAQListInput::StartPrefetch(std::size_t index) {
+    CancelPrefetch();
+    if (index >= fFiles.size()) return;
+    fPrefetch = new Prefetch;
+    fPrefetch->Index = index;
+    fPrefetch->Result = std::async(std::launch::async,
+                                   &CP::TUBDAQListInput::PrefetchFile,
+                                   fFiles[index],
+                                   fFirstSample, fLastSample,
+                                   fScaledDigitSave);
+}
+
+void CP::TUBDAQListInput::CancelPrefetch() {
+    if (!fPrefetch) return;
+    try {
+        delete fPrefetch->Result.get();
+    }
+    catch (...) {
+        // The file wasn't going to be used anyway.
+    }
+    delete fPrefetch;
+    fPrefetch = NULL;
+}
+
+bool CP::TUBDAQListInput::NextFile() {
+    if (fCurrent) {
+        delete fCurrent;
+        fCurrent = NULL;
+    }
+    while (fNextFile < fFiles.size()) {
+        std::size_t index = fNextFile++;
+        CP::TUBDAQInput* input = NULL;
+        try {
+            if (fPrefetch && fPrefetch->Index == index) {
+                // The time waiting here is a stall in the conversion.
+                CP::TRawInputTrace::Span span("wait for prefetch",
+                                              "ubdaqlist");
+                input = fPrefetch->Result.get();
+                delete fPrefetch;
+                fPrefetch = NULL;
+            }
+            else {
+                CancelPrefetch();
+                input = OpenFile(fFiles[index],
+                                 fFirstSample, fLastSample,
+                                 fScaledDigitSave);
+            }
+        }
+        catch (std::exception& e) {
+            CaptError("Cannot read " << fFiles[index] << ": " << e.what());
+            if (fPrefetch) {
+                delete fPrefetch;
+                fPrefetch = NULL;
+            }
+        }
+
+        // Start on the file after this one while this one is read.
+        StartPrefetch(fNextFile);
+
+        if (!input) {
+            CaptError("Cannot open " << fFiles[index]);
+            continue;
+        }
+        CaptLog("Read " << fFiles[index]);
+        // The prefetch only reads the first header, so the selections can be
+        // set here.
+        input->SetChannelSelection(fChannelSelection);
+        input->SetTriggerSelection(fTriggerSelection);
+        input->SetCompactDigits(fCompactDigits);
+        input->SetWaveformMatrix(fWaveformMatrix);
+        input->SetRegionsOfInterest(fRegionThreshold,fRegionPadding);
+        if (!fCacheDirectory.empty()) {
+            input->SetSampleCache(fCacheDirectory, fCacheLimit);
+        }
+        fCurrent = input;
+        return true;
+    }
+    fFinished = true;
+    return false;
+}
+
+bool CP::TUBDAQListInput::PeekContext(CP::TEventContext& context) {
+    while (true) {
+        if (!fCurrent && !NextFile()) return false;
+        if (fCurrent->PeekContext(context)) return true;
+        delete fCurrent;
+        fCurrent = NULL;
+    }
+}
+
+void CP::TUBDAQListInput::SkipEvent() {
+    CP::TEventContext context;
+    if (!PeekContext(context)) return;
+    fCurrent->SkipEvent();
+    ++fEventsRead;
+}
+
+CP::TEvent* CP::TUBDAQListInput::FirstEvent() {
+    return NextEvent();
+}
+
+CP::TEvent* CP::TUBDAQListInput::NextEvent(int skip) {
+    while (skip-- > 0) SkipEvent();
+    const CP::TRunEventSet* selection = GetSelection();
+    CP::TEventContext context;
+    while (PeekContext(context)) {
+        if (selection && !selection->Contains(context.GetRun(),
+                                              context.GetSubRun(),
+                                              context.GetEvent())) {
+            SkipEvent();
+            continue;
+        }
+        CP::TEvent* event = fCurrent->NextEvent();
+        if (!event) continue;
+        ++fEventsRead;
+        return event;
+    }
+    return NULL;
+}
+
+int CP::TUBDAQListInput::GetPosition() const {return fEventsRead;}
+
+bool CP::TUBDAQListInput::IsOpen() {return !fFiles.empty();}
+
+bool CP::TUBDAQListInput::EndOfFile() {return fFinished;}
+
+void CP::TUBDAQListInput::CloseFile() {
+    CancelPrefetch();
+    if (fCurrent) {
+        delete fCurrent;
+        fCurrent = NULL;
+    }
+}
@@ -0,0 +1,181 @@
+#ifndef TUBDAQListInput_hxx_seen
+#define TUBDAQListInput_hxx_seen
+
+#include <ECore.hxx>
+#include <TVRawInput.hxx>
+#include <TUBDAQChannelSelection.hxx>
+
+#include <string>
+#include <vector>
+
+namespace CP {
+    class TUBDAQListInput;
+    class TUBDAQInput;
+};
+
+/// Read a list of ubdaq files as a single stream of events.  This is used
+/// when a run has been split into many subrun files.  The input name can be
+///
+///   - a comma separated list of files,
+///   - a glob pattern (e.g. "/data/run_2011/*.ubdaq.gz"),
+///   - "@<file>" to read the file names from a text file (one per line),
+///   - a catalog query (e.g. "catalog:raw.cat:run=2011") which gives the
+///     ubdaq files in the catalog holding a selected event (see
+///     TCatalogInput for the syntax).  All of the events in those files
+///     are read.
+///
+/// While one file is being read, the next file is opened in a background
+/// thread and the front of it is decompressed (the first record header is
+/// peeked), so there isn't a stall at each file boundary.  The builder
+/// takes the same arguments as the ubdaq builder, so -tubdaqlist(temp) is
+/// allowed.
+class CP::TUBDAQListInput : public CP::TVRawInput {
+public:
+    /// Open the list of files.  The first, last and scale arguments are
+    /// passed to TUBDAQInput.
+    TUBDAQListInput(const char* name, int first=-1, int last=-1,
+                    int scale=-1);
+    virtual ~TUBDAQListInput();
+
+    /// Return the first event in the list.
+    virtual CP::TEvent* FirstEvent();
+
+    /// Get the next event.  If skip is greater than zero, then skip this
+    /// many events before returning.
+    virtual CP::TEvent* NextEvent(int skip=0);
+
+    /// Return the number of events read from all of the files.
+    virtual int GetPosition(void) const;
+
+    /// Flag that there are files to read.
+    virtual bool IsOpen();
+
+    /// Flag that the last file has been finished.
+    virtual bool EndOfFile();
+
+    /// Close the current file, and stop any prefetch.
+    virtual void CloseFile();
+
+    /// Fill the context of the next event, moving to the next file if the
+    /// current file is finished.
+    virtual bool PeekContext(CP::TEventContext& context);
+
+    /// Skip the next event.
+    virtual void SkipEvent();
+
+    /// Get the files that will be read.
+    const std::vector<std::string>& GetFiles() const {return fFiles;}
+
+    /// Get the name of this input.
+    const char* GetFilename()  const { return fFilename.c_str();  }
+
+    /// Set the crates, cards and channels to convert (see
+    /// TUBDAQChannelSelection).  This is passed to each ubdaq file.
+    void SetChannelSelection(const CP::TUBDAQChannelSelection& selection);
+
+    /// Only convert records with one of the trigger bits in mask (see
+    /// TUBDAQInput::SetTriggerSelection()).  This is passed to each ubdaq
+    /// file.
+    void SetTriggerSelection(int mask);
+
+    /// Save the TPC digits as TCompactPulseDigits (see
+    /// TUBDAQInput::SetCompactDigits()).  This is passed to each ubdaq
+    /// file.
+    void SetCompactDigits(int encoding);
+
+    /// Save the TPC samples as a waveform matrix (see
+    /// TUBDAQInput::SetWaveformMatrix()).  This is passed to each ubdaq
+    /// file.
+    void SetWaveformMatrix(int mode);
+
+    /// Only save the regions of interest in the TPC waveforms (see
+    /// TUBDAQInput::SetRegionsOfInterest()).  This is passed to each ubdaq
+    /// file.
+    void SetRegionsOfInterest(double threshold, int padding);
+
+    /// Keep the decoded samples in a cache directory (see
+    /// TUBDAQInput::SetSampleCache()).  Each ubdaq file has its own cache
+    /// file, and the size limit (in MB) applies to each of them.
+    void SetSampleCache(const std::string& directory,
+                        double megabytes = 8192);
+
+private:
+    /// Fill the list of files from the input name.
+    void ExpandName();
+
+    /// Start opening the file at index in the background.
+    void StartPrefetch(std::size_t index);
+
+    /// Wait for the prefetch to finish and delete any file it opened.
+    void CancelPrefetch();
+
+    /// Make the next file current.  This returns false when there are no
+    /// more files.
+    bool NextFile();
+
+    /// Open a file and read the first record header.  This is run in the
+    /// prefetch thread, or when the prefetch isn't for the file.
+    static CP::TUBDAQInput* OpenFile(std::string name,
+                                     int first, int last, int scale);
+
+    /// Name the prefetch thread in the trace, and open a file.
+    static CP::TUBDAQInput* PrefetchFile(std::string name,
+                                         int first, int last, int scale);
+
+    /// The name of the input.
+    std::string fFilename;
+
+    /// The files to read.
+    std::vector<std::string> fFiles;
+
+    /// The index in fFiles of the next file to read.
+    std::size_t fNextFile;
+
+    /// The file currently being read.
+    CP::TUBDAQInput* fCurrent;
+
+    /// The file being opened in the background.  This is defined in the
+    /// source so the thread headers aren't seen by the dictionary.
+    class Prefetch;
+    Prefetch* fPrefetch;
+
+    /// The number of events read.
+    int fEventsRead;
+
+    /// Flag that all of the files have been read.
+    bool fFinished;
+
+    /// The first sample to convert.
+    int fFirstSample;
+
+    /// The last sample to convert.
+    int fLastSample;
+
+    /// The scaling for saving the digits.
+    int fScaledDigitSave;
+
+    /// The crates, cards and channels to convert.
+    CP::TUBDAQChannelSelection fChannelSelection;
+
+    /// The trigger bits to select, or zero for every record.
+    int fTriggerSelection;
+
+    /// The encoding for compact TPC digits, or zero for TPulseDigits.
+    int fCompactDigits;
+
+    /// The way the TPC samples are saved.
+    int fWaveformMatrix;
+
+    /// The region of interest threshold, or zero for full waveforms.
+    double fRegionThreshold;
+
+    /// The padding around each region of interest.
+    int fRegionPadding;
+
+    /// The sample cache directory, or empty if the samples aren't cached.
+    std::string fCacheDirectory;
+
+    /// The size limit of each sample cache in MB.
+    double fCacheLimit;
+};
+#endif
@@ -0,0 +1,308 @@
+#include "TUBDAQSampleCache.hxx"
+
+#include <TCaptLog.hxx>
+
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <climits>
+#include <cstdlib>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace {
+    /// The magic number at the start of a cache file.
+    const char kMagic[8] = {'U','B','D','Q','C','A','C','H'};
+
+    /// The version of the cache layout.
+    const uint32_t kVersion = 1;
+
+    /// The alignment of the samples in the file.
+    const uint64_t kAlignment = 64;
+
+    /// The number of bytes at each end of the raw file in the checksum.
+    const std::size_t kChecksumBytes = 1<<20;
+
+    /// Add bytes to a 64 bit FNV-1a hash.
+    uint64_t fnv1a(uint64_t hash, const char* data, std::size_t bytes) {
+        for (std::size_t i = 0; i < bytes; ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    const uint64_t kFNVOffset = 14695981039346656037ULL;
+
+    /// Check that count items of size bytes starting at offset are inside
+    /// a mapped file.  This is written so that a corrupt count or offset
+    /// can't overflow.
+    bool inMap(uint64_t offset, uint64_t count, uint64_t size,
+               uint64_t mapSize) {
+        if (offset > mapSize) return false;
+        return count <= (mapSize - offset)/size;
+    }
+}
+
+CP::TUBDAQSampleCache::TUBDAQSampleCache()
+    : fMap(NULL), fMapSize(0), fHeader(NULL), fEvents(NULL),
+      fChannels(NULL), fOutput(NULL), fWritten(0), fWriteError(false),
+      fSizeLimit(0) {}
+
+CP::TUBDAQSampleCache::~TUBDAQSampleCache() {
+    Close();
+}
+
+bool CP::TUBDAQSampleCache::MakeKey(const std::string& rawFile, Key& key) {
+    int fd = open(rawFile.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat status;
+    if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode)) {
+        close(fd);
+        return false;
+    }
+    char resolved[PATH_MAX];
+    key.Path = rawFile;
+    if (realpath(rawFile.c_str(), resolved)) key.Path = resolved;
+    key.Size = status.st_size;
+    key.Modified = status.st_mtime;
+
+    // Hash the beginning and the end of the file.  This catches a file
+    // that was rewritten without changing the size or time.
+    std::vector<char> buffer(kChecksumBytes);
+    uint64_t hash = kFNVOffset;
+    ssize_t bytes = pread(fd, &buffer[0], buffer.size(), 0);
+    if (bytes > 0) hash = fnv1a(hash, &buffer[0], bytes);
+    if (key.Size > 2*kChecksumBytes) {
+        bytes = pread(fd, &buffer[0], buffer.size(),
+                      key.Size - kChecksumBytes);
+        if (bytes > 0) hash = fnv1a(hash, &buffer[0], bytes);
+    }
+    close(fd);
+    key.Checksum = hash;
+    return true;
+}
+
+std::string CP::TUBDAQSampleCache::CacheName(const std::string& directory,
+                                             const Key& key) {
+    std::ostringstream identity;
+    identity << key.Path << ":" << key.Size << ":" << key.Modified
+             << ":" << key.Checksum;
+    std::string id = identity.str();
+    std::string base = key.Path.substr(key.Path.find_last_of('/')+1);
+    std::ostringstream name;
+    name << directory << "/" << base << "."
+         << std::hex << std::setw(16) << std::setfill('0')
+         << fnv1a(kFNVOffset, id.c_str(), id.size())
+         << ".ubdaqcache";
+    return name.str();
+}
+
+bool CP::TUBDAQSampleCache::Open(const std::string& fileName,
+                                 const Key& key) {
+    Close();
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat status;
+    if (fstat(fd, &status) != 0
+        || status.st_size < (off_t) sizeof(FileHeader)) {
+        close(fd);
+        return false;
+    }
+    void* map = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+    fMap = static_cast<const char*>(map);
+    fMapSize = status.st_size;
+    fHeader = reinterpret_cast<const FileHeader*>(fMap);
+
+    bool valid = std::memcmp(fHeader->Magic, kMagic, sizeof(kMagic)) == 0
+        && fHeader->Version == kVersion
+        && fHeader->Complete == 1
+        && fHeader->RawSize == key.Size
+        && fHeader->RawModified == key.Modified
+        && fHeader->RawChecksum == key.Checksum
+        && inMap(fHeader->EventTable, fHeader->EventCount,
+                 sizeof(EventEntry), fMapSize)
+        && inMap(fHeader->ChannelTable, fHeader->ChannelCount,
+                 sizeof(ChannelEntry), fMapSize)
+        && inMap(fHeader->PathOffset, fHeader->PathLength, 1, fMapSize)
+        && key.Path == std::string(fMap + fHeader->PathOffset,
+                                   fHeader->PathLength);
+    if (!valid) {
+        CaptLog("Ignore stale sample cache " << fileName);
+        Close();
+        return false;
+    }
+    fEvents = reinterpret_cast<const EventEntry*>(fMap
+                                                  + fHeader->EventTable);
+    fChannels = reinterpret_cast<const ChannelEntry*>(fMap
+                                                      + fHeader->ChannelTable);
+
+    // Check every event and channel so that a truncated or corrupt cache
+    // can't be read past the end of the map.
+    for (uint64_t e = 0; valid && e < fHeader->EventCount; ++e) {
+        const EventEntry& event = fEvents[e];
+        valid = event.ChannelCount >= 0
+            && event.FirstChannel <= fHeader->ChannelCount
+            && (uint64_t) event.ChannelCount
+            <= fHeader->ChannelCount - event.FirstChannel;
+    }
+    for (uint64_t c = 0; valid && c < fHeader->ChannelCount; ++c) {
+        const ChannelEntry& channel = fChannels[c];
+        valid = inMap(channel.Offset, channel.Samples, sizeof(uint16_t),
+                      fMapSize);
+    }
+    if (!valid) {
+        CaptError("Ignore corrupt sample cache " << fileName);
+        Close();
+        return false;
+    }
+    // The samples are read in order.
+    madvise(const_cast<char*>(fMap), fMapSize, MADV_SEQUENTIAL);
+    fFileName = fileName;
+    fKey = key;
+    return true;
+}
+
+bool CP::TUBDAQSampleCache::Create(const std::string& fileName,
+                                   const Key& key) {
+    Close();
+    std::ostringstream temporary;
+    temporary << fileName << ".tmp" << getpid();
+    fOutput = std::fopen(temporary.str().c_str(), "wb");
+    if (!fOutput) {
+        CaptError("Cannot write sample cache " << temporary.str());
+        return false;
+    }
+    fFileName = fileName;
+    fTemporaryName = temporary.str();
+    fKey = key;
+    fWritten = 0;
+    fWriteError = false;
+    fEventTable.clear();
+    fChannelTable.clear();
+
+    // The header is written again when the cache is finished.
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    Write(&header, sizeof(header));
+    return !fWriteError;
+}
+
+void CP::TUBDAQSampleCache::Write(const void* data, std::size_t bytes) {
+    if (fWriteError || bytes < 1) return;
+    if (std::fwrite(data, 1, bytes, fOutput) != bytes) fWriteError = true;
+    fWritten += bytes;
+}
+
+void CP::TUBDAQSampleCache::AddEvent(const EventEntry& event) {
+    if (!fOutput) return;
+    fEventTable.push_back(event);
+    fEventTable.back().FirstChannel = fChannelTable.size();
+    fEventTable.back().ChannelCount = 0;
+}
+
+void CP::TUBDAQSampleCache::AddChannel(int kind, int crate, int card,
+                                       int channel, int first,
+                                       const char* samples, int count) {
+    if (!fOutput || fEventTable.empty()) return;
+    std::size_t pad = (kAlignment - fWritten%kAlignment)%kAlignment;
+    if (fSizeLimit > 0) {
+        // The tables and the path are written when the cache is finished.
+        uint64_t size = fWritten + pad + count*sizeof(uint16_t)
+            + fEventTable.size()*sizeof(EventEntry)
+            + (fChannelTable.size()+1)*sizeof(ChannelEntry)
+            + kAlignment + fKey.Path.size();
+        if (size > fSizeLimit) {
+            CaptWarn("Sample cache " << fFileName << " is over "
+                     << fSizeLimit/(1024.0*1024.0) << " MB and is abandoned");
+            Close();
+            return;
+        }
+    }
+    static const char padding[kAlignment] = {0};
+    Write(padding, pad);
+    ChannelEntry entry;
+    entry.Kind = kind;
+    entry.Crate = crate;
+    entry.Card = card;
+    entry.Channel = channel;
+    entry.First = first;
+    entry.Samples = count;
+    entry.Offset = fWritten;
+    Write(samples, count*sizeof(uint16_t));
+    fChannelTable.push_back(entry);
+    ++fEventTable.back().ChannelCount;
+}
+
+bool CP::TUBDAQSampleCache::Finish() {
+    if (!fOutput) return false;
+    static const char padding[kAlignment] = {0};
+    Write(padding, (kAlignment - fWritten%kAlignment)%kAlignment);
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.Magic, kMagic, sizeof(kMagic));
+    header.Version = kVersion;
+    header.Complete = 1;
+    header.RawSize = fKey.Size;
+    header.RawModified = fKey.Modified;
+    header.RawChecksum = fKey.Checksum;
+    header.EventCount = fEventTable.size();
+    header.EventTable = fWritten;
+    if (!fEventTable.empty()) {
+        Write(&fEventTable[0], fEventTable.size()*sizeof(EventEntry));
+    }
+    header.ChannelCount = fChannelTable.size();
+    header.ChannelTable = fWritten;
+    if (!fChannelTable.empty()) {
+        Write(&fChannelTable[0], fChannelTable.size()*sizeof(ChannelEntry));
+    }
+    header.PathOffset = fWritten;
+    header.PathLength = fKey.Path.size();
+    Write(fKey.Path.c_str(), fKey.Path.size());
+
+    if (!fWriteError) {
+        if (std::fseek(fOutput, 0, SEEK_SET) != 0) fWriteError = true;
+        else if (std::fwrite(&header, sizeof(header), 1, fOutput) != 1) {
+            fWriteError = true;
+        }
+    }
+    if (std::fclose(fOutput) != 0) fWriteError = true;
+    fOutput = NULL;
+
+    if (fWriteError
+        || std::rename(fTemporaryName.c_str(), fFileName.c_str()) != 0) {
+        CaptError("Cannot write sample cache " << fFileName);
+        std::remove(fTemporaryName.c_str());
+        return false;
+    }
+    CaptLog("Wrote sample cache " << fFileName
+            << " (" << fEventTable.size() << " events)");
+    fEventTable.clear();
+    fChannelTable.clear();
+    return true;
+}
+
+void CP::TUBDAQSampleCache::Close() {
+    if (fOutput) {
+        std::fclose(fOutput);
+        fOutput = NULL;
+        std::remove(fTemporaryName.c_str());
+        fEventTable.clear();
+        fChannelTable.clear();
+    }
+    if (fMap) {
+        munmap(const_cast<char*>(fMap), fMapSize);
+        fMap = NULL;
+        fMapSize = 0;
+        fHeader = NULL;
+        fEvents = NULL;
+        fChannels = NULL;
+    }
+}
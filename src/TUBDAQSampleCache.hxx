@@ -0,0 +1,221 @@
+#ifndef TUBDAQSampleCache_hxx_seen
+#define TUBDAQSampleCache_hxx_seen
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+
+namespace CP {
+    class TUBDAQSampleCache;
+};
+
+/// A cache on disk of the decoded samples for every event in a ubdaq file.
+/// The same raw file is often converted many times (e.g. for calibrations
+/// with different downstream settings), and each pass pays for the
+/// inflation, unpacking and Huffman decoding again.  The first pass writes
+/// the decoded samples of every TPC channel and PMT window to the cache,
+/// and the later passes map the cache into memory and make the digits
+/// straight from it without reading the raw file.  It's used by TUBDAQInput
+/// and is turned on with -tubdaq(cache=<directory>).
+///
+/// A cache file belongs to one raw file, and is found from the raw file
+/// path, size, modification time and a checksum of the first and last MB
+/// of the file.  If any of these change, the cache is ignored and a new
+/// one is written.  The cache holds the samples before the sample window,
+/// the channel selection, the regions of interest, and the digit encoding
+/// are applied, so one cache can be used with any of them.  It's only
+/// written by a pass that decodes every record of the raw file, and is
+/// renamed into place when the pass finishes so a partial cache is never
+/// used.
+///
+/// The cache takes two bytes on disk for every decoded sample, which is
+/// several times the size of the Huffman encoded raw file.  A cache being
+/// written is abandoned (and removed) if it would grow past a size limit
+/// (see SetSizeLimit()).
+///
+/// The file starts with a FileHeader, followed by the samples for each
+/// channel (16 bit, and aligned to 64 bytes), the EventEntry table, the
+/// ChannelEntry table, and the raw file path.  The tables are in native
+/// byte order.
+class CP::TUBDAQSampleCache {
+public:
+    /// The identity of a raw file.
+    struct Key {
+        std::string Path;
+        uint64_t Size;
+        int64_t Modified;
+        uint64_t Checksum;
+    };
+
+    /// The header at the beginning of the cache file.
+    struct FileHeader {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t Complete;
+        uint64_t RawSize;
+        int64_t RawModified;
+        uint64_t RawChecksum;
+        uint64_t EventCount;
+        uint64_t EventTable;
+        uint64_t ChannelCount;
+        uint64_t ChannelTable;
+        uint64_t PathOffset;
+        uint64_t PathLength;
+        uint64_t Reserved[4];
+    };
+
+    /// The context and trigger data of an event.  The trigger bits are -1
+    /// if the record didn't have trigger data.
+    struct EventEntry {
+        int32_t Run;
+        int32_t SubRun;
+        int32_t Event;
+        uint32_t Seconds;
+        uint32_t Nanoseconds;
+        int32_t TriggerBits;
+        int32_t TriggerFrame;
+        int32_t TriggerSample;
+        int32_t TriggerEvent;
+        int32_t ChannelCount;
+        int64_t RecordOffset;
+        uint64_t FirstChannel;
+    };
+
+    /// The kinds of channel.
+    enum {
+        kTPC = 0,               // A TPC channel.
+        kPMT = 1                // A PMT readout window.
+    };
+
+    /// A TPC channel or a PMT window.
+    struct ChannelEntry {
+        uint16_t Kind;
+        uint16_t Crate;
+        uint16_t Card;
+        uint16_t Channel;
+        int32_t First;
+        uint32_t Samples;
+        uint64_t Offset;
+    };
+
+    TUBDAQSampleCache();
+    virtual ~TUBDAQSampleCache();
+
+    /// Find the identity of a raw file.  This returns false if the file
+    /// can't be read (e.g. it's a pipe).
+    static bool MakeKey(const std::string& rawFile, Key& key);
+
+    /// Get the name of the cache file for a raw file in a directory.
+    static std::string CacheName(const std::string& directory,
+                                 const Key& key);
+
+    /// Map a cache file for reading.  This returns false if the file
+    /// doesn't exist, isn't complete, or belongs to a different raw file.
+    bool Open(const std::string& fileName, const Key& key);
+
+    /// Start writing a cache file.  The file is written under a temporary
+    /// name until Finish() is called.
+    bool Create(const std::string& fileName, const Key& key);
+
+    /// Set the largest cache file that will be written in bytes.  If the
+    /// cache being written would grow past the limit, it's abandoned and
+    /// the file is removed.  Zero (the default) doesn't limit the size.
+    void SetSizeLimit(uint64_t bytes) {fSizeLimit = bytes;}
+
+    /// Flag that the cache is mapped for reading.
+    bool IsReading() const {return fMap != NULL;}
+
+    /// Flag that the cache is being written.
+    bool IsWriting() const {return fOutput != NULL;}
+
+    /// Get the number of events in a cache being read.
+    int GetEventCount() const {return fHeader->EventCount;}
+
+    /// Get an event from a cache being read.
+    const EventEntry& GetEvent(int event) const {return fEvents[event];}
+
+    /// Get a channel of an event from a cache being read.
+    const ChannelEntry& GetChannel(const EventEntry& event,
+                                   int channel) const {
+        return fChannels[event.FirstChannel + channel];
+    }
+
+    /// Get the channels of an event from a cache being read.
+    const ChannelEntry* GetChannels(const EventEntry& event) const {
+        return fChannels + event.FirstChannel;
+    }
+
+    /// Get the start of a cache being read.  The channel offsets are from
+    /// here.
+    const char* GetData() const {return fMap;}
+
+    /// Get the samples of a channel from a cache being read.
+    const uint16_t* GetSamples(const ChannelEntry& channel) const {
+        return reinterpret_cast<const uint16_t*>(fMap + channel.Offset);
+    }
+
+    /// Start an event in a cache being written.
+    void AddEvent(const EventEntry& event);
+
+    /// Add a channel to the last event in a cache being written.  The
+    /// samples are a char array since the raw channel data may not be
+    /// aligned.
+    void AddChannel(int kind, int crate, int card, int channel, int first,
+                    const char* samples, int count);
+
+    /// Finish a cache being written and rename it into place.  This
+    /// returns false if it couldn't be written.
+    bool Finish();
+
+    /// Close the cache.  A cache being written that wasn't finished is
+    /// removed.
+    void Close();
+
+private:
+    /// Write a block to the cache being written.
+    void Write(const void* data, std::size_t bytes);
+
+    /// The name of the cache file.
+    std::string fFileName;
+
+    /// The temporary name of a cache being written.
+    std::string fTemporaryName;
+
+    /// The identity of the raw file.
+    Key fKey;
+
+    /// The mapped cache, or NULL.
+    const char* fMap;
+
+    /// The size of the mapped cache.
+    std::size_t fMapSize;
+
+    /// The header of the mapped cache.
+    const FileHeader* fHeader;
+
+    /// The event table of the mapped cache.
+    const EventEntry* fEvents;
+
+    /// The channel table of the mapped cache.
+    const ChannelEntry* fChannels;
+
+    /// The file for a cache being written, or NULL.
+    std::FILE* fOutput;
+
+    /// The number of bytes written.
+    uint64_t fWritten;
+
+    /// Flag that a write failed.
+    bool fWriteError;
+
+    /// The largest cache file to write, or zero.
+    uint64_t fSizeLimit;
+
+    /// The events for a cache being written.
+    std::vector<EventEntry> fEventTable;
+
+    /// The channels for a cache being written.
+    std::vector<ChannelEntry> fChannelTable;
+};
+#endif
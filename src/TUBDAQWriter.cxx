@@ -0,0 +1,288 @@
+#include "TUBDAQWriter.hxx"
+#include "TUBDAQCaboose.hxx"
+#include "TUBDAQFormat.hxx"
+
+#include "datatypes/eventRecord.h"
+#include "datatypes/crateData.h"
+#include "datatypes/crateDataPMT.h"
+#include "datatypes/cardData.h"
+#include "datatypes/channelData.h"
+
+#include <TCaptLog.hxx>
+
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/stream.hpp>
+
+#include <memory>
+#include <stdexcept>
+#include <cstring>
+
+namespace {
+    namespace dt = gov::fnal::uboone::datatypes;
+
+    /// Copy words out of a char buffer that may not be aligned.
+    void copyWords(const char* data, std::size_t bytes,
+                   CP::TUBDAQWriter::Words& words) {
+        words.resize(bytes/sizeof(uint16_t));
+        if (!words.empty()) {
+            std::memcpy(&words[0], data, words.size()*sizeof(uint16_t));
+        }
+    }
+
+    std::shared_ptr<char> makeBuffer(const CP::TUBDAQWriter::Words& words) {
+        std::shared_ptr<char> buffer(new char[2*words.size()],
+                                     std::default_delete<char[]>());
+        if (!words.empty()) {
+            std::memcpy(buffer.get(), &words[0], 2*words.size());
+        }
+        return buffer;
+    }
+
+    bool endsWith(const std::string& name, const std::string& suffix) {
+        if (name.size() < suffix.size()) return false;
+        return name.compare(name.size()-suffix.size(),
+                            suffix.size(), suffix) == 0;
+    }
+}
+
+CP::TUBDAQWriter::TUBDAQWriter(const std::string& fileName)
+    : fFileName(fileName), fOutput(NULL), fFirstSample(-1),
+      fLastSample(-1), fRecords(0), fBytes(0), fError(false) {
+    fFile.open(fFileName.c_str(), std::ios::binary);
+    if (!fFile.is_open()) {
+        CaptError("Cannot write " << fFileName);
+        return;
+    }
+    boost::iostreams::filtering_ostream* output
+        = new boost::iostreams::filtering_ostream;
+    if (endsWith(fFileName, ".gz")) {
+        output->push(boost::iostreams::gzip_compressor());
+    }
+    output->push(fFile);
+    fOutput = output;
+}
+
+CP::TUBDAQWriter::~TUBDAQWriter() {
+    Close();
+}
+
+void CP::TUBDAQWriter::Write(const void* data, std::size_t bytes) {
+    if (fError || !fOutput) return;
+    fOutput->write(static_cast<const char*>(data), bytes);
+    if (!fOutput->good()) fError = true;
+    fBytes += bytes;
+}
+
+bool CP::TUBDAQWriter::TrimCrates() const {
+    return !fChannelSelection.IsEmpty()
+        || fFirstSample > 0 || fLastSample > 0;
+}
+
+void CP::TUBDAQWriter::TrimChannel(const Words& data, int first, int last,
+                                   Words& trimmed) {
+    trimmed.clear();
+    bool huffman = false;
+    for (Words::const_iterator w = data.begin(); w != data.end(); ++w) {
+        if (*w & 0x8000) {
+            huffman = true;
+            break;
+        }
+    }
+
+    Words decoded;
+    const Words* samples = &data;
+    if (huffman) {
+        dt::channelData channel(makeBuffer(data), 2*data.size(),
+                                0x4000, 0x5000);
+        channel.decompress();
+        copyWords(channel.getChannelDataPtr(),
+                  channel.getChannelDataSize(), decoded);
+        samples = &decoded;
+    }
+
+    // The window is applied the same way as TUBDAQInput does it.
+    int begin = 0;
+    int end = samples->size();
+    if (first > 0 && first < end) begin = first;
+    if (last > first && last < end) end = last;
+    if (end <= begin) return;
+
+    if (!huffman) {
+        trimmed.assign(samples->begin()+begin, samples->begin()+end);
+        return;
+    }
+    Words window(samples->begin()+begin, samples->begin()+end);
+    CP::TUBDAQFormat::HuffmanEncode(window, trimmed);
+}
+
+bool CP::TUBDAQWriter::TrimCrate(int crateNumber,
+                                 const dt::crateData& crate,
+                                 Words& payload, int& cards) {
+    typedef dt::crateData::cardMap_t cardMap;
+    typedef dt::cardData::channelMap_t channelMap;
+
+    // Unpack a copy so the record isn't changed.  The copy shares the
+    // payload, and the cards that aren't selected are never copied out of
+    // it.
+    dt::crateData unpacked(crate);
+    uint32_t cardMask = unpacked.getCardSelection();
+    if (!fChannelSelection.IsEmpty()) {
+        cardMask &= fChannelSelection.GetCardMask(crateNumber);
+    }
+    unpacked.setCardSelection(cardMask);
+    unpacked.updateIOMode(dt::IO_GRANULARITY_CARD);
+
+    bool selectChannels = !fChannelSelection.IsEmpty();
+    payload.clear();
+    cards = 0;
+    CP::TUBDAQFormat::BeginCrate(payload);
+    Words card;
+    Words data;
+    Words trimmed;
+    const cardMap& cardsIn = unpacked.getCardMap();
+    for (cardMap::const_iterator c = cardsIn.begin();
+         c != cardsIn.end(); ++c) {
+        int cardNumber = c->first.getModule();
+        if (!((cardMask >> cardNumber) & 0x1)) continue;
+        dt::cardData channels(c->second);
+        channels.updateIOMode(dt::IO_GRANULARITY_CHANNEL, -1);
+        card.clear();
+        const channelMap& channelsIn = channels.getChannelMap();
+        for (channelMap::const_iterator ch = channelsIn.begin();
+             ch != channelsIn.end(); ++ch) {
+            int channelNumber = ch->second.getChannelNumber();
+            if (selectChannels
+                && !fChannelSelection.ChannelSelected(crateNumber,
+                                                      cardNumber,
+                                                      channelNumber)) {
+                continue;
+            }
+            copyWords(ch->second.getChannelDataPtr(),
+                      ch->second.getChannelDataSize(), data);
+            TrimChannel(data, fFirstSample, fLastSample, trimmed);
+            card.push_back(ch->second.getChannelHeader());
+            card.insert(card.end(), trimmed.begin(), trimmed.end());
+            card.push_back(ch->second.getChannelTrailer());
+        }
+        if (card.empty()) continue;
+
+        // The card header keeps the event and frame numbers, but gets the
+        // new word count and checksum.
+        dt::cardHeader header(c->first);
+        CP::TUBDAQFormat::AddTPCCard(payload, header.getCardHeader(), card);
+        ++cards;
+    }
+    CP::TUBDAQFormat::EndCrate(payload);
+    return cards > 0;
+}
+
+bool CP::TUBDAQWriter::Write(dt::eventRecord& record) {
+    typedef dt::eventRecord::sebMap_t crateMap;
+    typedef dt::eventRecord::sebMapPMT_t pmtCrateMap;
+
+    if (!fOutput || fError) return false;
+
+    // Copy everything except the crates into the record that is written.
+    dt::eventRecord output;
+    output.setGlobalHeader(record.getGlobalHeader());
+    output.setTriggerData(record.getTriggerData());
+    output.setGPS(record.getGPS());
+    output.setBeamHeader(record.getBeamHeader());
+    std::vector<dt::beamData> beamData = record.getBeamDataVector();
+    for (std::size_t i = 0; i < beamData.size(); ++i) {
+        output.insertBeamData(beamData[i]);
+    }
+
+    bool selectCrates = !fChannelSelection.IsEmpty();
+    Words payload;
+    try {
+        const crateMap& crates = record.getSEBMap();
+        for (crateMap::const_iterator crate = crates.begin();
+             crate != crates.end(); ++crate) {
+            int crateNumber = crate->first.getCrateNumber();
+            if (selectCrates
+                && !fChannelSelection.CrateSelected(crateNumber)) {
+                continue;
+            }
+            // A crate that was read with a card selection still has the
+            // unselected cards in the payload, so it's rebuilt too.
+            if (!TrimCrates()
+                && crate->second.getCardSelection() == 0xFFFFFFFF) {
+                output.insertSEB(crate->first, crate->second);
+                continue;
+            }
+            int cards = 0;
+            if (!TrimCrate(crateNumber, crate->second, payload, cards)) {
+                continue;
+            }
+            dt::crateHeader header(crate->first);
+            header.setCardCount(cards);
+            header.setCrateSize(2*payload.size());
+            output.insertSEB(header, dt::crateData(makeBuffer(payload),
+                                                   2*payload.size()));
+        }
+
+        const pmtCrateMap& pmtCrates = record.getSEBPMTMap();
+        for (pmtCrateMap::const_iterator crate = pmtCrates.begin();
+             crate != pmtCrates.end(); ++crate) {
+            if (selectCrates
+                && !fChannelSelection.CrateSelected(
+                    crate->first.getCrateNumber())) {
+                continue;
+            }
+            output.insertSEB(crate->first, crate->second);
+        }
+    }
+    catch (std::runtime_error& e) {
+        CaptError("Cannot trim record "
+                  << record.getGlobalHeader().getEventNumber()
+                  << " for " << fFileName << ": " << e.what());
+        return false;
+    }
+
+    // Serialize the record into memory so the size is known for the
+    // caboose.  Each record is a separate archive the way the DAQ writes
+    // them.
+    fBuffer.clear();
+    {
+        boost::iostreams::stream<
+            boost::iostreams::back_insert_device<std::vector<char> > >
+            buffer(fBuffer);
+        boost::archive::binary_oarchive archive(buffer);
+        archive << output;
+    }
+    CP::TUBDAQCaboose caboose;
+    caboose.Marker = CP::TUBDAQCaboose::kMarker;
+    caboose.Size = fBuffer.size();
+    if (!fBuffer.empty()) Write(&fBuffer[0], fBuffer.size());
+    Write(&caboose, sizeof(caboose));
+    if (fError) {
+        CaptError("Error writing " << fFileName);
+        return false;
+    }
+    ++fRecords;
+    return true;
+}
+
+bool CP::TUBDAQWriter::Close() {
+    if (!fOutput) return !fError;
+    CP::TUBDAQCaboose caboose;
+    caboose.Marker = CP::TUBDAQCaboose::kMarker;
+    caboose.Size = 0;
+    Write(&caboose, sizeof(caboose));
+    // The compressor is only finished when the chain is reset.
+    static_cast<boost::iostreams::filtering_ostream*>(fOutput)->reset();
+    delete fOutput;
+    fOutput = NULL;
+    fFile.close();
+    if (fFile.fail()) fError = true;
+    if (fError) {
+        CaptError("Error writing " << fFileName);
+        return false;
+    }
+    CaptLog("Wrote " << fRecords << " records to " << fFileName);
+    return true;
+}
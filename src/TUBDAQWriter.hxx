@@ -0,0 +1,155 @@
+#ifndef TUBDAQWriter_hxx_seen
+#define TUBDAQWriter_hxx_seen
+
+#include <TUBDAQChannelSelection.hxx>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <ostream>
+#include <stdint.h>
+
+namespace CP {
+    class TUBDAQWriter;
+};
+
+namespace gov {
+    namespace fnal {
+        namespace uboone {
+            namespace datatypes {
+                class eventRecord;
+                class crateHeader;
+                class crateData;
+            }
+        }
+    }
+}
+
+/// Write event records back into a ubdaq file so that selected events can
+/// be skimmed without converting them.  The skim is in the DAQ format, so
+/// it can be read by every tool that reads the DAQ files.  Each record is
+/// written as a separate boost archive followed by a caboose with the size
+/// of the record, and the end caboose is written when the file is closed
+/// (see TUBDAQCaboose).  The file is gzip compressed if the name ends in
+/// ".gz".
+///
+/// The records are usually read with TUBDAQInput::NextRecord() so that the
+/// input and trigger selections are applied, and the crates that aren't in
+/// the channel selection are never read.  The TPC crates can be trimmed
+/// further before they are written (see SetChannelSelection() and
+/// SetSampleWindow()).  A trimmed crate is rebuilt with the word layout
+/// the DAQ writes, and keeps only the selected cards and channels (a crate
+/// without any selected cards is left out).  The card headers get the new
+/// word count and checksum.  A Huffman encoded channel is decoded, cut to
+/// the sample window and encoded again (see channelData::decompress()),
+/// and a channel saved as explicit words is cut without being encoded.
+/// The PMT crates are written as they were read.
+///
+/// \code
+/// CP::TUBDAQInput input("run.ubdaq");
+/// CP::TUBDAQWriter writer("skim.ubdaq.gz");
+/// writer.SetSampleWindow(2800,3800);
+/// while (eventRecord* record = input.NextRecord()) {
+///     writer.Write(*record);
+///     delete record;
+/// }
+/// writer.Close();
+/// \endcode
+class CP::TUBDAQWriter {
+public:
+    typedef std::vector<uint16_t> Words;
+
+    /// Open a ubdaq file for writing.
+    explicit TUBDAQWriter(const std::string& fileName);
+
+    /// Close the file if it's still open.
+    virtual ~TUBDAQWriter();
+
+    /// Flag that the file is open.
+    bool IsOpen() const {return fOutput != NULL;}
+
+    /// Only keep the selected cards and channels of the TPC crates.  The
+    /// crates that aren't selected are left out.  The same selection
+    /// should be given to the input so that the unselected crates and
+    /// cards aren't read.
+    void SetChannelSelection(const CP::TUBDAQChannelSelection& selection) {
+        fChannelSelection = selection;
+    }
+
+    /// Only keep the TPC samples from first up to (but not including)
+    /// last.  This is the sample window used by TUBDAQInput, and a value
+    /// of -1 doesn't limit that end of the window.  The samples in the
+    /// skim start at the first sample of the window.
+    void SetSampleWindow(int first, int last) {
+        fFirstSample = first;
+        fLastSample = last;
+    }
+
+    /// Write a record to the file.  The crates of the record are unpacked
+    /// when they need to be trimmed.  This returns false if the record
+    /// can't be written.
+    bool Write(gov::fnal::uboone::datatypes::eventRecord& record);
+
+    /// Write the end caboose and close the file.  This returns false if
+    /// there was an error writing the file.
+    bool Close();
+
+    /// Get the number of records written.
+    int GetRecordCount() const {return fRecords;}
+
+    /// Get the number of bytes written before compression.
+    uint64_t GetBytesWritten() const {return fBytes;}
+
+    /// Cut the samples of a channel to the window from first up to (but
+    /// not including) last.  The data is the channel words between the
+    /// header and trailer.  A Huffman encoded channel is decoded and
+    /// encoded again.  This is public so it can be tested.
+    static void TrimChannel(const Words& data, int first, int last,
+                            Words& trimmed);
+
+private:
+    /// Flag that the TPC crates need to be rebuilt.
+    bool TrimCrates() const;
+
+    /// Rebuild the payload of a TPC crate with the selected cards and
+    /// channels, and the sample window.  This returns false if no card
+    /// was kept.
+    bool TrimCrate(int crateNumber,
+                   const gov::fnal::uboone::datatypes::crateData& crate,
+                   Words& payload, int& cards);
+
+    /// Write a block to the file.
+    void Write(const void* data, std::size_t bytes);
+
+    /// The name of the file.
+    std::string fFileName;
+
+    /// The file being written.
+    std::ofstream fFile;
+
+    /// The (possibly compressing) stream into the file, or NULL if the
+    /// file is closed.  This is a boost filtering_ostream.
+    std::ostream* fOutput;
+
+    /// The cards and channels to keep.
+    CP::TUBDAQChannelSelection fChannelSelection;
+
+    /// The first sample to keep.
+    int fFirstSample;
+
+    /// The sample after the last one to keep.
+    int fLastSample;
+
+    /// The buffer that each record is serialized into.
+    std::vector<char> fBuffer;
+
+    /// The number of records written.
+    int fRecords;
+
+    /// The number of bytes written.
+    uint64_t fBytes;
+
+    /// Flag that a write failed.
+    bool fError;
+};
+#endif
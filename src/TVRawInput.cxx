@@ -0,0 +1,27 @@
+#include "TVRawInput.hxx"
+
+#include <sstream>
+
+bool CP::TVRawInput::FindBuilderOption(const std::string& args,
+                                       const std::string& key,
+                                       std::string& value) {
+    value = "";
+    std::size_t open = args.find('(');
+    if (open == std::string::npos) return false;
+    std::string argument = args.substr(open+1);
+    argument = argument.substr(0,argument.rfind(')'));
+    bool found = false;
+    std::istringstream items(argument);
+    std::string item;
+    while (std::getline(items,item,',')) {
+        if (item == key) {
+            value = "";
+            found = true;
+        }
+        else if (item.compare(0,key.size()+1,key + "=") == 0) {
+            value = item.substr(key.size()+1);
+            found = true;
+        }
+    }
+    return found;
+}
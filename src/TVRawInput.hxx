@@ -0,0 +1,76 @@
+#ifndef TVRawInput_hxx_seen
+#define TVRawInput_hxx_seen
+
+#include <TVInputFile.hxx>
+#include <TRunEventSet.hxx>
+
+#include <string>
+
+namespace CP {
+    class TVRawInput;
+    class TEventContext;
+};
+
+/// A base class for the raw DAQ inputs that can report the context (run,
+/// subrun, event and time stamp) of the next event without building it.
+/// After PeekContext() has been called, the event can either be passed over
+/// with SkipEvent(), or read with NextEvent() which commits to the full
+/// decode.  The headers are all that's read by PeekContext, so skimming,
+/// cataloging, and merging can work at the speed of the raw file I/O.
+///
+/// \code
+/// CP::TEventContext context;
+/// while (input->PeekContext(context)) {
+///     if (!Interesting(context)) {
+///         input->SkipEvent();
+///         continue;
+///     }
+///     CP::TEvent* event = input->NextEvent();
+/// }
+/// \endcode
+///
+/// The peek always reports the next event in the file, and doesn't apply
+/// the input selection (see TRunEventSet::SetInputSelection()).
+class CP::TVRawInput : public CP::TVInputFile {
+public:
+    TVRawInput() : fApplySelection(true) {}
+    virtual ~TVRawInput() {}
+
+    /// Fill the context for the next event in the file without decoding
+    /// the event.  Calling this again before the event is skipped or read
+    /// returns the same context.  This returns false if there are no more
+    /// events in the file.
+    virtual bool PeekContext(CP::TEventContext& context) = 0;
+
+    /// Pass over the next event in the file without decoding it.  If the
+    /// event hasn't been peeked, this will do that first.
+    virtual void SkipEvent() = 0;
+
+    /// Set whether NextEvent() applies the input selection.  This is on by
+    /// default, but should be turned off for an input that's being merged
+    /// into another event stream (e.g. the PDS events in TMergeInput don't
+    /// have a run number).
+    void ApplyInputSelection(bool apply) {fApplySelection = apply;}
+
+    /// Look for an option in the arguments given to a raw input builder
+    /// (e.g. "ubdaq(10,100,temp=5,follow)").  The options are separated by
+    /// commas, and are either "key" or "key=value".  This returns true if
+    /// the option was found, and sets the value (which is empty for a plain
+    /// "key").
+    static bool FindBuilderOption(const std::string& args,
+                                  const std::string& key,
+                                  std::string& value);
+
+protected:
+    /// Get the input selection that should be applied by NextEvent(), or
+    /// NULL if every event should be read.
+    const CP::TRunEventSet* GetSelection() const {
+        if (!fApplySelection) return NULL;
+        return CP::TRunEventSet::GetInputSelection();
+    }
+
+private:
+    /// Flag that the input selection should be applied.
+    bool fApplySelection;
+};
+#endif
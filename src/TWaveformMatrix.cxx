@@ -0,0 +1,133 @@
+#include "TWaveformMatrix.hxx"
+
+#include <TROOT.h>
+#include <TBuffer.h>
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+
+ClassImp(CP::TWaveformMatrix);
+
+namespace {
+    /// The number of samples in the alignment.
+    const int kAlignSamples = CP::TWaveformMatrix::kAlignment/sizeof(Short_t);
+}
+
+CP::TWaveformMatrix::TWaveformMatrix(const char* name, const char* title)
+    : CP::TDatum(name,title), fTicks(0), fStride(0), fFirstSample(0),
+      fOffset(0) {}
+
+CP::TWaveformMatrix::~TWaveformMatrix() {}
+
+CP::TWaveformMatrix::TWaveformMatrix(const CP::TWaveformMatrix& other)
+    : CP::TDatum(other), fTicks(other.fTicks), fStride(other.fStride),
+      fFirstSample(other.fFirstSample), fOffset(other.fOffset),
+      fChannel(other.fChannel), fSamples(other.fSamples) {
+    Align();
+}
+
+CP::TWaveformMatrix& CP::TWaveformMatrix::operator = (
+    const CP::TWaveformMatrix& other) {
+    if (this == &other) return *this;
+    CP::TDatum::operator = (other);
+    fTicks = other.fTicks;
+    fStride = other.fStride;
+    fFirstSample = other.fFirstSample;
+    fOffset = other.fOffset;
+    fChannel = other.fChannel;
+    fSamples = other.fSamples;
+    Align();
+    return *this;
+}
+
+void CP::TWaveformMatrix::Resize(int channels, int ticks, int firstSample) {
+    fTicks = std::max(0,ticks);
+    fStride = kAlignSamples*((fTicks + kAlignSamples - 1)/kAlignSamples);
+    fFirstSample = firstSample;
+    fChannel.clear();
+    fChannel.reserve(channels);
+    fSamples.clear();
+    fOffset = 0;
+    if (channels < 1 || fStride < 1) return;
+    // The extra samples leave room to move the first row onto the
+    // alignment.
+    fSamples.resize((std::size_t) channels*fStride + kAlignSamples);
+    Align();
+}
+
+int CP::TWaveformMatrix::GetCapacity() const {
+    if (fStride < 1 || fSamples.size() < (std::size_t) kAlignSamples) {
+        return 0;
+    }
+    return (fSamples.size() - kAlignSamples)/fStride;
+}
+
+bool CP::TWaveformMatrix::IsAligned() const {
+    if (fSamples.empty()) return true;
+    uintptr_t address = reinterpret_cast<uintptr_t>(&fSamples[fOffset]);
+    return (address % kAlignment) == 0;
+}
+
+void CP::TWaveformMatrix::Align() {
+    if (IsAligned()) return;
+    uintptr_t address = reinterpret_cast<uintptr_t>(&fSamples[0]);
+    int offset = ((kAlignment - address%kAlignment)%kAlignment)
+        / sizeof(Short_t);
+    std::size_t count = fSamples.size() - kAlignSamples;
+    std::memmove(&fSamples[offset], &fSamples[fOffset],
+                 count*sizeof(Short_t));
+    // Keep the padding zero so the file doesn't depend on the alignment.
+    if (offset < fOffset) {
+        std::fill(fSamples.begin() + offset + count,
+                  fSamples.begin() + fOffset + count, 0);
+    }
+    else {
+        std::fill(fSamples.begin() + fOffset, fSamples.begin() + offset, 0);
+    }
+    fOffset = offset;
+}
+
+void CP::TWaveformMatrix::Streamer(TBuffer& buffer) {
+    if (buffer.IsReading()) {
+        buffer.ReadClassBuffer(CP::TWaveformMatrix::Class(), this);
+        // The samples that were read can start anywhere, so move the rows
+        // back onto the alignment.
+        Align();
+    }
+    else {
+        buffer.WriteClassBuffer(CP::TWaveformMatrix::Class(), this);
+    }
+}
+
+int CP::TWaveformMatrix::AddRow(const CP::TChannelId& id,
+                                const char* samples, int count) {
+    int row = fChannel.size();
+    if (row >= GetCapacity()) return -1;
+    fChannel.push_back(id.AsUInt());
+    count = std::max(0, std::min(count, (int) fTicks));
+    if (count > 0) {
+        std::memcpy(GetRow(row), samples, count*sizeof(Short_t));
+    }
+    return row;
+}
+
+int CP::TWaveformMatrix::Find(const CP::TChannelId& id) const {
+    std::vector<UInt_t>::const_iterator row
+        = std::find(fChannel.begin(), fChannel.end(), id.AsUInt());
+    if (row == fChannel.end()) return -1;
+    return row - fChannel.begin();
+}
+
+void CP::TWaveformMatrix::ls(Option_t* opt) const {
+    CP::TDatum::ls(opt);
+    TROOT::IncreaseDirLevel();
+    TROOT::IndentLevel();
+    std::cout << "channels: " << GetChannelCount()
+              << " ticks: " << fTicks
+              << " stride: " << fStride
+              << " first sample: " << fFirstSample
+              << std::endl;
+    TROOT::DecreaseDirLevel();
+}
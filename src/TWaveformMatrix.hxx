@@ -0,0 +1,129 @@
+#ifndef TWaveformMatrix_hxx_seen
+#define TWaveformMatrix_hxx_seen
+
+#include <TDatum.hxx>
+#include <TChannelId.hxx>
+
+#include <vector>
+
+namespace CP {
+    class TWaveformMatrix;
+};
+
+/// The TPC samples of one crate in an event saved as a dense channels by
+/// ticks matrix of 16 bit samples, with a column of the channel ids for
+/// the rows.  This is filled by TUBDAQInput while the crate is decoded
+/// (see TUBDAQInput::SetWaveformMatrix()) so that the noise filters and
+/// the deconvolution can work on the matrix without collecting the samples
+/// out of a TPulseDigit for each channel.
+///
+/// Every row starts on a 64 byte boundary so the rows can be used with
+/// aligned vector loads, and the stride between rows (see GetStride()) is
+/// at least the number of ticks.  The padding at the end of each row is
+/// zero, and so are the ticks after the end of a channel that is shorter
+/// than the matrix.  Column zero is the sample given by GetFirstSample().
+/// The alignment is restored when a matrix is copied, and by the streamer
+/// when a matrix is read from a file (see TWaveformMatrix_LinkDef.h).
+///
+/// \code
+/// CP::THandle<CP::TWaveformMatrix> matrix
+///     = event->Get<CP::TWaveformMatrix>("~/waveforms/crate1");
+/// for (int row = 0; row < matrix->GetChannelCount(); ++row) {
+///     const Short_t* samples = matrix->GetRow(row);
+///     ...
+/// }
+/// \endcode
+class CP::TWaveformMatrix : public CP::TDatum {
+public:
+    TWaveformMatrix(const char* name = "waveforms",
+                    const char* title = "TPC Waveform Matrix");
+    virtual ~TWaveformMatrix();
+
+    /// Copy a matrix.  The copy is aligned.
+    TWaveformMatrix(const CP::TWaveformMatrix& other);
+    CP::TWaveformMatrix& operator = (const CP::TWaveformMatrix& other);
+
+    /// The alignment of the rows in bytes.
+    enum {kAlignment = 64};
+
+    /// Make room for channels rows of ticks samples each starting at
+    /// firstSample.  The rows that were already added are removed.
+    void Resize(int channels, int ticks, int firstSample);
+
+    /// Add a row for a channel and copy the samples into it.  The samples
+    /// are a char array since the raw channel data may not be aligned, and
+    /// the samples past the number of ticks are dropped.  This returns the
+    /// row, or -1 if the matrix is full.
+    int AddRow(const CP::TChannelId& id, const char* samples, int count);
+
+    /// Get the number of rows that have been added.
+    int GetChannelCount() const {return fChannel.size();}
+
+    /// Get the number of ticks in each row.
+    int GetTickCount() const {return fTicks;}
+
+    /// Get the number of samples from the start of one row to the next.
+    int GetStride() const {return fStride;}
+
+    /// Get the sample number of the first tick.
+    int GetFirstSample() const {return fFirstSample;}
+
+    /// Get the channel for a row.
+    CP::TChannelId GetChannelId(int row) const {
+        return CP::TChannelId(fChannel[row]);
+    }
+
+    /// Find the row for a channel.  This returns -1 if the channel isn't
+    /// in the matrix.
+    int Find(const CP::TChannelId& id) const;
+
+    /// Get the first row of the matrix.  The rows follow each other, and
+    /// are GetStride() samples apart.
+    const Short_t* GetData() const {
+        if (fSamples.empty()) return NULL;
+        return &fSamples[fOffset];
+    }
+    Short_t* GetData() {
+        if (fSamples.empty()) return NULL;
+        return &fSamples[fOffset];
+    }
+
+    /// Get the samples for a row.
+    const Short_t* GetRow(int row) const {return GetData() + row*fStride;}
+    Short_t* GetRow(int row) {return GetData() + row*fStride;}
+
+    /// Print the matrix.
+    virtual void ls(Option_t* opt = "") const;
+
+private:
+    /// Check that the rows start on the alignment.
+    bool IsAligned() const;
+
+    /// Move the rows so they start on the alignment.  This is needed after
+    /// the samples were read from a file.
+    void Align();
+
+    /// Get the number of rows there is room for.
+    int GetCapacity() const;
+
+    /// The number of ticks in a row.
+    Int_t fTicks;
+
+    /// The number of samples from one row to the next.
+    Int_t fStride;
+
+    /// The sample number of the first tick.
+    Int_t fFirstSample;
+
+    /// The offset of the first row in the samples.
+    Int_t fOffset;
+
+    /// The channel ids of the rows.
+    std::vector<UInt_t> fChannel;
+
+    /// The samples of the rows with room to align the first row.
+    std::vector<Short_t> fSamples;
+
+    ClassDef(TWaveformMatrix,1);
+};
+#endif
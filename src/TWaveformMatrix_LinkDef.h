@@ -0,0 +1,9 @@
+// The TWaveformMatrix streamer is written by hand so that the rows are
+// moved back onto the alignment after the matrix is read.
+#ifdef __CINT__
+#pragma link off all globals;
+#pragma link off all classes;
+#pragma link off all functions;
+
+#pragma link C++ class CP::TWaveformMatrix-;
+#endif
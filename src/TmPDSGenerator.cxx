@@ -0,0 +1,160 @@
+#include "TmPDSGenerator.hxx"
+
+#include <TCaptLog.hxx>
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+
+CP::TmPDSGenerator::TmPDSGenerator(int seed)
+    : fRandom(seed), fDigitizers(3), fChannels(8), fSamples(2000),
+      fNoise(2.0), fPulseRate(5.0), fStartTime(1325376000.0),
+      fTriggerRate(100.0), fJitter(0.0), fDisorder(0.0),
+      fGPS(false), fGPSOffset(0.0) {}
+
+CP::TmPDSGenerator::~TmPDSGenerator() {}
+
+void CP::TmPDSGenerator::SetLayout(int digitizers, int channels,
+                                   int samples) {
+    fDigitizers = std::max(1, std::min((int) kMaxDigitizers, digitizers));
+    fChannels = std::max(1, std::min((int) kMaxChannels, channels));
+    fSamples = std::max(1, std::min((int) kMaxSamples, samples));
+}
+
+void CP::TmPDSGenerator::MakeSamples(unsigned short* samples) {
+    double baseline = 3900 + fRandom.Uniform(50.0);
+    std::vector<double> signal(fSamples, baseline);
+    // The pulses have a fast rise and an exponential tail.
+    int pulses = fRandom.Poisson(fPulseRate);
+    for (int p = 0; p < pulses; ++p) {
+        int start = fRandom.Uniform(fSamples);
+        double height = 20.0 + fRandom.Exp(60.0);
+        for (int s = start; s < fSamples && s < start + 80; ++s) {
+            signal[s] -= height*std::exp(-(s-start)/8.0);
+        }
+    }
+    for (int s = 0; s < fSamples; ++s) {
+        int value = signal[s] + fRandom.Gaus(0.0, fNoise) + 0.5;
+        samples[s] = std::max(0, std::min(0xFFF, value));
+    }
+}
+
+bool CP::TmPDSGenerator::Write(const std::string& fileName, int events) {
+    TFile file(fileName.c_str(), "RECREATE");
+    if (!file.IsOpen()) {
+        CaptError("Cannot write " << fileName);
+        return false;
+    }
+
+    UInt_t eventNumber;
+    Int_t computerSeconds;
+    Long64_t computerNanoseconds;
+    UInt_t gpsNanoseconds;
+    UInt_t gpsSecondsIntoDay;
+    UShort_t gpsDaysIntoYear;
+    UShort_t gpsYear;
+    UShort_t gpsFlag;
+    UInt_t digitizerSize[kMaxDigitizers];
+    UInt_t digitizerMask[kMaxDigitizers*kMaxChannels];
+    UInt_t digitizerEvent[kMaxDigitizers];
+    UInt_t digitizerTime[kMaxDigitizers];
+    std::vector<UShort_t> waveforms(kMaxDigitizers*kMaxChannels*kMaxSamples);
+    UInt_t digitizers = fDigitizers;
+    UInt_t channels = fChannels;
+    UInt_t samples = fSamples;
+    UInt_t data = fDigitizers*fChannels*fSamples;
+
+    TTree tree("pmt_tree", "Synthetic PDS events");
+    tree.Branch("event_number", &eventNumber, "event_number/i");
+    tree.Branch("computer_secIntoEpoch", &computerSeconds,
+                "computer_secIntoEpoch/I");
+    tree.Branch("computer_nsIntoSec", &computerNanoseconds,
+                "computer_nsIntoSec/L");
+    tree.Branch("gps_nsIntoSec", &gpsNanoseconds, "gps_nsIntoSec/i");
+    tree.Branch("gps_secIntoDay", &gpsSecondsIntoDay, "gps_secIntoDay/i");
+    tree.Branch("gps_daysIntoYear", &gpsDaysIntoYear, "gps_daysIntoYear/s");
+    tree.Branch("gps_Year", &gpsYear, "gps_Year/s");
+    tree.Branch("gps_ctrlFlag", &gpsFlag, "gps_ctrlFlag/s");
+    tree.Branch("nDigitizers", &digitizers, "nDigitizers/i");
+    tree.Branch("nChannels", &channels, "nChannels/i");
+    tree.Branch("nSamples", &samples, "nSamples/i");
+    tree.Branch("nData", &data, "nData/i");
+    tree.Branch("digitizer_size", digitizerSize, "digitizer_size[3]/i");
+    tree.Branch("digitizer_chMask", digitizerMask, "digitizer_chMask[24]/i");
+    tree.Branch("digitizer_evNum", digitizerEvent, "digitizer_evNum[3]/i");
+    tree.Branch("digitizer_time", digitizerTime, "digitizer_time[3]/i");
+    tree.Branch("digitizer_waveforms", &waveforms[0],
+                "digitizer_waveforms[nData]/s");
+
+    // The trigger times are made first so that neighboring events can be
+    // swapped.
+    std::vector<double> triggers(events);
+    double time = fStartTime;
+    for (int i = 0; i < events; ++i) {
+        triggers[i] = time;
+        time += fRandom.Exp(1.0/fTriggerRate);
+    }
+    std::vector<int> order(events);
+    for (int i = 0; i < events; ++i) order[i] = i;
+    for (int i = 0; i+1 < events; ++i) {
+        if (fRandom.Uniform() >= fDisorder) continue;
+        std::swap(order[i], order[i+1]);
+        ++i;
+    }
+
+    for (int i = 0; i < events; ++i) {
+        int trigger = order[i];
+        eventNumber = trigger;
+
+        double computer = triggers[trigger];
+        if (fJitter > 0) computer += fRandom.Gaus(0.0, fJitter);
+        computerSeconds = std::floor(computer);
+        computerNanoseconds = 1E9*(computer - computerSeconds);
+
+        gpsNanoseconds = gpsSecondsIntoDay = 0;
+        gpsDaysIntoYear = gpsYear = gpsFlag = 0;
+        if (fGPS) {
+            // TmPDSInput counts the days from the last day of the previous
+            // year, and the years from 1996.
+            double gps = triggers[trigger] + fGPSOffset;
+            std::time_t seconds = std::floor(gps);
+            struct tm date;
+            gmtime_r(&seconds, &date);
+            gpsNanoseconds = 1E9*(gps - seconds);
+            gpsSecondsIntoDay = 3600*date.tm_hour + 60*date.tm_min
+                + date.tm_sec;
+            gpsDaysIntoYear = date.tm_yday + 1;
+            gpsYear = date.tm_year - 96;
+            gpsFlag = 1;
+        }
+
+        for (int d = 0; d < kMaxDigitizers; ++d) {
+            bool used = d < fDigitizers;
+            // The V1720 event size is in 32 bit words with a four word
+            // header, and the time tag counts 8 ns ticks.
+            digitizerSize[d] = used ? 4 + fChannels*fSamples/2 : 0;
+            digitizerEvent[d] = used ? trigger : 0;
+            digitizerTime[d] = used
+                ? (UInt_t) std::fmod(triggers[trigger]*125E6, 2147483648.0)
+                : 0;
+            for (int c = 0; c < kMaxChannels; ++c) {
+                digitizerMask[d*kMaxChannels + c] = (used && c < fChannels);
+            }
+        }
+        for (int d = 0; d < fDigitizers; ++d) {
+            for (int c = 0; c < fChannels; ++c) {
+                MakeSamples(&waveforms[(d*fChannels + c)*fSamples]);
+            }
+        }
+
+        tree.Fill();
+    }
+
+    tree.Write();
+    file.Close();
+    return true;
+}
@@ -0,0 +1,102 @@
+#ifndef TmPDSGenerator_hxx_seen
+#define TmPDSGenerator_hxx_seen
+
+#include <TRandom3.h>
+
+#include <string>
+
+namespace CP {
+    class TmPDSGenerator;
+};
+
+/// Make synthetic miniCAPTAIN PDS DAQ files so that TmPDSInput, and the time
+/// window join in TMergeInput, can be benchmarked and stress tested without
+/// DAQ data.  The file has a "pmt_tree" with the branches read by
+/// TmPDSInput.  The waveforms are a baseline with gaussian noise, and
+/// negative going photoelectron pulses that arrive at a given rate.
+///
+/// The triggers arrive randomly at a mean rate starting from a given time
+/// (usually the time of the first TPC event), so there are several PDS
+/// events for each TPC event.  The computer time that is saved can be
+/// smeared (the jitter), and a fraction of the neighboring events can be
+/// swapped so that the file isn't in time order.  The GPS branches are
+/// filled when requested, and are otherwise zero (the way the DAQ writes
+/// them when the GPS isn't available).
+///
+/// \code
+/// CP::TmPDSGenerator generator;
+/// generator.SetTime(tpcStart, 100.0);
+/// generator.SetJitter(1E-3);
+/// generator.Write("synthetic.pds.root",10000);
+/// \endcode
+///
+/// The same seed always makes the same file.
+class CP::TmPDSGenerator {
+public:
+    explicit TmPDSGenerator(int seed = 1);
+    virtual ~TmPDSGenerator();
+
+    /// Set the number of digitizers (no more than 3), the channels on each
+    /// digitizer (no more than 8), and the samples in each channel (no more
+    /// than 4096).
+    void SetLayout(int digitizers, int channels, int samples);
+
+    /// Set the RMS of the noise in ADC counts.
+    void SetNoise(double rms) {fNoise = rms;}
+
+    /// Set the mean number of photoelectron pulses in each channel of an
+    /// event.
+    void SetPulseRate(double pulses) {fPulseRate = pulses;}
+
+    /// Set the unix time of the first trigger (in seconds), and the mean
+    /// trigger rate (in Hz).
+    void SetTime(double start, double rate) {
+        fStartTime = start;
+        fTriggerRate = rate;
+    }
+
+    /// Set the RMS (in seconds) of the smearing added to the computer time.
+    void SetJitter(double seconds) {fJitter = seconds;}
+
+    /// Set the fraction of the events that are swapped with the next event
+    /// in the file.
+    void SetDisorder(double fraction) {fDisorder = fraction;}
+
+    /// Fill the GPS branches.  The GPS time is the trigger time plus the
+    /// offset (in seconds).
+    void SetGPS(bool gps, double offset = 0) {
+        fGPS = gps;
+        fGPSOffset = offset;
+    }
+
+    /// Write a file with the given number of events.  This returns false if
+    /// the file can't be written.
+    bool Write(const std::string& fileName, int events);
+
+    /// The limits of the layout.
+    enum {
+        kMaxDigitizers = 3,
+        kMaxChannels = 8,
+        kMaxSamples = 4096
+    };
+
+private:
+    /// Fill the samples for one channel.
+    void MakeSamples(unsigned short* samples);
+
+    /// The random number generator.
+    TRandom3 fRandom;
+
+    int fDigitizers;
+    int fChannels;
+    int fSamples;
+    double fNoise;
+    double fPulseRate;
+    double fStartTime;
+    double fTriggerRate;
+    double fJitter;
+    double fDisorder;
+    bool fGPS;
+    double fGPSOffset;
+};
+#endif
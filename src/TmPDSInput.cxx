@@ -11,14 +11,20 @@
 #include "TIntegerDatum.hxx"
 #include "TPulseDigit.hxx"
 #include "TPDSChannelId.hxx"
+#include "TRunEventSet.hxx"
 
 #include <TFile.h>
 #include <TTree.h>
 #include <TFolder.h>
 
 #include <iostream>
+#include <sstream>
 #include <memory>
 #include <ctime>
+#include <cstring>
+#include <algorithm>
+#include <list>
+#include <map>
 
 namespace {
     std::time_t unixMkTimeIsInsane(struct tm* tmStruct) {
@@ -58,9 +64,22 @@ namespace {
     class TmPDSInputBuilder : public CP::TVInputBuilder {
     public:
         TmPDSInputBuilder() 
-            : CP::TVInputBuilder("mPDS", "Read a miniCAPTAIN PDS DAQ file") {}
+            : CP::TVInputBuilder("mPDS", "Read a miniCAPTAIN PDS DAQ file"
+                                 " [mPDS(lru[=MB])]") {}
         CP::TVInputFile* Open(const char* file) const {
-            return new CP::TmPDSInput(file,"OLD");
+            std::auto_ptr<CP::TmPDSInput> input(
+                new CP::TmPDSInput(file,"OLD"));
+            std::string value;
+            if (CP::TVRawInput::FindBuilderOption(GetArguments(),
+                                                  "lru", value)) {
+                double megabytes = 64;
+                if (!value.empty()) {
+                    std::istringstream parse(value);
+                    parse >> megabytes;
+                }
+                input->SetEventCache(megabytes);
+            }
+            return input.release();
         }
     };
 
@@ -74,23 +93,84 @@ namespace {
 
 }
 
+/// The tree entries kept in memory.  Each entry is a copy of the leaves,
+/// with only the waveform samples that are used.
+class CP::TmPDSInput::EntryCache {
+public:
+    struct Entry {
+        UInt_t          event_number;
+        Int_t           computer_secIntoEpoch;
+        Long64_t        computer_nsIntoSec;
+        UInt_t          gps_nsIntoSec;
+        UInt_t          gps_secIntoDay;
+        UShort_t        gps_daysIntoYear;
+        UShort_t        gps_Year;
+        UShort_t        gps_ctrlFlag;
+        UInt_t          digitizer_size[MAXDIGITIZER];
+        UInt_t          digitizer_chMask[MAXDIGITIZER*MAXCHANNELS];
+        UInt_t          digitizer_evNum[MAXDIGITIZER];
+        UInt_t          digitizer_time[MAXDIGITIZER];
+        UInt_t          nDigitizers;
+        UInt_t          nChannels;
+        UInt_t          nSamples;
+        UInt_t          nData;
+        std::vector<UShort_t> Waveforms;
+        std::list<Int_t>::iterator Use;
+
+        std::size_t GetSize() const {
+            return sizeof(Entry) + Waveforms.size()*sizeof(UShort_t);
+        }
+    };
+
+    explicit EntryCache(double megabytes)
+        : Budget(megabytes*1024*1024), Size(0) {}
+
+    /// The most memory to use.
+    std::size_t Budget;
+
+    /// The memory used by the entries.
+    std::size_t Size;
+
+    /// The entries by tree entry number.
+    std::map<Int_t, Entry> Entries;
+
+    /// The entry numbers with the most recently used first.
+    std::list<Int_t> UseOrder;
+
+    /// Drop the least recently used entries until the cache fits the
+    /// budget.  The most recent entry is always kept.
+    void Trim() {
+        while (Size > Budget && UseOrder.size() > 1) {
+            std::map<Int_t, Entry>::iterator e
+                = Entries.find(UseOrder.back());
+            Size -= e->second.GetSize();
+            Entries.erase(e);
+            UseOrder.pop_back();
+        }
+    }
+};
+
 CP::TmPDSInput::TmPDSInput(const char* name, Option_t* option, Int_t compress) 
     : fFile(NULL), fSequence(0), fEventTree(NULL), 
-      fEventsRead(0), fAttached(false) {
+      fEventsRead(0), fAttached(false), fProfile("mPDS"),
+      fSelection(NULL), fEntryCache(NULL) {
     fFile = new TFile(name, option, "PDS Input File", compress);
     if (!fFile || !fFile->IsOpen()) {
         throw CP::EPDSInputFileMissing();
     }
+    InitProfile();
     IsAttached();
     CaptVerbose("Input file " << fFile->GetName() << " is open");
 }
 
 CP::TmPDSInput::TmPDSInput(TFile* file) 
     : fFile(file), fSequence(0), fEventTree(NULL),
-      fEventsRead(0), fAttached(false) {
+      fEventsRead(0), fAttached(false), fProfile("mPDS"),
+      fSelection(NULL), fEntryCache(NULL) {
     if (!IsOpen()) {
         throw CP::ENoInputFile();
     }
+    InitProfile();
     IsAttached();
     
     CaptVerbose("PDS Input file " << fFile->GetName() << " is open");
@@ -99,6 +179,7 @@ CP::TmPDSInput::TmPDSInput(TFile* file)
 CP::TmPDSInput::~TmPDSInput(void) {
     Close();
     if (fFile) delete fFile;
+    delete fEntryCache;
 }
 
 #ifdef PRIVATE_COPY
@@ -109,6 +190,25 @@ CP::TmPDSInput::TmPDSInput(const CP::TmPDSInput& aFile) {
 }
 #endif
 
+void CP::TmPDSInput::InitProfile() {
+    fProfile.SetName(std::string("mPDS ") + fFile->GetName());
+    // The stages and counters must be added in the order of the enums.
+    fProfile.AddStage("read");
+    fProfile.AddStage("digits");
+    fProfile.AddCounter("bytes in");
+    fProfile.AddCounter("channels");
+    fProfile.AddCounter("samples");
+    fProfile.AddCounter("digits");
+}
+
+void CP::TmPDSInput::SetEventCache(double megabytes) {
+    delete fEntryCache;
+    fEntryCache = NULL;
+    if (megabytes <= 0) return;
+    fEntryCache = new EntryCache(megabytes);
+    CaptLog("PDS event cache: " << megabytes << " MB");
+}
+
 const char* CP::TmPDSInput::GetInputName() const {
     if (fFile) return fFile->GetName();
     return NULL;
@@ -217,9 +317,66 @@ bool CP::TmPDSInput::EndOfFile(void) {
     return false;
 }
 
+void CP::TmPDSInput::FillContext(CP::TEventContext& context) const {
+    context.SetEvent(event_number);
+    context.SetRun(0);
+    context.SetPartition(CP::TEventContext::kmCAPTAIN);
+    context.SetTimeStamp(computer_secIntoEpoch);
+    context.SetNanoseconds(computer_nsIntoSec);
+}
+
+bool CP::TmPDSInput::PeekContext(CP::TEventContext& context) {
+    if (!IsAttached()) return false;
+    Int_t next = fSequence+1;
+    if (next < 0 || GetEventsInFile() <= next) return false;
+    // Only read the branches needed for the context.  The waveforms are
+    // most of the entry.
+    if (b_event_number->GetEntry(next) < 1) return false;
+    b_computer_secIntoEpoch->GetEntry(next);
+    b_computer_nsIntoSec->GetEntry(next);
+    FillContext(context);
+    return true;
+}
+
+void CP::TmPDSInput::SkipEvent() {
+    ++fSequence;
+}
+
+void CP::TmPDSInput::BuildSelectedEntries(
+    const CP::TRunEventSet* selection) {
+    fSelection = selection;
+    fSelectedEntries.clear();
+    if (!selection) return;
+    if (!IsAttached()) return;
+    // The PDS DAQ doesn't have a run or subrun number, so the run is always
+    // zero (see ReadEvent).
+    Int_t entries = GetEventsInFile();
+    for (Int_t i = 0; i < entries; ++i) {
+        if (b_event_number->GetEntry(i) < 1) continue;
+        if (!selection->Contains(0, CP::TRunEventSet::kAnySubRun,
+                                 event_number)) continue;
+        fSelectedEntries.push_back(i);
+    }
+    CaptLog("PDS selection: " << fSelectedEntries.size()
+            << " of " << entries << " events");
+}
+
 CP::TEvent* CP::TmPDSInput::NextEvent(int skip) {
     if (skip>0) fSequence += skip;
-    return ReadEvent(++fSequence);
+    const CP::TRunEventSet* selection = GetSelection();
+    if (!selection) return ReadEvent(++fSequence);
+
+    // Jump straight to the next selected entry.  The index is built the
+    // first time it's needed.
+    if (selection != fSelection) BuildSelectedEntries(selection);
+    std::vector<Int_t>::iterator next
+        = std::upper_bound(fSelectedEntries.begin(), fSelectedEntries.end(),
+                           fSequence);
+    if (next == fSelectedEntries.end()) {
+        fSequence = GetEventsInFile();
+        return NULL;
+    }
+    return ReadEvent(*next);
 }
 
 CP::TEvent* CP::TmPDSInput::PreviousEvent(int skip) {
@@ -227,6 +384,75 @@ CP::TEvent* CP::TmPDSInput::PreviousEvent(int skip) {
     return ReadEvent(--fSequence);
 }
 
+int CP::TmPDSInput::ReadEntry(Int_t entry) {
+    if (fEntryCache) {
+        std::map<Int_t, EntryCache::Entry>::iterator cached
+            = fEntryCache->Entries.find(entry);
+        if (cached != fEntryCache->Entries.end()) {
+            EntryCache::Entry& e = cached->second;
+            fEntryCache->UseOrder.splice(fEntryCache->UseOrder.begin(),
+                                         fEntryCache->UseOrder, e.Use);
+            event_number = e.event_number;
+            computer_secIntoEpoch = e.computer_secIntoEpoch;
+            computer_nsIntoSec = e.computer_nsIntoSec;
+            gps_nsIntoSec = e.gps_nsIntoSec;
+            gps_secIntoDay = e.gps_secIntoDay;
+            gps_daysIntoYear = e.gps_daysIntoYear;
+            gps_Year = e.gps_Year;
+            gps_ctrlFlag = e.gps_ctrlFlag;
+            std::memcpy(digitizer_size, e.digitizer_size,
+                        sizeof(digitizer_size));
+            std::memcpy(digitizer_chMask, e.digitizer_chMask,
+                        sizeof(digitizer_chMask));
+            std::memcpy(digitizer_evNum, e.digitizer_evNum,
+                        sizeof(digitizer_evNum));
+            std::memcpy(digitizer_time, e.digitizer_time,
+                        sizeof(digitizer_time));
+            nDigitizers = e.nDigitizers;
+            nChannels = e.nChannels;
+            nSamples = e.nSamples;
+            nData = e.nData;
+            std::copy(e.Waveforms.begin(), e.Waveforms.end(),
+                      digitizer_waveforms);
+            return 1;
+        }
+    }
+
+    CP::TRawInputProfile::Timer readTimer(&fProfile,kStageRead);
+    int nBytes = fEventTree->GetEntry(entry);
+    readTimer.Stop();
+    if (nBytes < 1 || !fEntryCache) return nBytes;
+
+    EntryCache::Entry& e = fEntryCache->Entries[entry];
+    e.event_number = event_number;
+    e.computer_secIntoEpoch = computer_secIntoEpoch;
+    e.computer_nsIntoSec = computer_nsIntoSec;
+    e.gps_nsIntoSec = gps_nsIntoSec;
+    e.gps_secIntoDay = gps_secIntoDay;
+    e.gps_daysIntoYear = gps_daysIntoYear;
+    e.gps_Year = gps_Year;
+    e.gps_ctrlFlag = gps_ctrlFlag;
+    std::memcpy(e.digitizer_size, digitizer_size, sizeof(digitizer_size));
+    std::memcpy(e.digitizer_chMask, digitizer_chMask,
+                sizeof(digitizer_chMask));
+    std::memcpy(e.digitizer_evNum, digitizer_evNum, sizeof(digitizer_evNum));
+    std::memcpy(e.digitizer_time, digitizer_time, sizeof(digitizer_time));
+    e.nDigitizers = nDigitizers;
+    e.nChannels = nChannels;
+    e.nSamples = nSamples;
+    e.nData = nData;
+    // Only keep the samples that are used to build the digits.
+    std::size_t samples = std::max<std::size_t>(
+        nData, std::size_t(nDigitizers)*nChannels*nSamples);
+    samples = std::min<std::size_t>(samples, MAXDATA);
+    e.Waveforms.assign(digitizer_waveforms, digitizer_waveforms+samples);
+    fEntryCache->UseOrder.push_front(entry);
+    e.Use = fEntryCache->UseOrder.begin();
+    fEntryCache->Size += e.GetSize();
+    fEntryCache->Trim();
+    return nBytes;
+}
+
 CP::TEvent* CP::TmPDSInput::ReadEvent(Int_t n) {
     // Read the n'th event (starting from 0) in the file
     fSequence = n;
@@ -237,8 +463,9 @@ CP::TEvent* CP::TmPDSInput::ReadEvent(Int_t n) {
 
     if (!IsAttached()) return NULL;
  
-    // Read the new event from the tree.
-    int nBytes = fEventTree->GetEntry(fSequence);
+    // Read the new event from the tree (or the cache).
+    int nBytes = ReadEntry(fSequence);
+    if (nBytes > 1) fProfile.Count(kCountBytesIn, nBytes);
     if (nBytes > 0) {
         ++fEventsRead;
     } else {
@@ -247,11 +474,7 @@ CP::TEvent* CP::TmPDSInput::ReadEvent(Int_t n) {
 
     // Create the context.
     CP::TEventContext context;
-    context.SetEvent(event_number);
-    context.SetRun(0);
-    context.SetPartition(CP::TEventContext::kmCAPTAIN);
-    context.SetTimeStamp(computer_secIntoEpoch);
-    context.SetNanoseconds(computer_nsIntoSec);
+    FillContext(context);
     
     // Create the event.
     std::auto_ptr<CP::TEvent> newEvent(new CP::TEvent(context));
@@ -304,6 +527,7 @@ CP::TEvent* CP::TmPDSInput::ReadEvent(Int_t n) {
         pmt = newEvent->Get<CP::TDigitContainer>("~/digits/pmt");
     }
 
+    CP::TRawInputProfile::Timer digitTimer(&fProfile,kStageDigits);
     for (int i = 0; i< nDigitizers; ++i) {
         for (int j=0; j<nChannels; ++j) {
             // Get the digits from the event.
@@ -316,14 +540,20 @@ CP::TEvent* CP::TmPDSInput::ReadEvent(Int_t n) {
             CP::TPDSChannelId chanId(0,i,j);
             CP::TPulseDigit* digit = new TPulseDigit(chanId,0,adc);
             pmt->push_back(digit);
+            fProfile.Count(kCountChannels);
+            fProfile.Count(kCountSamples, nSamples);
+            fProfile.Count(kCountDigits);
         }
     }
-    
+    digitTimer.Stop();
+
+    fProfile.EndEvent(context.GetRun(), context.GetEvent());
     return newEvent.release();
 }
 
 void CP::TmPDSInput::Close(Option_t* opt) {
     if (!IsOpen()) return;
+    fProfile.PrintSummary();
     fFile->Close(opt);
 }
 
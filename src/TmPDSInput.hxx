@@ -4,7 +4,10 @@
 #include <TFile.h>
 
 #include "ECore.hxx"
-#include "TVInputFile.hxx"
+#include "TVRawInput.hxx"
+#include "TRawInputProfile.hxx"
+
+#include <vector>
 
 class TTree;
 class TBranch;
@@ -14,7 +17,9 @@ namespace CP {
     EXCEPTION(EPDSNoEvents,EInputFile);
 
     class TEvent;
+    class TEventContext;
     class TmPDSInput;
+    class TRunEventSet;
 }
 
 /// Attach to a miniCAPTAIN PDS DAQ file so that the photon detection system
@@ -22,7 +27,7 @@ namespace CP {
 /// container, and the GPS time stamp is in a TIntegerDatum (second,ns).  Be
 /// aware that the GPS time doesn't seem to take into account the leap seconds
 /// so it's offset from the computer time by more than 15 seconds!
-class CP::TmPDSInput : public TVInputFile {
+class CP::TmPDSInput : public TVRawInput {
 public:
     /// Open an input file. 
     TmPDSInput(const char* fName, Option_t* option="", int compress = 1);
@@ -57,8 +62,9 @@ public:
     /// event in the file.
     virtual bool EndOfFile(void);
 
-    /// Return the first event in the file.
-    virtual TEvent* FirstEvent(void) {return ReadEvent(0);}
+    /// Return the first event in the file (the first selected event if
+    /// there is an input selection).
+    virtual TEvent* FirstEvent(void) {fSequence = -1; return NextEvent();}
 
     /// Read the next event in the file.
     virtual TEvent* NextEvent(int skip = 0);
@@ -77,6 +83,18 @@ public:
     /// NULL.
     virtual TEvent* ReadEvent(Int_t n);
 
+    /// Fill the context of the next event.  Only the event number and
+    /// computer time branches are read.
+    virtual bool PeekContext(CP::TEventContext& context);
+
+    /// Skip the next event without reading the waveforms.
+    virtual void SkipEvent();
+
+    /// Move to a tree entry without reading it, so the entry is the next
+    /// event that is peeked or read.  This is used to read the events
+    /// found in a raw catalog (see TCatalogInput).
+    void SeekEntry(Int_t entry) {fSequence = entry-1;}
+
     /// Make sure that the file is closed.  This method is specific to
     /// TmPDSInput.
     virtual void Close(Option_t* opt = "");
@@ -97,7 +115,37 @@ public:
     /// Return the file name to provide the base abstract input name class.
     virtual const char* GetInputName(void) const;
 
+    /// Get the profile of the time spent reading the file (see
+    /// TRawInputProfile).
+    CP::TRawInputProfile& GetProfile() {return fProfile;}
+
+    /// Keep up to megabytes of the most recently read tree entries in
+    /// memory so that moving back and forth through the file with
+    /// ReadEvent() and PreviousEvent() doesn't read and decompress the
+    /// entries again.  The least recently used entries are dropped when the
+    /// cache is full, and the event is built from the cached entry.  This
+    /// can be set from the command line with -tmPDS(lru[=<MB>]), where the
+    /// default is 64 MB.  The cache is off (zero) unless it's asked for.
+    void SetEventCache(double megabytes);
+
 private:
+    /// The stages timed by the profile.
+    enum {
+        kStageRead,             // Reading the tree entry.
+        kStageDigits            // Copying the samples into digits.
+    };
+
+    /// The counters kept by the profile.
+    enum {
+        kCountBytesIn,          // Bytes read from the tree.
+        kCountChannels,         // Channels converted.
+        kCountSamples,          // Samples converted.
+        kCountDigits            // Digits made.
+    };
+
+    /// Add the stages and counters to the profile.
+    void InitProfile();
+
     TFile* fFile;               // The file to get events from.
     Int_t fSequence;            // The sequence number of the last event read.
 
@@ -106,6 +154,35 @@ private:
     Int_t fEventsRead;          //! count of events read from file
     bool fAttached;             //! are we prepared to read from the file?
 
+    /// The profile of the time spent reading the file.
+    CP::TRawInputProfile fProfile; //!
+
+    /// Fill the context from the current values of the branch leaves.
+    void FillContext(CP::TEventContext& context) const;
+
+    /// Build the list of tree entries that are in the input selection.  Only
+    /// the event_number branch is read, so this is fast even for large
+    /// files.
+    void BuildSelectedEntries(const CP::TRunEventSet* selection);
+
+    /// The input selection used to build the list of selected entries.
+    const CP::TRunEventSet* fSelection; //!
+
+    /// The sorted tree entries of the events in the input selection.
+    std::vector<Int_t> fSelectedEntries; //!
+
+    /// The cache of the recently read tree entries.  This is defined in the
+    /// source.
+    class EntryCache;
+
+    /// Read a tree entry into the leaves, using the cache if there is one.
+    /// This returns the number of bytes read from the tree (or one if the
+    /// entry was in the cache), and zero if the entry couldn't be read.
+    int ReadEntry(Int_t entry);
+
+    /// The cache of tree entries, or NULL if it's not used.
+    EntryCache* fEntryCache; //!
+
 #ifdef PRIVATE_COPY
 private:
     TmPDSInput(const TmPDSInput& aFile);
@@ -1,6 +1,9 @@
 #include "cardData.h"
 #include <stdexcept>
 #include <iostream> // For debugging
+#include <cstring>
+#include <vector>
+#include "wordScan.h"
 
 using namespace gov::fnal::uboone::datatypes;
 
@@ -33,98 +36,83 @@ void cardData::updateIOMode(uint8_t new_mode, int total_size=0){
     return;
 
   if(new_mode >= IO_GRANULARITY_CHANNEL && cardData_IO_mode < IO_GRANULARITY_CHANNEL){
-    size_t total_data_read = 0;
     const size_t size16 = sizeof(uint16_t);
-    // std::cout << "Start card." << std::endl;
+    const char* data = getCardDataPtr();
+    const size_t n_words = card_data_size/size16;
 
-    while(total_data_read < card_data_size){
+    // For variable length (huffman) channels, find every word that could
+    // be a channel trailer (0x5xxx) in one pass over the card.
+    std::vector<uint32_t> trailers;
+    if(total_size <= 0) findWords(data, n_words, 0xF000, 0x5000, trailers);
+    std::vector<uint32_t>::const_iterator next_trailer = trailers.begin();
+
+    size_t word = 0;
+    while(word < n_words){
       
       //get the channel header word
-      std::unique_ptr<uint16_t> channel_header(new uint16_t);
-      std::copy(getCardDataPtr() + total_data_read,
-                getCardDataPtr() + total_data_read + size16,
-                (char*)channel_header.get());
-      total_data_read += size16;
+      uint16_t channel_header;
+      std::memcpy(&channel_header, data + word*size16, size16);
+      ++word;
       
-      // std::cout << "Channel header " << std::hex << *channel_header << "  preset channel size = " << std::dec << (total_size)
-      //  << " 0x" << std::hex << ((*channel_header)&0xF000) << std::dec << std::endl;
-      if(((*channel_header)&0xF000)!=0x4000) {
+      if((channel_header&0xF000)!=0x4000) {
         std::cout << "Bad channel_header word at line " << __LINE__
                   << " in " << __FILE__ << std::endl;
         throw std::runtime_error("Bad channel_header word.");
       }
 
-      if(total_size > 0){
+      size_t first_word = word;
+      size_t channel_words = 0;
+      uint16_t channel_trailer = 0;
 
-        size_t channel_data_size = (size_t)total_size - 2*size16; //subtract header+trailer
-
-        //pointer to the channel data
-        std::shared_ptr<char> channel_data_ptr(new char[channel_data_size]);
-        std::copy(getCardDataPtr() + total_data_read,
-                  getCardDataPtr() + total_data_read + channel_data_size,
-                  channel_data_ptr.get());
-        total_data_read += channel_data_size;
-
-        std::unique_ptr<uint16_t> channel_trailer(new uint16_t);
-        std::copy(getCardDataPtr() + total_data_read,
-                  getCardDataPtr() + total_data_read + size16,
-                  (char*)channel_trailer.get());
-        total_data_read += size16;
-
-        // std::cout << " unpacking cardData with " << std::dec << channel_data_size 
-        //           << " first words: " << std::hex 
-        //         << (unsigned int)(*channel_data_ptr+0) << " "
-        //         << (unsigned int)(*channel_data_ptr+1) << " "
-        //         << (unsigned int)(*channel_data_ptr+2) << " "
-        //         << (unsigned int)(*channel_data_ptr+3) << " "                                  
-        //                           << std::endl;
-
-        //now initialise channelData object, and store in map
-        channelData chD(channel_data_ptr,channel_data_size,*channel_header,*channel_trailer);
-        insertChannel(chD.getChannelNumber(),chD);
+      if(total_size > 0){
+        channel_words = (size_t)total_size/size16 - 2; //subtract header+trailer
+        if(first_word + channel_words + 1 > n_words)
+          throw std::runtime_error("Channel data bigger than card data.");
+        std::memcpy(&channel_trailer, data + (first_word+channel_words)*size16, size16);
+        word = first_word + channel_words + 1;
       } //end if known channel data size
 
       else{
-        //loop until we find the channel trailer
-        std::unique_ptr<uint16_t> channel_trailer(new uint16_t);
-        size_t channel_data_size = 0;
-        while(total_data_read < card_data_size){
-          std::copy(getCardDataPtr() + total_data_read,
-                    getCardDataPtr() + total_data_read + size16,
-                    (char*)channel_trailer.get());
-          // std::cout << "Next Word " << std::hex << *channel_trailer << std::endl;
-          total_data_read += size16;
-          
-          if( (*channel_trailer)==(0x5000 + ((*channel_header) & 0xfff)) )
-            break;
-          else 
-            channel_data_size += size16;
-        }//end while over channel data
-        
-        // despite code above, this can happen if you reach the end of the channel data.
-        if( (*channel_trailer)!=(0x5000 + ((*channel_header) & 0xfff)) ) {
+        // The trailer is the first word after the header that matches the
+        // channel number.
+        const uint16_t expected = 0x5000 + (channel_header & 0xfff);
+        for(; next_trailer != trailers.end(); ++next_trailer){
+          if(*next_trailer < first_word) continue;
+          uint16_t candidate;
+          std::memcpy(&candidate, data + (*next_trailer)*size16, size16);
+          if(candidate == expected) break;
+        }
+
+        if(next_trailer != trailers.end()){
+          channel_words = *next_trailer - first_word;
+          channel_trailer = expected;
+          word = *next_trailer + 1;
+          ++next_trailer;
+        }
+        else {
+          // This can happen if you reach the end of the channel data.
           std::cout << "Bad channel_trailer"
                     << " at line " << __LINE__
                     << " in " << __FILE__ << std::endl;
 #ifdef HARD_RUNTIME_ERRORS
           throw std::runtime_error("Bad channel_trailer word.");
 #endif
+          // Use the rest of the card, with the last word as the trailer.
+          if(n_words > first_word){
+            channel_words = n_words - first_word - 1;
+            std::memcpy(&channel_trailer, data + (n_words-1)*size16, size16);
+          }
+          word = n_words;
         }
-        
-        // std::cout << "Huffman Decode: chan:" << ((*channel_header)&0xFFF) << " data_size = "  << channel_data_size/size16 << std::endl;
-        // std::cout << "              header:" << std::hex << (*channel_header) << " trailer: "  << (*channel_trailer) << std::dec << std::endl;
-        
-        // std::cout << "read channel with channel_data_size = " << channel_data_size << std::endl;
-        //pointer to the channel data
-        std::shared_ptr<char> channel_data_ptr(new char[channel_data_size]);
-        std::copy(getCardDataPtr() + total_data_read - channel_data_size - size16,
-                  getCardDataPtr() + total_data_read - size16,
-                  channel_data_ptr.get());
-        
-        //now initialise channelData object, and store in map
-        channelData chD(channel_data_ptr,channel_data_size,*channel_header,*channel_trailer);
-        insertChannel(chD.getChannelNumber(),chD);
       } // end else (for unknown data size)
+
+      // The channel data refers into the card buffer instead of being
+      // copied out of it.
+      std::shared_ptr<char> channel_data_ptr(card_data_ptr, card_data_ptr.get() + first_word*size16);
+
+      //now initialise channelData object, and store in map
+      channelData chD(channel_data_ptr,channel_words*size16,channel_header,channel_trailer);
+      insertChannel(chD.getChannelNumber(),chD);
       
     }//end while over card data size
     
@@ -136,7 +124,7 @@ void cardData::updateIOMode(uint8_t new_mode, int total_size=0){
 }
 
 void cardData::insertChannel(int channel_number, channelData chD){
-  channel_map.insert(std::pair<int,channelData>(channel_number,chD));
+  channel_map.insert(channelMap_t::value_type(channel_number,chD));
 }
 
 
@@ -145,7 +133,7 @@ void cardData::decompress(){
   if(cardData_IO_mode < IO_GRANULARITY_CHANNEL)
     updateIOMode(IO_GRANULARITY_CHANNEL);
 
-  std::map<int,channelData>::iterator i_ch;
+  channelMap_t::iterator i_ch;
   for (i_ch=channel_map.begin(); i_ch!=channel_map.end(); i_ch++)
     (i_ch->second).decompress();
 
@@ -14,6 +14,7 @@
 
 #include "constants.h"
 #include "channelData.h"
+#include "flatMap.h"
 
 namespace gov {
 namespace fnal {
@@ -47,7 +48,7 @@ class cardData {
   //uint8_t getIOMode() { return cardData_IO_mode; }
   uint8_t getIOMode() const { return cardData_IO_mode; }
 
-  typedef std::map<int,channelData> channelMap_t;
+  typedef flatMap<int,channelData> channelMap_t;
   const channelMap_t& getChannelMap() const { return channel_map; }
   
   int getNumberOfChannels() const { return channel_map.size(); }
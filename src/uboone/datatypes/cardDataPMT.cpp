@@ -1,6 +1,9 @@
 #include "cardDataPMT.h"
 #include <stdexcept>
 #include <iostream> // For debugging
+#include <cstring>
+#include <vector>
+#include "wordScan.h"
 
 using namespace gov::fnal::uboone::datatypes;
 
@@ -62,91 +65,77 @@ void cardDataPMT::updateIOMode(uint8_t new_mode){
 }
 
 void cardDataPMT::insertChannel(int channel_number, channelDataPMT chD){
-  channel_map.insert(std::pair<int,channelDataPMT>(channel_number,chD));
+  channel_map.insert(channelMap_t::value_type(channel_number,chD));
 }
 
 void cardDataPMT::insertWindow(windowHeaderPMT wH, windowDataPMT wD){
   int channel_number = wH.getChannelNumber();
   
-  if(channel_map.find(channel_number) == channel_map.end()){
+  channelMap_t::iterator channel = channel_map.find(channel_number);
+  if(channel == channel_map.end()){
     channelDataPMT chD;
     chD.insertWindow(wH,wD);
     insertChannel(channel_number,chD);
   }
   else{
-    (channel_map.find(channel_number)->second).insertWindow(wH,wD);
+    channel->second.insertWindow(wH,wD);
   }
 
 }
 
 void cardDataPMT::FillPMTChannels(size_t &total_data_read){
 
-  bool full_header = true;
-  std::unique_ptr<pmt_window_header_t> memblkWH(new pmt_window_header_t);
-
   const size_t size16 = sizeof(uint16_t);
-  std::unique_ptr<uint16_t> word(new uint16_t);
+  const char* data = card_data_ptr.get();
+  const size_t data_end = card_data_size - sizeof(pmt_data_trailer_t);
+
+  // Find all of the window ends in one pass. A header word can look like
+  // a window end, so each window uses the first end after its header.
+  std::vector<uint32_t> ends;
+  findWords(data, data_end/size16, 0x3000, 0x3000, ends);
+  std::vector<uint32_t>::const_iterator next_end = ends.begin();
+
+  pmt_window_header_t window_header;
+  bool full_header = true;
 
-  while(total_data_read < (card_data_size - sizeof(pmt_data_trailer_t))){
+  while(total_data_read < data_end){
 
     if(full_header){
-      std::copy(getCardDataPtr() + total_data_read,
-		getCardDataPtr() + total_data_read + sizeof(pmt_window_header_t),
-		(char*)memblkWH.get());
+      std::memcpy(&window_header, data + total_data_read, sizeof(pmt_window_header_t));
       total_data_read += sizeof(pmt_window_header_t);
     }
     else{
-      std::copy(getCardDataPtr() + total_data_read,
-		getCardDataPtr() + total_data_read + size16,
-		(char*)word.get());
+      // A partial header keeps the channel word of the previous window.
+      std::memcpy(&window_header.frame_and_sample1, data + total_data_read, size16);
       total_data_read += size16;
-      memblkWH->frame_and_sample1 = *word;
-      
-      std::copy(getCardDataPtr() + total_data_read,
-		getCardDataPtr() + total_data_read + size16,
-		(char*)word.get());
+      std::memcpy(&window_header.sample2, data + total_data_read, size16);
       total_data_read += size16;
-      memblkWH->sample2 = *word;
-
       full_header=true;
-
     }
-       
-    size_t window_data_size=0;
-    char* window_data_begin_ptr = getCardDataPtr() + total_data_read;
-    while(1){
-      std::copy(getCardDataPtr() + total_data_read,
-		getCardDataPtr() + total_data_read + size16,
-		(char*)word.get());
-      total_data_read += size16;
-      window_data_size += size16;
 
-      //std::cout << std::hex << *word << std::endl;
-      
-      if( (*word & 0x3000)==0x3000) {
+    size_t first_word = total_data_read/size16;
+    while(next_end != ends.end() && *next_end < first_word) ++next_end;
 
+    // The window runs through its end word. Without an end word the rest
+    // of the block is used.
+    size_t end_word = (next_end != ends.end()) ? *next_end + 1 : data_end/size16;
+    size_t window_data_size = (end_word - first_word)*size16;
+    
+    windowHeaderPMT windowH(window_header);
+    windowDataPMT windowD(card_data_ptr,total_data_read,window_data_size);
+    insertWindow(windowH,windowD);
 
-	std::copy(getCardDataPtr() + total_data_read,
-		  getCardDataPtr() + total_data_read + size16,
-		  (char*)word.get());
-
-	//std::cout << std::hex << *word << " " << (*word & 0x3000) << std::endl;
+    total_data_read += window_data_size;
+    if(next_end == ends.end()) break;
+    ++next_end;
 
-	if( (*word & 0x3000)==0x2000){ //we have more adc words/secondary header words...
-	  //std::cout << "We have a partial header coming up!" << std::endl;
-	  full_header=false;
-	}
-	break;
-      }
-      
+    // Check if more samples follow for the same channel.
+    if(total_data_read + size16 <= data_end){
+      uint16_t word;
+      std::memcpy(&word, data + total_data_read, size16);
+      if( (word & 0x3000)==0x2000 ) full_header=false;
     }
-
-    windowHeaderPMT windowH(*memblkWH);
-    windowDataPMT windowD(window_data_size,window_data_begin_ptr);
-    
-    insertWindow(windowH,windowD);
     
   }
  
 }
-
@@ -18,6 +18,7 @@
 #include "channelDataPMT.h"
 #include "windowHeaderPMT.h"
 #include "windowDataPMT.h"
+#include "flatMap.h"
 
 namespace gov {
 namespace fnal {
@@ -50,7 +51,7 @@ class cardDataPMT {
   void updateIOMode(uint8_t);
   uint8_t getIOMode()  const{ return cardData_IO_mode; }
 
-  typedef std::map<int,channelDataPMT> channelMap_t;
+  typedef flatMap<int,channelDataPMT> channelMap_t;
 
   const channelMap_t& getChannelMap() const { return channel_map; }
   int getNumberOfChannels() const { return channel_map.size(); }
@@ -64,7 +65,7 @@ class cardDataPMT {
   uint8_t cardData_IO_mode;
 
   dataHeaderPMT pmt_data_header;
-  std::map<int,channelDataPMT> channel_map;
+  channelMap_t channel_map;
   dataTrailerPMT pmt_data_trailer;
 
   void FillPMTChannels(size_t&);
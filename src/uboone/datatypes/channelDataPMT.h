@@ -15,6 +15,7 @@
 #include "constants.h"
 #include "windowHeaderPMT.h"
 #include "windowDataPMT.h"
+#include "flatMap.h"
 
 namespace gov {
 namespace fnal {
@@ -28,7 +29,7 @@ using namespace gov::fnal::uboone;
  ***/
 
 struct compareWindowHeaderPMT {
-  bool operator() ( windowHeaderPMT lhs, windowHeaderPMT rhs) const
+  bool operator() ( const windowHeaderPMT& lhs, const windowHeaderPMT& rhs) const
   {  
     if(lhs.getFrame()==rhs.getFrame())
       return lhs.getSample() < rhs.getSample();
@@ -46,17 +47,17 @@ class channelDataPMT {
     {window_map.clear();}
   
   void insertWindow(windowHeaderPMT wH, windowDataPMT wD)
-  { window_map.insert(std::pair<windowHeaderPMT,windowDataPMT>(wH,wD)); }
+  { window_map.insert(windowMap_t::value_type(wH,wD)); }
 
   void clearWindows(){ window_map.clear(); }
 
   int getNumberOfWindows() const { return window_map.size(); }
   
-  typedef std::map<windowHeaderPMT,windowDataPMT, compareWindowHeaderPMT> windowMap_t;
+  typedef flatMap<windowHeaderPMT,windowDataPMT,compareWindowHeaderPMT> windowMap_t;
   const windowMap_t& getWindowMap() const { return window_map; }
 
  private:
-  std::map<windowHeaderPMT,windowDataPMT,compareWindowHeaderPMT> window_map;
+  windowMap_t window_map;
 
   friend class boost::serialization::access;
   
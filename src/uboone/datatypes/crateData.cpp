@@ -71,44 +71,50 @@ void crateData::updateIOMode(uint8_t new_mode){
       // Sanity check. 
       if(data_read + cardDataSize > crate_data_size) throw std::runtime_error("TPC cardDataSize error - card data bigger than remaining crate data.");
 
-      std::shared_ptr<char> card_data(new char[cardDataSize]);
-      std::copy(getCrateDataPtr() + data_read,
-                getCrateDataPtr() + data_read + cardDataSize,
-                (char*)card_data.get());
-      //wait to increment data_read until after updating channel granularity
-
-      cardData cardD(card_data,cardDataSize);
-      if(new_mode == IO_GRANULARITY_CHANNEL) {
-        // We've unpacked the card, now unpack the channel.
+      // Pass over a card that isn't selected without copying it.
+      if(!((card_selection >> cardH.getModule()) & 0x1)){
+        data_read += cardDataSize;
+      }
+      else {
+        std::shared_ptr<char> card_data(new char[cardDataSize]);
+        std::copy(getCrateDataPtr() + data_read,
+                  getCrateDataPtr() + data_read + cardDataSize,
+                  (char*)card_data.get());
+        //wait to increment data_read until after updating channel granularity
+
+        cardData cardD(card_data,cardDataSize);
+        if(new_mode == IO_GRANULARITY_CHANNEL) {
+          // We've unpacked the card, now unpack the channel.
         
-        int channel_data_size = -1; // By default, assume variable-length channel records, i.e. huffman-encoded.
+          int channel_data_size = -1; // By default, assume variable-length channel records, i.e. huffman-encoded.
 
-        // Check to see if data is huffman or flat.
-        // NJT - Alas, this check doesn't work. It's entirely possible the huffman bit isn't in that word,
-        // and in fact it's even LIKELY for noisy data. We could go through all the words looking for the huffman
-        // bit, but without a clue from the electronics the safest thing is to put everything through
+          // Check to see if data is huffman or flat.
+          // NJT - Alas, this check doesn't work. It's entirely possible the huffman bit isn't in that word,
+          // and in fact it's even LIKELY for noisy data. We could go through all the words looking for the huffman
+          // bit, but without a clue from the electronics the safest thing is to put everything through
  
-        //for non-Huffman coded data, we can directly get the channel data size
-        // std::cout << "Data word is " << std::hex << *data_word << std::dec << std::endl;
-
-        // std::unique_ptr<uint16_t> data_word(new uint16_t);
-        //  std::copy(getCrateDataPtr() + data_read + size16*3, //we want the 3rd word in channel
-        //            getCrateDataPtr() + data_read + size16*4,
-        //            (char*)data_word.get());
-        //  if( !(*data_word & 0x8000) )
-        //    channel_data_size = cardDataSize/64; //64 channels in each FEM
+          //for non-Huffman coded data, we can directly get the channel data size
+          // std::cout << "Data word is " << std::hex << *data_word << std::dec << std::endl;
+
+          // std::unique_ptr<uint16_t> data_word(new uint16_t);
+          //  std::copy(getCrateDataPtr() + data_read + size16*3, //we want the 3rd word in channel
+          //            getCrateDataPtr() + data_read + size16*4,
+          //            (char*)data_word.get());
+          //  if( !(*data_word & 0x8000) )
+          //    channel_data_size = cardDataSize/64; //64 channels in each FEM
         
 
-        // std::cout << "Channel data size is " << channel_data_size << std::endl;        
-        cardD.updateIOMode(new_mode,channel_data_size);
-      }
+          // std::cout << "Channel data size is " << channel_data_size << std::endl;        
+          cardD.updateIOMode(new_mode,channel_data_size);
+        }
 
-      //now increment the data_read variable
-      data_read += cardDataSize;
+        //now increment the data_read variable
+        data_read += cardDataSize;
 
-      // Got a header and data object for this card. Put it in the map.
-      insertCard(cardH,cardD);
-      cards_read++;
+        // Got a header and data object for this card. Put it in the map.
+        insertCard(cardH,cardD);
+        cards_read++;
+      }
 
 
       // Do we have enough space left to see another card header?
@@ -141,7 +147,7 @@ void crateData::updateIOMode(uint8_t new_mode){
 
   if(new_mode == IO_GRANULARITY_CHANNEL && crateData_IO_mode < IO_GRANULARITY_CHANNEL){
     // this code activated when current granularity is card, wanted is channel
-    std::map<cardHeader,cardData>::iterator card_it;
+    cardMap_t::iterator card_it;
     for( card_it = card_map.begin(); card_it != card_map.end(); card_it++){
 
       size_t cardDataSize = (card_it->second).getCardDataSize();
@@ -173,7 +179,7 @@ void crateData::updateIOMode(uint8_t new_mode){
 }
 
 void crateData::insertCard(cardHeader cH, cardData cD){
-  card_map.insert(std::pair<cardHeader,cardData>(cH,cD));
+  card_map.insert(cardMap_t::value_type(cH,cD));
 }
 
 void crateData::decompress(){
@@ -181,7 +187,7 @@ void crateData::decompress(){
   if(crateData_IO_mode < IO_GRANULARITY_CHANNEL)
     updateIOMode(IO_GRANULARITY_CHANNEL);
 
-  std::map<cardHeader,cardData>::iterator i_card;
+  cardMap_t::iterator i_card;
   for (i_card=card_map.begin(); i_card!=card_map.end(); i_card++)
     (i_card->second).decompress();
 
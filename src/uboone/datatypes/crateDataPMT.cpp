@@ -76,22 +76,28 @@ void crateDataPMT::updateIOMode(uint8_t new_mode){
   // << memblkCardH->event_number << " " << memblkCardH->frame_number<< " " << memblkCardH->checksum << std::dec << std::endl;
 
 
-      std::shared_ptr<char> card_data(new char[cardDataSize]);
-      std::copy(ptr + data_read,
-                ptr + data_read + cardDataSize,
-                (char*)card_data.get());
-      //wait to increment data_read until after updating channel granularity
-
-      cardDataPMT cardD(card_data,cardDataSize);
-      if(new_mode == IO_GRANULARITY_CHANNEL)
-             cardD.updateIOMode(new_mode);
-
-      //now increment the data_read variable
-      data_read += cardDataSize;
-
-      // Got a header and data object for this card. Put it in the map.
-      insertCard(cardH,cardD);
-      cards_read++;
+      // Pass over a card that isn't selected without copying it.
+      if(!((card_selection >> cardH.getModule()) & 0x1)){
+        data_read += cardDataSize;
+      }
+      else {
+        std::shared_ptr<char> card_data(new char[cardDataSize]);
+        std::copy(ptr + data_read,
+                  ptr + data_read + cardDataSize,
+                  (char*)card_data.get());
+        //wait to increment data_read until after updating channel granularity
+
+        cardDataPMT cardD(card_data,cardDataSize);
+        if(new_mode == IO_GRANULARITY_CHANNEL)
+               cardD.updateIOMode(new_mode);
+
+        //now increment the data_read variable
+        data_read += cardDataSize;
+
+        // Got a header and data object for this card. Put it in the map.
+        insertCard(cardH,cardD);
+        cards_read++;
+      }
 
 
       // Do we have enough space left to see another card header?
@@ -126,7 +132,7 @@ void crateDataPMT::updateIOMode(uint8_t new_mode){
   if(new_mode == IO_GRANULARITY_CHANNEL && crateData_IO_mode < IO_GRANULARITY_CHANNEL){
 
     // this code activated when current granularity is card, wanted is channel
-    std::map<cardHeaderPMT,cardDataPMT>::iterator card_it;
+    cardMap_t::iterator card_it;
     for( card_it = card_map.begin(); card_it != card_map.end(); card_it++){
       (card_it->second).updateIOMode(new_mode);      
     }
@@ -138,5 +144,5 @@ void crateDataPMT::updateIOMode(uint8_t new_mode){
 }
 
 void crateDataPMT::insertCard(cardHeaderPMT cH, cardDataPMT cD){
-  card_map.insert(std::pair<cardHeaderPMT,cardDataPMT>(cH,cD));
+  card_map.insert(cardMap_t::value_type(cH,cD));
 }
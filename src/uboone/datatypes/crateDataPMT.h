@@ -18,6 +18,7 @@
 #include "eventHeaderTrailer.h"
 #include "cardHeaderPMT.h"
 #include "cardDataPMT.h"
+#include "flatMap.h"
 
 namespace gov {
 namespace fnal {
@@ -31,7 +32,7 @@ using namespace gov::fnal::uboone;
  ***/
 
 struct compareCardHeaderPMT {
-  bool operator() ( cardHeaderPMT lhs, cardHeaderPMT rhs) const
+  bool operator() ( const cardHeaderPMT& lhs, const cardHeaderPMT& rhs) const
   { return lhs.getModule() < rhs.getModule(); }
 };
 
@@ -41,10 +42,10 @@ class crateDataPMT {
   static const uint8_t DAQ_version_number = gov::fnal::uboone::datatypes::constants::VERSION;
   
   crateDataPMT()
-    { crate_data_ptr.reset(); crate_data_size=0; crateData_IO_mode = IO_GRANULARITY_CRATE;}
+    { crate_data_ptr.reset(); crate_data_size=0; crateData_IO_mode = IO_GRANULARITY_CRATE; card_selection = 0xffffffff;}
 
   crateDataPMT(std::shared_ptr<char> data_ptr, size_t size)
-    { crate_data_ptr.swap(data_ptr); crate_data_size=size; crateData_IO_mode = IO_GRANULARITY_CRATE; }
+    { crate_data_ptr.swap(data_ptr); crate_data_size=size; crateData_IO_mode = IO_GRANULARITY_CRATE; card_selection = 0xffffffff; }
 
   size_t getCrateDataSize() const {return crate_data_size;}
   void setCrateDataSize(size_t size) { crate_data_size = size; }
@@ -56,13 +57,21 @@ class crateDataPMT {
   void updateIOMode(uint8_t);
   uint8_t getIOMode() { return crateData_IO_mode; }
 
+  // Choose the cards that are unpacked by updateIOMode. Bit n of the mask
+  // selects module n (the module number is five bits). The cards that
+  // aren't selected are passed over without being copied. This isn't
+  // saved in the archive.
+  void setCardSelection(uint32_t module_mask) { card_selection = module_mask; }
+  uint32_t getCardSelection() const { return card_selection; }
+
   void insertCard(cardHeaderPMT,cardDataPMT);
 
-  typedef std::map<cardHeaderPMT,cardDataPMT,compareCardHeaderPMT> cardMap_t;
+  typedef flatMap<cardHeaderPMT,cardDataPMT,compareCardHeaderPMT> cardMap_t;
   const cardMap_t& getCardMap() const { return card_map; }
 
  private:
   uint8_t crateData_IO_mode;
+  uint32_t card_selection;
   
   std::shared_ptr<char> crate_data_ptr;
   size_t crate_data_size;
@@ -24,7 +24,7 @@ eventRecord::eventRecord() {
 //this updates all the crates and cards if necessary
 void eventRecord::updateIOMode(uint8_t mode) {
 
-  std::map<crateHeader,crateData>::iterator seb_it;
+  sebMap_t::iterator seb_it;
   for( seb_it = seb_map.begin(); seb_it != seb_map.end(); seb_it++){
     try {
       (seb_it->second).updateIOMode(mode);
@@ -39,7 +39,7 @@ void eventRecord::updateIOMode(uint8_t mode) {
     }
   }
 
-  std::map<crateHeader,crateDataPMT>::iterator seb_pmt_it;
+  sebMapPMT_t::iterator seb_pmt_it;
   for( seb_pmt_it = seb_pmt_map.begin(); seb_pmt_it != seb_pmt_map.end(); seb_pmt_it++) {
     try {
       (seb_pmt_it->second).updateIOMode(mode);
@@ -59,11 +59,11 @@ void eventRecord::updateIOMode(uint8_t mode) {
 
 //insert crateHeader,crateData pair
 void eventRecord::insertSEB(crateHeader cH, crateData cD){ 
-  seb_map.insert( std::pair<crateHeader,crateData>(cH,cD) ); 
+  seb_map.insert( sebMap_t::value_type(cH,cD) ); 
 }
 
 void eventRecord::insertSEB(crateHeader cH, crateDataPMT cD){ 
-  seb_pmt_map.insert( std::pair<crateHeader,crateDataPMT>(cH,cD) ); 
+  seb_pmt_map.insert( sebMapPMT_t::value_type(cH,cD) ); 
 }
 
 void::eventRecord::decompress(){
@@ -71,7 +71,7 @@ void::eventRecord::decompress(){
   if(er_IO_mode < IO_GRANULARITY_CHANNEL)
     updateIOMode(IO_GRANULARITY_CHANNEL);
 
-  std::map<crateHeader,crateData>::iterator seb_it;
+  sebMap_t::iterator seb_it;
   for( seb_it = seb_map.begin(); seb_it != seb_map.end(); seb_it++)
     (seb_it->second).decompress();
   
@@ -12,6 +12,7 @@
 #include "crateDataPMT.h"
 #include "beamHeader.h"
 #include "beamData.h"
+#include "flatMap.h"
 
 #include <boost/serialization/list.hpp>
 #include <boost/serialization/string.hpp>
@@ -41,7 +42,7 @@ using namespace gov::fnal::uboone;
 
 //used for map
 struct compareCrateHeader {
-  bool operator() ( crateHeader lhs, crateHeader rhs) const
+  bool operator() ( const crateHeader& lhs, const crateHeader& rhs) const
   { return lhs.getCrateNumber() < rhs.getCrateNumber(); }
 };
 
@@ -61,8 +62,8 @@ class eventRecord {
   //void insertSEB_PMT(crateHeader,crateDataPMT); //in .cpp file
   //void insertSEB_TPC(crateHeader,crateData); //in .cpp file
 
-  typedef std::map<crateHeader,crateData,compareCrateHeader> sebMap_t;
-  typedef std::map<crateHeader,crateDataPMT,compareCrateHeader> sebMapPMT_t;
+  typedef flatMap<crateHeader,crateData,compareCrateHeader> sebMap_t;
+  typedef flatMap<crateHeader,crateDataPMT,compareCrateHeader> sebMapPMT_t;
   
   globalHeader getGlobalHeader() { return global_header; }
   triggerData getTriggerData() { return trigger_data; }
@@ -0,0 +1,173 @@
+#ifndef _UBOONETYPES_FLATMAP_H
+#define _UBOONETYPES_FLATMAP_H
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+#include <boost/serialization/utility.hpp>
+#include <boost/serialization/map.hpp>
+#include <boost/serialization/split_free.hpp>
+
+namespace gov {
+namespace fnal {
+namespace uboone {
+namespace datatypes {
+
+/***
+    A map that keeps the items in one contiguous vector in the order they
+    were inserted, with a sorted index of the keys for lookup. Walking the
+    items is a linear pass through memory instead of following tree
+    pointers. This has the part of the std::map interface used by the
+    datatypes, and is serialized exactly like a std::map (in key order), so
+    the files are unchanged. Unlike a std::map, inserting an item can move
+    the others, so iterators and references aren't kept across an insert.
+ ***/
+
+template <class Key, class T, class Compare = std::less<Key> >
+class flatMap {
+
+ public:
+  typedef Key key_type;
+  typedef T mapped_type;
+  typedef std::pair<const Key,T> value_type;
+  typedef Compare key_compare;
+  typedef typename std::vector<value_type>::iterator iterator;
+  typedef typename std::vector<value_type>::const_iterator const_iterator;
+  typedef typename std::vector<value_type>::size_type size_type;
+
+  flatMap() {}
+
+  iterator begin() { return items.begin(); }
+  iterator end() { return items.end(); }
+  const_iterator begin() const { return items.begin(); }
+  const_iterator end() const { return items.end(); }
+
+  size_type size() const { return items.size(); }
+  bool empty() const { return items.empty(); }
+  void reserve(size_type n) { items.reserve(n); index.reserve(n); }
+  void clear() { items.clear(); index.clear(); }
+
+  // Add an item unless the key is already there (like std::map::insert).
+  std::pair<iterator,bool> insert(const value_type& item){
+    typename std::vector<size_type>::iterator pos = lowerBound(item.first);
+    if(pos != index.end() && !comp(item.first, items[*pos].first))
+      return std::make_pair(items.begin() + *pos, false);
+    index.insert(pos, items.size());
+    items.push_back(item);
+    return std::make_pair(items.end() - 1, true);
+  }
+
+  // The hint isn't needed, but std::map has it.
+  iterator insert(iterator, const value_type& item){
+    return insert(item).first;
+  }
+
+  iterator find(const Key& key){
+    typename std::vector<size_type>::iterator pos = lowerBound(key);
+    if(pos == index.end() || comp(key, items[*pos].first)) return items.end();
+    return items.begin() + *pos;
+  }
+
+  const_iterator find(const Key& key) const{
+    return const_cast<flatMap*>(this)->find(key);
+  }
+
+  size_type count(const Key& key) const { return find(key) != end() ? 1 : 0; }
+
+  T& operator[](const Key& key){
+    return insert(value_type(key,T())).first->second;
+  }
+
+  // Get the item with the i'th smallest key.
+  const value_type& sorted(size_type i) const { return items[index[i]]; }
+
+ private:
+  std::vector<value_type> items;
+  std::vector<size_type> index; // item positions sorted by key
+  Compare comp;
+
+  // Find the first position in the index that isn't less than key. The
+  // DAQ usually writes in key order, so check the end first.
+  typename std::vector<size_type>::iterator lowerBound(const Key& key){
+    if(index.empty() || comp(items[index.back()].first, key))
+      return index.end();
+    typename std::vector<size_type>::iterator first = index.begin();
+    typename std::vector<size_type>::difference_type n = index.size();
+    while(n > 0){
+      typename std::vector<size_type>::difference_type half = n/2;
+      typename std::vector<size_type>::iterator mid = first + half;
+      if(comp(items[*mid].first, key)){
+	first = mid + 1;
+	n -= half + 1;
+      }
+      else n = half;
+    }
+    return first;
+  }
+
+};
+
+}  // end of namespace datatypes
+}  // end of namespace uboone
+}  // end of namespace fnal
+}  // end of namespace gov
+
+namespace boost {
+namespace serialization {
+
+// Use the same format as std::map, so the items are saved in key order
+// whatever order they were inserted in.
+template<class Archive, class Key, class T, class Compare>
+inline void save(Archive & ar,
+		 const gov::fnal::uboone::datatypes::flatMap<Key,T,Compare> &t,
+		 const unsigned int /* file_version */){
+  typedef gov::fnal::uboone::datatypes::flatMap<Key,T,Compare> Container;
+  typedef typename Container::value_type type;
+  collection_size_type count(t.size());
+  ar << BOOST_SERIALIZATION_NVP(count);
+  const item_version_type item_version(version<type>::value);
+  ar << BOOST_SERIALIZATION_NVP(item_version);
+  for(typename Container::size_type i = 0; i < t.size(); ++i){
+    save_construct_data_adl(ar, boost::addressof(t.sorted(i)), item_version);
+    ar << make_nvp("item", t.sorted(i));
+  }
+}
+
+// This follows load_map_collection, but the items are reserved first. The
+// archive is told where each item ends up, so the items can't move while
+// the later ones are added.
+template<class Archive, class Key, class T, class Compare>
+inline void load(Archive & ar,
+		 gov::fnal::uboone::datatypes::flatMap<Key,T,Compare> &t,
+		 const unsigned int /* file_version */){
+  typedef gov::fnal::uboone::datatypes::flatMap<Key,T,Compare> Container;
+  typedef typename Container::value_type type;
+  t.clear();
+  const library_version_type library_version(ar.get_library_version());
+  item_version_type item_version(0);
+  collection_size_type count;
+  ar >> BOOST_SERIALIZATION_NVP(count);
+  if(library_version_type(3) < library_version){
+    ar >> BOOST_SERIALIZATION_NVP(item_version);
+  }
+  t.reserve(count);
+  while(count-- > 0){
+    detail::stack_construct<Archive, type> item(ar, item_version);
+    ar >> make_nvp("item", item.reference());
+    typename Container::iterator result = t.insert(item.reference()).first;
+    ar.reset_object_address(&(result->second), &item.reference().second);
+  }
+}
+
+template<class Archive, class Key, class T, class Compare>
+inline void serialize(Archive & ar,
+		      gov::fnal::uboone::datatypes::flatMap<Key,T,Compare> &t,
+		      const unsigned int file_version){
+  boost::serialization::split_free(ar, t, file_version);
+}
+
+}  // end of namespace serialization
+}  // end of namespace boost
+
+#endif /* #ifndef _UBOONETYPES_FLATMAP_H */
@@ -42,6 +42,11 @@ class windowDataPMT {
       std::copy(wd_ptr,wd_ptr+wd_size,data_ptr.get());
       window_data_ptr.swap(data_ptr); }
 
+  // Refer to a window inside of a card buffer without copying it. The
+  // window shares ownership of the buffer.
+  windowDataPMT(const std::shared_ptr<char>& buffer, size_t offset, size_t wd_size)
+    : window_data_ptr(buffer, buffer.get()+offset), window_data_size(wd_size) {}
+
   char*       getWindowDataPtr()       { return window_data_ptr.get(); }
   const char* getWindowDataPtr() const { return window_data_ptr.get(); }
   void setWindowDataPtr(char* ptr) {window_data_ptr.reset(ptr);}
@@ -0,0 +1,55 @@
+#ifndef _UBOONETYPES_WORDSCAN_H
+#define _UBOONETYPES_WORDSCAN_H
+#include <vector>
+#include <cstring>
+#include <sys/types.h>
+#include <inttypes.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace gov {
+namespace fnal {
+namespace uboone {
+namespace datatypes {
+
+/***
+    Find every word in a block of 16-bit words where (word & mask) equals
+    value, and append the word indices to hits. This is used to find the
+    channel and window boundaries in a card without walking the words one
+    at a time. With SSE2 eight words are tested at once; the scalar loop
+    does the tail (and everything when SSE2 isn't available). The data
+    doesn't need to be aligned.
+ ***/
+inline void findWords(const char* data, size_t n_words,
+		      uint16_t mask, uint16_t value,
+		      std::vector<uint32_t>& hits){
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128i mask8 = _mm_set1_epi16((short)mask);
+  const __m128i value8 = _mm_set1_epi16((short)value);
+  for(; i + 8 <= n_words; i += 8){
+    __m128i words = _mm_loadu_si128((const __m128i*)(data + i*sizeof(uint16_t)));
+    __m128i match = _mm_cmpeq_epi16(_mm_and_si128(words,mask8),value8);
+    // Two bits per word in the byte mask, so keep the even ones.
+    unsigned int bits = _mm_movemask_epi8(match) & 0x5555;
+    while(bits){
+      hits.push_back(i + __builtin_ctz(bits)/2);
+      bits &= bits - 1;
+    }
+  }
+#endif
+  for(; i < n_words; ++i){
+    uint16_t word;
+    std::memcpy(&word, data + i*sizeof(uint16_t), sizeof(uint16_t));
+    if( (word & mask)==value ) hits.push_back(i);
+  }
+}
+
+}  // end of namespace datatypes
+}  // end of namespace uboone
+}  // end of namespace fnal
+}  // end of namespace gov
+
+#endif /* #ifndef _UBOONETYPES_WORDSCAN_H */
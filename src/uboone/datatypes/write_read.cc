@@ -121,13 +121,13 @@ int main() {
   **************************************************************************************/
 
   //get the seb map, and do a loop over all sebs/crates
-  std::map<crateHeader,crateData,compareCrateHeader> seb_map = event_record.getSEBMap();
-  std::map<crateHeader,crateData>::iterator seb_it;
+  const eventRecord::sebMap_t& seb_map = event_record.getSEBMap();
+  eventRecord::sebMap_t::const_iterator seb_it;
   for( seb_it = seb_map.begin(); seb_it != seb_map.end(); seb_it++){
 
     //get the crateHeader/crateData objects
     crateHeader crate_header = seb_it->first;
-    crateData crate_data = seb_it->second;
+    const crateData& crate_data = seb_it->second;
 
     //can check some things in the crate header
     std::cout << "\nFrom crate header, crate (number,event,frame) is ... (" << std::dec
@@ -151,13 +151,13 @@ int main() {
     */
 
     //now get the card map (for the current crate), and do a loop over all cards
-    std::map<cardHeader,cardData>::iterator card_it;
-    std::map<cardHeader,cardData,compareCardHeader> card_map = crate_data.getCardMap();
+    crateData::cardMap_t::const_iterator card_it;
+    const crateData::cardMap_t& card_map = crate_data.getCardMap();
     for(card_it = card_map.begin(); card_it != card_map.end(); card_it++){
 
       //get the cardHeader/cardData objects
       cardHeader card_header = card_it->first;
-      cardData card_data = card_it->second;
+      const cardData& card_data = card_it->second;
 
       //can check some things in the card header
       std::cout << "From CARD header, card (IDandModuleWord,WordCountWord,EventWord,FrameWord,ChecksumWord) is ... ( " << std::hex
@@ -168,13 +168,13 @@ int main() {
 		<< " , " << card_header.getEvent() << " , " << card_header.getFrame() << " )" << std::endl;
 
       //now get the channel map (for the current card), and do a loop over all channels
-      std::map<int,channelData> channel_map = card_data.getChannelMap();
-      std::map<int,channelData>::iterator channel_it;
+      const cardData::channelMap_t& channel_map = card_data.getChannelMap();
+      cardData::channelMap_t::const_iterator channel_it;
       for(channel_it = channel_map.begin(); channel_it != channel_map.end(); channel_it++){
 
 	//get the channel number and channelData
 	int ch_num = channel_it->first;
-	channelData chD = channel_it->second;
+	const channelData& chD = channel_it->second;
 	
 	//can pull some info from the channelData (channelData objects include some header/trailer words)
 	std::cout << "(" << std::dec << ch_num << "," << std::hex << chD.getChannelHeader() << "," << chD.getChannelTrailer() << ") " << std::endl;;
@@ -0,0 +1,315 @@
+// Measure the throughput of the uboone datatypes unpackers, the Huffman
+// decoder, and the TUBDAQInput sample copy on generated payloads.
+//
+//   benchUnpack [-b cards] [-n channels] [-s samples] [-f fraction]
+//               [-r rms] [-p pmt-cards] [-w windows] [-l length]
+//               [-i iterations] [-S seed]
+//
+// The TPC crate has "cards" cards with "channels" channels of "samples"
+// samples.  The samples are a pedestal with gaussian noise of the given rms
+// (in ADC counts), and a "fraction" of the channels are Huffman encoded
+// the way the DAQ does it (the rest are saved as explicit words).  The PMT
+// crate has "pmt-cards" cards with 40 channels that each have "windows"
+// readout windows of "length" samples.  The payloads are made with
+// CP::TUBDAQGenerator.
+//
+// Each kernel is run over the same payload for the given number of
+// iterations, and a line is printed for each kernel with
+//
+//   <kernel> <MB/s> <channels/s> <ms/iteration>
+//
+// where the MB/s is counted from the size of the input to the kernel.  The
+// lines start with "bench" so they can be picked out of the log.
+#include <TUBDAQInput.hxx>
+#include <TUBDAQGenerator.hxx>
+#include <TPulseDigit.hxx>
+
+#include "datatypes/crateData.h"
+#include "datatypes/cardData.h"
+#include "datatypes/channelData.h"
+#include "datatypes/crateDataPMT.h"
+#include "datatypes/cardDataPMT.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <memory>
+#include <cstring>
+#include <cstdlib>
+
+#include <unistd.h>
+
+namespace {
+    namespace dt = gov::fnal::uboone::datatypes;
+
+    typedef CP::TUBDAQGenerator::Words Words;
+
+    std::shared_ptr<char> makeBuffer(const Words& words) {
+        std::shared_ptr<char> buffer(new char[2*words.size()],
+                                     std::default_delete<char[]>());
+        std::memcpy(buffer.get(), &words[0], 2*words.size());
+        return buffer;
+    }
+
+    /// A generated channel.
+    struct Channel {
+        uint16_t Header;
+        uint16_t Trailer;
+        Words Samples;
+        Words Data;
+    };
+
+    /// The generated payloads.
+    struct Payload {
+        std::vector<Channel> Channels;
+        std::vector<Words> Cards;
+        Words Crate;
+        std::vector<Words> PMTCards;
+        Words PMTCrate;
+        int PMTChannels;
+    };
+
+    void makePayload(Payload& payload, int cards, int channels, int samples,
+                     double fraction, double rms, int pmtCards, int windows,
+                     int length, int seed) {
+        CP::TUBDAQGenerator generator(seed);
+        generator.SetTPC(1, cards, channels, samples);
+        generator.SetHuffmanFraction(fraction);
+        generator.SetNoise(rms);
+        generator.SetPMT(pmtCards, windows, length);
+
+        // The channels are kept separately so that they can be decoded by
+        // themselves.
+        CP::TUBDAQGenerator::BeginCrate(payload.Crate);
+        for (int card = 0; card < cards; ++card) {
+            Words cardWords;
+            for (int c = 0; c < channels; ++c) {
+                Channel channel;
+                channel.Header = 0x4000 | c;
+                channel.Trailer = 0x5000 | c;
+                generator.MakeSamples(c, channel.Samples);
+                generator.EncodeSamples(channel.Samples, channel.Data);
+                cardWords.push_back(channel.Header);
+                cardWords.insert(cardWords.end(),
+                                 channel.Data.begin(), channel.Data.end());
+                cardWords.push_back(channel.Trailer);
+                payload.Channels.push_back(channel);
+            }
+            CP::TUBDAQGenerator::AddTPCCard(payload.Crate, card + 4,
+                                            cardWords);
+            payload.Cards.push_back(cardWords);
+        }
+        CP::TUBDAQGenerator::EndCrate(payload.Crate);
+
+        payload.PMTChannels = pmtCards*CP::TUBDAQGenerator::kPMTChannels;
+        CP::TUBDAQGenerator::BeginCrate(payload.PMTCrate);
+        for (int card = 0; card < pmtCards; ++card) {
+            Words cardWords;
+            generator.MakePMTCard(cardWords);
+            CP::TUBDAQGenerator::AddPMTCard(payload.PMTCrate, card + 4,
+                                            cardWords);
+            payload.PMTCards.push_back(cardWords);
+        }
+        CP::TUBDAQGenerator::EndCrate(payload.PMTCrate);
+    }
+
+    /// Print the throughput for a kernel.
+    void report(const std::string& kernel, double seconds, int iterations,
+                double bytes, double channels) {
+        if (seconds <= 0) seconds = 1E-9;
+        std::cout << "bench " << std::setw(28) << std::left << kernel
+                  << std::right << std::fixed << std::setprecision(1)
+                  << " " << std::setw(10) << iterations*bytes/seconds/1E6
+                  << " " << std::setw(12) << std::setprecision(0)
+                  << iterations*channels/seconds
+                  << " " << std::setw(10) << std::setprecision(3)
+                  << 1000.0*seconds/iterations
+                  << std::endl;
+    }
+
+    double elapsed(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+    void usage(const char* name) {
+        std::cout << "Usage: " << name << " [options]" << std::endl
+                  << "    -b <n>  TPC cards (default 16)" << std::endl
+                  << "    -n <n>  Channels per card (default 64)" << std::endl
+                  << "    -s <n>  Samples per channel (default 9595)"
+                  << std::endl
+                  << "    -f <x>  Fraction of Huffman channels (default 1)"
+                  << std::endl
+                  << "    -r <x>  Noise RMS in ADC counts (default 2)"
+                  << std::endl
+                  << "    -p <n>  PMT cards (default 4)" << std::endl
+                  << "    -w <n>  Windows per PMT channel (default 10)"
+                  << std::endl
+                  << "    -l <n>  Samples per PMT window (default 40)"
+                  << std::endl
+                  << "    -i <n>  Iterations (default 10)" << std::endl
+                  << "    -S <n>  Random seed (default 1)" << std::endl;
+    }
+}
+
+int main(int argc, char **argv) {
+    int cards = 16;
+    int channels = 64;
+    int samples = 9595;
+    double fraction = 1.0;
+    double rms = 2.0;
+    int pmtCards = 4;
+    int windows = 10;
+    int length = 40;
+    int iterations = 10;
+    int seed = 1;
+
+    int c;
+    while ((c = getopt(argc, argv, "b:n:s:f:r:p:w:l:i:S:h")) != -1) {
+        switch (c) {
+        case 'b': cards = std::atoi(optarg); break;
+        case 'n': channels = std::atoi(optarg); break;
+        case 's': samples = std::atoi(optarg); break;
+        case 'f': fraction = std::atof(optarg); break;
+        case 'r': rms = std::atof(optarg); break;
+        case 'p': pmtCards = std::atoi(optarg); break;
+        case 'w': windows = std::atoi(optarg); break;
+        case 'l': length = std::atoi(optarg); break;
+        case 'i': iterations = std::atoi(optarg); break;
+        case 'S': seed = std::atoi(optarg); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (cards < 1 || channels < 1 || samples < 1 || iterations < 1
+        || pmtCards < 1 || windows < 1 || length < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Payload payload;
+    makePayload(payload, cards, channels, samples, fraction, rms,
+                pmtCards, windows, length, seed);
+    int tpcChannels = payload.Channels.size();
+
+    std::shared_ptr<char> crateBuffer = makeBuffer(payload.Crate);
+    std::vector< std::shared_ptr<char> > cardBuffers;
+    for (std::size_t i = 0; i < payload.Cards.size(); ++i) {
+        cardBuffers.push_back(makeBuffer(payload.Cards[i]));
+    }
+    std::vector< std::shared_ptr<char> > channelBuffers;
+    std::vector< std::shared_ptr<char> > sampleBuffers;
+    double channelBytes = 0;
+    double sampleBytes = 0;
+    for (std::size_t i = 0; i < payload.Channels.size(); ++i) {
+        channelBuffers.push_back(makeBuffer(payload.Channels[i].Data));
+        sampleBuffers.push_back(makeBuffer(payload.Channels[i].Samples));
+        channelBytes += 2*payload.Channels[i].Data.size();
+        sampleBytes += 2*payload.Channels[i].Samples.size();
+    }
+    std::shared_ptr<char> pmtCrateBuffer = makeBuffer(payload.PMTCrate);
+    std::vector< std::shared_ptr<char> > pmtCardBuffers;
+    for (std::size_t i = 0; i < payload.PMTCards.size(); ++i) {
+        pmtCardBuffers.push_back(makeBuffer(payload.PMTCards[i]));
+    }
+
+    std::cout << "TPC crate: " << cards << " cards, " << tpcChannels
+              << " channels, " << 2*payload.Crate.size() << " bytes"
+              << " (" << std::setprecision(3)
+              << channelBytes/sampleBytes << " of the samples)" << std::endl;
+    std::cout << "PMT crate: " << pmtCards << " cards, "
+              << payload.PMTChannels << " channels, "
+              << 2*payload.PMTCrate.size() << " bytes" << std::endl;
+    std::cout << "bench " << std::setw(28) << std::left << "kernel"
+              << std::right
+              << " " << std::setw(10) << "MB/s"
+              << " " << std::setw(12) << "channels/s"
+              << " " << std::setw(10) << "ms/iter" << std::endl;
+
+    // The check sum keeps the work from being optimized away.
+    long check = 0;
+
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        dt::crateData crate(crateBuffer, 2*payload.Crate.size());
+        crate.updateIOMode(dt::IO_GRANULARITY_CHANNEL);
+        check += crate.getCardMap().size();
+    }
+    report("crateData::updateIOMode", elapsed(start), iterations,
+           2*payload.Crate.size(), tpcChannels);
+
+    double cardBytes = 0;
+    for (std::size_t card = 0; card < payload.Cards.size(); ++card) {
+        cardBytes += 2*payload.Cards[card].size();
+    }
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        for (std::size_t card = 0; card < cardBuffers.size(); ++card) {
+            dt::cardData cardData(cardBuffers[card],
+                                  2*payload.Cards[card].size());
+            cardData.updateIOMode(dt::IO_GRANULARITY_CHANNEL,-1);
+            check += cardData.getNumberOfChannels();
+        }
+    }
+    report("cardData::updateIOMode", elapsed(start), iterations,
+           cardBytes, tpcChannels);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        for (std::size_t ch = 0; ch < channelBuffers.size(); ++ch) {
+            const Channel& channel = payload.Channels[ch];
+            dt::channelData channelData(channelBuffers[ch],
+                                        2*channel.Data.size(),
+                                        channel.Header, channel.Trailer);
+            channelData.decompress();
+            check += channelData.getChannelDataSize();
+        }
+    }
+    report("channelData::decompress", elapsed(start), iterations,
+           channelBytes, tpcChannels);
+
+    CP::TPulseDigit::Vector adc;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        for (std::size_t ch = 0; ch < sampleBuffers.size(); ++ch) {
+            CP::TUBDAQInput::CopySamples(sampleBuffers[ch].get(), 0,
+                                         payload.Channels[ch].Samples.size(),
+                                         adc);
+            check += adc.size();
+        }
+    }
+    report("TUBDAQInput::CopySamples", elapsed(start), iterations,
+           sampleBytes, tpcChannels);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        dt::crateDataPMT crate(pmtCrateBuffer, 2*payload.PMTCrate.size());
+        crate.updateIOMode(dt::IO_GRANULARITY_CHANNEL);
+        check += crate.getCardMap().size();
+    }
+    report("crateDataPMT::updateIOMode", elapsed(start), iterations,
+           2*payload.PMTCrate.size(), payload.PMTChannels);
+
+    // The windows are filled by cardDataPMT::FillPMTChannels, which is
+    // private, so it's timed through the card unpacking.
+    double pmtCardBytes = 0;
+    for (std::size_t card = 0; card < payload.PMTCards.size(); ++card) {
+        pmtCardBytes += 2*payload.PMTCards[card].size();
+    }
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        for (std::size_t card = 0; card < pmtCardBuffers.size(); ++card) {
+            dt::cardDataPMT cardData(pmtCardBuffers[card],
+                                     2*payload.PMTCards[card].size());
+            cardData.updateIOMode(dt::IO_GRANULARITY_CHANNEL);
+            check += cardData.getNumberOfChannels();
+        }
+    }
+    report("cardDataPMT::FillPMTChannels", elapsed(start), iterations,
+           pmtCardBytes, payload.PMTChannels);
+
+    std::cout << "Check " << check << std::endl;
+    return 0;
+}
@@ -0,0 +1,135 @@
+// Write a synthetic raw data file for testing and benchmarking the inputs.
+//
+//   generateRawFile -t <ubdaq|nevis|mPDS> [-n events] [-c channels]
+//                   [-s samples] [-p pulses] [-r rms] [-T start]
+//                   [-R rate] [-J jitter] [-D disorder] [-g] [-S seed]
+//                   <output>
+//
+// The channels are the total number of TPC channels for ubdaq (on cards of
+// 64 channels) and nevis, and the channels on each of the three digitizers
+// for mPDS.  The pulses are the mean number of pulses in each channel of an
+// event (the ubdaq samples are only noise).  The start is the unix time of
+// the first event, and the rate is the event rate in Hz.  The ubdaq events
+// are evenly spaced, and the mPDS triggers arrive randomly.  The jitter
+// (in seconds), the fraction of events out of time order, and the GPS
+// branches (-g) only apply to mPDS.  A ubdaq or nevis file is compressed
+// if the name ends in ".gz".
+//
+// A matching pair of files for the merge builder can be written with
+//
+//   generateRawFile -t ubdaq -n 100 -R 10 tpc.ubdaq
+//   generateRawFile -t mPDS -n 1000 -R 100 -J 0.001 pds.root
+//   capt-trans -tmerge tpc.ubdaq,pds.root
+#include <TUBDAQGenerator.hxx>
+#include <TNevisGenerator.hxx>
+#include <TmPDSGenerator.hxx>
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+#include <unistd.h>
+
+namespace {
+    void usage(const char* name) {
+        std::cout << "Usage: " << name << " -t <type> [options] <output>"
+                  << std::endl
+                  << "    -t <s>  File type (ubdaq, nevis or mPDS)"
+                  << std::endl
+                  << "    -n <n>  Events (default 100)" << std::endl
+                  << "    -c <n>  Channels" << std::endl
+                  << "    -s <n>  Samples per channel" << std::endl
+                  << "    -p <x>  Mean pulses per channel" << std::endl
+                  << "    -r <x>  Noise RMS in ADC counts (default 2)"
+                  << std::endl
+                  << "    -T <x>  Unix time of the first event" << std::endl
+                  << "    -R <x>  Event rate in Hz (default 1)" << std::endl
+                  << "    -J <x>  mPDS computer time jitter in seconds"
+                  << std::endl
+                  << "    -D <x>  Fraction of mPDS events out of order"
+                  << std::endl
+                  << "    -g      Fill the mPDS GPS branches" << std::endl
+                  << "    -S <n>  Random seed (default 1)" << std::endl;
+    }
+}
+
+int main(int argc, char **argv) {
+    std::string type;
+    int events = 100;
+    int channels = -1;
+    int samples = -1;
+    double pulses = -1;
+    double rms = 2.0;
+    double start = 1420070400.0;
+    double rate = 1.0;
+    double jitter = 0.0;
+    double disorder = 0.0;
+    bool gps = false;
+    int seed = 1;
+
+    int c;
+    while ((c = getopt(argc, argv, "t:n:c:s:p:r:T:R:J:D:gS:h")) != -1) {
+        switch (c) {
+        case 't': type = optarg; break;
+        case 'n': events = std::atoi(optarg); break;
+        case 'c': channels = std::atoi(optarg); break;
+        case 's': samples = std::atoi(optarg); break;
+        case 'p': pulses = std::atof(optarg); break;
+        case 'r': rms = std::atof(optarg); break;
+        case 'T': start = std::atof(optarg); break;
+        case 'R': rate = std::atof(optarg); break;
+        case 'J': jitter = std::atof(optarg); break;
+        case 'D': disorder = std::atof(optarg); break;
+        case 'g': gps = true; break;
+        case 'S': seed = std::atoi(optarg); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (optind+1 != argc || events < 1 || rate <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    std::string output = argv[optind];
+
+    bool ok = false;
+    if (type == "ubdaq") {
+        CP::TUBDAQGenerator generator(seed);
+        if (channels < 1) channels = 1024;
+        if (samples < 1) samples = 9595;
+        int cards = (channels+63)/64;
+        generator.SetTPC(1, cards, channels/cards, samples);
+        generator.SetNoise(rms);
+        generator.SetTime(start, 1.0/rate);
+        ok = generator.Write(output, events);
+    }
+    else if (type == "nevis") {
+        CP::TNevisGenerator generator(seed);
+        if (channels > 0) generator.SetChannels(channels);
+        if (samples > 0) generator.SetSamples(samples);
+        if (pulses >= 0) generator.SetPulseRate(pulses);
+        generator.SetNoise(rms);
+        ok = generator.Write(output, events);
+    }
+    else if (type == "mPDS") {
+        CP::TmPDSGenerator generator(seed);
+        generator.SetLayout(CP::TmPDSGenerator::kMaxDigitizers,
+                            (channels > 0) ? channels : 8,
+                            (samples > 0) ? samples : 2000);
+        if (pulses >= 0) generator.SetPulseRate(pulses);
+        generator.SetNoise(rms);
+        generator.SetTime(start, rate);
+        generator.SetJitter(jitter);
+        generator.SetDisorder(disorder);
+        generator.SetGPS(gps);
+        ok = generator.Write(output, events);
+    }
+    else {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (!ok) return 1;
+    std::cout << "Wrote " << events << " " << type << " events to "
+              << output << std::endl;
+    return 0;
+}
@@ -88,9 +88,9 @@ int main(int argc, char** argv) {
   
   /* Now do some declaring of variables we'll use. */
   eventRecord event_record; event_record.updateIOMode(0);
-  std::map<crateHeader,crateData>::iterator seb_it;
-  std::map<cardHeader,cardData>::iterator card_it;
-  std::map<int,channelData>::iterator channel_it;
+  eventRecord::sebMap_t::const_iterator seb_it;
+  crateData::cardMap_t::const_iterator card_it;
+  cardData::channelMap_t::const_iterator channel_it;
   
   //unsigned int event_number;
   unsigned int crate_number;
@@ -157,7 +157,7 @@ int main(int argc, char** argv) {
   
   event_record.updateIOMode(IO_GRANULARITY_CHANNEL);
   
-  std::map<crateHeader,crateData,compareCrateHeader> seb_map = event_record.getSEBMap();
+  const eventRecord::sebMap_t& seb_map = event_record.getSEBMap();
   for( seb_it = seb_map.begin(); seb_it != seb_map.end(); seb_it++){
 
     crateHeader crate_header = seb_it->first;
@@ -165,16 +165,16 @@ int main(int argc, char** argv) {
     
     std::cout << "Crate number is " << crate_number << std::endl;
 
-    crateData *crate_data = &(seb_it->second);            
-    std::map<cardHeader,cardData,compareCardHeader> card_map = crate_data->getCardMap();
+    const crateData *crate_data = &(seb_it->second);            
+    const crateData::cardMap_t& card_map = crate_data->getCardMap();
     for(card_it = card_map.begin(); card_it != card_map.end(); card_it++){
       
       cardHeader card_header = (card_it->first);
       card_number = (card_header.getModule());
       
-      cardData *card_data = &(card_it->second);
+      const cardData *card_data = &(card_it->second);
       
-      std::map<int,channelData> channel_map = card_data->getChannelMap();
+      const cardData::channelMap_t& channel_map = card_data->getChannelMap();
       for(channel_it = channel_map.begin(); channel_it != channel_map.end(); channel_it++){
 	
 
@@ -190,7 +190,7 @@ int main(int argc, char** argv) {
 		      << ".C";
 
 
-	channelData *chD = &(channel_it->second);
+	const channelData *chD = &(channel_it->second);
 	int n_words = (int)(chD->getChannelDataSize()/sizeof(uint16_t));
 	
 	TH1F* htmp = new TH1F("htmp",(stream_hTitle.str()).c_str(),n_words,-0.5,(float)n_words+0.5);
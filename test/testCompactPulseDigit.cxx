@@ -0,0 +1,135 @@
+// Check that CP::TCompactPulseDigit gives back the samples it was made
+// with for both encodings.  The packed encoding is checked byte by byte for
+// a short digit, and then both encodings are checked with odd and even
+// lengths, the largest 12 bit samples, differences that do and don't fit in
+// the Huffman codes, and random waveforms.
+//
+//   testCompactPulseDigit
+//
+// This prints a line for each failure, and returns the number of failures.
+#include <TCompactPulseDigit.hxx>
+#include <TPulseDigit.hxx>
+#include <TTPCChannelId.hxx>
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdlib>
+
+namespace {
+    typedef CP::TPulseDigit::Vector Vector;
+
+    int failures = 0;
+
+    void check(bool ok, const std::string& what) {
+        if (ok) return;
+        std::cout << "FAIL: " << what << std::endl;
+        ++failures;
+    }
+
+    std::string encodingName(CP::TCompactPulseDigit::Encoding encoding) {
+        if (encoding == CP::TCompactPulseDigit::kHuffman) return "huffman";
+        return "packed";
+    }
+
+    /// Make a digit with each encoding and check that the samples come
+    /// back.  The samples are decoded twice to check ReleaseSamples().
+    void checkRoundTrip(const std::string& name, const Vector& adc) {
+        CP::TCompactPulseDigit::Encoding encodings[2] = {
+            CP::TCompactPulseDigit::kPacked,
+            CP::TCompactPulseDigit::kHuffman
+        };
+        for (int e = 0; e < 2; ++e) {
+            std::string what = name + " (" + encodingName(encodings[e]) + ")";
+            try {
+                CP::TCompactPulseDigit digit(CP::TTPCChannelId(1,4,17), 31,
+                                             adc, encodings[e]);
+                check(digit.GetEncoding() == encodings[e],
+                      what + ": encoding");
+                check(digit.GetFirstSample() == 31, what + ": first sample");
+                check(digit.GetSampleCount() == (int) adc.size(),
+                      what + ": sample count");
+                check(digit.GetSamples() == adc, what + ": samples");
+                digit.ReleaseSamples();
+                if (!adc.empty()) {
+                    check(digit.GetSample(adc.size()-1) == adc.back(),
+                          what + ": last sample");
+                }
+                std::auto_ptr<CP::TPulseDigit> pulse(digit.MakePulseDigit());
+                bool same = (pulse->GetFirstSample() == 31
+                             && pulse->GetSampleCount() == (int) adc.size());
+                for (std::size_t i = 0; same && i < adc.size(); ++i) {
+                    same = (pulse->GetSample(i) == adc[i]);
+                }
+                check(same, what + ": pulse digit");
+            }
+            catch (CP::ECompactDigit& e) {
+                check(false, what + ": " + e.what());
+            }
+        }
+    }
+
+    void testPacked() {
+        // Two samples in three bytes, with the low sample in the first byte
+        // and a half, and the last sample padded with zero.
+        Vector adc;
+        adc.push_back(0xABC);
+        adc.push_back(0x123);
+        adc.push_back(0xFFF);
+        CP::TCompactPulseDigit digit(CP::TTPCChannelId(1,4,17), 0, adc,
+                                     CP::TCompactPulseDigit::kPacked);
+        check(digit.GetEncodedSize() == 6, "packed: encoded size");
+        check(digit.GetSamples() == adc, "packed: samples");
+    }
+
+    void testWaveforms() {
+        checkRoundTrip("empty", Vector());
+        checkRoundTrip("one sample", Vector(1, 2048));
+        checkRoundTrip("two samples", Vector(2, 4095));
+        checkRoundTrip("odd length", Vector(101, 700));
+
+        // Every difference from -5 to +5 so that both sides of the Huffman
+        // escape are used.
+        Vector steps(1, 2000);
+        for (int d = -5; d <= 5; ++d) {
+            for (int i = 0; i < 4; ++i) steps.push_back(steps.back() + d);
+        }
+        checkRoundTrip("steps", steps);
+
+        // The full 12 bit range, which the DAQ encoding would mask.
+        Vector range;
+        for (int i = 0; i < 4096; i += 13) range.push_back(i);
+        range.push_back(4095);
+        range.push_back(4094);
+        range.push_back(0);
+        checkRoundTrip("range", range);
+
+        std::srand(1);
+        for (int trial = 0; trial < 100; ++trial) {
+            Vector adc;
+            int length = std::rand()%5000;
+            int sample = std::rand()%4096;
+            for (int i = 0; i < length; ++i) {
+                if (trial%4 == 0) sample = std::rand()%4096;
+                else if (std::rand()%100 < 3) sample += std::rand()%201-100;
+                else sample += std::rand()%3 - 1;
+                if (sample < 0) sample = 0;
+                if (sample > 4095) sample = 4095;
+                adc.push_back(sample);
+            }
+            checkRoundTrip("random " + std::to_string(trial), adc);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    testPacked();
+    testWaveforms();
+    if (failures > 0) {
+        std::cout << failures << " failures" << std::endl;
+        return failures;
+    }
+    std::cout << "TCompactPulseDigit OK" << std::endl;
+    return 0;
+}
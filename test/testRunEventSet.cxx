@@ -0,0 +1,120 @@
+// Check that CP::TRunEventSet::ReadFile() parses the skim files.  A file
+// is written with two and three column lines, comments, blank lines, a bad
+// line and a duplicate event, and the set is checked against what the
+// lines ask for (including the kAnySubRun matching of the two column
+// lines).  The set is then grown past its starting size to check that
+// nothing is lost when the table is rehashed.
+//
+//   testRunEventSet
+//
+// This prints a line for each failure, and returns the number of failures.
+#include <TRunEventSet.hxx>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+
+#include <unistd.h>
+
+namespace {
+    int failures = 0;
+
+    void check(bool ok, const std::string& what) {
+        if (ok) return;
+        std::cout << "FAIL: " << what << std::endl;
+        ++failures;
+    }
+
+    std::string eventName(int run, int subrun, int event) {
+        std::ostringstream name;
+        name << run << "/" << subrun << "/" << event;
+        return name.str();
+    }
+
+    void testReadFile() {
+        std::ostringstream fileName;
+        fileName << "testRunEventSet." << getpid() << ".skim";
+        {
+            std::ofstream skim(fileName.str().c_str());
+            skim << "# run event, or run subrun event" << std::endl
+                 << std::endl
+                 << "100 7" << std::endl
+                 << "100 2 8" << std::endl
+                 << "  101   3   9  " << std::endl
+                 << "100 7" << std::endl
+                 << "not an event" << std::endl
+                 << "102" << std::endl
+                 << "#103 1 1" << std::endl
+                 << "104 0 5";
+        }
+
+        CP::TRunEventSet set;
+        int added = set.ReadFile(fileName.str());
+        check(added == 4, "ReadFile count");
+        check(set.GetSize() == 4, "set size");
+
+        // Reading the file again doesn't add anything.
+        check(set.ReadFile(fileName.str()) == 0, "ReadFile count again");
+        check(set.GetSize() == 4, "set size again");
+        std::remove(fileName.str().c_str());
+
+        // The two column line matches every subrun.
+        const int any = CP::TRunEventSet::kAnySubRun;
+        int found[][3] = {
+            {100, 0, 7}, {100, 5, 7}, {100, any, 7},
+            {100, 2, 8}, {100, any, 8},
+            {101, 3, 9},
+            {104, 0, 5},
+        };
+        for (std::size_t i = 0; i < sizeof(found)/sizeof(found[0]); ++i) {
+            check(set.Contains(found[i][0], found[i][1], found[i][2]),
+                  "missing " + eventName(found[i][0], found[i][1],
+                                         found[i][2]));
+        }
+        int missing[][3] = {
+            {100, 3, 8}, {101, 2, 9}, {100, 0, 9}, {102, any, 0},
+            {103, 1, 1}, {104, 1, 5}, {7, any, 100},
+        };
+        for (std::size_t i = 0; i < sizeof(missing)/sizeof(missing[0]); ++i) {
+            check(!set.Contains(missing[i][0], missing[i][1], missing[i][2]),
+                  "unexpected " + eventName(missing[i][0], missing[i][1],
+                                            missing[i][2]));
+        }
+
+        CP::TRunEventSet empty;
+        check(empty.ReadFile("testRunEventSet.missing.skim") == 0,
+              "missing file");
+        check(empty.IsEmpty(), "missing file leaves the set empty");
+    }
+
+    void testGrow() {
+        CP::TRunEventSet set;
+        for (int event = 0; event < 10000; ++event) {
+            set.Insert(5000 + event%3, event%7, event);
+        }
+        check(set.GetSize() == 10000, "grown set size");
+        for (int event = 0; event < 10000; ++event) {
+            if (!set.Contains(5000 + event%3, event%7, event)) {
+                check(false, "grown set lost "
+                      + eventName(5000 + event%3, event%7, event));
+                break;
+            }
+        }
+        check(!set.Contains(5000, 1, 10000), "grown set extra event");
+        set.Clear();
+        check(set.IsEmpty() && !set.Contains(5000, 0, 0), "cleared set");
+    }
+}
+
+int main(int argc, char **argv) {
+    testReadFile();
+    testGrow();
+    if (failures > 0) {
+        std::cout << failures << " failures" << std::endl;
+        return failures;
+    }
+    std::cout << "TRunEventSet OK" << std::endl;
+    return 0;
+}
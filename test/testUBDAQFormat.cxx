@@ -0,0 +1,234 @@
+// Check that the crates written with CP::TUBDAQFormat are read back by the
+// uboone datatypes.  The Huffman encoder is checked word by word for each
+// of the -3 to +3 difference codes, and for the explicit words that are
+// used when the difference is too large.  The samples are then decoded
+// with channelData::decompress(), and a crate is unpacked with crateData
+// to check the card framing (the headers, word counts and checksums).
+//
+//   testUBDAQFormat
+//
+// This prints a line for each failure, and returns the number of failures.
+#include <TUBDAQFormat.hxx>
+
+#include "datatypes/crateData.h"
+#include "datatypes/cardData.h"
+#include "datatypes/cardHeader.h"
+#include "datatypes/channelData.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstring>
+#include <cstdlib>
+
+namespace {
+    namespace dt = gov::fnal::uboone::datatypes;
+
+    typedef CP::TUBDAQFormat::Words Words;
+
+    int failures = 0;
+
+    void check(bool ok, const std::string& what) {
+        if (ok) return;
+        std::cout << "FAIL: " << what << std::endl;
+        ++failures;
+    }
+
+    std::shared_ptr<char> makeBuffer(const Words& words) {
+        std::shared_ptr<char> buffer(new char[2*words.size()+2],
+                                     std::default_delete<char[]>());
+        if (!words.empty()) {
+            std::memcpy(buffer.get(), &words[0], 2*words.size());
+        }
+        return buffer;
+    }
+
+    /// Decode the words with the DAQ decoder.
+    Words decompress(const Words& data) {
+        dt::channelData channel(makeBuffer(data), 2*data.size(),
+                                0x4000, 0x5000);
+        channel.decompress();
+        const uint16_t* samples
+            = reinterpret_cast<const uint16_t*>(channel.getChannelDataPtr());
+        return Words(samples, samples + channel.getChannelDataSize()/2);
+    }
+
+    /// Encode the samples, and check the words if any are expected.  The
+    /// decoded samples must match the masked input.
+    void checkHuffman(const std::string& name, const Words& samples,
+                      const Words& expected = Words()) {
+        Words data;
+        CP::TUBDAQFormat::HuffmanEncode(samples, data);
+        if (!expected.empty()) {
+            check(data == expected, name + ": encoded words");
+        }
+        Words masked;
+        for (std::size_t i = 0; i < samples.size(); ++i) {
+            masked.push_back(samples[i] & CP::TUBDAQFormat::kSampleMask);
+        }
+        check(decompress(data) == masked, name + ": decoded samples");
+    }
+
+    void testCodes() {
+        // The DAQ code for a difference is a one after a number of zeros,
+        // and the first code ends at bit 15.
+        const int deltas[7] = {-3, -2, -1, 0, 1, 2, 3};
+        const int zeros[7] = {5, 3, 1, 0, 2, 4, 6};
+        for (int d = 0; d < 7; ++d) {
+            Words samples;
+            samples.push_back(1000);
+            samples.push_back(1000 + deltas[d]);
+            Words expected;
+            expected.push_back(1000);
+            expected.push_back(0x8000 | (1 << (15-zeros[d]-1)));
+            checkHuffman("delta " + std::to_string(deltas[d]), samples,
+                         expected);
+        }
+
+        // Fifteen zero differences fill a word, and the sixteenth starts
+        // the next one.
+        Words flat(17, 500);
+        Words expected;
+        expected.push_back(500);
+        expected.push_back(0xFFFF);
+        expected.push_back(0xC000);
+        checkHuffman("full word", flat, expected);
+
+        // A difference of four is saved as an explicit word, and the codes
+        // continue from the explicit sample.
+        Words jump;
+        jump.push_back(200);
+        jump.push_back(204);
+        jump.push_back(201);
+        jump.push_back(197);
+        expected.clear();
+        expected.push_back(200);
+        expected.push_back(204);
+        expected.push_back(0x8000 | (1 << (15-5-1)));
+        expected.push_back(197);
+        checkHuffman("explicit escape", jump, expected);
+
+        // The explicit words only keep the sample bits.
+        Words high;
+        high.push_back(0x0FFF);
+        high.push_back(0x0FFE);
+        checkHuffman("sample mask", high);
+
+        // A code that doesn't fit in the rest of a word goes to the next.
+        Words wide;
+        wide.push_back(100);
+        for (int i = 0; i < 6; ++i) {
+            wide.push_back(wide.back() + ((i%2) ? -3 : 3));
+        }
+        checkHuffman("word overflow", wide);
+
+        checkHuffman("empty", Words(), Words());
+    }
+
+    void testRandom() {
+        std::srand(1);
+        for (int trial = 0; trial < 100; ++trial) {
+            std::vector<int> samples;
+            int sample = 1000 + std::rand()%1000;
+            int length = std::rand()%2000;
+            for (int i = 0; i < length; ++i) {
+                int r = std::rand()%100;
+                if (r < 5) sample += std::rand()%41 - 20;
+                else sample += std::rand()%7 - 3;
+                if (sample < 0) sample = 0;
+                if (sample > CP::TUBDAQFormat::kSampleMask) {
+                    sample = CP::TUBDAQFormat::kSampleMask;
+                }
+                samples.push_back(sample);
+            }
+            Words data;
+            CP::TUBDAQFormat::HuffmanEncode(samples, data);
+            Words decoded = decompress(data);
+            check(decoded == Words(samples.begin(), samples.end()),
+                  "random trial " + std::to_string(trial));
+        }
+    }
+
+    void testCrate() {
+        // Two cards with a Huffman encoded channel each.
+        std::vector<Words> samples(2);
+        std::vector<Words> payloads(2);
+        for (int card = 0; card < 2; ++card) {
+            for (int i = 0; i < 100; ++i) {
+                samples[card].push_back(300 + card + (i%7) - 3*(i%2));
+            }
+            payloads[card].push_back(0x4000 | card);
+            CP::TUBDAQFormat::HuffmanEncode(samples[card], payloads[card]);
+            payloads[card].push_back(0x5000 | card);
+        }
+
+        Words crate;
+        CP::TUBDAQFormat::BeginCrate(crate);
+        CP::TUBDAQFormat::AddTPCCard(crate, 7, payloads[0]);
+        CP::TUBDAQFormat::AddTPCCard(crate, 5, payloads[1]);
+        CP::TUBDAQFormat::EndCrate(crate);
+
+        check(crate.size() >= 4 && crate[0] == 0xFFFF && crate[1] == 0xFFFF,
+              "crate start word");
+        check(crate.size() >= 4 && crate[crate.size()-2] == 0x0000
+              && crate[crate.size()-1] == 0xE000, "crate end word");
+
+        dt::crateData crateData(makeBuffer(crate), 2*crate.size());
+        try {
+            crateData.updateIOMode(dt::IO_GRANULARITY_CHANNEL);
+        }
+        catch (std::exception& e) {
+            check(false, std::string("crate unpacking: ") + e.what());
+            return;
+        }
+
+        const dt::crateData::cardMap_t& cards = crateData.getCardMap();
+        check(cards.size() == 2, "crate card count");
+        int modules[2] = {7, 5};
+        for (int card = 0; card < 2; ++card) {
+            std::string name = "card " + std::to_string(modules[card]);
+            dt::crateData::cardMap_t::const_iterator c = cards.begin();
+            while (c != cards.end()
+                   && (int) c->first.getModule() != modules[card]) ++c;
+            if (c == cards.end()) {
+                check(false, name + ": not found");
+                continue;
+            }
+            uint32_t checksum = 0;
+            for (std::size_t w = 0; w < payloads[card].size(); ++w) {
+                checksum += payloads[card][w];
+            }
+            check(c->first.getWordCount() == payloads[card].size()-1,
+                  name + ": word count");
+            check(c->first.getChecksum() == (checksum & 0xFFFFFF),
+                  name + ": checksum");
+            const dt::cardData::channelMap_t& channels
+                = c->second.getChannelMap();
+            dt::cardData::channelMap_t::const_iterator channel
+                = channels.find(card);
+            if (channels.size() != 1 || channel == channels.end()) {
+                check(false, name + ": channel not found");
+                continue;
+            }
+            dt::channelData data = channel->second;
+            data.decompress();
+            const uint16_t* words
+                = reinterpret_cast<const uint16_t*>(data.getChannelDataPtr());
+            check(Words(words, words + data.getChannelDataSize()/2)
+                  == samples[card], name + ": samples");
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    testCodes();
+    testRandom();
+    testCrate();
+    if (failures > 0) {
+        std::cout << failures << " failures" << std::endl;
+        return failures;
+    }
+    std::cout << "TUBDAQFormat OK" << std::endl;
+    return 0;
+}